@@ -0,0 +1,143 @@
+/*
+ * File AlignedRows.h: aligned sequences handed from ClustalW, ClustalOmega,
+ * and MUSCLE to R
+ *
+ * The engines write the rows of the final alignment into one block of
+ * nseq * alen characters (no terminators) in output order, together with
+ * the sequence names and the version string. AlnRowsToR() turns this into
+ * the list(msa=<named character vector>, version=<string>) returned by the
+ * .Call() interfaces; every row is copied exactly once, into its CHARSXP,
+ * and nothing needs to be parsed in R.
+ *
+ * Everything is defined in this header (static inline functions) so that it
+ * can be used by the C and C++ sources of all three libraries. AlnRowsToR()
+ * is only defined if Rinternals.h (or Rcpp.h) was included before; the R
+ * interfaces include this header once more after the R headers.
+ */
+
+#ifndef _AlignedRows_H_
+
+#define _AlignedRows_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define ALN_ROWS_VERSION_LEN 128
+
+typedef struct {
+    size_t nseq;
+    size_t alen;
+    char *seqs;    /* row i starts at seqs + i * alen */
+    char **names;
+    char version[ALN_ROWS_VERSION_LEN];
+} aln_rows_t;
+
+static inline void AlnRowsInit(aln_rows_t *a)
+{
+    a->nseq = a->alen = 0;
+    a->seqs = NULL;
+    a->names = NULL;
+    a->version[0] = '\0';
+}
+
+static inline void AlnRowsFree(aln_rows_t *a)
+{
+    size_t i;
+
+    if (NULL != a->names) {
+        for (i = 0; i < a->nseq; i++)
+            free(a->names[i]);
+        free(a->names);
+    }
+    free(a->seqs);
+    AlnRowsInit(a);
+}
+
+/*
+ * Frees the previous contents and allocates nseq rows of alen characters
+ * and nseq (empty) names. Returns -1 if out of memory.
+ */
+static inline int AlnRowsAlloc(aln_rows_t *a, size_t nseq, size_t alen)
+{
+    AlnRowsFree(a);
+    a->seqs = (char *) malloc(nseq * alen + 1);
+    a->names = (char **) calloc(nseq + 1, sizeof(char *));
+    if (NULL == a->seqs || NULL == a->names) {
+        free(a->seqs);
+        free(a->names);
+        AlnRowsInit(a);
+        return -1;
+    }
+    a->nseq = nseq;
+    a->alen = alen;
+    return 0;
+}
+
+static inline char *AlnRowsRow(aln_rows_t *a, size_t i)
+{
+    return a->seqs + i * a->alen;
+}
+
+/*
+ * Sets the name of row i to the first word of name (like the ids of an
+ * aln file). Returns -1 if out of memory.
+ */
+static inline int AlnRowsSetName(aln_rows_t *a, size_t i, const char *name)
+{
+    size_t len = 0;
+
+    while (name[len] != '\0' && !isspace((unsigned char) name[len]))
+        len++;
+    free(a->names[i]);
+    if (NULL == (a->names[i] = (char *) malloc(len + 1)))
+        return -1;
+    memcpy(a->names[i], name, len);
+    a->names[i][len] = '\0';
+    return 0;
+}
+
+static inline void AlnRowsSetVersion(aln_rows_t *a, const char *version)
+{
+    strncpy(a->version, version, ALN_ROWS_VERSION_LEN - 1);
+    a->version[ALN_ROWS_VERSION_LEN - 1] = '\0';
+}
+
+#endif
+
+#if defined(R_INTERNALS_H_) && !defined(_AlignedRows_R_H_)
+
+#define _AlignedRows_R_H_
+
+/*
+ * Returns list(msa=<character vector of the rows, named by the sequence
+ * names>, version=<version string>).
+ */
+static inline SEXP AlnRowsToR(const aln_rows_t *a)
+{
+    SEXP out, msa, names, listNames;
+    size_t i;
+
+    PROTECT(out = Rf_allocVector(VECSXP, 2));
+    PROTECT(msa = Rf_allocVector(STRSXP, (R_xlen_t) a->nseq));
+    PROTECT(names = Rf_allocVector(STRSXP, (R_xlen_t) a->nseq));
+    for (i = 0; i < a->nseq; i++) {
+        SET_STRING_ELT(msa, (R_xlen_t) i,
+                       Rf_mkCharLenCE(a->seqs + i * a->alen, (int) a->alen, CE_NATIVE));
+        SET_STRING_ELT(names, (R_xlen_t) i,
+                       Rf_mkChar(NULL != a->names[i] ? a->names[i] : ""));
+    }
+    Rf_setAttrib(msa, R_NamesSymbol, names);
+    SET_VECTOR_ELT(out, 0, msa);
+    SET_VECTOR_ELT(out, 1, Rf_mkString(a->version));
+
+    PROTECT(listNames = Rf_allocVector(STRSXP, 2));
+    SET_STRING_ELT(listNames, 0, Rf_mkChar("msa"));
+    SET_STRING_ELT(listNames, 1, Rf_mkChar("version"));
+    Rf_setAttrib(out, R_NamesSymbol, listNames);
+
+    UNPROTECT(4);
+    return out;
+}
+
+#endif
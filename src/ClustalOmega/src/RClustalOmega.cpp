@@ -36,6 +36,7 @@
 #include <R.h>
 #include <Rinternals.h>
 #include <Rdefines.h>
+#include "../../AlignedRows.h"
 
 extern "C" {
 #include "mymain.h"
@@ -396,6 +397,7 @@ SEXP RClustalOmega(SEXP rInputSeqs,
         }
 
         ClustalOmegaOutput msaOutput;
+        AlnRowsInit(&msaOutput.msa);
         executeClustalOmega(argc, argv, &msaInput, &msaOutput);
 
         for (int i = 0; i < argc; i++) {
@@ -411,16 +413,8 @@ SEXP RClustalOmega(SEXP rInputSeqs,
         }
 
 
-        vector<string> result;
-        for (int i = 0; i < msaOutput.msa_c; i++) {
-            result.push_back(msaOutput.msa_v[i]);
-            //Rprintf("free %i - %s\n", i, msaOutput.msa_v[i]);
-            free(msaOutput.msa_v[i]);
-        }
-        free((msaOutput.msa_v));
-
-        retList = Rcpp::List::create(Rcpp::Named("msa") =
-                Rcpp::CharacterVector(result.begin(), result.end()));
+        retList = AlnRowsToR(&msaOutput.msa);
+        AlnRowsFree(&msaOutput.msa);
 
     } catch(int i) {
         if (i == 0) {
@@ -111,16 +111,6 @@
  */
 
 
-/* the following are temporary flags while the code is still under construction;
-   had problems internalising hhmake, so as temporary crutch 
-   write alignment to file and get external hmmer/hhmake via system call 
-   to read alignment and convert into HMM
-   All this will go, once hhmake is properly internalised */
-#define INDIRECT_HMM 0 /* temp flag: (1) write aln to file, use system(hmmer/hhmake), (0) internal hhmake */
-#define USEHMMER 1 /* temp flag: use system(hmmer) to build HMM */
-#define USEHHMAKE (!USEHMMER) /* temp flag: use system(hhmake) to build HMM */
-
-
 /* shuffle order of input sequences */
 #define SHUFFLE_INPUT_SEQ_ORDER 0
 
@@ -310,304 +300,36 @@ PrintAlnOpts(FILE *prFile, opts_t *prOpts)
 
 
 
-/**
- * @brief Returns major version of HMMER. Whichever hmmbuild version
- * is found first in your PATH will be used
- *
- * @return -1 on error, major hmmer version otherwise
- *
- */
-int
-HmmerVersion()
-{
-    char zcHmmerTestCall[] = "hmmbuild -h";
-    FILE *fp = NULL;
-    int iMajorVersion = 0;
-    char zcLine[16384];
-
-    if (NULL == (fp = popen(zcHmmerTestCall, "r"))) {
-        Log(&rLog, LOG_ERROR, "Couldn't exec %s", zcHmmerTestCall);
-        return -1;
-    }
-    while (fgets(zcLine, sizeof(zcLine), fp)) {
-        char *pcLocate;
-        if ((pcLocate = strstr(zcLine, "HMMER "))) {
-            iMajorVersion = atoi(&pcLocate[6]);
-            break;
-        }
-    }
-    pclose(fp);
-
-    return iMajorVersion;
-}
-/* end of HmmerVersion() */
-
-
-
-/**
- * @brief Create a HHM file from aligned sequences
- *
- * @warning Should be eliminated in the future 
- * as building routine should not create intermediate files
- *
- * @param[in] prMSeq
- * Aligned mseq_t
- * @param[in] pcHMMOut
- * HMM output file name
- *
- * @return Non-zero on error
- *
- */
-int
-AlnToHHMFile(mseq_t *prMSeq, char *pcHMMOut)
-{
-    char *tmp_aln = NULL;
-    int retcode = OK;
-
-    int msa_c = 0;
-    char **msa_v = NULL;
-
-    assert(NULL!=prMSeq);
-    assert(NULL!=pcHMMOut);
-
-    if (FALSE == prMSeq->aligned) {
-        Log(&rLog, LOG_ERROR, "Sequences need to be aligned to create an HMM");
-        return FAILURE;
-    }
-
-    /* Convert alignment to a2m, and call hhmake
-     *
-     * can't be static templates, or mktemp fails (at least on os x
-     * (with a bus error))
-     * 
-     * gcc says we should use mkstemp to avoid race conditions, 
-     * but that returns a file descriptor, which is of no use to 
-     * us  
-     */
-    /* NOTE: the following won't work on windows: missing /tmp/ */
-    tmp_aln = CkStrdup("/tmp/clustalo_tmpaln_XXXXXX");
-    if (NULL == mktemp(tmp_aln)) {
-        Log(&rLog, LOG_ERROR, "Could not create temporary alignment filename");
-        retcode = FAILURE;
-        goto cleanup_and_return;
-    }
-#define LINE_WRAP 60
-
-    if (WriteAlignment(prMSeq, tmp_aln, MSAFILE_A2M, LINE_WRAP, FALSE, &msa_c, &msa_v)) {
-        Log(&rLog, LOG_ERROR, "Could not save alignment to %s", tmp_aln);
-        retcode = FAILURE;
-        goto cleanup_and_return;
-    }
-
-    if (HHMake_Wrapper(tmp_aln, pcHMMOut)){
-        Log(&rLog, LOG_ERROR, "Could not convert alignment %s into HHM", tmp_aln);
-        retcode = FAILURE;
-        goto cleanup_and_return;
-    }
-
-
- cleanup_and_return:
-
-    if (NULL != tmp_aln) {
-        if (FileExists(tmp_aln)) {
-            if (remove(tmp_aln)) {
-                Log(&rLog, LOG_WARN, "Removing %s failed. Continuing anyway", tmp_aln);
-            }
-        }
-        CKFREE(tmp_aln);
-    }
-
-    return retcode; 
-
-} /* end of AlnToHHMFile() */
-
-
-
-/**
- * @brief Create a HMM file from aligned sequences
- *
- * @warning Should be replaced in the future by some internal HMM
- * building routine that does not call external programs
- *
- * @param[in] prMSeq
- * Aligned mseq_t
- * @param[in] pcHMMOut
- * HMM output file name
- *
- * @return Non-zero on error
- *
-
- */
-int
-AlnToHMMFile(mseq_t *prMSeq, const char *pcHMMOut)
-{
-    char *tmp_aln = NULL;
-    char *tmp_hmm = NULL; /* only needed for hmmer3 to hmmer2 conversion */
-    char cmdbuf[16384];
-    int iHmmerVersion = 0;
-    int retcode = OK;
-    
-    int msa_c = 0;
-    char **msa_v = NULL;
-
-    assert(NULL!=prMSeq);
-    assert(NULL!=pcHMMOut);
-
-    if (FALSE == prMSeq->aligned) {
-        Log(&rLog, LOG_ERROR, "Sequences need to be aligned to create an HMM");
-        return FAILURE;
-    }
-
-    iHmmerVersion = HmmerVersion();
-    if (2 != iHmmerVersion && 3 != iHmmerVersion) {
-        Log(&rLog, LOG_ERROR, "Could not find suitable HMMER binaries");
-        return FAILURE;
-    }
-
-    /* Convert alignment to stockholm, call hmmbuild and then
-     * either hmmconvert (hmmer3) or hmmcalibrate (hmmer2)
-     *
-     * can't be static templates, or mktemp fails (at least on os x
-     * (with a bus error))
-     *
-     * gcc says we should use mkstemp to avoid race conditions,
-     * but that returns a file descriptor, which is of no use to
-     * us
-     */
-    /* NOTE: the following won't work on windows: missing /tmp/ */
-    tmp_aln = CkStrdup("/tmp/clustalo_tmpaln_XXXXXX");
-    if (NULL == mktemp(tmp_aln)) {
-        Log(&rLog, LOG_ERROR, "Could not create temporary alignment filename");
-        retcode = FAILURE;
-        goto cleanup_and_return;
-    }
-#define LINE_WRAP 60
-    if (WriteAlignment(prMSeq, tmp_aln, MSAFILE_STOCKHOLM, LINE_WRAP, FALSE, &msa_c, &msa_v)) {
-        Log(&rLog, LOG_ERROR, "Could not save alignment to %s", tmp_aln);
-        retcode = FAILURE;
-        goto cleanup_and_return;
-    }
-
-    if (2 == iHmmerVersion) {
-        sprintf(cmdbuf, "hmmbuild %s %s >/dev/null && hmmcalibrate %s >/dev/null",
-                pcHMMOut, tmp_aln, pcHMMOut);
-        if (system(cmdbuf)) {
-            Log(&rLog, LOG_ERROR, "Command '%s' failed", cmdbuf);
-            retcode = FAILURE;
-            goto cleanup_and_return;
-        }
-    } else if (3 == iHmmerVersion) {
-        /* NOTE: the following won't work on windows: missing /tmp/ */
-        tmp_hmm = CkStrdup("/tmp/clustalo_tmphmm2_XXXXXX");
-        if (NULL == mktemp(tmp_hmm)) {
-            Log(&rLog, LOG_ERROR, "Could not create temporary hmm filename");
-            retcode = FAILURE;
-            goto cleanup_and_return;
-        }
-        sprintf(cmdbuf, "hmmbuild %s %s >/dev/null && hmmconvert -2 %s > %s",
-                tmp_hmm, tmp_aln, tmp_hmm, pcHMMOut);
-        if (system(cmdbuf)) {
-            Log(&rLog, LOG_ERROR, "Command '%s' failed", cmdbuf);
-            retcode = FAILURE;
-            goto cleanup_and_return;
-        }
-    } else {
-        CKFREE(tmp_aln);
-        Log(&rLog, LOG_FATAL, "Internal error: Unknown Hmmer version %d", iHmmerVersion);
-    }
-
-
- cleanup_and_return:
-
-    if (NULL != tmp_aln) {
-        if (FileExists(tmp_aln)) {
-            if (remove(tmp_aln)) {
-                Log(&rLog, LOG_WARN, "Removing %s failed. Continuing anyway", tmp_aln);
-            }
-        }
-        CKFREE(tmp_aln);
-    }
-    if (NULL != tmp_hmm) {
-        if (FileExists(tmp_hmm)) {
-            if (remove(tmp_hmm)) {
-                Log(&rLog, LOG_WARN, "Removing %s failed. Continuing anyway", tmp_hmm);
-            }
-        }
-        CKFREE(tmp_hmm);
-    }
-
-    return retcode;
-}
-/* end of AlnToHMMFile() */
-
-
-
 /**
  * @brief Convert a multiple sequence structure into a HMM
  *
+ * The HMM is built in memory by hhalign (frequencies, transitions and
+ * pseudocounts as in hhmake); no intermediate files are written.
+ *
  * @param[out] prHMM
  * Pointer to preallocted HMM which will be set here
  * @param[in] prMSeq
  * Pointer to an alignment
  *
- * @return 0 on error, non-0 otherwise
+ * @return Non-zero on error
  *
- * @see AlnToHMMFile()
- * 
  */    
 int
 AlnToHMM(hmm_light *prHMM, mseq_t *prMSeq)
 {
-    char *pcHMM; /* temp hmm file */
-
-    Log(&rLog, LOG_INFO,
-        "Using HMMER version %d to calculate a new HMM.",
-         HmmerVersion());
-    /* FIXME replace all this with internal HMM computation (HHmake) */
+    assert(NULL!=prHMM);
+    assert(NULL!=prMSeq);
 
-    /**
-     * @warning the following probably won't work on windows: missing
-     * /tmp/. Should be ok on Cygwin though
-     */
-    pcHMM = CkStrdup("/tmp/clustalo-hmm-iter_XXXXXX");
-    if (NULL == mktemp(pcHMM)) {
-        Log(&rLog, LOG_ERROR, "Could not create temporary hmm filename");
-        CKFREE(pcHMM);
-        return FAILURE;
-    }
-    
-    /* Create a HMM representing the current alignment
-     */
-#if USEHMMER
-    if (AlnToHMMFile(prMSeq, pcHMM)) {
-        Log(&rLog, LOG_ERROR, "AlnToHMMFile() on %s failed.", pcHMM);
-        CKFREE(pcHMM);
-        return FAILURE;
-    }
-#elif USEHHMAKE
-    if (AlnToHHMFile(prMSeq, pcHMM)) {
-        Log(&rLog, LOG_ERROR, "AlnToHHMFile() on %s failed.", pcHMM);
-        CKFREE(pcHMM);
+    if (FALSE == prMSeq->aligned) {
+        Log(&rLog, LOG_ERROR, "Sequences need to be aligned to create an HMM");
         return FAILURE;
     }
-    /* Log(&rLog, LOG_FATAL, "Method to create HHM (HMM using hhmake) not installed yet"); */
-#else
-    Log(&rLog, LOG_FATAL, "Unknown method to create temporary HMM");
-#endif
-    
-    /* Read HMM information
-     */
-    if (OK != readHMMWrapper(prHMM, pcHMM)){
-        Log(&rLog, LOG_ERROR, "Processing of HMM file %s failed", pcHMM);
-        CKFREE(pcHMM);
+
+    if (OK != AlnToHMM2(prHMM, prMSeq->seq, prMSeq->nseqs)) {
+        Log(&rLog, LOG_ERROR, "Could not convert alignment into HMM");
         return FAILURE;
     }
 
-    if (remove(pcHMM)) {
-        Log(&rLog, LOG_WARN, "Removing %s failed. Continuing anyway", pcHMM);
-    }
-    CKFREE(pcHMM);
-        
     return OK; 
 }
 /* end of AlnToHMM() */
@@ -1090,13 +812,7 @@ Align(mseq_t *prMSeq,
         /* certain gap parameters ('~' MSF) cause problems, 
            sanitise them; FS, r258 -> r259 */
         SanitiseUnknown(prMSeq);
-        if (OK !=
-#if INDIRECT_HMM 
-            AlnToHMM(&rHMMLocal, prMSeq)
-#else
-            AlnToHMM2(&rHMMLocal, prMSeq->seq, prMSeq->nseqs)
-#endif
-            ) {
+        if (OK != AlnToHMM(&rHMMLocal, prMSeq)) {
             Log(&rLog, LOG_ERROR, "Couldn't convert aligned input sequences to HMM. Will try to continue");
         } else {
             prHMMs = (hmm_light *) CKREALLOC(prHMMs, ((prOpts->iHMMInputFiles+1) * sizeof(hmm_light)));
@@ -1115,13 +831,7 @@ Align(mseq_t *prMSeq,
         hmm_light rHMMLocal = {0};
         Log(&rLog, LOG_INFO,
             "Turning profile1 into HMM and will use it during progressive alignment.");
-        if (OK !=
-#if INDIRECT_HMM 
-            AlnToHMM(&rHMMLocal, prMSeqProfile)
-#else 
-            AlnToHMM2(&rHMMLocal, prMSeqProfile->seq, prMSeqProfile->nseqs)
-#endif
-            ) {
+        if (OK != AlnToHMM(&rHMMLocal, prMSeqProfile)) {
             Log(&rLog, LOG_ERROR, "Couldn't convert profile1 to HMM. Will try to continue");
         } else {
             prHMMs = (hmm_light *) CKREALLOC(prHMMs, ((prOpts->iHMMInputFiles+1) * sizeof(hmm_light)));
@@ -1233,7 +943,7 @@ Align(mseq_t *prMSeq,
             char *pcFormat = "fasta";
             sprintf(zcIntermediate, "clustalo-aln-iter~%d~", iIterationCounter);
 #define LINE_WRAP 60
-            if (WriteAlignment(prMSeq, zcIntermediate, MSAFILE_A2M, LINE_WRAP, &msa_c, &msa_v)) {
+            if (WriteAlignment(prMSeq, zcIntermediate, MSAFILE_A2M, LINE_WRAP, FALSE, NULL)) {
                 Log(&rLog, LOG_ERROR, "Could not save alignment to %s", zcIntermediate);
                 return -1;
             }
@@ -1278,19 +988,13 @@ Align(mseq_t *prMSeq,
         /* new local hmm iteration
          *
          */
-        /* non-residue/gap characters will crash AlnToHMM2(), 
+        /* non-residue/gap characters will crash AlnToHMM(), 
            therefore sanitise unknown characters, FS, r259 -> r260 */
         SanitiseUnknown(prMSeq);
         if (iIterationCounter < prOpts->iMaxHMMIterations) {
             Log(&rLog, LOG_INFO, "Computing HMM from alignment");
             
-            if (OK !=
-#if INDIRECT_HMM 
-                AlnToHMM(&rHMMLocal, prMSeq)
-#else
-                AlnToHMM2(&rHMMLocal, prMSeq->seq, prMSeq->nseqs)
-#endif
-                ) {
+            if (OK != AlnToHMM(&rHMMLocal, prMSeq)) {
                 Log(&rLog, LOG_ERROR, "Couldn't convert alignment to HMM. Will stop iterating now...");
                 break;
             }
@@ -27,6 +27,9 @@
 #include <assert.h>
 #include <ctype.h>
 #include <stdbool.h>
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #include "seq.h"
 #include "tree.h"
@@ -461,6 +464,656 @@ PrepareAlignment(mseq_t *mseq, char **ppcProfile1, char **ppcProfile2,
 } /*** end: PrepareAlignment() ***/
 
 
+/**
+ * @brief Aligns the profiles of two nodes of the guide tree and
+ * stores the leaves of both as the leaves of the parent node.
+ *
+ * Only the sequences below the two nodes and the entries iL, iR, iP
+ * of piLeafCount/ppiLeafList are touched, so that nodes whose
+ * subtrees are disjoint can be merged at the same time (see
+ * MergeNodesParallel()).
+ *
+ * @param[in,out] prMSeq
+ * the sequences, the ones below iL and iR are aligned here
+ * @param[in] iL
+ * left node
+ * @param[in] iR
+ * right node
+ * @param[in] iP
+ * parent node
+ * @param[in,out] piLeafCount
+ * number of leaves beneath a node
+ * @param[in,out] ppiLeafList
+ * list of leaves beneath a node
+ * @param[in] pdSeqWeights
+ * Weight per sequence. No weights used if NULL
+ * @param[out] pdScores
+ * scores of the alignments to the background HMM (per sequence)
+ * @param[in] prHMM
+ * background HMM, not used if prHMM->L is 0
+ * @param[in] rHhalignPara
+ * various parameters read from commandline
+ * @param[out] pdScore
+ * score of the alignment of the two profiles
+ * @param[out] pcError
+ * error message if the profiles could not be aligned
+ *
+ * @return 0 on success, non-zero if the profiles could not be aligned
+ */
+static int
+MergeProfiles(mseq_t *prMSeq, int iL, int iR, int iP,
+              int *piLeafCount, int **ppiLeafList,
+              double *pdSeqWeights, double *pdScores,
+              hmm_light *prHMM, hhalign_para rHhalignPara,
+              double *pdScore, char *pcError)
+{
+    char **ppcProfile1 = NULL; /* pointer to sequences in profile */
+    char **ppcProfile2 = NULL; /* pointer to sequences in profile */
+    char *pcReprsnt1 = NULL; /* representative of HMM aligned to left */
+    char *pcReprsnt2 = NULL; /* representative of HMM aligned to right */
+    char **ppcReprsnt1 = &pcReprsnt1; /* representative of HMM aligned to L */
+    char **ppcReprsnt2 = &pcReprsnt2; /* representative of HMM aligned to R */
+    char *pcConsens1 = NULL; /* copy of  left sequence */
+    char *pcConsens2 = NULL; /* copy of right sequence */
+    char **ppcCopy1 = NULL; /* copy of  left sequences */
+    char **ppcCopy2 = NULL; /* copy of right sequences */
+    double *pdWeightsL = NULL; /* sequence weights of left  profile */
+    double *pdWeightsR = NULL; /* sequence weights of right profile */
+    double dScore = 0.0; /* alignment score (seq/HMM) */
+    int iAux_FS = 0;
+    char zcAux[10000] = {0};
+    char zcError[10000] = {0};
+    hhalign_scores rHHscores = {0};
+    int iRetVal = 0;
+    int i, j; /* aux */
+
+    ppcProfile1 = CKCALLOC(piLeafCount[iL]+1, sizeof(char *));
+    ppcProfile2 = CKCALLOC(piLeafCount[iR]+1, sizeof(char *));
+    pdWeightsL  = CKCALLOC(piLeafCount[iL], sizeof(double));
+    pdWeightsR  = CKCALLOC(piLeafCount[iR], sizeof(double));
+
+    piLeafCount[iP] = piLeafCount[iL] + piLeafCount[iR];
+    ppiLeafList[iP] = (int *)CKMALLOC(piLeafCount[iP] * sizeof(int));
+
+    for (i = j = 0; i < piLeafCount[iL]; i++, j++){
+        ppiLeafList[iP][j] = ppiLeafList[iL][i];
+    }
+    for (i = 0; i < piLeafCount[iR]; i++, j++){
+        ppiLeafList[iP][j] = ppiLeafList[iR][i];
+    }
+
+    /* prepare simulation arena:
+     * - make sure enough memory in sequences
+     * - attach sequence pointers to profiles
+     */
+    /* idea: switch template and query according to nseq? */
+
+    PrepareAlignment(prMSeq, ppcProfile1, ppcProfile2,
+                     pdWeightsL, pdWeightsR, pdSeqWeights,
+                     piLeafCount[iL], ppiLeafList[iL],
+                     piLeafCount[iR], ppiLeafList[iR]);
+    if (rLog.iLogLevelEnabled <= LOG_DEBUG){
+        int i;
+        FILE *fp = LogGetFP(&rLog, LOG_DEBUG);
+        Log(&rLog, LOG_DEBUG, "merging profiles %d & %d", iL, iR);
+        for (i = 0; i < piLeafCount[iL]; i++){
+            fprintf(fp, "L/#=%3d (ID=%3d, w=%f): %s\n",
+                   i, ppiLeafList[iL][i], pdWeightsL[i], ppcProfile1[i]);
+        }
+        for (i = 0; i < piLeafCount[iR]; i++){
+            fprintf(fp, "R/#=%3d (ID=%3d, w=%f): %s\n",
+                   i, ppiLeafList[iR][i], pdWeightsR[i], ppcProfile2[i]);
+        }
+    }
+
+
+    
+    /* align individual sequences to HMM;
+     * - use representative sequence to get gapping
+     * - create copies of both, individual/representative sequences
+     *   as we don't want to introduce gaps into original
+     *
+     * FIXME: representative sequence is crutch, should use
+     * full HMM but that does not seem to work at all
+     * -- try harder! Fail better!
+     */
+    if ( (piLeafCount[iL] <= APPLY_BG_HMM_UP_TO_TREE_DEPTH) && (0 != prHMM->L) ){
+        int i, j;
+        pcReprsnt1 = CKCALLOC(prHMM->L+strlen(ppcProfile1[0])+1, sizeof(char));
+        for (i = 0; i < prHMM->L; i++){
+            pcReprsnt1[i] = prHMM->seq[prHMM->ncons][i+1];
+        }
+        ppcCopy1 = CKCALLOC(piLeafCount[iL], sizeof(char *));
+        for (j = 0; j < piLeafCount[iL]; j++){
+            ppcCopy1[j] = CKCALLOC(prHMM->L+strlen(ppcProfile1[0])+1, sizeof(char));
+            for (i = 0; i < (int) strlen(ppcProfile1[0]); i++){
+                ppcCopy1[j][i] = ppcProfile1[j][i];
+            }
+        }
+
+        {
+            /* the size of the elements in the forward/backward matrices 
+               depends very much on the lengths of the profiles _and_ 
+               in which position (1st/2nd) the longer/shorter profile/HMM is.
+               the matrix elements can easily exceed the size of a (long?) double
+               if the longer profile/HMM is associated with the query (q) and the 
+               shorter with the target (t). 
+               FIXME: however, pseudo-count adding may also depend on position, 
+               this is only really tested for the HMM being in the 1st position (q)
+               MUST TEST THIS MORE THOROUGHLY
+
+               this switch appears to be most easily (although unelegantly) 
+               effected here. Don't want to do it (upstairs) in PrepareAlignment() 
+               because it might jumble up the nodes. Don't want to do it in hhalign() 
+               either because ppcProfile1/2 and q/t may be used independently.
+               FS, r236 -> r237
+            */
+            int iLenA = strlen(ppcCopy1[0]);
+            int iLenH = prHMM->L;
+            int iHHret = 0;
+            
+            if (iLenH < iLenA){
+                iHHret = hhalign(ppcReprsnt1, 0/* only one representative seq*/, NULL,
+                                 ppcCopy1, piLeafCount[iL], pdWeightsL,
+                                 &dScore, prHMM,
+                                 NULL, NULL, NULL, NULL,
+                                 rHhalignPara, &rHHscores, 
+                                 iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                                 zcAux, zcError);
+            }
+            else {
+                iHHret = hhalign(ppcCopy1, piLeafCount[iL], pdWeightsL,
+                                 ppcReprsnt1, 0/* only one representative seq*/, NULL,
+                                 &dScore, prHMM,
+                                 NULL, NULL, NULL, NULL,
+                                 rHhalignPara, &rHHscores, 
+                                 iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                                 zcAux, zcError);
+            }
+            if ( (0 != iHHret) && (rLog.iLogLevelEnabled <= LOG_VERBOSE) ){ /* FS, r255 -> */
+                fprintf(stderr, "%s:%s:%d: (not essential) HMM pre-alignment failed, error %d, \n"
+                        "\t#=%d (len=%d), lead-seq=%s, len(HMM)=%d\n%s\nCARRY ON REGARDLESS\n", 
+                        __FUNCTION__, __FILE__, __LINE__, iHHret, 
+                        piLeafCount[iL], (int)strlen(ppcCopy1[0]), prMSeq->sqinfo[ppiLeafList[iL][0]].name, 
+                        (int)strlen(ppcReprsnt1[0]), zcError);
+            }
+        }
+        pdScores[ppiLeafList[iL][0]] = dScore;
+#if 0
+        printf("score: %f\nL: %s\nH: %s\n",
+               dScore, ppcCopy1[0], ppcReprsnt1[0]);
+#endif
+        /* assemble 'consensus';
+         * this is not a real consensus, it is more a gap indicator,
+         * for each position it consists of residues/gaps in the 1st sequences,
+         * or a residue (if any) of the other sequences.
+         * it only contains a gap if all sequences of the profile
+         * have a gap at this position
+         */
+        pcConsens1 = CKCALLOC(prHMM->L+strlen(ppcProfile1[0])+1, sizeof(char));
+        for (i = 0; i < prHMM->L; i++){
+            for (j = 0, pcConsens1[i] = '-'; (j < piLeafCount[iL]) && ('-' == pcConsens1[i]); j++){
+                pcConsens1[i] = ppcCopy1[j][i];
+            }
+        }
+#if 0
+        for (j = 0; (j < piLeafCount[iL]); j++){
+            printf("L%d:%s\n", j, ppcCopy1[j]);
+        }
+        printf("LC:%s\n", pcConsens1);
+#endif
+    } /* ( (1 == piLeafCount[iL]) && (0 != prHMM->L) ) */
+
+    if ( (piLeafCount[iR] <= APPLY_BG_HMM_UP_TO_TREE_DEPTH) && (0 != prHMM->L) ){
+        int i, j;
+
+        pcReprsnt2 = CKCALLOC(prHMM->L+strlen(ppcProfile2[0])+1, sizeof(char));
+        for (i = 0; i < prHMM->L; i++){
+            pcReprsnt2[i] = prHMM->seq[prHMM->ncons][i+1];
+        }
+        ppcCopy2 = CKCALLOC(piLeafCount[iR], sizeof(char *));
+        for (j = 0; j < piLeafCount[iR]; j++){
+            ppcCopy2[j] = CKCALLOC(prHMM->L+strlen(ppcProfile2[0])+1, sizeof(char));
+            for (i = 0; i < (int) strlen(ppcProfile2[0]); i++){
+                ppcCopy2[j][i] = ppcProfile2[j][i];
+            }
+        }
+
+        {
+            /* the size of the elements in the forward/backward matrices 
+               depends very much on the lengths of the profiles _and_ 
+               in which position (1st/2nd) the longer/shorter profile/HMM is.
+               the matrix elements can easily exceed the size of a (long?) double
+               if the longer profile/HMM is associated with the query (q) and the 
+               shorter with the target (t). 
+               FIXME: however, pseudo-count adding may also depend on position, 
+               this is only really tested for the HMM being in the 1st position (q)
+               MUST TEST THIS MORE THOROUGHLY
+               
+               this switch appears to be most easily (although unelegantly) 
+               effected here. Don't want to do it (upstairs) in PrepareAlignment() 
+               because it might jumble up the nodes. Don't want to do it in hhalign() 
+               either because ppcProfile1/2 and q/t may be used independently.
+               FS, r236 -> r237
+            */
+            int iLenA = strlen(ppcCopy2[0]);
+            int iLenH = prHMM->L;
+            int iHHret = 0;
+
+            if (iLenH < iLenA){
+                iHHret = hhalign(ppcReprsnt2, 0/* only one representative seq */, NULL,
+                                 ppcCopy2,    piLeafCount[iR], pdWeightsR,
+                                 &dScore, prHMM,
+                                 NULL, NULL, NULL, NULL,
+                                 rHhalignPara, &rHHscores, 
+                                 iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                                 zcAux, zcError);
+            }
+            else {
+                iHHret = hhalign(ppcCopy2,    piLeafCount[iR], pdWeightsR,
+                                 ppcReprsnt2, 0/* only one representative seq */, NULL,
+                                 &dScore, prHMM,
+                                 NULL, NULL, NULL, NULL,
+                                 rHhalignPara, &rHHscores, 
+                                 iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                                 zcAux, zcError);
+            }
+            if ( (0 != iHHret) && (rLog.iLogLevelEnabled <= LOG_VERBOSE) ){ /* FS, r255 -> */
+                fprintf(stderr, "%s:%s:%d: (not essential) HMM pre-alignment failed, error %d, \n"
+                        "\t#=%d (len=%d), lead-seq=%s, len(HMM)=%d\n%s\nCARRY ON REGARDLESS\n", 
+                        __FUNCTION__, __FILE__, __LINE__, iHHret, 
+                        piLeafCount[iR], (int)strlen(ppcCopy2[0]), prMSeq->sqinfo[ppiLeafList[iR][0]].name, 
+                        (int)strlen(ppcReprsnt2[0]), zcError);
+            }
+        }
+        pdScores[ppiLeafList[iR][0]] = dScore;
+#if 0
+        printf("H: %s\nR: %s\nscore: %f\n",
+               ppcReprsnt2[0], ppcCopy2[0], dScore);
+#endif
+        /* assemble 'consensus';
+         * this is not a real consensus, it is more a gap indicator,
+         * for each position it consists of residues/gaps in the 1st sequences,
+         * or a residue (if any) of the other sequences.
+         * it only contains a gap if all sequences of the profile
+         * have a gap at this position
+         */
+        pcConsens2 = CKCALLOC(prHMM->L+strlen(ppcProfile2[0])+1, sizeof(char));
+        for (i = 0; i < prHMM->L; i++){
+            for (j = 0, pcConsens2[i] = '-'; (j < piLeafCount[iR]) && ('-' == pcConsens2[i]); j++){
+                pcConsens2[i] = ppcCopy2[j][i];
+            }
+        }
+#if 0
+        for (j = 0; (j < piLeafCount[iR]); j++){
+            printf("R%d:%s\n", j, ppcCopy2[j]);
+        }
+        printf("RC:%s\n", pcConsens2);
+#endif
+    } /*  ( (1 == piLeafCount[iR]) && (0 != prHMM->L) ) */
+
+    
+
+    /* do alignment here (before free)
+     */
+    {
+        /* the size of the elements in the forward/backward matrices 
+           depends very much on the lengths of the profiles _and_ 
+           in which position (1st/2nd) the longer/shorter profile is.
+           the matrix elements can easily exceed the size of a (long?) double
+           if the longer profile is associated with the query (q) and the 
+           shorter with the target (t). 
+           this switch appears to be most easily (although unelegantly) 
+           effected here. Don't want to do it (upstairs) in PrepareAlignment() 
+           because it might jumble up the nodes. Don't want to do it in hhalign() 
+           either because ppcProfile1/2 and q/t may be used independently.
+           FS, r228 -> 229
+         */
+        int iLen1 = strlen(ppcProfile1[0]);
+        int iLen2 = strlen(ppcProfile2[0]);
+        /* potential problem with empty profiles, FS, r249 -> r250 */
+        if ( (0 == iLen1) || (0 == iLen2) ){
+            sprintf(pcError, "strlen(prof1)=%d, strlen(prof2)=%d -- nothing to align\n", 
+                    iLen1, iLen2);
+            iRetVal = -1;
+        }
+        else if (iLen1 < iLen2){
+            int iHHret = 0;
+            int iOldMacRam = rHhalignPara.iMacRamMB;
+            iHHret = hhalign(ppcProfile1, piLeafCount[iL], pdWeightsL,
+                             ppcProfile2, piLeafCount[iR], pdWeightsR,
+                             &dScore, prHMM,
+                             pcConsens1, pcReprsnt1,
+                             pcConsens2, pcReprsnt2,
+                             rHhalignPara, &rHHscores, 
+                             iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                             zcAux, zcError);
+
+            if (RETURN_OK != iHHret){ /* FS, r241 -> */
+                //fprintf(stderr, "%s:%d: emergency EXIT\n", __FILE__, __LINE__); throw(ClustalOmegaException, "-1");;
+                fprintf(stderr, 
+                        "%s:%s:%d: problem in alignment (profile sizes: %d + %d) (%s + %s), forcing Viterbi\n"
+                        "\thh-error-code=%d (mac-ram=%d)\n%s",
+                        __FUNCTION__, __FILE__, __LINE__, piLeafCount[iL], piLeafCount[iR],
+                        prMSeq->sqinfo[ppiLeafList[iL][0]].name, prMSeq->sqinfo[ppiLeafList[iR][0]].name,
+                        iHHret, rHhalignPara.iMacRamMB, zcError);
+                /* at this stage hhalign() has failed, 
+                   the only thing we can do (easily) is to re-run it in Viterbi mode, 
+                   for this set MAC-RAM=0, set it back to its original value after 2nd try. 
+                   FS, r241 -> r243 */
+                if (RETURN_FROM_MAC == iHHret){
+                    /* Note: the default way to run hhalign() is to initially select MAC 
+                       by giving it all the memory it needs. MAC may fail due to overflow (repeats?).
+                       alternatively, the problem may be (genuinely) too big for MAC.
+                       in thses cases it is legitimate to switch to Viterbi. 
+                       However, selecting Viterbi from the outset is an abuse (abomination!), 
+                       should this 1st invocation of Viterbi fail, then we (FS) will overrule 
+                       the user and hammer the system with a massive memory request. 
+                       (Jos 2:19) If anyone goes outside your house into the street, 
+                       his blood will be on his own head; we will not be responsible. FS, r246 -> r247 */
+                    rHhalignPara.iMacRamMB = 0;
+                }
+                else {
+                    rHhalignPara.iMacRamMB = REALLY_BIG_MEMORY_MB;
+                }
+
+                iHHret = hhalign(ppcProfile1, piLeafCount[iL], pdWeightsL,
+                                 ppcProfile2, piLeafCount[iR], pdWeightsR,
+                                 &dScore, prHMM,
+                                 pcConsens1, pcReprsnt1,
+                                 pcConsens2, pcReprsnt2,
+                                 rHhalignPara, &rHHscores, 
+                                 iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                                 zcAux, zcError);
+                if (RETURN_OK != iHHret){ /* at this stage hhalign() has failed twice, 
+                                     1st time MAC, 2nd time Viterbi, don't know what to do else. FS, r241 -> r243 */
+                    fprintf(stderr, "%s:%s:%d: problem in alignment, Viterbi did not work\n"
+                            "\thh-error-code=%d (mac-ram=%d)\n%s",
+                            __FUNCTION__, __FILE__, __LINE__, iHHret, rHhalignPara.iMacRamMB, zcError);
+                    sprintf(pcError, "could not perform alignment -- bailing out\n");
+                    iRetVal = -1;
+                }
+                else {
+                    fprintf(stderr, "%s:%s:%d: 2nd attempt worked", __FUNCTION__, __FILE__, __LINE__);
+                }
+                rHhalignPara.iMacRamMB = iOldMacRam; 
+            } /* 1st invocation failed */
+
+        } /* 1st profile was shorter than 2nd */
+        else {
+            int iHHret = 0;
+            int iOldMacRam = rHhalignPara.iMacRamMB;
+            iHHret = hhalign(ppcProfile2, piLeafCount[iR], pdWeightsR,
+                             ppcProfile1, piLeafCount[iL], pdWeightsL,
+                             &dScore, prHMM,
+                             pcConsens2, pcReprsnt2,
+                             pcConsens1, pcReprsnt1,
+                             rHhalignPara, &rHHscores, 
+                             iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                             zcAux, zcError);
+
+            if (RETURN_OK != iHHret){ /* FS, r241 -> r243 */
+                //fprintf(stderr, "%s:%d: emergency EXIT\n", __FILE__, __LINE__); throw(ClustalOmegaException, "-1");;
+                fprintf(stderr, 
+                        "%s:%s:%d: problem in alignment (profile sizes: %d + %d) (%s + %s), forcing Viterbi\n"
+                        "\thh-error-code=%d (mac-ram=%d)\n%s",
+                        __FUNCTION__, __FILE__, __LINE__, piLeafCount[iL], piLeafCount[iR],
+                        prMSeq->sqinfo[ppiLeafList[iL][0]].name, prMSeq->sqinfo[ppiLeafList[iR][0]].name,
+                        iHHret, rHhalignPara.iMacRamMB, zcError);
+                /* at this stage hhalign() has failed, 
+                   the only thing we can do (easily) is to re-run it in Viterbi mode, 
+                   for this set MAC-RAM=0, set it back to its original value after 2nd try. 
+                   FS, r241 -> r243 */
+                if (RETURN_FROM_MAC == iHHret){
+                    /* see above */
+                    rHhalignPara.iMacRamMB = 0;
+                }
+                else {
+                    rHhalignPara.iMacRamMB = REALLY_BIG_MEMORY_MB;
+                }
+
+                iHHret = hhalign(ppcProfile2, piLeafCount[iR], pdWeightsR,
+                                 ppcProfile1, piLeafCount[iL], pdWeightsL,
+                                 &dScore, prHMM,
+                                 pcConsens2, pcReprsnt2,
+                                 pcConsens1, pcReprsnt1,
+                                 rHhalignPara, &rHHscores, 
+                                 iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
+                                 zcAux, zcError);
+                if (RETURN_OK != iHHret){ /* at this stage hhalign() has failed twice, 
+                                     1st time MAC, 2nd time Viterbi, don't know what to do else. FS, r241 -> r243 */
+                    fprintf(stderr, "%s:%s:%d: problem in alignment, Viterbi did not work\n"
+                            "\thh-error-code=%d (mac-ram=%d)\n%s",
+                            __FUNCTION__, __FILE__, __LINE__, iHHret, rHhalignPara.iMacRamMB, zcError);
+                    sprintf(pcError, "could not perform alignment -- bailing out\n");
+                    iRetVal = -1;
+                }
+                else {
+                    fprintf(stderr, "%s:%s:%d: 2nd attempt worked", __FUNCTION__, __FILE__, __LINE__);
+                }
+                rHhalignPara.iMacRamMB = iOldMacRam; 
+            } /* 1st invocation failed */
+
+        } /* 2nd profile was shorter than 1st */
+    
+        if (rLog.iLogLevelEnabled <= LOG_DEBUG){
+            int i;
+
+            printf("@@iL=%d, #(iL)=%d, iR=%d, #(iR)=%d\n", iL, piLeafCount[iL], iR, piLeafCount[iR]);
+            for (i = 0; i < piLeafCount[iL]; i++){
+                char *pc = ppcProfile1[i];
+                printf("@@>%s\n", prMSeq->sqinfo[ppiLeafList[iL][i]].name);
+                printf("@@");
+                while('\0' != *pc){
+                    printf("%c", toupper(*pc));
+                    pc++;
+                }
+                printf("\n");
+            }
+            for (i = 0; i < piLeafCount[iR]; i++){
+                char *pc = ppcProfile2[i];
+                printf("@@>%s\n", prMSeq->sqinfo[ppiLeafList[iR][i]].name);
+                printf("@@");
+                while('\0' != *pc){
+                    printf("%c", toupper(*pc));
+                    pc++;
+                }
+                printf("\n");
+            }
+            printf("\n");
+        } /* LOG_DEBUG */    
+
+    }
+    /* free left/right node lists,
+     * after alignment left/right profiles no longer needed
+     */
+    if (NULL != ppcCopy1){
+        int i;
+        for (i = 0; i <  piLeafCount[iL]; i++){
+            CKFREE(ppcCopy1[i]);
+        }
+        CKFREE(ppcCopy1);
+        CKFREE(pcReprsnt1);
+        CKFREE(pcConsens1);
+    }
+    if (NULL != ppcCopy2){
+        int i;
+        for (i = 0; i <  piLeafCount[iR]; i++){
+            CKFREE(ppcCopy2[i]);
+        }
+        CKFREE(ppcCopy2);
+        CKFREE(pcReprsnt2);
+        CKFREE(pcConsens2);
+    }
+    CKFREE(ppiLeafList[iL]);
+    ppiLeafList[iL] = NULL;
+    CKFREE(ppiLeafList[iR]);
+    ppiLeafList[iR] = NULL;
+    piLeafCount[iL] = piLeafCount[iR] = 0;
+
+    CKFREE(ppcProfile1);
+    CKFREE(ppcProfile2);
+    CKFREE(pdWeightsL);
+    CKFREE(pdWeightsR);
+
+    *pdScore = dScore;
+    return iRetVal;
+
+} /*** end: MergeProfiles() ***/
+
+
+/**
+ * @brief Merges the nodes of the guide tree in parallel. A node is
+ * merged as soon as both of its children are, so nodes with disjoint
+ * subtrees are aligned at the same time. Each merge is the same as in
+ * the serial loop of HHalignWrapper(), the result does not depend on
+ * the number of threads.
+ *
+ * Each thread starts at a node with two leaves as children and moves
+ * on to the parent node if it was the last one to finish a child of
+ * the parent.
+ *
+ * @param[in,out] prMSeq
+ * holds the unaligned sequences [in] and the final alignment [out]
+ * @param[in] piOrderLR
+ * order in which sequences/profiles are to be aligned, see HHalignWrapper()
+ * @param[in] iNodeCount
+ * number of nodes in tree
+ * @param[in,out] piLeafCount
+ * number of leaves beneath a node
+ * @param[in,out] ppiLeafList
+ * list of leaves beneath a node
+ * @param[in] pdSeqWeights
+ * Weight per sequence. No weights used if NULL
+ * @param[out] pdScores
+ * scores of the alignments to the background HMM (per sequence)
+ * @param[in] prHMM
+ * background HMM (must not be used, i.e. prHMM->L is 0)
+ * @param[in] rHhalignPara
+ * various parameters read from commandline
+ * @param[in] prProgress
+ * progress output
+ * @param[in] iMergeNodeTotal
+ * number of merge nodes (for the progress output)
+ *
+ * @return score of the alignment at the root
+ */
+static double
+MergeNodesParallel(mseq_t *prMSeq, int *piOrderLR, int iNodeCount,
+                   int *piLeafCount, int **ppiLeafList,
+                   double *pdSeqWeights, double *pdScores,
+                   hmm_light *prHMM, hhalign_para rHhalignPara,
+                   progress_t *prProgress, int iMergeNodeTotal)
+{
+    int *piMergedAt = NULL; /* entry of piOrderLR merging a node, -1 for root */
+    int *piPending = NULL; /* number of children of an entry still to be merged */
+    int *piStart = NULL; /* entries merging two leaves */
+    int iStartCount = 0;
+    int iMergeNodeCounter = 0;
+    int iFailed = -1; /* entry that could not be aligned */
+    char zcFatal[1024] = {0};
+    double dScore = 0.0;
+    int iN, iS;
+
+    piMergedAt = (int *)CKMALLOC(iNodeCount * sizeof(int));
+    piPending  = (int *)CKCALLOC(iNodeCount, sizeof(int));
+    piStart    = (int *)CKMALLOC(iNodeCount * sizeof(int));
+
+    for (iN = 0; iN < iNodeCount; iN++){
+        piMergedAt[iN] = -1;
+    }
+    for (iN = 0; iN < iNodeCount; iN++){
+        register int riAux = DIFF_NODE * iN;
+        if (piOrderLR[riAux+LEFT_NODE] != piOrderLR[riAux+RGHT_NODE]){
+            piMergedAt[piOrderLR[riAux+LEFT_NODE]] = iN;
+            piMergedAt[piOrderLR[riAux+RGHT_NODE]] = iN;
+            piPending[iN] = 2;
+        }
+    }
+
+    /* leaves */
+    for (iN = 0; iN < iNodeCount; iN++){
+        register int riAux = DIFF_NODE * iN;
+        if (piOrderLR[riAux+LEFT_NODE] == piOrderLR[riAux+RGHT_NODE]){
+            register int riLeaf = piOrderLR[riAux+LEFT_NODE];
+            register int riNode = piOrderLR[riAux+PRNT_NODE];
+            piLeafCount[riNode] = 1;
+            ppiLeafList[riNode] = (int *)CKMALLOC(1 * sizeof(int));
+            ppiLeafList[riNode][0] = riLeaf;
+            if (piMergedAt[riNode] >= 0){
+                piPending[piMergedAt[riNode]]--;
+            }
+        }
+    }
+    for (iN = 0; iN < iNodeCount; iN++){
+        register int riAux = DIFF_NODE * iN;
+        if ( (piOrderLR[riAux+LEFT_NODE] != piOrderLR[riAux+RGHT_NODE]) &&
+             (0 == piPending[iN]) ){
+            piStart[iStartCount++] = iN;
+        }
+    }
+
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (iS = 0; iS < iStartCount; iS++){
+        int iE = piStart[iS]; /* entry of piOrderLR to be merged */
+        char zcError[1024] = {0};
+
+        while (iE >= 0){
+            register int riAux = DIFF_NODE * iE;
+            int iNext = -1;
+            int iRet = 0;
+            double dNodeScore = 0.0;
+
+#ifdef HAVE_OPENMP
+            #pragma omp critical(hhalign_wrapper)
+#endif
+            {
+                ProgressLog(prProgress, ++iMergeNodeCounter,
+                            iMergeNodeTotal, FALSE);
+            }
+
+            iRet = MergeProfiles(prMSeq, piOrderLR[riAux+LEFT_NODE],
+                                 piOrderLR[riAux+RGHT_NODE], piOrderLR[riAux+PRNT_NODE],
+                                 piLeafCount, ppiLeafList, pdSeqWeights, pdScores,
+                                 prHMM, rHhalignPara, &dNodeScore, zcError);
+
+#ifdef HAVE_OPENMP
+            #pragma omp critical(hhalign_wrapper)
+#endif
+            {
+                register int riParent = piMergedAt[piOrderLR[riAux+PRNT_NODE]];
+                if (0 != iRet){
+                    if ( (iFailed < 0) || (iE < iFailed) ){
+                        iFailed = iE;
+                        strcpy(zcFatal, zcError);
+                    }
+                }
+                else if (riParent < 0){
+                    dScore = dNodeScore;
+                }
+                else if ( (0 == --piPending[riParent]) && (iFailed < 0) ){
+                    iNext = riParent;
+                }
+            }
+            iE = iNext;
+        }
+    }
+
+    CKFREE(piStart);
+    CKFREE(piPending);
+    CKFREE(piMergedAt);
+
+    if (iFailed >= 0){
+        Log(&rLog, LOG_FATAL, "%s", zcFatal);
+    }
+
+    return dScore;
+
+} /*** end: MergeNodesParallel() ***/
+
+
 /**
  * @brief wrapper for hhalign. This is a frontend function to
  * the ported hhalign code.
@@ -514,27 +1167,15 @@ HHalignWrapper(mseq_t *prMSeq, int *piOrderLR,
     int iN; /* node iterator */
     int *piLeafCount = NULL; /* number of leaves beneath a certain node */
     int **ppiLeafList = NULL; /* list of leaves beneath a certain node */
-    char **ppcProfile1 = NULL; /* pointer to sequences in profile */
-    char **ppcProfile2 = NULL; /* pointer to sequences in profile */
-    char *pcReprsnt1 = NULL; /* representative of HMM aligned to left */
-    char *pcReprsnt2 = NULL; /* representative of HMM aligned to right */
-    char **ppcReprsnt1 = &pcReprsnt1; /* representative of HMM aligned to L */
-    char **ppcReprsnt2 = &pcReprsnt2; /* representative of HMM aligned to R */
-    char *pcConsens1 = NULL; /* copy of  left sequence */
-    char *pcConsens2 = NULL; /* copy of right sequence */
-    char **ppcCopy1 = /*&pcCopy1*/NULL; /* copy of  left sequences */
-    char **ppcCopy2 = /*&pcCopy2*/NULL; /* copy of right sequences */
     double *pdScores = NULL; /* alignment scores (seq/HMM) */
     double dScore = 0.0; /* alignment score (seq/HMM) */
-    int iAux_FS = 0;
-    char zcAux[10000] = {0};
     char zcError[10000] = {0};
     int i; /* aux */
     progress_t *prProgress;
     int iAlnLen; /* alignment length */
-    double *pdWeightsL = NULL; /* sequence weights of left  profile */
-    double *pdWeightsR = NULL; /* sequence weights of right profile */
     int iMergeNodeCounter = 0;
+    int iMergeNodeTotal = 0;
+    bool bParallel = FALSE; /* merge independent nodes at the same time */
     hmm_light *prHMM = NULL;
     bool bPrintCR = (rLog.iLogLevelEnabled<=LOG_VERBOSE) ? FALSE : TRUE;
 #if TIMING
@@ -543,7 +1184,6 @@ HHalignWrapper(mseq_t *prMSeq, int *piOrderLR,
     StopwatchZero(stopwatch);
     StopwatchStart(stopwatch);
 #endif
-    hhalign_scores rHHscores = {0};
 
     if (NULL != prHMMList) {
         if (iHMMCount>1) {
@@ -592,11 +1232,7 @@ HHalignWrapper(mseq_t *prMSeq, int *piOrderLR,
      * and sequence weights*/
     piLeafCount = CKCALLOC(iNodeCount, sizeof(int));
     ppiLeafList = CKCALLOC(iNodeCount, sizeof(int *));
-    ppcProfile1 = CKCALLOC(prMSeq->nseqs*2-1, sizeof(char *));
-    ppcProfile2 = CKCALLOC(prMSeq->nseqs*2-1, sizeof(char *));
     pdScores    = CKCALLOC(iNodeCount, sizeof(double));
-    pdWeightsL  = CKCALLOC(iNodeCount, sizeof(double));
-    pdWeightsR  = CKCALLOC(iNodeCount, sizeof(double));
 
     NewProgress(&prProgress, LogGetFP(&rLog, LOG_INFO),
                 "Progressive alignment progress", bPrintCR);
@@ -635,490 +1271,94 @@ HHalignWrapper(mseq_t *prMSeq, int *piOrderLR,
     
 
 
-    iMergeNodeCounter = 0;
-    for (iN = 0; iN < iNodeCount; iN++){
-
-        register int riAux = DIFF_NODE * iN;
-
-        /*LOG_DEBUG("node %d ", iN);*/
-
-        if (piOrderLR[riAux+LEFT_NODE] == piOrderLR[riAux+RGHT_NODE]){
+    /* iNodeCount - prMSeq->nseqs = total # of merge-nodes 
+     * unless in profile/profile alignment mode
+     */
+    if (1 == iNodeCount) {
+        iMergeNodeTotal = 1;
+    } else {
+        iMergeNodeTotal = iNodeCount - prMSeq->nseqs;
+    }
 
-            register int riLeaf = piOrderLR[riAux+LEFT_NODE];
-#if TRACE
-            if (NULL == pdSeqWeights) {
-                Log(&rLog, LOG_FORCED_DEBUG, "node %d is a leaf with entry %d (seq %s)",
-                          iN, riLeaf, prMSeq->sqinfo[riLeaf].name);
-            } else {
-                Log(&rLog, LOG_FORCED_DEBUG, "node %d is a leaf with entry %d  (seq %s) and weight %f",
-                          iN, riLeaf, prMSeq->sqinfo[riLeaf].name, pdSeqWeights[riLeaf]);
-            }
+#ifdef HAVE_OPENMP
+    /* merge independent nodes in parallel; but not with a background
+     * HMM (the HMM code of hhalign uses the garbage collector, which
+     * is not set up for several threads) and not in debug mode (which
+     * prints all nodes after every step)
+     */
+    if ( (iNodeCount > 1) && (0 == prHMM->L) &&
+         (rLog.iLogLevelEnabled > LOG_DEBUG) && (omp_get_max_threads() > 1) ){
+        bParallel = TRUE;
+    }
 #endif
-            /* left/right entry same, this is a leaf */
-            piLeafCount[piOrderLR[riAux+PRNT_NODE]] = 1; /* number of leaves is '1' */
-            ppiLeafList[piOrderLR[riAux+PRNT_NODE]] = (int *)CKMALLOC(1 * sizeof(int));
-            ppiLeafList[piOrderLR[riAux+PRNT_NODE]][0] = riLeaf;
-
-        } /* was a leaf */
-        else {
-            int iL, iR, iP; /* ID of left/right nodes, parent */
-            int i, j; /* aux */
 
-            Log(&rLog, LOG_DEBUG,
-                "merge profiles at node %d", iN, piOrderLR[riAux]);
-
-            /* iNodeCount - prMSeq->nseqs = total # of merge-nodes 
-             * unless in profile/profile alignment mode
-             */
-            if (1 == iNodeCount) {
-                ProgressLog(prProgress, ++iMergeNodeCounter,
-                            1, FALSE);
-            } else {
-                ProgressLog(prProgress, ++iMergeNodeCounter,
-                            iNodeCount - prMSeq->nseqs, FALSE);                
-            }
-
-            /* left/right entry are not same, this is a merge node */
-            iL = piOrderLR[riAux+LEFT_NODE];
-            iR = piOrderLR[riAux+RGHT_NODE];
-            iP = piOrderLR[riAux+PRNT_NODE];
-            piLeafCount[iP] = piLeafCount[iL] + piLeafCount[iR];
-            ppiLeafList[iP] = (int *)CKMALLOC(piLeafCount[iP] * sizeof(int));
-
-            for (i = j = 0; i < piLeafCount[iL]; i++, j++){
-                ppiLeafList[iP][j] = ppiLeafList[iL][i];
-            }
-            for (i = 0; i < piLeafCount[iR]; i++, j++){
-                ppiLeafList[iP][j] = ppiLeafList[iR][i];
-            }
-
-            /* prepare simulation arena:
-             * - make sure enough memory in sequences
-             * - attach sequence pointers to profiles
-             */
-            /* idea: switch template and query according to nseq? */
-
-            PrepareAlignment(prMSeq, ppcProfile1, ppcProfile2,
-                             pdWeightsL, pdWeightsR, pdSeqWeights,
-                             piLeafCount[iL], ppiLeafList[iL],
-                             piLeafCount[iR], ppiLeafList[iR]);
-            if (rLog.iLogLevelEnabled <= LOG_DEBUG){
-                int i;
-                FILE *fp = LogGetFP(&rLog, LOG_DEBUG);
-                Log(&rLog, LOG_DEBUG, "merging profiles %d & %d", iL, iR);
-                for (i = 0; i < piLeafCount[iL]; i++){
-                    fprintf(fp, "L/#=%3d (ID=%3d, w=%f): %s\n",
-                           i, ppiLeafList[iL][i], pdWeightsL[i], ppcProfile1[i]);
-                }
-                for (i = 0; i < piLeafCount[iR]; i++){
-                    fprintf(fp, "R/#=%3d (ID=%3d, w=%f): %s\n",
-                           i, ppiLeafList[iR][i], pdWeightsR[i], ppcProfile2[i]);
-                }
-            }
+    if (TRUE == bParallel) {
+        dScore = MergeNodesParallel(prMSeq, piOrderLR, iNodeCount,
+                                    piLeafCount, ppiLeafList,
+                                    pdSeqWeights, pdScores,
+                                    prHMM, rHhalignPara,
+                                    prProgress, iMergeNodeTotal);
+    }
+    else {
+        iMergeNodeCounter = 0;
+        for (iN = 0; iN < iNodeCount; iN++){
 
+            register int riAux = DIFF_NODE * iN;
 
-            
-            /* align individual sequences to HMM;
-             * - use representative sequence to get gapping
-             * - create copies of both, individual/representative sequences
-             *   as we don't want to introduce gaps into original
-             *
-             * FIXME: representative sequence is crutch, should use
-             * full HMM but that does not seem to work at all
-             * -- try harder! Fail better!
-             */
-            if ( (piLeafCount[iL] <= APPLY_BG_HMM_UP_TO_TREE_DEPTH) && (0 != prHMM->L) ){
-                int i, j;
-                pcReprsnt1 = CKCALLOC(prHMM->L+strlen(ppcProfile1[0])+1, sizeof(char));
-                for (i = 0; i < prHMM->L; i++){
-                    pcReprsnt1[i] = prHMM->seq[prHMM->ncons][i+1];
-                }
-                ppcCopy1 = CKCALLOC(piLeafCount[iL], sizeof(char *));
-                for (j = 0; j < piLeafCount[iL]; j++){
-                    ppcCopy1[j] = CKCALLOC(prHMM->L+strlen(ppcProfile1[0])+1, sizeof(char));
-                    for (i = 0; i < (int) strlen(ppcProfile1[0]); i++){
-                        ppcCopy1[j][i] = ppcProfile1[j][i];
-                    }
-                }
+            /*LOG_DEBUG("node %d ", iN);*/
 
-                {
-                    /* the size of the elements in the forward/backward matrices 
-                       depends very much on the lengths of the profiles _and_ 
-                       in which position (1st/2nd) the longer/shorter profile/HMM is.
-                       the matrix elements can easily exceed the size of a (long?) double
-                       if the longer profile/HMM is associated with the query (q) and the 
-                       shorter with the target (t). 
-                       FIXME: however, pseudo-count adding may also depend on position, 
-                       this is only really tested for the HMM being in the 1st position (q)
-                       MUST TEST THIS MORE THOROUGHLY
-
-                       this switch appears to be most easily (although unelegantly) 
-                       effected here. Don't want to do it (upstairs) in PrepareAlignment() 
-                       because it might jumble up the nodes. Don't want to do it in hhalign() 
-                       either because ppcProfile1/2 and q/t may be used independently.
-                       FS, r236 -> r237
-                    */
-                    int iLenA = strlen(ppcCopy1[0]);
-                    int iLenH = prHMM->L;
-                    int iHHret = 0;
-                    
-                    if (iLenH < iLenA){
-                        iHHret = hhalign(ppcReprsnt1, 0/* only one representative seq*/, NULL,
-                                         ppcCopy1, piLeafCount[iL], pdWeightsL,
-                                         &dScore, prHMM,
-                                         NULL, NULL, NULL, NULL,
-                                         rHhalignPara, &rHHscores, 
-                                         iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                         zcAux, zcError);
-                    }
-                    else {
-                        iHHret = hhalign(ppcCopy1, piLeafCount[iL], pdWeightsL,
-                                         ppcReprsnt1, 0/* only one representative seq*/, NULL,
-                                         &dScore, prHMM,
-                                         NULL, NULL, NULL, NULL,
-                                         rHhalignPara, &rHHscores, 
-                                         iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                         zcAux, zcError);
-                    }
-                    if ( (0 != iHHret) && (rLog.iLogLevelEnabled <= LOG_VERBOSE) ){ /* FS, r255 -> */
-                        fprintf(stderr, "%s:%s:%d: (not essential) HMM pre-alignment failed, error %d, \n"
-                                "\t#=%d (len=%d), lead-seq=%s, len(HMM)=%d\n%s\nCARRY ON REGARDLESS\n", 
-                                __FUNCTION__, __FILE__, __LINE__, iHHret, 
-                                piLeafCount[iL], (int)strlen(ppcCopy1[0]), prMSeq->sqinfo[ppiLeafList[iL][0]].name, 
-                                (int)strlen(ppcReprsnt1[0]), zcError);
-                    }
-                }
-                pdScores[ppiLeafList[iL][0]] = dScore;
-#if 0
-                printf("score: %f\nL: %s\nH: %s\n",
-                       dScore, ppcCopy1[0], ppcReprsnt1[0]);
-#endif
-                /* assemble 'consensus';
-                 * this is not a real consensus, it is more a gap indicator,
-                 * for each position it consists of residues/gaps in the 1st sequences,
-                 * or a residue (if any) of the other sequences.
-                 * it only contains a gap if all sequences of the profile
-                 * have a gap at this position
-                 */
-                pcConsens1 = CKCALLOC(prHMM->L+strlen(ppcProfile1[0])+1, sizeof(char));
-                for (i = 0; i < prHMM->L; i++){
-                    for (j = 0, pcConsens1[i] = '-'; (j < piLeafCount[iL]) && ('-' == pcConsens1[i]); j++){
-                        pcConsens1[i] = ppcCopy1[j][i];
-                    }
-                }
-#if 0
-                for (j = 0; (j < piLeafCount[iL]); j++){
-                    printf("L%d:%s\n", j, ppcCopy1[j]);
+            if (piOrderLR[riAux+LEFT_NODE] == piOrderLR[riAux+RGHT_NODE]){
+                register int riLeaf = piOrderLR[riAux+LEFT_NODE];
+#if TRACE
+                if (NULL == pdSeqWeights) {
+                    Log(&rLog, LOG_FORCED_DEBUG, "node %d is a leaf with entry %d (seq %s)",
+                              iN, riLeaf, prMSeq->sqinfo[riLeaf].name);
+                } else {
+                    Log(&rLog, LOG_FORCED_DEBUG, "node %d is a leaf with entry %d  (seq %s) and weight %f",
+                              iN, riLeaf, prMSeq->sqinfo[riLeaf].name, pdSeqWeights[riLeaf]);
                 }
-                printf("LC:%s\n", pcConsens1);
 #endif
-            } /* ( (1 == piLeafCount[iL]) && (0 != prHMM->L) ) */
+                /* left/right entry same, this is a leaf */
+                piLeafCount[piOrderLR[riAux+PRNT_NODE]] = 1; /* number of leaves is '1' */
+                ppiLeafList[piOrderLR[riAux+PRNT_NODE]] = (int *)CKMALLOC(1 * sizeof(int));
+                ppiLeafList[piOrderLR[riAux+PRNT_NODE]][0] = riLeaf;
 
-            if ( (piLeafCount[iR] <= APPLY_BG_HMM_UP_TO_TREE_DEPTH) && (0 != prHMM->L) ){
-                int i, j;
+            } /* was a leaf */
+            else {
+                Log(&rLog, LOG_DEBUG,
+                    "merge profiles at node %d", iN, piOrderLR[riAux]);
 
-                pcReprsnt2 = CKCALLOC(prHMM->L+strlen(ppcProfile2[0])+1, sizeof(char));
-                for (i = 0; i < prHMM->L; i++){
-                    pcReprsnt2[i] = prHMM->seq[prHMM->ncons][i+1];
-                }
-                ppcCopy2 = CKCALLOC(piLeafCount[iR], sizeof(char *));
-                for (j = 0; j < piLeafCount[iR]; j++){
-                    ppcCopy2[j] = CKCALLOC(prHMM->L+strlen(ppcProfile2[0])+1, sizeof(char));
-                    for (i = 0; i < (int) strlen(ppcProfile2[0]); i++){
-                        ppcCopy2[j][i] = ppcProfile2[j][i];
-                    }
-                }
-
-                {
-                    /* the size of the elements in the forward/backward matrices 
-                       depends very much on the lengths of the profiles _and_ 
-                       in which position (1st/2nd) the longer/shorter profile/HMM is.
-                       the matrix elements can easily exceed the size of a (long?) double
-                       if the longer profile/HMM is associated with the query (q) and the 
-                       shorter with the target (t). 
-                       FIXME: however, pseudo-count adding may also depend on position, 
-                       this is only really tested for the HMM being in the 1st position (q)
-                       MUST TEST THIS MORE THOROUGHLY
-                       
-                       this switch appears to be most easily (although unelegantly) 
-                       effected here. Don't want to do it (upstairs) in PrepareAlignment() 
-                       because it might jumble up the nodes. Don't want to do it in hhalign() 
-                       either because ppcProfile1/2 and q/t may be used independently.
-                       FS, r236 -> r237
-                    */
-                    int iLenA = strlen(ppcCopy2[0]);
-                    int iLenH = prHMM->L;
-                    int iHHret = 0;
-
-                    if (iLenH < iLenA){
-                        iHHret = hhalign(ppcReprsnt2, 0/* only one representative seq */, NULL,
-                                         ppcCopy2,    piLeafCount[iR], pdWeightsR,
-                                         &dScore, prHMM,
-                                         NULL, NULL, NULL, NULL,
-                                         rHhalignPara, &rHHscores, 
-                                         iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                         zcAux, zcError);
-                    }
-                    else {
-                        iHHret = hhalign(ppcCopy2,    piLeafCount[iR], pdWeightsR,
-                                         ppcReprsnt2, 0/* only one representative seq */, NULL,
-                                         &dScore, prHMM,
-                                         NULL, NULL, NULL, NULL,
-                                         rHhalignPara, &rHHscores, 
-                                         iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                         zcAux, zcError);
-                    }
-                    if ( (0 != iHHret) && (rLog.iLogLevelEnabled <= LOG_VERBOSE) ){ /* FS, r255 -> */
-                        fprintf(stderr, "%s:%s:%d: (not essential) HMM pre-alignment failed, error %d, \n"
-                                "\t#=%d (len=%d), lead-seq=%s, len(HMM)=%d\n%s\nCARRY ON REGARDLESS\n", 
-                                __FUNCTION__, __FILE__, __LINE__, iHHret, 
-                                piLeafCount[iR], (int)strlen(ppcCopy2[0]), prMSeq->sqinfo[ppiLeafList[iR][0]].name, 
-                                (int)strlen(ppcReprsnt2[0]), zcError);
-                    }
-                }
-                pdScores[ppiLeafList[iR][0]] = dScore;
-#if 0
-                printf("H: %s\nR: %s\nscore: %f\n",
-                       ppcReprsnt2[0], ppcCopy2[0], dScore);
-#endif
-                /* assemble 'consensus';
-                 * this is not a real consensus, it is more a gap indicator,
-                 * for each position it consists of residues/gaps in the 1st sequences,
-                 * or a residue (if any) of the other sequences.
-                 * it only contains a gap if all sequences of the profile
-                 * have a gap at this position
-                 */
-                pcConsens2 = CKCALLOC(prHMM->L+strlen(ppcProfile2[0])+1, sizeof(char));
-                for (i = 0; i < prHMM->L; i++){
-                    for (j = 0, pcConsens2[i] = '-'; (j < piLeafCount[iR]) && ('-' == pcConsens2[i]); j++){
-                        pcConsens2[i] = ppcCopy2[j][i];
-                    }
-                }
-#if 0
-                for (j = 0; (j < piLeafCount[iR]); j++){
-                    printf("R%d:%s\n", j, ppcCopy2[j]);
+                ProgressLog(prProgress, ++iMergeNodeCounter,
+                            iMergeNodeTotal, FALSE);
+
+                /* left/right entry are not same, this is a merge node */
+                if (0 != MergeProfiles(prMSeq, piOrderLR[riAux+LEFT_NODE],
+                                       piOrderLR[riAux+RGHT_NODE], piOrderLR[riAux+PRNT_NODE],
+                                       piLeafCount, ppiLeafList, pdSeqWeights, pdScores,
+                                       prHMM, rHhalignPara, &dScore, zcError)){
+                    Log(&rLog, LOG_FATAL, "%s", zcError);
                 }
-                printf("RC:%s\n", pcConsens2);
-#endif
-            } /*  ( (1 == piLeafCount[iR]) && (0 != prHMM->L) ) */
 
-            
+            } /* was a merge node */
 
-            /* do alignment here (before free)
-             */
-            {
-                /* the size of the elements in the forward/backward matrices 
-                   depends very much on the lengths of the profiles _and_ 
-                   in which position (1st/2nd) the longer/shorter profile is.
-                   the matrix elements can easily exceed the size of a (long?) double
-                   if the longer profile is associated with the query (q) and the 
-                   shorter with the target (t). 
-                   this switch appears to be most easily (although unelegantly) 
-                   effected here. Don't want to do it (upstairs) in PrepareAlignment() 
-                   because it might jumble up the nodes. Don't want to do it in hhalign() 
-                   either because ppcProfile1/2 and q/t may be used independently.
-                   FS, r228 -> 229
-                 */
-                int iLen1 = strlen(ppcProfile1[0]);
-                int iLen2 = strlen(ppcProfile2[0]);
-                /* potential problem with empty profiles, FS, r249 -> r250 */
-                if ( (0 == iLen1) || (0 == iLen2) ){
-                    Log(&rLog, LOG_FATAL, "strlen(prof1)=%d, strlen(prof2)=%d -- nothing to align\n", 
-                        iLen1, iLen2);
-                }
-                   
-
-                if (iLen1 < iLen2){
-                    int iHHret = 0;
-                    int iOldMacRam = rHhalignPara.iMacRamMB;
-                    iHHret = hhalign(ppcProfile1, piLeafCount[iL], pdWeightsL,
-                                     ppcProfile2, piLeafCount[iR], pdWeightsR,
-                                     &dScore, prHMM,
-                                     pcConsens1, pcReprsnt1,
-                                     pcConsens2, pcReprsnt2,
-                                     rHhalignPara, &rHHscores, 
-                                     iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                     zcAux, zcError);
-
-                    if (RETURN_OK != iHHret){ /* FS, r241 -> */
-                        //fprintf(stderr, "%s:%d: emergency EXIT\n", __FILE__, __LINE__); throw(ClustalOmegaException, "-1");;
-                        fprintf(stderr, 
-                                "%s:%s:%d: problem in alignment (profile sizes: %d + %d) (%s + %s), forcing Viterbi\n"
-                                "\thh-error-code=%d (mac-ram=%d)\n%s",
-                                __FUNCTION__, __FILE__, __LINE__, piLeafCount[iL], piLeafCount[iR],
-                                prMSeq->sqinfo[ppiLeafList[iL][0]].name, prMSeq->sqinfo[ppiLeafList[iR][0]].name,
-                                iHHret, rHhalignPara.iMacRamMB, zcError);
-                        /* at this stage hhalign() has failed, 
-                           the only thing we can do (easily) is to re-run it in Viterbi mode, 
-                           for this set MAC-RAM=0, set it back to its original value after 2nd try. 
-                           FS, r241 -> r243 */
-                        if (RETURN_FROM_MAC == iHHret){
-                            /* Note: the default way to run hhalign() is to initially select MAC 
-                               by giving it all the memory it needs. MAC may fail due to overflow (repeats?).
-                               alternatively, the problem may be (genuinely) too big for MAC.
-                               in thses cases it is legitimate to switch to Viterbi. 
-                               However, selecting Viterbi from the outset is an abuse (abomination!), 
-                               should this 1st invocation of Viterbi fail, then we (FS) will overrule 
-                               the user and hammer the system with a massive memory request. 
-                               (Jos 2:19) If anyone goes outside your house into the street, 
-                               his blood will be on his own head; we will not be responsible. FS, r246 -> r247 */
-                            rHhalignPara.iMacRamMB = 0;
-                        }
-                        else {
-                            rHhalignPara.iMacRamMB = REALLY_BIG_MEMORY_MB;
-                        }
-
-                        iHHret = hhalign(ppcProfile1, piLeafCount[iL], pdWeightsL,
-                                         ppcProfile2, piLeafCount[iR], pdWeightsR,
-                                         &dScore, prHMM,
-                                         pcConsens1, pcReprsnt1,
-                                         pcConsens2, pcReprsnt2,
-                                         rHhalignPara, &rHHscores, 
-                                         iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                         zcAux, zcError);
-                        if (RETURN_OK != iHHret){ /* at this stage hhalign() has failed twice, 
-                                             1st time MAC, 2nd time Viterbi, don't know what to do else. FS, r241 -> r243 */
-                            fprintf(stderr, "%s:%s:%d: problem in alignment, Viterbi did not work\n"
-                                    "\thh-error-code=%d (mac-ram=%d)\n%s",
-                                    __FUNCTION__, __FILE__, __LINE__, iHHret, rHhalignPara.iMacRamMB, zcError);
-                            Log(&rLog, LOG_FATAL, "could not perform alignment -- bailing out\n");
-                        }
-                        else {
-                            fprintf(stderr, "%s:%s:%d: 2nd attempt worked", __FUNCTION__, __FILE__, __LINE__);
-                        }
-                        rHhalignPara.iMacRamMB = iOldMacRam; 
-                    } /* 1st invocation failed */
-
-                } /* 1st profile was shorter than 2nd */
-                else {
-                    int iHHret = 0;
-                    int iOldMacRam = rHhalignPara.iMacRamMB;
-                    iHHret = hhalign(ppcProfile2, piLeafCount[iR], pdWeightsR,
-                                     ppcProfile1, piLeafCount[iL], pdWeightsL,
-                                     &dScore, prHMM,
-                                     pcConsens2, pcReprsnt2,
-                                     pcConsens1, pcReprsnt1,
-                                     rHhalignPara, &rHHscores, 
-                                     iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                     zcAux, zcError);
-
-                    if (RETURN_OK != iHHret){ /* FS, r241 -> r243 */
-                        //fprintf(stderr, "%s:%d: emergency EXIT\n", __FILE__, __LINE__); throw(ClustalOmegaException, "-1");;
-                        fprintf(stderr, 
-                                "%s:%s:%d: problem in alignment (profile sizes: %d + %d) (%s + %s), forcing Viterbi\n"
-                                "\thh-error-code=%d (mac-ram=%d)\n%s",
-                                __FUNCTION__, __FILE__, __LINE__, piLeafCount[iL], piLeafCount[iR],
-                                prMSeq->sqinfo[ppiLeafList[iL][0]].name, prMSeq->sqinfo[ppiLeafList[iR][0]].name,
-                                iHHret, rHhalignPara.iMacRamMB, zcError);
-                        /* at this stage hhalign() has failed, 
-                           the only thing we can do (easily) is to re-run it in Viterbi mode, 
-                           for this set MAC-RAM=0, set it back to its original value after 2nd try. 
-                           FS, r241 -> r243 */
-                        if (RETURN_FROM_MAC == iHHret){
-                            /* see above */
-                            rHhalignPara.iMacRamMB = 0;
-                        }
-                        else {
-                            rHhalignPara.iMacRamMB = REALLY_BIG_MEMORY_MB;
-                        }
-
-                        iHHret = hhalign(ppcProfile2, piLeafCount[iR], pdWeightsR,
-                                         ppcProfile1, piLeafCount[iL], pdWeightsL,
-                                         &dScore, prHMM,
-                                         pcConsens2, pcReprsnt2,
-                                         pcConsens1, pcReprsnt1,
-                                         rHhalignPara, &rHHscores, 
-                                         iAux_FS++, /* DEBUG ARGUMENT */ rLog.iLogLevelEnabled,
-                                         zcAux, zcError);
-                        if (RETURN_OK != iHHret){ /* at this stage hhalign() has failed twice, 
-                                             1st time MAC, 2nd time Viterbi, don't know what to do else. FS, r241 -> r243 */
-                            fprintf(stderr, "%s:%s:%d: problem in alignment, Viterbi did not work\n"
-                                    "\thh-error-code=%d (mac-ram=%d)\n%s",
-                                    __FUNCTION__, __FILE__, __LINE__, iHHret, rHhalignPara.iMacRamMB, zcError);
-                            Log(&rLog, LOG_FATAL, "could not perform alignment -- bailing out\n");
-                        }
-                        else {
-                            fprintf(stderr, "%s:%s:%d: 2nd attempt worked", __FUNCTION__, __FILE__, __LINE__);
-                        }
-                        rHhalignPara.iMacRamMB = iOldMacRam; 
-                    } /* 1st invocation failed */
-
-                } /* 2nd profile was shorter than 1st */
-            
-                if (rLog.iLogLevelEnabled <= LOG_DEBUG){
-                    int i;
-
-                    printf("@@iL=%d, #(iL)=%d, iR=%d, #(iR)=%d\n", iL, piLeafCount[iL], iR, piLeafCount[iR]);
-                    for (i = 0; i < piLeafCount[iL]; i++){
-                        char *pc = ppcProfile1[i];
-                        printf("@@>%s\n", prMSeq->sqinfo[ppiLeafList[iL][i]].name);
-                        printf("@@");
-                        while('\0' != *pc){
-                            printf("%c", toupper(*pc));
-                            pc++;
-                        }
-                        printf("\n");
+            if (rLog.iLogLevelEnabled <= LOG_DEBUG){
+                int i, j;
+                FILE *fp = LogGetFP(&rLog, LOG_DEBUG);
+                for (i = 0; i < iNodeCount; i++){
+                    if (0 == piLeafCount[i]){
+                        continue;
                     }
-                    for (i = 0; i < piLeafCount[iR]; i++){
-                        char *pc = ppcProfile2[i];
-                        printf("@@>%s\n", prMSeq->sqinfo[ppiLeafList[iR][i]].name);
-                        printf("@@");
-                        while('\0' != *pc){
-                            printf("%c", toupper(*pc));
-                            pc++;
-                        }
-                        printf("\n");
+                    fprintf(fp, "node %3d, #leaves=%d:\t", i, piLeafCount[i]);
+                    for (j = 0; ppiLeafList && (j < piLeafCount[i]); j++){
+                        fprintf(fp, "%d,", ppiLeafList[i][j]);
                     }
-                    printf("\n");
-                } /* LOG_DEBUG */    
-
-            }
-            /* free left/right node lists,
-             * after alignment left/right profiles no longer needed
-             */
-            if (NULL != ppcCopy1){
-                int i;
-                for (i = 0; i <  piLeafCount[iL]; i++){
-                    CKFREE(ppcCopy1[i]);
+                    fprintf(fp, "\n");
                 }
-                CKFREE(ppcCopy1);
-                CKFREE(pcReprsnt1);
-                CKFREE(pcConsens1);
             }
-            if (NULL != ppcCopy2){
-                int i;
-                for (i = 0; i <  piLeafCount[iR]; i++){
-                    CKFREE(ppcCopy2[i]);
-                }
-                CKFREE(ppcCopy2);
-                CKFREE(pcReprsnt2);
-                CKFREE(pcConsens2);
-            }
-            CKFREE(ppiLeafList[iL]);
-            ppiLeafList[iL] = NULL;
-            CKFREE(ppiLeafList[iR]);
-            ppiLeafList[iR] = NULL;
-            piLeafCount[iL] = piLeafCount[iR] = 0;
-            
-        } /* was a merge node */
-
-        if (rLog.iLogLevelEnabled <= LOG_DEBUG){
-            int i, j;
-            FILE *fp = LogGetFP(&rLog, LOG_DEBUG);
-            for (i = 0; i < iNodeCount; i++){
-                if (0 == piLeafCount[i]){
-                    continue;
-                }
-                fprintf(fp, "node %3d, #leaves=%d:\t", i, piLeafCount[i]);
-                for (j = 0; ppiLeafList && (j < piLeafCount[i]); j++){
-                    fprintf(fp, "%d,", ppiLeafList[i][j]);
-                }
-                fprintf(fp, "\n");
-            }
-        }
 
 
-    } /* 0 <= iN < iNodeCount */
+        } /* 0 <= iN < iNodeCount */
+    } /* !bParallel */
     ProgressDone(prProgress);
 
 
@@ -1160,15 +1400,11 @@ HHalignWrapper(mseq_t *prMSeq, int *piOrderLR,
     if (NULL == prHMMList){
         CKFREE(prHMM);
     }
-    CKFREE(ppcProfile2);
-    CKFREE(ppcProfile1);
     CKFREE(ppiLeafList[piOrderLR[DIFF_NODE*(iNodeCount-1)+PRNT_NODE]]);
     CKFREE(ppiLeafList);
     CKFREE(piLeafCount);
     CKFREE(pdScores);
     FreeProgress(&prProgress);
-    CKFREE(pdWeightsL);
-    CKFREE(pdWeightsR);
 
 #if TIMING
     StopwatchStop(stopwatch);
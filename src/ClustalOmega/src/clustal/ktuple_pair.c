@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
+#include <limits.h>
 
 #ifdef HAVE_OPENMP
 #include <omp.h>
@@ -48,15 +49,28 @@
 #include "log.h"
 #include "progress.h"
 
+
 #define END_MARK -3 /* see interface.c in 1.83 */
 #define NUMRES 32 /* max size of comparison matrix */
 
 /* see notes below */
 #undef SORT_LAST_ELEMENT_AS_WELL
 
+/* On x86, diagonal scores and matches are found with SSE2 (or AVX2 if
+ * the CPU has it), see pair_align(). The vector code finds exactly the
+ * same matches in the same order, so distances do not depend on it.
+ */
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define KTUPLE_SSE2 1
+#include <emmintrin.h>
+#if !defined(_WIN32)
+#define KTUPLE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
 /* gap_pos1 = NUMRES-2; /@ code for gaps inserted by clustalw @/ */
 static const int GAP_POS2 = NUMRES-1; /* code for gaps already in alignment */
-static bool DNAFLAG = FALSE;
 
 static const char *AMINO_ACID_CODES = "ABCDEFGHIKLMNPQRSTUVWXYZ-";
 static const char *NUCLEIC_ACID_CODES = "ACGTUN-";
@@ -68,13 +82,46 @@ static const char *NUCLEIC_ACID_CODES = "ACGTUN-";
 
 static bool percent = TRUE;
 
-static void make_ptrs(int *tptr, int *pl, const int naseq, const int l, const int ktup, const int max_res_code, char **seq_array);
+/* k-tuple tables of all sequences. Built once by NewKTupleIndex()
+ * and only read afterwards, so that all threads can share them.
+ * Positions are unit-offset as in the original code.
+ */
+struct ktuple_index_s {
+    ktuple_param_t param;
+    int limit;            /* number of k-tuple codes */
+    int nseqs;
+    int max_seq_len;
+    int max_aln_length;
+    int *seqlen;          /* unit-offset */
+    int **tuple;          /* code (1..limit) of the k-tuple starting at each position, 0 if none */
+    int **next;           /* previous position with the same code (tptr of make_ptrs) */
+    unsigned char **tuple8; /* zero-offset byte copy of tuple for the vector kernels, or NULL */
+    void (*count_diagonals)(const unsigned char *a, int n1,
+                            const unsigned char *b, int n2, int *displ);
+    int (*match_positions)(const unsigned char *a, const unsigned char *b, int n, int *pos);
+};
+
+/* buffers of one thread, sized for the longest sequence pair */
+typedef struct {
+    int **accum;
+    int *dcount;
+    int *displ;
+    int *diag_index;
+    int *diags;
+    char *slopes;
+    int *first;
+    int *head;            /* pl of make_ptrs() for sequence head_seq */
+    int head_seq;
+    int *match;           /* match_max each of vn1, diagonal, order */
+    int match_max;
+} ktuple_work_t;
+
+static void make_ptrs(int *tptr, int *pl, int *tuple, const char *seq, const int l, const int ktup, const int max_res_code, const int limit);
 static void put_frag(const int fs, const int v1, const int v2, const int flen, const int curr_frag, int *next, int *maxsf, int **accum);
 static bool frag_rel_pos(int a1, int b1, int a2, int b2, int ktup);
 static void des_quick_sort(int *array1, int *array2, const int array_size);
-static void pair_align(int seq_no, int l1, int l2, int max_res_code, ktuple_param_t *aln_param,
-    char **seq_array, int *maxsf, int **accum, int max_aln_length,
-    int *zza, int *zzb, int *zzc, int *zzd);
+static void pair_align(const ktuple_index_t *prIndex, int seq1, int seq2,
+    int *maxsf, ktuple_work_t *work);
 static void encode(char *seq, char *naseq, int l, const char *res_codes);
 static int res_index(const char *lookup, char c);
 
@@ -166,34 +213,33 @@ res_index(const char *t, char c)
 
 
 /**
- *
+ * Sets up the k-tuple code of each position of seq (tuple) and
+ * chains all positions with the same code: pl[code] is the last
+ * such position, tptr[i] the one before i.
  */
 static void
-make_ptrs(int *tptr, int *pl, const int naseq, const int l, const int ktup, const int max_res_code, char **seq_array)
+make_ptrs(int *tptr, int *pl, int *tuple, const char *seq, const int l, const int ktup, const int max_res_code, const int limit)
 {
     /* FIXME make 10 a constant and give it a nice name */
-    static int a[10];
+    int a[10];
     int i, j, code, flag;
     char residue;
-    const int limit = (int) pow((double)(max_res_code+1),(double)ktup);
 
     for (i=1;i<=ktup;i++)
         a[i] = (int) pow((double)(max_res_code+1),(double)(i-1));
 
     for (i=1; i<=limit; ++i)
         pl[i]=0;
-    for (i=1; i<=l; ++i)
+    for (i=1; i<=l; ++i) {
         tptr[i]=0;
+        tuple[i]=0;
+    }
 
     for (i=1; i<=(l-ktup+1); ++i) {
         code=0;
         flag=FALSE;
         for (j=1; j<=ktup; ++j) {
-            /* Log(&rLog, LOG_FORCED_DEBUG, "naseq=%d i=%d j=%d seq_array[naseq]=%p",
-             * naseq, i, j, seq_array[naseq]);
-             */
-            residue = seq_array[naseq][i+j-1];
-            /* Log(&rLog, LOG_FORCED_DEBUG, "residue = %d", residue); */
+            residue = seq[i+j-1];
             if ((residue<0) || (residue > max_res_code)){
                 flag=TRUE;
                 break;
@@ -203,6 +249,7 @@ make_ptrs(int *tptr, int *pl, const int naseq, const int l, const int ktup, cons
         if (flag)
             continue;
         ++code;
+        tuple[i] = code;
         if (0 != pl[code])
             tptr[i] =pl[code];
         pl[code] = i;
@@ -213,6 +260,161 @@ make_ptrs(int *tptr, int *pl, const int naseq, const int l, const int ktup, cons
 /* end of make_ptrs */
 
 
+#ifdef KTUPLE_SSE2
+/* Vector kernels for k-tuple codes stored as bytes (tuple8), comparing
+ * 16 (SSE2) or 32 (AVX2) positions at a time:
+ *
+ * count_diagonals(a, n1, b, n2, displ) sets displ[d] to the number of
+ * positions x with a[x] == b[x-d] != 0, for 1-n2 <= d < n1. Matches
+ * are counted in 8-bit lanes, which are added up with psadbw before
+ * they can overflow.
+ *
+ * match_positions(a, b, n, pos) stores the positions x < n with
+ * a[x] == b[x] != 0 in pos, in increasing order, and returns their
+ * number.
+ *
+ * The last, partial block is masked, so the codes have to be followed
+ * by KTUPLE_PAD readable bytes.
+ */
+#define KTUPLE_PAD 32
+
+static const unsigned char ktuple_mask[2*KTUPLE_PAD] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* 0xff where a == b and a != 0 */
+#define MATCH_SSE2(a, b, zero) \
+    _mm_andnot_si128(_mm_cmpeq_epi8((a), (zero)), _mm_cmpeq_epi8((a), (b)))
+
+static void
+count_diagonals_sse2(const unsigned char *a, int n1, const unsigned char *b, int n2, int *displ)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int d, x, x1, k;
+
+    for (d=1-n2; d<n1; d++) {
+        __m128i lanes = zero;
+        __m128i sum = zero;
+
+        x1 = MIN(n1, n2+d);
+        k = 0;
+        for (x=MAX(0, d); x<x1; x+=16) {
+            __m128i eq = MATCH_SSE2(_mm_loadu_si128((const __m128i *)(a+x)),
+                                    _mm_loadu_si128((const __m128i *)(b+x-d)), zero);
+            if (x1-x < 16) {
+                eq = _mm_and_si128(eq, _mm_loadu_si128(
+                         (const __m128i *)(ktuple_mask+KTUPLE_PAD-(x1-x))));
+            }
+            lanes = _mm_sub_epi8(lanes, eq);
+            if (255 == ++k) {
+                sum = _mm_add_epi64(sum, _mm_sad_epu8(lanes, zero));
+                lanes = zero;
+                k = 0;
+            }
+        }
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(lanes, zero));
+        sum = _mm_add_epi64(sum, _mm_srli_si128(sum, 8));
+        displ[d] = _mm_cvtsi128_si32(sum);
+    }
+}
+/* end of count_diagonals_sse2 */
+
+static int
+match_positions_sse2(const unsigned char *a, const unsigned char *b, int n, int *pos)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int bits;
+    int x, count = 0;
+
+    for (x=0; x<n; x+=16) {
+        bits = (unsigned int) _mm_movemask_epi8(
+            MATCH_SSE2(_mm_loadu_si128((const __m128i *)(a+x)),
+                       _mm_loadu_si128((const __m128i *)(b+x)), zero));
+        if (n-x < 16) {
+            bits &= (1u << (n-x)) - 1;
+        }
+        while (bits) {
+            pos[count++] = x + __builtin_ctz(bits);
+            bits &= bits-1;
+        }
+    }
+    return count;
+}
+/* end of match_positions_sse2 */
+#endif
+
+
+#ifdef KTUPLE_AVX2
+#define MATCH_AVX2(a, b, zero) \
+    _mm256_andnot_si256(_mm256_cmpeq_epi8((a), (zero)), _mm256_cmpeq_epi8((a), (b)))
+
+__attribute__((target("avx2")))
+static void
+count_diagonals_avx2(const unsigned char *a, int n1, const unsigned char *b, int n2, int *displ)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int d, x, x1, k;
+
+    for (d=1-n2; d<n1; d++) {
+        __m256i lanes = zero;
+        __m256i sum = zero;
+        __m128i sum128;
+
+        x1 = MIN(n1, n2+d);
+        k = 0;
+        for (x=MAX(0, d); x<x1; x+=32) {
+            __m256i eq = MATCH_AVX2(_mm256_loadu_si256((const __m256i *)(a+x)),
+                                    _mm256_loadu_si256((const __m256i *)(b+x-d)), zero);
+            if (x1-x < 32) {
+                eq = _mm256_and_si256(eq, _mm256_loadu_si256(
+                         (const __m256i *)(ktuple_mask+KTUPLE_PAD-(x1-x))));
+            }
+            lanes = _mm256_sub_epi8(lanes, eq);
+            if (255 == ++k) {
+                sum = _mm256_add_epi64(sum, _mm256_sad_epu8(lanes, zero));
+                lanes = zero;
+                k = 0;
+            }
+        }
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(lanes, zero));
+        sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        sum128 = _mm_add_epi64(sum128, _mm_srli_si128(sum128, 8));
+        displ[d] = _mm_cvtsi128_si32(sum128);
+    }
+}
+/* end of count_diagonals_avx2 */
+
+__attribute__((target("avx2")))
+static int
+match_positions_avx2(const unsigned char *a, const unsigned char *b, int n, int *pos)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned int bits;
+    int x, count = 0;
+
+    for (x=0; x<n; x+=32) {
+        bits = (unsigned int) _mm256_movemask_epi8(
+            MATCH_AVX2(_mm256_loadu_si256((const __m256i *)(a+x)),
+                       _mm256_loadu_si256((const __m256i *)(b+x)), zero));
+        if (n-x < 32) {
+            bits &= (1u << (n-x)) - 1;
+        }
+        while (bits) {
+            pos[count++] = x + __builtin_ctz(bits);
+            bits &= bits-1;
+        }
+    }
+    return count;
+}
+/* end of match_positions_avx2 */
+#endif
+
+
+
+
 /**
  *
  * FIXME Why hardcoding of 5?
@@ -379,63 +581,268 @@ des_quick_sort(int *array1, int *array2, const int array_size)
 
 
 
+
+
+/**
+ *
+ * Sets work->head to the last position of each k-tuple code in
+ * sequence seq, i.e. to the heads of its chains (pl of make_ptrs()).
+ * Only the entries of the previous sequence are cleared, so that this
+ * does not depend on the number of codes.
+ *
+ */
+static void
+set_heads(const ktuple_index_t *prIndex, int seq, ktuple_work_t *work)
+{
+    const int *tuple;
+    int i, n;
+
+    if (seq == work->head_seq) {
+        return;
+    }
+    if (0 != work->head_seq) {
+        tuple = prIndex->tuple[work->head_seq];
+        n = prIndex->seqlen[work->head_seq] - prIndex->param.ktup + 1;
+        for (i=1; i<=n; i++) {
+            work->head[tuple[i]] = 0;
+        }
+    }
+
+    tuple = prIndex->tuple[seq];
+    n = prIndex->seqlen[seq] - prIndex->param.ktup + 1;
+    for (i=1; i<=n; i++) {
+        if (0 != tuple[i]) {
+            work->head[tuple[i]] = i;
+        }
+    }
+    work->head_seq = seq;
+}
+/* end of set_heads */
+
+
+
+/**
+ *
+ * des_quick_sort(displ, diag_index, tl1) leaves displ[tl1] where it is
+ * (see SORT_LAST_ELEMENT_AS_WELL) and moves the k largest scores of
+ * displ[1..tl1-1] to the positions before it. Which diagonals these
+ * are only depends on the sort if the k-th and (k+1)-th largest score
+ * are the same and positive. Otherwise the top diagonals are tl1 and
+ * all others with a positive score >= the returned value, and no
+ * sort is needed. Returns 0 if the sort is needed. top is scratch
+ * space for k+1 values.
+ *
+ */
+static int
+top_score_threshold(const int *displ, const int tl1, const int k, int *top)
+{
+#if defined(QSORT_REPLACEMENT) || defined(SORT_LAST_ELEMENT_AS_WELL)
+    return 0;
+#else
+    int i, n, t, score;
+
+    if (0 == k) {
+        return INT_MAX;
+    }
+    if (k >= tl1-1) {
+        return 1;
+    }
+
+    /* top[0..n-1] are the largest scores so far, decreasing */
+    n = 0;
+    for (i=1; i<tl1; i++) {
+        score = displ[i];
+        if (n == k+1 && score <= top[k]) {
+            continue;
+        }
+        t = (n < k+1) ? n++ : k;
+        while (t > 0 && top[t-1] < score) {
+            top[t] = top[t-1];
+            t--;
+        }
+        top[t] = score;
+    }
+
+    if (0 == top[k-1]) {
+        return 1;
+    }
+    if (top[k-1] > top[k]) {
+        return top[k-1];
+    }
+    return 0;
+#endif
+}
+/* end of top_score_threshold */
+
+
+
+/**
+ *
+ * Flags all diagonals within window of diagonal pos
+ *
+ */
+static void
+flag_window(char *slopes, const int pos, const int window, const int tl1)
+{
+    int l, m;
+
+    l = (1   > pos - window) ?
+        1 :  pos - window;
+    m = (tl1 < pos + window) ?
+        tl1 : pos + window;
+    for (; l <= m; l++)
+        slopes[l] = 1;
+}
+/* end of flag_window */
+
+
+
+/**
+ *
+ * A-loop of pair_align(): adds the k-tuple match of position i of
+ * the first and vn2 of the second sequence (diagonal osptr) to the
+ * fragments. Returns FALSE if there is no room for another fragment.
+ *
+ */
+static bool
+add_match(int i, int vn2, int osptr, const ktuple_param_t *aln_param,
+    int max_aln_length, int *displ, int *curr_frag, int *maxsf, int **accum)
+{
+    int next, flen, fs, tv1, tv2, subt1, subt2, rmndr;
+
+    flen=0;
+    fs=aln_param->ktup;
+    next=*maxsf;
+
+    while (TRUE) {
+        if (!next) {
+            ++(*curr_frag);
+            if (*curr_frag >= 2*max_aln_length) {
+                Log(&rLog, LOG_VERBOSE, "(Partial alignment)");
+                return FALSE;
+            }
+            displ[osptr]=*curr_frag;
+            put_frag(fs, i, vn2, flen, *curr_frag, &next, maxsf, accum);
+
+        } else {
+            tv1=accum[1][next];
+            tv2=accum[2][next];
+
+            if (frag_rel_pos(i, vn2, tv1, tv2, aln_param->ktup)) {
+                if (i-vn2 == accum[1][next]-accum[2][next]) {
+                    if (i > accum[1][next]+(aln_param->ktup-1)) {
+                        fs = accum[0][next]+aln_param->ktup;
+                    } else {
+                        rmndr = i-accum[1][next];
+                        fs = accum[0][next]+rmndr;
+                    }
+                    flen=next;
+                    next=0;
+                    continue;
+
+                } else {
+                    if (0 == displ[osptr]) {
+                        subt1=aln_param->ktup;
+                    } else {
+                        if (i > accum[1][displ[osptr]]+(aln_param->ktup-1)) {
+                            subt1=accum[0][displ[osptr]]+aln_param->ktup;
+                        } else {
+                            rmndr=i-accum[1][displ[osptr]];
+                            subt1=accum[0][displ[osptr]]+rmndr;
+                        }
+                    }
+                    subt2=accum[0][next] - aln_param->wind_gap + aln_param->ktup;
+                    if (subt2>subt1) {
+                        flen=next;
+                        fs=subt2;
+                    } else {
+                        flen=displ[osptr];
+                        fs=subt1;
+                    }
+                    next=0;
+                    continue;
+                }
+            } else {
+                next=accum[4][next];
+                continue;
+            }
+        }
+        break;
+    }
+
+    return TRUE;
+}
+/* end of add_match */
+
+
+
 /**
  *
  * FIXME together with des_quick_sort most time consuming routine
  * according to gprof on r110
  *
+ * Works on the k-tuple tables of prIndex, so that nothing has to be
+ * set up per pair. With byte codes (tuple8), diagonal scores and the
+ * matches on the flagged diagonals are found with vector compares.
+ *
  */
 static void
-pair_align(int seq_no, int l1, int l2, int max_res_code, ktuple_param_t *aln_param,
-    char **seq_array, int *maxsf, int **accum, int max_aln_length,
-    int *zza, int *zzb, int *zzc, int *zzd)
+pair_align(const ktuple_index_t *prIndex, int seq1, int seq2,
+    int *maxsf, ktuple_work_t *work)
 {
-    int next; /* forrmerly static */
-    int pot[8],i, j, l, m, flag, limit, pos, vn1, vn2, flen, osptr, fs;
-    int tv1, tv2, encrypt, subt1, subt2, rmndr;
-    char residue;
-    int *diag_index;
-    int *displ;
-    char *slopes;
-    int curr_frag;
+    const ktuple_param_t *aln_param = &prIndex->param;
+    const int l1 = prIndex->seqlen[seq1];
+    const int l2 = prIndex->seqlen[seq2];
+    const int n1 = l1 - aln_param->ktup + 1; /* number of k-tuples */
+    const int n2 = l2 - aln_param->ktup + 1;
+    int **accum = work->accum;
+    int *dcount = work->dcount;
+    int *displ = work->displ;
+    int *diag_index = work->diag_index;
+    int *diags = work->diags;
+    char *slopes = work->slopes;
+    int *first = work->first;
+    int *match_vn1, *match_diag, *order;
+    int i, j, k, t, d, x0, x1, vn1, vn2, osptr;
+    int curr_frag, ndiags, nmatches, threshold;
     const int tl1 = (l1+l2)-1;
 
     assert(NULL!=aln_param);
 
-    /*
-      Log(&rLog, LOG_FORCED_DEBUG, "DNAFLAG=%d seq_no=%d l1=%d l2=%d window=%d ktup=%d signif=%d wind_gap=%d",
-      DNAFLAG, seq_no, l1, l2, window, ktup, signif,
-      wind_gap);
-    */
-
-    slopes = (char *) CKCALLOC(tl1+1, sizeof(char));
-    displ = (int *) CKCALLOC(tl1+1, sizeof(int));
-    diag_index = (int *) CKMALLOC((tl1+1) * sizeof(int));
+    curr_frag=*maxsf=0;
 
-    for (i=1; i<=tl1; ++i) {
-        /* unnecessary, because we calloced: slopes[i] = displ[i] = 0; */
-        diag_index[i] = i;
+    /* no k-tuples, no matches */
+    if (n1 < 1 || n2 < 1) {
+        return;
     }
 
-    for (i=1;i<=aln_param->ktup;i++)
-        pot[i] = (int) pow((double)(max_res_code+1),(double)(i-1));
-    limit = (int) pow((double)(max_res_code+1),(double)aln_param->ktup);
+    memset(slopes, 0, (tl1+1) * sizeof(char));
+    memset(dcount, 0, (tl1+1) * sizeof(int));
 
 
+    /* increment diagonal score for each k_tuple match
+     */
 
-    /* increment diagonal score for each k_tuple match */
+    if (NULL != prIndex->tuple8) {
+        /* diagonal osptr = vn1-vn2+l2 is d = vn1-vn2 in count_diagonals()
+         */
+        prIndex->count_diagonals(prIndex->tuple8[seq1], n1,
+                                 prIndex->tuple8[seq2], n2, &(dcount[l2]));
 
-    for (i=1; i<=limit; ++i) {
-        vn1=zzc[i];
-        while (TRUE) {
-            if (!vn1) break;
-            vn2 = zzd[i];
-            while (0 != vn2) {
+    } else {
+        const int *tuple1 = prIndex->tuple[seq1];
+        const int *zzb = prIndex->next[seq2];
+        const int *zzd = work->head;
+
+        set_heads(prIndex, seq2, work);
+        for (vn1=1; vn1<=n1; ++vn1) {
+            if (0 == tuple1[vn1]) {
+                continue;
+            }
+            for (vn2=zzd[tuple1[vn1]]; 0 != vn2; vn2=zzb[vn2]) {
                 osptr = vn1-vn2+l2;
-                ++displ[osptr];
-                vn2 = zzb[vn2];
+                ++dcount[osptr];
             }
-            vn1=zza[vn1];
         }
     }
 
@@ -443,166 +850,155 @@ pair_align(int seq_no, int l1, int l2, int max_res_code, ktuple_param_t *aln_par
     /* choose the top SIGNIF diagonals
      */
 
-#ifdef QSORT_REPLACEMENT
-    /* This was an attempt to replace des_quick_sort with qsort(),
-     * which turns out to be much slower, so don't use this
-     */
+    j = tl1 - aln_param->signif + 1;
 
-    /* FIXME: if we use this branch, we don't need to init diag_index
-     * before, because that is done in QSortAndTrackIndex()
-     * automatically.
-     */
-#if 0
-    for (i=1; i<=tl1; i++) {
-        Log(&rLog, LOG_FORCED_DEBUG, "b4 sort disp[%d]=%d diag_index[%d]=%d", i, diag_index[i], i, displ[i]);
+    if (j < 1) {
+        j = 1;
     }
-#endif
 
-    QSortAndTrackIndex(&(diag_index[1]), &(displ[1]), tl1, 'a', TRUE);
+    threshold = top_score_threshold(dcount, tl1, tl1-j, diags);
 
-#if 0
-    for (i=1; i<=tl1; i++) {
-        Log(&rLog, LOG_FORCED_DEBUG, "after sort disp[%d]=%d diag_index[%d]=%d", i, diag_index[i], i, displ[i]);
-    }
-#endif
+    if (threshold > 0) {
+        /* flag all diagonals within WINDOW of a top diagonal */
 
-#else
+        for (i=1; i<=tl1; i++) {
+            if (dcount[i] > 0 && (i == tl1 || dcount[i] >= threshold)) {
+                flag_window(slopes, i, aln_param->window, tl1);
+            }
+        }
 
-    des_quick_sort(displ, diag_index, tl1);
+    } else {
+        memcpy(displ, dcount, (tl1+1) * sizeof(int));
+        for (i=1; i<=tl1; ++i) {
+            diag_index[i] = i;
+        }
 
-#endif
+#ifdef QSORT_REPLACEMENT
+        /* This was an attempt to replace des_quick_sort with qsort(),
+         * which turns out to be much slower, so don't use this
+         */
 
-    j = tl1 - aln_param->signif + 1;
+        /* FIXME: if we use this branch, we don't need to init diag_index
+         * before, because that is done in QSortAndTrackIndex()
+         * automatically.
+         */
+        QSortAndTrackIndex(&(diag_index[1]), &(displ[1]), tl1, 'a', TRUE);
 
-    if (j < 1) {
-        j = 1;
-    }
+#else
+
+        des_quick_sort(displ, diag_index, tl1);
+
+#endif
 
-    /* flag all diagonals within WINDOW of a top diagonal */
+        /* flag all diagonals within WINDOW of a top diagonal */
 
-    for (i=tl1; i>=j; i--)  {
-        if (displ[i] > 0) {
-            pos = diag_index[i];
-            l = (1   > pos - aln_param->window) ?
-                1 :  pos - aln_param->window;
-            m = (tl1 < pos + aln_param->window) ?
-                tl1 : pos + aln_param->window;
-            for (; l <= m; l++)
-                slopes[l] = 1;
+        for (i=tl1; i>=j; i--)  {
+            if (displ[i] > 0) {
+                flag_window(slopes, diag_index[i], aln_param->window, tl1);
+            }
         }
     }
 
+    ndiags = 0;
+    nmatches = 0;
     for (i=1; i<=tl1; i++) {
         displ[i] = 0;
+        if (1 == slopes[i]) {
+            diags[ndiags++] = i;
+            nmatches += dcount[i];
+        }
+    }
+    if (0 == nmatches) {
+        return;
     }
 
-    curr_frag=*maxsf=0;
-
-    for (i=1; i<=(l1-aln_param->ktup+1); ++i) {
-        encrypt=flag=0;
-        for (j=1; j<=aln_param->ktup; ++j) {
-            residue = seq_array[seq_no][i+j-1];
-            if ((residue<0) || (residue>max_res_code)) {
-                flag=TRUE;
-                break;
-            }
-            encrypt += ((residue)*pot[j]);
-        }
-        if (flag) {
-            continue;
-        }
-        ++encrypt;
 
-        vn2=zzd[encrypt];
+    if (NULL == prIndex->tuple8) {
+        /* for each position vn1 of seq1 walk through the chain of its
+         * k-tuple in seq2, i.e. with decreasing vn2 or increasing
+         * diagonal, skipping diagonals which are not flagged
+         */
+        const int *tuple1 = prIndex->tuple[seq1];
+        const int *zzb = prIndex->next[seq2];
+        const int *zzd = work->head;
 
-        flag=FALSE;
-        while (TRUE) {
-            if (!vn2) {
-                flag=TRUE;
-                break;
-            }
-            osptr=i-vn2+l2;
-            if (1 != slopes[osptr]) {
-                vn2=zzb[vn2];
+        for (vn1=1; vn1<=n1; ++vn1) {
+            if (0 == tuple1[vn1]) {
                 continue;
             }
-            flen=0;
-            fs=aln_param->ktup;
-            next=*maxsf;
+            for (vn2=zzd[tuple1[vn1]]; 0 != vn2; vn2=zzb[vn2]) {
+                osptr=vn1-vn2+l2;
+                if (1 != slopes[osptr]) {
+                    continue;
+                }
+                if (!add_match(vn1, vn2, osptr, aln_param, prIndex->max_aln_length,
+                               displ, &curr_frag, maxsf, accum)) {
+                    return;
+                }
+            }
+        }
+        return;
+    }
 
-            /*
-             * A-loop
-             */
+    /* Same order as above, but instead of walking the chains, the
+     * matches of the flagged diagonals are collected diagonal by
+     * diagonal and then sorted by vn1 (stable, counting sort)
+     */
 
-            while (TRUE) {
-                if (!next) {
-                    ++curr_frag;
-                    if (curr_frag >= 2*max_aln_length) {
-                        Log(&rLog, LOG_VERBOSE, "(Partial alignment)");
-                        goto free_and_exit; /* Yesss! Always wanted to
-                                             * use a goto (AW) */
-                    }
-                    displ[osptr]=curr_frag;
-                    put_frag(fs, i, vn2, flen, curr_frag, &next, maxsf, accum);
+    if (nmatches > work->match_max) {
+        work->match_max = nmatches;
+        work->match = (int *) CKREALLOC(work->match, 3 * nmatches * sizeof(int));
+    }
+    match_vn1 = work->match;
+    match_diag = work->match + nmatches;
+    order = work->match + 2*nmatches;
+
+    t = 0;
+    for (k=0; k<ndiags; k++) {
+        int count;
+
+        d = diags[k] - l2;
+        x0 = MAX(0, d);
+        x1 = MIN(n1, n2+d);
+        if (x0 >= x1) {
+            continue;
+        }
 
-                } else {
-                    tv1=accum[1][next];
-                    tv2=accum[2][next];
-
-                    if (frag_rel_pos(i, vn2, tv1, tv2, aln_param->ktup)) {
-                        if (i-vn2 == accum[1][next]-accum[2][next]) {
-                            if (i > accum[1][next]+(aln_param->ktup-1)) {
-                                fs = accum[0][next]+aln_param->ktup;
-                            } else {
-                                rmndr = i-accum[1][next];
-                                fs = accum[0][next]+rmndr;
-                            }
-                            flen=next;
-                            next=0;
-                            continue;
+        count = prIndex->match_positions(prIndex->tuple8[seq1]+x0,
+                                         prIndex->tuple8[seq2]+x0-d,
+                                         x1-x0, &(match_vn1[t]));
+        for (i=t; i<t+count; i++) {
+            match_vn1[i] += x0+1;
+            match_diag[i] = diags[k];
+        }
+        t += count;
+    }
+    assert(t == nmatches);
 
-                        } else {
-                            if (0 == displ[osptr]) {
-                                subt1=aln_param->ktup;
-                            } else {
-                                if (i > accum[1][displ[osptr]]+(aln_param->ktup-1)) {
-                                    subt1=accum[0][displ[osptr]]+aln_param->ktup;
-                                } else {
-                                    rmndr=i-accum[1][displ[osptr]];
-                                    subt1=accum[0][displ[osptr]]+rmndr;
-                                }
-                            }
-                            subt2=accum[0][next] - aln_param->wind_gap + aln_param->ktup;
-                            if (subt2>subt1) {
-                                flen=next;
-                                fs=subt2;
-                            } else {
-                                flen=displ[osptr];
-                                fs=subt1;
-                            }
-                            next=0;
-                            continue;
-                        }
-                    } else {
-                        next=accum[4][next];
-                        continue;
-                    }
-                }
-                break;
-            }
-            /*
-             * End of Aloop
-             */
+    memset(first, 0, (n1+2) * sizeof(int));
+    for (t=0; t<nmatches; t++) {
+        first[match_vn1[t]]++;
+    }
+    for (i=1, k=0; i<=n1; i++) {
+        int count = first[i];
+        first[i] = k;
+        k += count;
+    }
+    for (t=0; t<nmatches; t++) {
+        order[first[match_vn1[t]]++] = t;
+    }
 
-            vn2=zzb[vn2];
+    for (k=0; k<nmatches; k++) {
+        t = order[k];
+        vn1 = match_vn1[t];
+        osptr = match_diag[t];
+        vn2 = vn1-osptr+l2;
+        if (!add_match(vn1, vn2, osptr, aln_param, prIndex->max_aln_length,
+                       displ, &curr_frag, maxsf, accum)) {
+            return;
         }
     }
 
-free_and_exit:
-    CKFREE(displ);
-    CKFREE(slopes);
-    CKFREE(diag_index);
-
     return;
 }
 /* end of pair_align */
@@ -611,148 +1007,203 @@ free_and_exit:
 
 /**
  *
- * Will compute ktuple scores and store in tmat
- * Following values will be set: tmat[i][j], where
- * istart <= i <iend
- * and
- * jstart <= j < jend
- * i.e. zero-offset
- * tmat data members have to be preallocated
+ * Encodes all sequences of mseq and sets up their k-tuple tables
+ * for KTupleIndexPairDist(). This is done once, instead of once per
+ * sequence pair, and the result is only read afterwards, i.e. it can
+ * be shared by all threads. Free with FreeKTupleIndex().
  *
- * if ktuple_param_t *aln_param == NULL defaults will be used
+ * if ktuple_param_t *param_override == NULL defaults will be used
  */
-void
-KTuplePairDist(symmatrix_t *tmat, mseq_t *mseq,
-               int istart, int iend,
-               int jstart, int jend,
-               ktuple_param_t *param_override,
-               progress_t *prProgress, 
-               unsigned long int *ulStepNo, unsigned long int ulTotalStepNo)
+ktuple_index_t *
+NewKTupleIndex(mseq_t *mseq, ktuple_param_t *param_override)
 {
-    /* this first group of variables were previously static
-       and hence un-parallelisable */
-    char **seq_array;
-    int maxsf;
-    int **accum;
-    int max_aln_length;
-    /* divide score with length of smallest sequence */
-    int *zza, *zzb, *zzc, *zzd;
-    int private_step_no = 0;
-
-    int i, j, dsr;
-    double calc_score;
+    ktuple_index_t *prIndex;
+    const char *res_codes = NULL;
+    char *seq;
+    int *pl;
     int max_res_code = -1;
+    int i, len;
 
-    int max_seq_len;
-    int *seqlen_array;
-    /* progress_t *prProgress; */
-    /* int uStepNo, uTotalStepNo; */
-    ktuple_param_t aln_param = default_protein_param;
-    bool bPrintCR = (rLog.iLogLevelEnabled<=LOG_VERBOSE) ? FALSE : TRUE;
-
-
-    if(prProgress == NULL) {
-        NewProgress(&prProgress, LogGetFP(&rLog, LOG_INFO), 
-                    "Ktuple-distance calculation progress", bPrintCR);
-    }
-
-    /* conversion to old style data types follows
-     *
-     */
-
-    seqlen_array = (int*) CKMALLOC((mseq->nseqs+1) * sizeof(int));
-    for (i=0; i<mseq->nseqs; i++) {
-        seqlen_array[i+1] = mseq->sqinfo[i].len;
-    }
+    prIndex = (ktuple_index_t *) CKCALLOC(1, sizeof(ktuple_index_t));
 
     /* setup alignment parameters
      */
     if (SEQTYPE_PROTEIN == mseq->seqtype) {
-        DNAFLAG = FALSE;
         max_res_code = strlen(AMINO_ACID_CODES)-2;
-        aln_param = default_protein_param;
+        res_codes = AMINO_ACID_CODES;
+        prIndex->param = default_protein_param;
 
     } else if (SEQTYPE_RNA == mseq->seqtype || SEQTYPE_DNA == mseq->seqtype) {
-        DNAFLAG = TRUE;
         max_res_code = strlen(NUCLEIC_ACID_CODES)-2;
-        aln_param = default_dna_param;
+        res_codes = NUCLEIC_ACID_CODES;
+        prIndex->param = default_dna_param;
 
     } else {
         Log(&rLog, LOG_FATAL, "Internal error in %s: Unknown sequence type.", __FUNCTION__);
     }
 
     if (NULL!=param_override) {
-        aln_param.ktup = param_override->ktup;
-        aln_param.wind_gap = param_override->wind_gap;
-        aln_param.signif = param_override->signif;
-        aln_param.window = param_override->window;
+        prIndex->param.ktup = param_override->ktup;
+        prIndex->param.wind_gap = param_override->wind_gap;
+        prIndex->param.signif = param_override->signif;
+        prIndex->param.window = param_override->window;
     }
+    assert(prIndex->param.ktup > 0 && prIndex->param.ktup < 10);
 
-    /*LOG_DEBUG("DNAFLAG = %d max_res_code = %d", DNAFLAG, max_res_code);*/
+    prIndex->limit = (int) pow((double)(max_res_code+1),(double)prIndex->param.ktup);
+    prIndex->nseqs = mseq->nseqs;
 
-    /* convert mseq to clustal's old-style int encoded sequences (unit-offset)
-     */
-    max_aln_length = 0;
-    max_seq_len = 0;
-    seq_array =  (char **) CKMALLOC((mseq->nseqs+1) * sizeof(char *));
-    seq_array[0] = NULL;
-    /* FIXME check that non of the seqs is smaller than ktup (?).
-     * Otherwise segfault occurs
-     */
+    prIndex->seqlen = (int *) CKMALLOC((mseq->nseqs+1) * sizeof(int));
+    prIndex->max_seq_len = 0;
     for (i=0; i<mseq->nseqs; i++) {
-        seq_array[i+1] = (char *) CKMALLOC((seqlen_array[i+1]+2) * sizeof (char));;
+        prIndex->seqlen[i+1] = mseq->sqinfo[i].len;
+        if (prIndex->seqlen[i+1] > prIndex->max_seq_len) {
+            prIndex->max_seq_len = prIndex->seqlen[i+1];
+        }
     }
-    for (i=0; i<mseq->nseqs; i++) {
+
+    /* convert mseq to clustal's old-style int encoded sequences
+     * (unit-offset) one at a time, and set up the k-tuple tables
+     */
+    prIndex->tuple = (int **) CKCALLOC(mseq->nseqs+1, sizeof(int *));
+    prIndex->next = (int **) CKCALLOC(mseq->nseqs+1, sizeof(int *));
+    seq = (char *) CKMALLOC((prIndex->max_seq_len+2) * sizeof(char));
+    pl = (int *) CKMALLOC((prIndex->limit+1) * sizeof(int));
+    for (i=1; i<=mseq->nseqs; i++) {
+        len = prIndex->seqlen[i];
         /*LOG_DEBUG("calling encode with seq_array[%d+1] len=%d and seq=%s",
           i, seqlen_array[i+1], mseq->seq[i]);*/
-        if (TRUE == DNAFLAG) {
-            encode(&(mseq->seq[i][-1]), seq_array[i+1],
-                   seqlen_array[i+1], NUCLEIC_ACID_CODES);
-        } else  {
-            encode(&(mseq->seq[i][-1]), seq_array[i+1],
-                   seqlen_array[i+1], AMINO_ACID_CODES);
-        }
+        encode(&(mseq->seq[i-1][-1]), seq, len, res_codes);
 
-        if (seqlen_array[i+1]>max_seq_len) {
-            max_seq_len = seqlen_array[i+1];
-        }
+        prIndex->tuple[i] = (int *) CKMALLOC((len+1) * sizeof(int));
+        prIndex->next[i] = (int *) CKMALLOC((len+1) * sizeof(int));
+        make_ptrs(prIndex->next[i], pl, prIndex->tuple[i], seq,
+                  len, prIndex->param.ktup, max_res_code, prIndex->limit);
     }
-    max_aln_length = max_seq_len * 2;
+    CKFREE(seq);
+    CKFREE(pl);
+
+    prIndex->max_aln_length = prIndex->max_seq_len * 2;
     /* see sequence.c in old source */
 
     /* FIXME: short sequences can cause seg-fault 
      * because max_aln_length can get shorter 
      * than (max_res_code+1)^k 
      * FS, r222->r223 */
-    max_aln_length = max_aln_length > pow((max_res_code+1), aln_param.ktup)+1 ? 
-        max_aln_length : pow((max_res_code+1), aln_param.ktup)+1;
+    prIndex->max_aln_length = prIndex->max_aln_length > prIndex->limit+1 ?
+        prIndex->max_aln_length : prIndex->limit+1;
 
-    /*
-     *
-     * conversion to old style clustal done (in no time) */
+#ifdef KTUPLE_SSE2
+    /* zero-offset byte codes for the vector kernels
+     */
+    if (prIndex->limit <= UCHAR_MAX) {
+        int p;
+
+        prIndex->tuple8 = (unsigned char **) CKCALLOC(mseq->nseqs+1, sizeof(unsigned char *));
+        for (i=1; i<=mseq->nseqs; i++) {
+            len = prIndex->seqlen[i];
+            prIndex->tuple8[i] = (unsigned char *) CKCALLOC(len+KTUPLE_PAD+1, sizeof(unsigned char));
+            for (p=1; p<=len; p++) {
+                prIndex->tuple8[i][p-1] = (unsigned char) prIndex->tuple[i][p];
+            }
+        }
+        prIndex->count_diagonals = count_diagonals_sse2;
+        prIndex->match_positions = match_positions_sse2;
+#ifdef KTUPLE_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            prIndex->count_diagonals = count_diagonals_avx2;
+            prIndex->match_positions = match_positions_avx2;
+        }
+#endif
+    }
+#endif
 
+    return prIndex;
+}
+/* end of NewKTupleIndex */
 
-    accum = (int **) CKCALLOC(5, sizeof (int *));
-    for (i=0;i<5;i++) {
-        accum[i] = (int *) CKCALLOC((2*max_aln_length+1), sizeof(int));
+
+
+/**
+ *
+ * Frees an index created by NewKTupleIndex()
+ */
+void
+FreeKTupleIndex(ktuple_index_t *prIndex)
+{
+    int i;
+
+    if (NULL == prIndex) {
+        return;
+    }
+    for (i=1; i<=prIndex->nseqs; i++) {
+        CKFREE(prIndex->tuple[i]);
+        CKFREE(prIndex->next[i]);
+        if (NULL != prIndex->tuple8) {
+            CKFREE(prIndex->tuple8[i]);
+        }
+    }
+    CKFREE(prIndex->tuple);
+    CKFREE(prIndex->next);
+    if (NULL != prIndex->tuple8) {
+        CKFREE(prIndex->tuple8);
     }
-    zza = (int *) CKCALLOC( (max_aln_length+1), sizeof(int));
-    zzb = (int *) CKCALLOC( (max_aln_length+1), sizeof(int));
-    zzc = (int *) CKCALLOC( (max_aln_length+1), sizeof(int));
-    zzd = (int *) CKCALLOC( (max_aln_length+1), sizeof(int));
+    CKFREE(prIndex->seqlen);
+    CKFREE(prIndex);
+}
+/* end of FreeKTupleIndex */
 
-    /* estimation of total number of steps (if istart and jstart are
-     * both 0) (now handled in the calling routine)
-     */
-    /* uTotalStepNo = iend*jend - iend*iend/2 + iend/2;
-    uStepNo = 0; */
-    /*LOG_DEBUG("istart=%d iend=%d jstart=%d jend=%d", istart, iend, jstart, jend);*/
+
+
+/**
+ *
+ * Will compute ktuple scores and store in tmat
+ * Following values will be set: tmat[i][j], where
+ * istart <= i <iend
+ * and
+ * jstart <= j < jend
+ * i.e. zero-offset
+ * tmat data members have to be preallocated
+ *
+ * Can be called by several threads at the same time for disjoint
+ * ranges of rows: every call only writes its own matrix entries, so no
+ * locking is needed apart from logging.
+ */
+void
+KTupleIndexPairDist(symmatrix_t *tmat, const ktuple_index_t *prIndex,
+                    int istart, int iend,
+                    int jstart, int jend,
+                    progress_t *prProgress,
+                    unsigned long int *ulStepNo, unsigned long int ulTotalStepNo)
+{
+    ktuple_work_t work;
+    int maxsf;
+    int i, j, dsr;
+    double calc_score;
+    const int *seqlen_array = prIndex->seqlen;
+    /* longest diagonal index is l1+l2-1 */
+    const int tl_max = 2*prIndex->max_seq_len + 1;
+
+    work.accum = (int **) CKCALLOC(5, sizeof (int *));
+    for (i=0;i<5;i++) {
+        work.accum[i] = (int *) CKCALLOC((2*prIndex->max_aln_length+1), sizeof(int));
+    }
+    work.dcount = (int *) CKMALLOC(tl_max * sizeof(int));
+    work.displ = (int *) CKMALLOC(tl_max * sizeof(int));
+    work.diag_index = (int *) CKMALLOC(tl_max * sizeof(int));
+    work.diags = (int *) CKMALLOC(tl_max * sizeof(int));
+    work.slopes = (char *) CKMALLOC(tl_max * sizeof(char));
+    work.first = (int *) CKMALLOC((prIndex->max_seq_len+2) * sizeof(int));
+    work.head = (int *) CKCALLOC(prIndex->limit+1, sizeof(int));
+    work.head_seq = 0;
+    work.match = NULL;
+    work.match_max = 0;
 
     for (i=istart+1; i<=iend; ++i) {
         /* by definition a sequence compared to itself should give
            a score of 0. AW */
         SymMatrixSetValue(tmat, i-1, i-1, 0.0);
-        make_ptrs(zza, zzc, i, seqlen_array[i], aln_param.ktup, max_res_code, seq_array);
 
 #ifdef HAVE_OPENMP
         #pragma omp critical(ktuple)
@@ -762,18 +1213,14 @@ KTuplePairDist(symmatrix_t *tmat, mseq_t *mseq,
         }
 
         for (j=MAX(i+1, jstart+1); j<=jend; ++j) {
-            (*ulStepNo)++;
-            private_step_no++;
             /*LOG_DEBUG("comparing pair %d:%d", i, j);*/
 
-            make_ptrs(zzb, zzd, j, seqlen_array[j], aln_param.ktup, max_res_code, seq_array);
-            pair_align(i, seqlen_array[i], seqlen_array[j], max_res_code, &aln_param,
-                seq_array, &maxsf, accum, max_aln_length, zza, zzb, zzc, zzd);
+            pair_align(prIndex, i, j, &maxsf, &work);
 
             if (!maxsf) {
                 calc_score=0.0;
             } else {
-                calc_score=(double)accum[0][maxsf];
+                calc_score=(double)work.accum[0][maxsf];
                 if (percent) {
                     dsr=(seqlen_array[i]<seqlen_array[j]) ?
                         seqlen_array[i] : seqlen_array[j];
@@ -791,52 +1238,70 @@ KTuplePairDist(symmatrix_t *tmat, mseq_t *mseq,
              * don't have a full symmetry. so only use the defined
              * symmetric part. AW
              */
-            /*LOG_DEBUG("setting %d : %d = %f", j, i, tmat[i][j]);*/
-            /* not needed anymore since we use symmatrix_t
-               if (j<=iend) {
-               tmat[j][i] = tmat[i][j];
-               }
-            */
+            if (rLog.iLogLevelEnabled <= LOG_DEBUG) {
 #ifdef HAVE_OPENMP
-            #pragma omp critical(ktuple)
+                #pragma omp critical(ktuple)
 #endif
-            {
-                Log(&rLog, LOG_DEBUG, "K-tuple distance for sequence pair %d:%d = %lg",
-                    i, j, SymMatrixGetValue(tmat, i-1, j-1));
+                {
+                    Log(&rLog, LOG_DEBUG, "K-tuple distance for sequence pair %d:%d = %lg",
+                        i, j, SymMatrixGetValue(tmat, i-1, j-1));
+                }
             }
         }
-    }
-    /*
-      Log(&rLog, LOG_FORCED_DEBUG, "uTotalStepNo=%d for istart=%d iend=%d jstart=%d jend=%d", uStepNo, istart, iend, jstart, jend);
-      Log(&rLog, LOG_FORCED_DEBUG, "Fabian = %d", iend*jend - iend*iend/2 + iend/2);
-    */
 
-/*    printf("\n\n%d\t%d\t%d\t%d\n\n", omp_get_thread_num(), uStepNo, istart, iend); */
+        if (jend >= MAX(i+1, jstart+1)) {
+#ifdef HAVE_OPENMP
+            #pragma omp atomic
+#endif
+            *ulStepNo += jend - MAX(i+1, jstart+1) + 1;
+        }
+    }
 
     for (i=0;i<5;i++) {
-        CKFREE(accum[i]);
+        CKFREE(work.accum[i]);
     }
-    CKFREE(accum);
-
-#ifdef HAVE_OPENMP
-    #pragma omp critical(ktuple)
-#if 0
-    {
-    printf("steps: %d\n", private_step_no);
+    CKFREE(work.accum);
+    CKFREE(work.dcount);
+    CKFREE(work.displ);
+    CKFREE(work.diag_index);
+    CKFREE(work.diags);
+    CKFREE(work.slopes);
+    CKFREE(work.first);
+    CKFREE(work.head);
+    if (NULL != work.match) {
+        CKFREE(work.match);
     }
-#endif
-#endif
+}
+/* end of KTupleIndexPairDist */
 
-    CKFREE(zza);
-    CKFREE(zzb);
-    CKFREE(zzc);
-    CKFREE(zzd);
 
-    free(seqlen_array);
 
-    for (i=1; i<=mseq->nseqs; i++) {
-        CKFREE(seq_array[i]);
+/**
+ *
+ * Will compute ktuple scores and store in tmat, see
+ * KTupleIndexPairDist()
+ *
+ * if ktuple_param_t *aln_param == NULL defaults will be used
+ */
+void
+KTuplePairDist(symmatrix_t *tmat, mseq_t *mseq,
+               int istart, int iend,
+               int jstart, int jend,
+               ktuple_param_t *param_override,
+               progress_t *prProgress, 
+               unsigned long int *ulStepNo, unsigned long int ulTotalStepNo)
+{
+    ktuple_index_t *prIndex;
+    bool bPrintCR = (rLog.iLogLevelEnabled<=LOG_VERBOSE) ? FALSE : TRUE;
+
+    if(prProgress == NULL) {
+        NewProgress(&prProgress, LogGetFP(&rLog, LOG_INFO), 
+                    "Ktuple-distance calculation progress", bPrintCR);
     }
-    CKFREE(seq_array);
+
+    prIndex = NewKTupleIndex(mseq, param_override);
+    KTupleIndexPairDist(tmat, prIndex, istart, iend, jstart, jend,
+                        prProgress, ulStepNo, ulTotalStepNo);
+    FreeKTupleIndex(prIndex);
 }
 /* end of KTuplePairDist */
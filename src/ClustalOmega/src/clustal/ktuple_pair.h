@@ -35,6 +35,10 @@ typedef struct {
     int signif;
 } ktuple_param_t;
 
+/* k-tuple tables of all sequences of an mseq_t, see NewKTupleIndex()
+ */
+typedef struct ktuple_index_s ktuple_index_t;
+
 
 extern void
 KTuplePairDist(symmatrix_t *tmat, mseq_t *mseq,
@@ -44,4 +48,17 @@ KTuplePairDist(symmatrix_t *tmat, mseq_t *mseq,
                progress_t *prProgress, 
 			   unsigned long int *ulStepNo, unsigned long int ulTotalStepNo);
 
+extern ktuple_index_t *
+NewKTupleIndex(mseq_t *mseq, ktuple_param_t *param_override);
+
+extern void
+FreeKTupleIndex(ktuple_index_t *prIndex);
+
+extern void
+KTupleIndexPairDist(symmatrix_t *tmat, const ktuple_index_t *prIndex,
+                    int istart, int iend,
+                    int jstart, int jend,
+                    progress_t *prProgress,
+                    unsigned long int *ulStepNo, unsigned long int ulTotalStepNo);
+
 #endif
@@ -399,6 +399,9 @@ SeqToVec(double **ppdSeqVec, mseq_t *prMSeq,
      * changed mseq order
      *
      */
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for private(iSeedIndex) schedule(static)
+#endif
     for (iSeqIndex=0; iSeqIndex<prMSeq->nseqs; iSeqIndex++) {
         for (iSeedIndex=0; iSeedIndex<iNumSeeds; iSeedIndex++) {
             ppdSeqVec[restore[iSeqIndex]][iSeedIndex] =
@@ -586,7 +589,7 @@ SeedSelection(int *piSeeds, int iNumSeeds, int iSelectionMethod,  mseq_t *prMSeq
         dCost = KMeans(prMSeq->nseqs, iNumSeeds, iNumSeeds,
                        pdKMeansVectors,
                        RESTARTS_PER_SPLIT, USE_KMEANS_LLOYDS,
-                       pdKMeansClusterCenters, piKMeansClusterAssignments);
+                       pdKMeansClusterCenters, piKMeansClusterAssignments, 0);
         Log(&rLog, LOG_FORCED_DEBUG, "Best split cost = %f", dCost);
         
         Log(&rLog, LOG_FORCED_DEBUG, "%s", "FIXME Check for Nan in cluster centers");
@@ -637,6 +640,88 @@ SeedSelection(int *piSeeds, int iNumSeeds, int iSelectionMethod,  mseq_t *prMSeq
 
 
 
+/**
+ * @brief Runs 2-means on each of the given clusters. The runs are
+ * independent of each other and done in parallel.
+ *
+ * @param[out] ppiAssignments
+ * Cluster assignments (0 or 1) of the objects of each cluster. Will be
+ * allocated here. Caller has to free each.
+ * @param[out] pdCenters
+ * The two new cluster centers (2*iDim coordinates) of each
+ * cluster. Must be preallocated.
+ * @param[in] prKMeansResult
+ * Current clustering
+ * @param[in] piClusters
+ * Indices of the clusters to split
+ * @param[in] iNClusters
+ * Number of elements in piClusters
+ * @param[in] ppdVectors
+ * Coordinates of all objects
+ * @param[in] uFirstSeed
+ * Random seed of the first split. The others use consecutive seeds.
+ *
+ */
+static void
+SplitClusters(int **ppiAssignments, double *pdCenters,
+              bisecting_kmeans_result_t *prKMeansResult,
+              const int *piClusters, const int iNClusters,
+              double **ppdVectors, const unsigned int uFirstSeed)
+{
+    const int iDim = prKMeansResult->iDim;
+    int iC;
+
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (iC=0; iC<iNClusters; iC++) {
+        int iN, iD;
+        const int iCluster = piClusters[iC];
+        /* number of objects in cluster that is to be split */
+        const int iNObjsInClusterToSplit = prKMeansResult->piNObjsPerCluster[iCluster];
+        /* coordinates of points in cluster that is to be split
+         * array of size n*d where [d*i + j] gives coordinate j of point i
+         */
+        double *pdVectorsInClusterToSplit = (double *)
+            CKMALLOC(iNObjsInClusterToSplit * iDim * sizeof(double));
+
+        ppiAssignments[iC] = (int *)
+            CKMALLOC(iNObjsInClusterToSplit * sizeof(int));
+        for (iN=0; iN<iNObjsInClusterToSplit; iN++) {
+            int iThisObjIdx = prKMeansResult->ppiObjIndicesPerCluster[iCluster][iN];
+            for (iD=0; iD<iDim; ++iD) {
+                pdVectorsInClusterToSplit[iDim*iN + iD] = ppdVectors[iThisObjIdx][iD];
+            }
+        }
+
+       /* KMeans(1 "The number of points in the data set",
+        *        2 "The number of clusters to look for",
+        *        3 "The number of dimensions that the data set lives in",
+        *        4 "points: An array of size n*d where points[d*i + j] gives coordinate j of point i",
+        *        5 "attempts: The number of times to independently run k-means",
+        *        6 "use_lloyds_method: uses kmpp if false, otherwise lloyds method",
+        *        7 "centers: This can either be null or an array of size k*d.
+        *           In the latter case, centers[d*i + j] will give coordinate j of center i.
+        *           If the cluster is unused, it will contain NaN instead.",
+        *        8 "assignments: This can either be null or an array of size n.
+        *           In the latter case, it will be filled with the cluster that each point is assigned to
+        *           (an integer between 0 and k-1 inclusive).",
+        *        9 "seed: Seed for the random choice of starting centers");
+        */
+        (void) KMeans(iNObjsInClusterToSplit, 2, iDim,
+                      pdVectorsInClusterToSplit,
+                      RESTARTS_PER_SPLIT, USE_KMEANS_LLOYDS,
+                      &pdCenters[2*iDim*iC], ppiAssignments[iC],
+                      uFirstSeed + (unsigned int) iC);
+
+        CKFREE(pdVectorsInClusterToSplit);
+    }
+}
+/* end of SplitClusters() */
+
+
+
+
 /**
  * @brief Bisecting K-Means clustering. Repeatedly calls K-Means with
  * a K of 2 until no cluster has more than iMaxAllowedObjsPerCluster.
@@ -659,6 +744,11 @@ SeedSelection(int *piSeeds, int iNumSeeds, int iSelectionMethod,  mseq_t *prMSeq
  * @note Convoluted code. Could use some restructuring. My apologies.
  * AW
  *
+ * @note The clusters waiting in the queue are split with 2-means in
+ * parallel (see SplitClusters()). Results are still applied in queue
+ * order and each split uses its own random seed (its number in that
+ * order), so the result does not depend on the number of threads.
+ *
  */
 void
 BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
@@ -669,6 +759,16 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
     int iN, iD;
     /* cluster centers for each cluster created at each split */
     double *pdKClusterCenters;
+    /* 2-means results of all clusters queued at the start of a pass:
+     * indices of the clusters, their assignments and centers */
+    int *piPassClusters = NULL;
+    int **ppiPassAssignments = NULL;
+    double *pdPassCenters = NULL;
+    /* size of current pass and number of its clusters handled */
+    int iPassSize = 0;
+    int iPassPos = 0;
+    /* number of clusters popped from the queue so far */
+    int iNSplits = 0;
     /* keep track of updated object indices per newly created
      * cluster */
     int *piCurObjToUpdate;
@@ -692,10 +792,6 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
 
     NewKMeansResult(prKMeansResult_p);
 
-    /* new cluster centers created at each split/KMeans run
-     */
-    pdKClusterCenters = (double *) CKCALLOC(2 * iDim, sizeof(double));
-
     /* init results by setting a first cluster that contains all objects
      */
     (*prKMeansResult_p)->iNClusters = 1;
@@ -776,14 +872,8 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
         int *piKClusterAssignments;
         /* number of objects in cluster that is to be split */
         int iNObjsInClusterToSplit;
-        /* coordinates of points in cluster that is to be split
-         * array of size n*d where [d*i + j] gives coordinate j of point i
-         */
-        double *pdVectorsInClusterToSplit;
         /* copy of object indices in split cluster */
         int *piObjIndicesOfSplitCluster;
-        /* best cost of kmeans rounds */
-        double dCost = -1.0;
 
         /*  indices for the two created clusters
          */
@@ -799,22 +889,40 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
         StopwatchStart(stopwatch);
 #endif
 
-        INT_QUEUE_POP(&rClusterSplitQueue, &iClusterToSplot);
-        
-        iNObjsInClusterToSplit = (*prKMeansResult_p)->piNObjsPerCluster[iClusterToSplot];
-        piKClusterAssignments = (int *)
-            CKMALLOC(iNObjsInClusterToSplit * sizeof(int));
-
-        pdVectorsInClusterToSplit = (double *)
-            CKMALLOC(iNObjsInClusterToSplit * iDim * sizeof(double));
-        for (iN=0; iN<iNObjsInClusterToSplit; iN++) {
-            for (iD=0; iD<iDim; ++iD) {
-                int iThisObjIdx =
-                    (*prKMeansResult_p)->ppiObjIndicesPerCluster[iClusterToSplot][iN];
-                pdVectorsInClusterToSplit[iDim*iN + iD] = ppdVectors[iThisObjIdx][iD];
+        /* Start of a pass: split everything that is queued now
+         * in parallel. Clusters queued during the pass come after
+         * these, i.e. they belong to the next pass.
+         */
+        if (iPassPos == iPassSize) {
+            list_elem_t *prElem;
+
+            iPassSize = INT_LIST_SIZE(&rClusterSplitQueue);
+            iPassPos = 0;
+            piPassClusters = (int *)
+                CKREALLOC(piPassClusters, iPassSize * sizeof(int));
+            ppiPassAssignments = (int **)
+                CKREALLOC(ppiPassAssignments, iPassSize * sizeof(int *));
+            pdPassCenters = (double *)
+                CKREALLOC(pdPassCenters, iPassSize * 2 * iDim * sizeof(double));
+            iN = 0;
+            for (prElem = CLUSTALO_LIST_HEAD(&rClusterSplitQueue);
+                 NULL != prElem; prElem = INT_LIST_NEXT(prElem)) {
+                piPassClusters[iN++] = *(int *)INT_LIST_DATA(prElem);
             }
+            SplitClusters(ppiPassAssignments, pdPassCenters, (*prKMeansResult_p),
+                          piPassClusters, iPassSize, ppdVectors,
+                          (unsigned int) iNSplits);
         }
 
+        INT_QUEUE_POP(&rClusterSplitQueue, &iClusterToSplot);
+        assert(iClusterToSplot == piPassClusters[iPassPos]);
+        piKClusterAssignments = ppiPassAssignments[iPassPos];
+        pdKClusterCenters = &pdPassCenters[2*iDim*iPassPos];
+        iPassPos += 1;
+        iNSplits += 1;
+
+        iNObjsInClusterToSplit = (*prKMeansResult_p)->piNObjsPerCluster[iClusterToSplot];
+
 #if TRACE
         Log(&rLog, LOG_FORCED_DEBUG, "Round %d: Will split cluster %d which has %d objects",
             iNRounds, iClusterToSplot, iNObjsInClusterToSplit);
@@ -835,30 +943,13 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
                     __FILE__, __FUNCTION__, __LINE__, iN,
                     (*prKMeansResult_p)->ppiObjIndicesPerCluster[iClusterToSplot][iN]);
             for (iD=0; iD<iDim; iD++) {
-                fprintf(stderr, " %f", pdVectorsInClusterToSplit[iDim*iN + iD]);
+                fprintf(stderr, " %f",
+                        ppdVectors[(*prKMeansResult_p)->ppiObjIndicesPerCluster[iClusterToSplot][iN]][iD]);
             }
             fprintf(stderr, "\n");
             (void) fflush(stderr);
         }
 #endif
-        
-       /* KMeans(1 "The number of points in the data set",
-        *        2 "The number of clusters to look for",
-        *        3 "The number of dimensions that the data set lives in",
-        *        4 "points: An array of size n*d where points[d*i + j] gives coordinate j of point i",
-        *        5 "attempts: The number of times to independently run k-means",
-        *        6 "use_lloyds_method: uses kmpp if false, otherwise lloyds method",
-        *        7 "centers: This can either be null or an array of size k*d.
-        *           In the latter case, centers[d*i + j] will give coordinate j of center i.
-        *           If the cluster is unused, it will contain NaN instead.",
-        *        8 "assignments: This can either be null or an array of size n.
-        *           In the latter case, it will be filled with the cluster that each point is assigned to
-        *           (an integer between 0 and k-1 inclusive).");
-        */
-        dCost = KMeans(iNObjsInClusterToSplit, 2, iDim,
-                       pdVectorsInClusterToSplit,
-                       RESTARTS_PER_SPLIT, USE_KMEANS_LLOYDS,
-                       pdKClusterCenters, piKClusterAssignments);
 
 #if TRACE
         Log(&rLog, LOG_FORCED_DEBUG, "%s", "Raw K-Means output:");
@@ -936,7 +1027,6 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
          */
         if (bNaNDetected || bSmallClusterDetected) {
             CKFREE(piKClusterAssignments);
-            CKFREE(pdVectorsInClusterToSplit);
             continue;
         }
 
@@ -1098,7 +1188,6 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
         (*prKMeansResult_p)->iNClusters += 1;
         iNRounds += 1;
         CKFREE(piKClusterAssignments);
-        CKFREE(pdVectorsInClusterToSplit);
 
     } /* while */
     INT_QUEUE_DESTROY(&rClusterSplitQueue);
@@ -1114,7 +1203,11 @@ BisectingKmeans(bisecting_kmeans_result_t **prKMeansResult_p,
 
     /* @note could use progress/timer */
 
-    CKFREE(pdKClusterCenters);
+    if (NULL != piPassClusters) {
+        CKFREE(piPassClusters);
+        CKFREE(ppiPassAssignments);
+        CKFREE(pdPassCenters);
+    }
     CKFREE(piCurObjToUpdate);
 
     return;
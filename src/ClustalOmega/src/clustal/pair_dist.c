@@ -283,6 +283,8 @@ PairDistances(symmatrix_t **distmat, mseq_t *mseq, int pairdist_type, bool bPerc
     int iChunkStarts[iNumberOfThreads];
     int iChunkEnds[iNumberOfThreads];
     progress_t *prProgress = NULL;
+    ktuple_index_t *prKTupleIndex = NULL;
+    int iTask, iColBlocks, iColBlockSize;
     int iSquidSuccess = 0;
     bool bPrintCR = (rLog.iLogLevelEnabled<=LOG_VERBOSE) ? FALSE : TRUE;
 
@@ -332,15 +334,36 @@ PairDistances(symmatrix_t **distmat, mseq_t *mseq, int pairdist_type, bool bPerc
 
             NewProgress(&prProgress, LogGetFP(&rLog, LOG_INFO),
                         "Ktuple-distance calculation progress", bPrintCR);
+
+            /* k-tuple tables are set up once and shared by all
+             * threads. Each row is a separate task, so the threads
+             * write to disjoint parts of the matrix and rows of
+             * different length are balanced by the scheduler.
+             * If there are only a few rows (e.g. the seeds of mBed
+             * against all sequences), rows are split into blocks of
+             * columns as well.
+             */
+            prKTupleIndex = NewKTupleIndex(mseq, NULL);
+            iColBlocks = 1;
+            if (iend - istart < 4 * iNumberOfThreads) {
+                iColBlocks = (4 * iNumberOfThreads + (iend - istart) - 1) / (iend - istart);
+            }
+            iColBlockSize = (jend - jstart + iColBlocks - 1) / iColBlocks;
 #ifdef HAVE_OPENMP
-            #pragma omp parallel for private(iChunk) schedule(dynamic)
+            #pragma omp parallel for private(iTask) schedule(dynamic)
 #endif
-            for(iChunk = 0; iChunk < iNumberOfThreads; iChunk++)
+            for(iTask = 0; iTask < (iend - istart) * iColBlocks; iTask++)
             {
-                KTuplePairDist((*distmat), mseq, iChunkStarts[iChunk], 
-                    iChunkEnds[iChunk], jstart, jend, NULL, prProgress, 
-                    &ulStepNo, ulTotalStepNo);
+                int iRow = istart + iTask / iColBlocks;
+                int iColStart = jstart + (iTask % iColBlocks) * iColBlockSize;
+                int iColEnd = MIN(iColStart + iColBlockSize, jend);
+
+                if (iColStart < iColEnd) {
+                    KTupleIndexPairDist((*distmat), prKTupleIndex, iRow, iRow+1,
+                        iColStart, iColEnd, prProgress, &ulStepNo, ulTotalStepNo);
+                }
             }
+            FreeKTupleIndex(prKTupleIndex);
 
 #if 0
             printf("total ops %d\n", ulStepNo);
@@ -37,6 +37,7 @@
 #include "util.h"
 #include "log.h"
 #include "seq.h"
+#include "../../../FastaScanner.h"
 
 
 #define ALLOW_ONLY_PROTEIN 0 // DD
@@ -393,6 +394,94 @@ SeqTypeToStr(int iSeqType)
 
 
 
+/**
+ * @brief Checks whether a sequence file that was opened with FastaOpen()
+ * is in FASTA format, using the same test as squid's SeqfileFormat().
+ * gzip-compressed files are always taken to be FASTA.
+ *
+ * @param[in] prFasta
+ * The opened file
+ * @param[in] pcSeqFile
+ * Its name
+ *
+ * @return TRUE if the file is in FASTA format
+ */
+static bool
+IsFastaFile(const fasta_file_t *prFasta, const char *pcSeqFile)
+{
+    const char *pc = prFasta->data;
+    const char *pcEnd = prFasta->data + prFasta->size;
+
+    if (FastaIsGzip(pcSeqFile)) {
+        return TRUE;
+    }
+    while (pc < pcEnd && isspace((int) *pc)) {
+        pc++;
+    }
+    /* ">>>>" starts a GCG data file */
+    return (pc < pcEnd && '>' == *pc &&
+            ! (pcEnd - pc >= 4 && 0 == strncmp(pc, ">>>>", 4)));
+}
+/***   end: IsFastaFile   ***/
+
+
+
+/**
+ * @brief Reads the next sequence from a FASTA file that is scanned in
+ * memory (see FastaScanner.h); does the same as squid's ReadSeq() for
+ * this format, but translates the residues directly into the returned
+ * sequence.
+ *
+ * @param[in] prFasta
+ * The opened file
+ * @param[in] pucMap
+ * Translation table: the residue to store for each byte or FASTA_SKIP
+ * @param[out] ppcSeq
+ * The sequence, allocated here
+ * @param[out] prSqinfo
+ * Name, description and length of the sequence
+ *
+ * @return 1 if a sequence was read, 0 at the end of the file or if the
+ * file does not start with a FASTA header (prFasta->junk is set)
+ */
+static int
+ReadFastaSeq(fasta_file_t *prFasta, const unsigned char *pucMap,
+             char **ppcSeq, SQINFO *prSqinfo)
+{
+    fasta_record_t rRecord;
+    char *pcHeader;
+    char *pcToken;
+    size_t iLen;
+
+    if (! FastaNextRecord(prFasta, &rRecord) || prFasta->junk) {
+        return 0;
+    }
+
+    prSqinfo->flags = 0;
+    pcHeader = (char *) CKMALLOC(rRecord.nameLen + 2);
+    memcpy(pcHeader, rRecord.name, rRecord.nameLen);
+    pcHeader[rRecord.nameLen] = '\n';
+    pcHeader[rRecord.nameLen + 1] = '\0';
+    if ((pcToken = strtok(pcHeader, "\n\t ")) != NULL)
+        SetSeqinfoString(prSqinfo, pcToken, SQINFO_NAME);
+    if ((pcToken = strtok(NULL, "\n")) != NULL)
+        SetSeqinfoString(prSqinfo, pcToken, SQINFO_DESC);
+    CKFREE(pcHeader);
+
+    *ppcSeq = (char *) CKMALLOC(rRecord.bodyLen + 1);
+    iLen = FastaEncode(&rRecord, pucMap, *ppcSeq, NULL);
+    *ppcSeq = (char *) CKREALLOC(*ppcSeq, iLen + 1);
+    (*ppcSeq)[iLen] = '\0';
+
+    prSqinfo->len = (int) iLen;
+    prSqinfo->flags |= SQINFO_LEN;
+
+    return 1;
+}
+/***   end: ReadFastaSeq   ***/
+
+
+
 /**
  * @brief reads sequences from file
  *
@@ -414,6 +503,8 @@ SeqTypeToStr(int iSeqType)
  * @note
  *  - Depends heavily on squid
  *  - Sequence file format will be guessed
+ *  - FASTA files, also gzipped ones, are mapped into memory and read
+ *    without squid (see ReadFastaSeq())
  *  - If supported by squid, gzipped files can be read as well.
  */
 int
@@ -421,15 +512,41 @@ ReadSequences(mseq_t *prMSeq, char *seqfile,
               int iSeqType, int iSeqFmt, bool bIsProfile, 
               int iMaxNumSeq, int iMaxSeqLen)
 {
-    SQFILE *dbfp; /* sequence file descriptor */
+    SQFILE *dbfp = NULL; /* sequence file descriptor */
     char *cur_seq;
     SQINFO cur_sqinfo;
     int iSeqIdx; /* sequence counter */
     int iSeqPos; /* sequence string position counter */
+    fasta_file_t rFasta; /* FASTA file scanned in memory */
+    bool bFasta = FALSE; /* read with ReadFastaSeq() instead of squid */
+    unsigned char aucFastaMap[256];
 
     assert(NULL!=seqfile);
 
 
+    /* FASTA files (and anything gzipped) are read by ReadFastaSeq(),
+     * other formats and stdin by squid
+     */
+    if ((SQFILE_UNKNOWN == iSeqFmt || SQFILE_FASTA == iSeqFmt) &&
+        strcmp(seqfile, "-") != 0) {
+        if (0 != FastaOpen(&rFasta, seqfile)) {
+            Log(&rLog, LOG_ERROR, "Failed to open sequence file %s for reading", seqfile);
+            return -1;
+        }
+        bFasta = (SQFILE_FASTA == iSeqFmt || IsFastaFile(&rFasta, seqfile));
+        if (! bFasta) {
+            FastaClose(&rFasta);
+        }
+    }
+    if (bFasta) {
+        /* same characters as kept by squid's addseq() */
+        for (iSeqPos=0; iSeqPos<256; iSeqPos++) {
+            aucFastaMap[iSeqPos] =
+                (! isdigit(iSeqPos) && ! isspace(iSeqPos) && isprint(iSeqPos)) ?
+                (unsigned char) iSeqPos : FASTA_SKIP;
+        }
+    }
+
     /* Try to work around inability to autodetect from a pipe or .gz:
      * assume FASTA format
      */
@@ -446,7 +563,8 @@ ReadSequences(mseq_t *prMSeq, char *seqfile,
      *
      */
 
-    if (NULL == (dbfp = SeqfileOpen(seqfile, iSeqFmt, NULL))) {
+    if (! bFasta &&
+        NULL == (dbfp = SeqfileOpen(seqfile, iSeqFmt, NULL))) {
         Log(&rLog, LOG_ERROR, "Failed to open sequence file %s for reading", seqfile);
         return -1;
     }
@@ -460,32 +578,38 @@ ReadSequences(mseq_t *prMSeq, char *seqfile,
      * use a patched version.
      *
      */
-    while (ReadSeq(dbfp, dbfp->format,
+    while (bFasta ?
+           ReadFastaSeq(&rFasta, aucFastaMap, &cur_seq, &cur_sqinfo) :
+           ReadSeq(dbfp, dbfp->format,
                    &cur_seq,
                    &cur_sqinfo)) {
 
         if (prMSeq->nseqs+1>iMaxNumSeq) {
             Log(&rLog, LOG_ERROR, "Maximum number of sequences (=%d) exceeded after reading sequence '%s' from '%s'",
                   iMaxNumSeq, cur_sqinfo.name, seqfile);
+            if (bFasta) FastaClose(&rFasta);
             return -1;
         }
         if ((int)strlen(cur_seq)>iMaxSeqLen) {
             Log(&rLog, LOG_ERROR, "Sequence '%s' has %d residues and is therefore longer than allowed (max. sequence length is %d)",
                   cur_sqinfo.name, strlen(cur_seq), iMaxSeqLen);
+            if (bFasta) FastaClose(&rFasta);
             return -1;
         }
         if ((int)strlen(cur_seq)==0) {
             Log(&rLog, LOG_ERROR, "Sequence '%s' has 0 residues",
                 cur_sqinfo.name);
+            if (bFasta) FastaClose(&rFasta);
             return -1;
         }
 
         /* FIXME: use modified version of AddSeq() that allows handing down SqInfo
          */
 
+        /* sequences from ReadFastaSeq() are handed over, not copied */
         prMSeq->seq =  (char **)
             CKREALLOC(prMSeq->seq, (prMSeq->nseqs+1) * sizeof(char *));
-        prMSeq->seq[prMSeq->nseqs] = CkStrdup(cur_seq);
+        prMSeq->seq[prMSeq->nseqs] = bFasta ? cur_seq : CkStrdup(cur_seq);
 
 
         prMSeq->sqinfo =  (SQINFO *)
@@ -531,8 +655,12 @@ ReadSequences(mseq_t *prMSeq, char *seqfile,
             /* if type could not be determined and was not set return error */
             if (SEQTYPE_UNKNOWN == iSeqType && SEQTYPE_UNKNOWN == prMSeq->seqtype) {
                 Log(&rLog, LOG_ERROR, "Couldn't guess sequence type from first sequence");
-                FreeSequence(cur_seq, &cur_sqinfo);
-                SeqfileClose(dbfp);
+                if (bFasta) {
+                    FastaClose(&rFasta);
+                } else {
+                    FreeSequence(cur_seq, &cur_sqinfo);
+                    SeqfileClose(dbfp);
+                }
                 return -1;
             }
         }
@@ -549,9 +677,18 @@ ReadSequences(mseq_t *prMSeq, char *seqfile,
 
         prMSeq->nseqs++;
 
-        FreeSequence(cur_seq, &cur_sqinfo);
+        FreeSequence(bFasta ? NULL : cur_seq, &cur_sqinfo);
+    }
+    if (bFasta) {
+        bool bJunk = rFasta.junk;
+        FastaClose(&rFasta);
+        if (bJunk) {
+            Log(&rLog, LOG_ERROR, "File %s does not appear to be in FASTA format", seqfile);
+            return -1;
+        }
+    } else {
+        SeqfileClose(dbfp);
     }
-    SeqfileClose(dbfp);
 
 /*#if ALLOW_ONLY_PROTEIN
     if (SEQTYPE_PROTEIN != prMSeq->seqtype) {
@@ -972,6 +1109,47 @@ FreeRSeq(mseq_t **mseq, bool bRSequence)
 /***   end: FreeMSeq   ***/
 
 
+/**
+ * @brief Hands the aligned sequences to R: the rows are copied straight
+ * from mseq in output order (guide-tree order if mseq->tree_order is set),
+ * without the detour through a squid MSA and Clustal formatted lines.
+ *
+ * @param[in] mseq
+ * The mseq_t struct containing the aligned sequences
+ * @param[out] prRows
+ * The rows, names, and version string
+ *
+ * @return Non-zero on error
+ */
+static int
+WriteAlignedRows(mseq_t *mseq, aln_rows_t *prRows)
+{
+    int i;
+    int alen = strlen(mseq->seq[0]);
+    char zcVersion[ALN_ROWS_VERSION_LEN];
+
+    if (AlnRowsAlloc(prRows, mseq->nseqs, alen)) {
+        Log(&rLog, LOG_ERROR, "Could not allocate memory for the alignment");
+        return -1;
+    }
+    snprintf(zcVersion, sizeof(zcVersion), "ClustalOmega %s", PACKAGE_VERSION);
+    AlnRowsSetVersion(prRows, zcVersion);
+
+    for (i=0; i<mseq->nseqs; i++) {
+        int iI = (NULL == mseq->tree_order) ? i : mseq->tree_order[i];
+
+        memcpy(AlnRowsRow(prRows, i), mseq->seq[iI], alen);
+        if (AlnRowsSetName(prRows, i, mseq->sqinfo[iI].name)) {
+            Log(&rLog, LOG_ERROR, "Could not allocate memory for the alignment");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+/***   end of WriteAlignedRows()   ***/
+
+
 /**
  * @brief Write alignment to file.
  *
@@ -983,6 +1161,9 @@ FreeRSeq(mseq_t **mseq, bool bRSequence)
  * The alignment output format (defined in squid.h)
  * @param[in] iWrap
  * length of line for Clustal/Fasta format
+ * @param[out] prRows
+ * If not NULL, Clustal format is not written but the aligned rows are
+ * handed to R in prRows (see AlignedRows.h)
  *
  * @return Non-zero on error
  *
@@ -992,7 +1173,7 @@ FreeRSeq(mseq_t **mseq, bool bRSequence)
  * 
  */    
 int
-WriteAlignment(mseq_t *mseq, const char *pcAlnOutfile, int outfmt, int iWrap, bool bResno, int *result_c, char ***result_v)
+WriteAlignment(mseq_t *mseq, const char *pcAlnOutfile, int outfmt, int iWrap, bool bResno, aln_rows_t *prRows)
 {
     int i; /* aux */
     MSA *msa; /* squid's alignment structure */
@@ -1008,6 +1189,10 @@ WriteAlignment(mseq_t *mseq, const char *pcAlnOutfile, int outfmt, int iWrap, bo
         return -1;
     }
 
+    if (MSAFILE_CLUSTAL == outfmt && NULL != prRows) {
+        return WriteAlignedRows(mseq, prRows);
+    }
+
     if (NULL == pcAlnOutfile || TRUE) { //do not write to file!!
         pfOut = stdout;
         use_stdout = TRUE;
@@ -1093,7 +1278,7 @@ WriteAlignment(mseq_t *mseq, const char *pcAlnOutfile, int outfmt, int iWrap, bo
         WriteA2M(pfOut, msa, INT_MAX);
         break;
     case MSAFILE_CLUSTAL:
-        WriteClustalForR(msa, iWrap, TRUE==bResno ? 1 : 0, result_c, result_v);
+        WriteClustal(pfOut, msa, iWrap, TRUE==bResno ? 1 : 0);
         break;
     case MSAFILE_MSF:
         WriteMSF(pfOut, msa);
@@ -20,6 +20,7 @@
 #define CLUSTALO_SEQ_H
 
 #include "../squid/squid.h"
+#include "../../../AlignedRows.h"
 
 #include "util.h"
 
@@ -156,7 +157,7 @@ extern int
 FindSeqName(char *seqname, mseq_t *mseq);
 
 extern int
-WriteAlignment(mseq_t *mseq, const char *aln_outfile, int msafile_format, int iWrap, bool bResno, int *result_c, char ***result_v);
+WriteAlignment(mseq_t *mseq, const char *aln_outfile, int msafile_format, int iWrap, bool bResno, aln_rows_t *prRows);
 
 extern void
 DealignSeq(char *seq);
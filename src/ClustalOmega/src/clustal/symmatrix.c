@@ -21,9 +21,6 @@
  * Functions for symmetric (square) matrices including diagonal.
  * supports the notion of non-square sub-matrices of a symmetric
  * matrix, i.e. where |rows|<|cols|.
- *
- * FIXME Allocating one big chunk of memory is probably
- * much faster and also easier to maintain.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -67,8 +64,6 @@
 int
 NewSymMatrix(symmatrix_t **symmat, int nrows, int ncols)
 {
-    int i; /* aux */
-    
     assert(nrows>0 && ncols>0 && ncols>=nrows);
     assert(ncols>0 && ncols>=nrows);
 
@@ -79,39 +74,25 @@ NewSymMatrix(symmatrix_t **symmat, int nrows, int ncols)
         return -1;
     }
     
-    (*symmat)->data = (double **) malloc(nrows * sizeof(double *));
-    if (NULL == (*symmat)->data) {
+    if (PdmNew(&(*symmat)->data, nrows, ncols, PDM_DOUBLE)) {
         fprintf(stderr, "Couldn't allocate memory (%s|%s)\n",
                 __FILE__, __FUNCTION__);
         free(*symmat);
         *symmat = NULL;
         return -1;
     }
-    for (i=0; i<nrows; i++) {
-        (*symmat)->data[i] = (double *) calloc((ncols-i), sizeof(double));
-        if (NULL == (*symmat)->data[i]) {
-            fprintf(stderr, "Couldn't allocate memory (%s|%s)\n",
-                    __FILE__, __FUNCTION__); 
-            while (0!=--i) {
-                free((*symmat)->data[i]);
-            }           
-            free((*symmat)->data);
-            free(*symmat);
-            *symmat = NULL;
-            return -1;
-        }
 #ifdef TRACE
-        fprintf(stderr, "DEBUG(%s|%s():%d) initialising symmat with the number of the beast\n",
-                __FILE__, __FUNCTION__, __LINE__);
-        {
-            int j;
-            for (j=0; j<ncols-i; j++) {
-                (*symmat)->data[i][j] = -666.0;
+    fprintf(stderr, "DEBUG(%s|%s():%d) initialising symmat with the number of the beast\n",
+            __FILE__, __FUNCTION__, __LINE__);
+    {
+        int i, j;
+        for (i=0; i<nrows; i++) {
+            for (j=i; j<ncols; j++) {
+                PdmSet(&(*symmat)->data, i, j, -666.0);
             }
-
         }
-#endif
     }
+#endif
     
     (*symmat)->nrows = nrows;
     (*symmat)->ncols = ncols;
@@ -145,11 +126,10 @@ SymMatrixSetValue(symmatrix_t *symmat, const int i, const int j, const double va
 
     if (i<=j) {
         assert(i < symmat->nrows && j < symmat->ncols);
-        symmat->data[i][j-i] = value;
     } else {
         assert(j < symmat->nrows && i < symmat->ncols);
-        symmat->data[j][i-j] = value;
     }
+    PdmSet(&symmat->data, i, j, value);
 }
 /***   end: symmatrix_setvalue   ***/
 
@@ -178,11 +158,10 @@ SymMatrixGetValue(symmatrix_t *symmat, const int i, const int j)
 
     if (i<=j) {
         assert(i < symmat->nrows && j < symmat->ncols);
-        return symmat->data[i][j-i];
     } else {
         assert(j < symmat->nrows && i < symmat->ncols);
-        return symmat->data[j][i-j];
     }
+    return PdmGet(&symmat->data, i, j);
 }
 /***   end: symmatrix_getvalue   ***/
 
@@ -190,43 +169,6 @@ SymMatrixGetValue(symmatrix_t *symmat, const int i, const int j)
 
 
 
-/**
- * @brief Returns a pointer to an element of symmat corresponding to
- * given indices
- *
- * @param[out] val
- * Value to be set
- * @param[in] symmat
- * symmatrix_t of question
- * @param[in] i
- * index i
- * @param[in] j
- * index j
- *
- * @return pointer to value
- *
- * @see SymMatrixGetValue()
- *
- * @note This is a convenience function that checks index order.
- *
- */
-void
-SymMatrixGetValueP(double **val, symmatrix_t *symmat,
-                   const int i, const int j)
-{
-    assert(NULL != symmat);
-    
-    if (i<=j) {
-        assert(i < symmat->nrows && j < symmat->ncols);
-        *val = &(symmat->data[i][j-i]);
-    } else {
-        assert(j < symmat->nrows && i < symmat->ncols);
-        *val = &(symmat->data[j][i-j]);
-    }
-}
-/***   end: symmatrix_getvaluep   ***/
-
-
 /**
  * @brief Frees memory allocated by data members of symmat and symmat
  * itself. 
@@ -242,14 +184,8 @@ SymMatrixGetValueP(double **val, symmatrix_t *symmat,
 void
 FreeSymMatrix(symmatrix_t **symmat)
 {
-    int i;
     if (NULL != (*symmat)) {
-        if (NULL != (*symmat)->data) {
-            for (i=0; i<(*symmat)->nrows; i++) {
-                free((*symmat)->data[i]);
-            }
-            free((*symmat)->data);
-        }
+        PdmFree(&(*symmat)->data);
     }
     free(*symmat);
     *symmat = NULL;
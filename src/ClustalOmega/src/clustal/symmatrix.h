@@ -23,19 +23,16 @@
  * matrix, i.e. where |rows|<|cols| and the corresponding full matrix
  * would be |cols|x|cols|
  *
- * Instead of making this one big chunk of memory we keep pointers to
- * pointers, so that we can easily realloc (the project where this file
- * originated from needed this for growing a "seed" matrix).
- *
- * FIXME Allocating one big chunk of memory is probably
- * much faster and also easier to maintain.
- * 
- * 
+ * The data is one packed block shared with the ClustalW and MUSCLE
+ * guide-tree code (see PackedDistMatrix.h), which may be stored with
+ * reduced precision or be file-backed for very large matrices.
  */
 
 #ifndef CLUSTALO_SYMMATRIX_H
 #define CLUSTALO_SYMMATRIX_H
 
+#include "../../../PackedDistMatrix.h"
+
 
 /**
  * @brief symmetric matrix structure
@@ -46,12 +43,10 @@ typedef struct {
     /**
      * stored data
      *
-     * @note indices range: [i][j-i] i<=j. use getvalue() and
-     * setvalue() instead of accessing directly
-     *
-     * @see SymMatrixGetValue(), SymMatrixSetValue()
+     * @note use SymMatrixGetValue() and SymMatrixSetValue() instead
+     * of accessing directly
      */
-    double **data; 
+    pdm_t data;
 } symmatrix_t;
 
 
@@ -65,9 +60,6 @@ SymMatrixSetValue(symmatrix_t *symmat, const int i, const int j, const double va
 extern double
 SymMatrixGetValue(symmatrix_t *symmat, const int i, const int j);
 
-extern void
-SymMatrixGetValueP(double **value, symmatrix_t *symmat, const int i, const int j);
-
 extern void
 FreeSymMatrix(symmatrix_t **symmat);
 
@@ -56,6 +56,9 @@ using std::ifstream;
 using std::ofstream;
 
 int iAux_GLOBAL;
+#ifdef _OPENMP
+#pragma omp threadprivate(iAux_GLOBAL)
+#endif
 
 #include "general.h"
 #include "util-C.h"     /* imax, fmax, iround, iceil, ifloor, strint, strscn, 
@@ -94,9 +97,6 @@ HMM *t;                 /* Create template HMM with maximum of MAXRES
 			  match states  */
 Alignment *qali;        /* (query alignment might be needed outside of hhfunc.C 
 			  for -a option) */
-Hit hit;               // Ceate new hit object pointed at by hit
-HitList hitlist;       /* list of hits with one Hit object for each 
-			  pairwise comparison done */
 char aliindices[256];  /* hash containing indices of all alignments 
 			  which to show in dot plot */
 char* dmapfile=NULL;   /* where to write the coordinates for the HTML map file 
@@ -692,6 +692,10 @@ hhalign(char **ppcFirstProf, int iFirstCnt, double *pdWeightsL,
 
 	v = 3;
 
+    /* hit and hitlist are not global (as in hhalign proper), 
+       so that several hhalign() can run at the same time */
+    Hit hit;                     // Ceate new hit object pointed at by hit
+
 #ifdef CLUSTALO
     int iRetVal = RETURN_OK;
     iAux_GLOBAL = iFlag;
@@ -810,6 +814,10 @@ hhalign(char **ppcFirstProf, int iFirstCnt, double *pdWeightsL,
     Alignment qali(iFirstCnt+iSecndCnt);
     HMM q(iFirstCnt+iSecndCnt);
     HMM t(iFirstCnt+iSecndCnt);
+    /* list of hits with one Hit object for each pairwise comparison done;
+       big (score/weight arrays), so not on the (thread's) stack */
+    HitList *prHitList = new HitList;
+    HitList &hitlist = *prHitList;
     //initialize
     static char const empty[] = "";
     strcpy(q.file, empty);
@@ -875,6 +883,7 @@ hhalign(char **ppcFirstProf, int iFirstCnt, double *pdWeightsL,
 		SetRnaSubstitutionMatrix();
 	}	
 	else {
+		nucleomode = false;
 		SetSubstitutionMatrix();
 	}
 
@@ -906,8 +915,17 @@ hhalign(char **ppcFirstProf, int iFirstCnt, double *pdWeightsL,
     const float MEMSPACE_DYNPROG = (double)1024*1024*rHhalignPara.iMacRamMB;
     // longest allowable length of database HMM
     int Lmaxmem=(int)((float)MEMSPACE_DYNPROG/qL/6/8); 
-    if (par.forward==2 && tL+2>=Lmaxmem) {
-        if (v>=1)
+    // ... if F_MM is the only full matrix of doubles (compact MAC, see Hit::AllocateForwardMatrix())
+    int Lmaxmem_compact=(int)((float)MEMSPACE_DYNPROG/qL/8);
+    char compact=0;
+    if (par.forward==2 && tL+2>=Lmaxmem && tL+2<Lmaxmem_compact && !Nstochali) {
+        if (v>=2)
+            cerr<<"Not sufficient memory for full MAC matrices. Using compact MAC matrices."<<endl;
+        compact=1;
+    }
+    else if (par.forward==2 && tL+2>=Lmaxmem) {
+        /* MAC-RAM=0 selects Viterbi on purpose, any other budget should not be left silently */
+        if (v>=1 || rHhalignPara.iMacRamMB>0)
             cerr<<"WARNING: Not sufficient memory to realign with MAC algorithm. Using Viterbi algorithm."<<endl;
         par.forward=0;
 
@@ -996,7 +1014,7 @@ hhalign(char **ppcFirstProf, int iFirstCnt, double *pdWeightsL,
   // Allocate memory for dynamic programming matrix
   hit.AllocateBacktraceMatrix(q.L+2,t.L+2); // ...with a separate dynamic programming matrix (memory!!)
   if (par.forward>=1 || Nstochali) 
-    hit.AllocateForwardMatrix(q.L+2,t.L+2);
+    hit.AllocateForwardMatrix(q.L+2,t.L+2,compact);
   if (par.forward==2)     
     hit.AllocateBackwardMatrix(q.L+2,t.L+2);
 
@@ -1414,6 +1432,7 @@ hhalign(char **ppcFirstProf, int iFirstCnt, double *pdWeightsL,
       t.ClobberGlobal();
   }
   hitlist.ClobberGlobal();
+  delete prHitList;
   
   return iRetVal;
 
@@ -245,3 +245,9 @@ float S73[NDSSP][NSSPRED][MAXCF];           // P[A][B][cf]       =  log2 P(A,B,c
 float S33[NSSPRED][MAXCF][NSSPRED][MAXCF];  // P[B][cf][B'][cf'] =  log2 sum_B' P(A,B',cf)/P(A)/P(B,cf) * P_b(B'|B)
 // float S77[NDSSP][DSSP];                  // P[A][B]           =  log2 P(A,B)/P(A)/P(B)
 
+#ifdef _OPENMP
+// Parameters and matrices are set up anew by each call of hhalign(); every thread 
+// has its own copy, so that independent profile-profile alignments can run in parallel
+#pragma omp threadprivate(v,par,P,R,Sim,S,pb,qav,S73,S33)
+#endif
+
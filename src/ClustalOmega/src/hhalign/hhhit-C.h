@@ -48,6 +48,21 @@ using std::ofstream;
 #include "hhhitlist.h"   // class HitList
 #endif
 
+// SSE2/AVX kernels for ProbFwdRow(), picked at run time
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define HHHIT_SSE2 1
+#include <immintrin.h>
+// GCC on Windows does not align the stack for 256-bit spills.
+#if !defined(_WIN32)
+#define HHHIT_AVX 1
+#else
+#define HHHIT_AVX 0
+#endif
+#else
+#define HHHIT_SSE2 0
+#define HHHIT_AVX 0
+#endif
+
 #define CALCULATE_MAX6(max, var1, var2, var3, var4, var5, var6, varb) \
 if (var1>var2) { max=var1; varb=STOP;} \
 else           { max=var2; varb=MM;}; \
@@ -78,6 +93,8 @@ if (var4>max)  { max=var4; varb=IM;};
 // Function declarations
 inline float Score(float* qi, float* tj);
 inline float ProbFwd(float* qi, float* tj);
+inline void ProfileByLetter(float** p, int L, float* tp, int stride);
+inline void ProbFwdRow(float* qi, const float* tp, int stride, int jfirst, int jlast, float* row);
 inline float max2(const float& xMM, const float& xX, char& b); 
 inline int pickprob2(const double& xMM, const double& xX, const int& state); 
 inline int pickprob3_GD(const double& xMM, const double& xDG, const double& xGD); 
@@ -109,6 +126,8 @@ Hit::Hit()
   Xcons = NULL;
   B_MM=B_MI=B_IM=B_DG=B_GD=NULL;
   F_MM=F_MI=F_IM=F_DG=F_GD=NULL;
+  compact = 0;
+  B_rows = NULL;
   cell_off = NULL;
   scale = NULL;
   sum_of_probs=0.0; 
@@ -232,10 +251,19 @@ Hit::DeleteBacktraceMatrix(int Nq)
 ///////////////////////////////////////////////////////////////////////////////
 /**
  * @brief Allocate/delete memory for Forward dynamic programming matrix
+ *
+ * Forward(), Backward() and MACAlignment() only look at the rows i-1, i and i+1 
+ * of F_MI, F_DG, F_IM and F_GD (and of B_MI etc., which are the same matrices).
+ * With compact=1 these four matrices therefore consist of two rows only: 
+ * row i is the same memory as row i%2. F_MM remains a full matrix (also for the 
+ * posterior probabilities, see Backward()). This needs a sixth of the memory 
+ * of the full matrices and gives exactly the same results for the MAC algorithm; 
+ * the stochastic backtrace and the debugging output need the full matrices.
  */
 void 
-Hit::AllocateForwardMatrix(int Nq, int Nt)
+Hit::AllocateForwardMatrix(int Nq, int Nt, char compact)
 {
+  this->compact=compact;
   F_MM=new double*[Nq];
   F_MI=new double*[Nq];
   F_DG=new double*[Nq];
@@ -245,6 +273,14 @@ Hit::AllocateForwardMatrix(int Nq, int Nt)
   for (int i=0; i<Nq; i++) 
     {
       F_MM[i] = new double[Nt];
+      if (compact && i>=2)
+	{
+	  F_MI[i] = F_MI[i%2];
+	  F_DG[i] = F_DG[i%2];
+	  F_IM[i] = F_IM[i%2];
+	  F_GD[i] = F_GD[i%2];
+	  continue;
+	}
       F_MI[i] = new double[Nt];
       F_DG[i] = new double[Nt];
       F_IM[i] = new double[Nt];
@@ -272,6 +308,7 @@ Hit::DeleteForwardMatrix(int Nq)
     if (NULL != F_MM){ /* FS, r259 -> r260 */
         for (int i=0; i<Nq; i++) {
             delete[] F_MM[i]; F_MM[i] = NULL;
+            if (compact && i>=2) continue; // same memory as rows 0 and 1
             delete[] F_MI[i]; F_MI[i] = NULL;
             delete[] F_IM[i]; F_IM[i] = NULL;
             delete[] F_GD[i]; F_GD[i] = NULL;
@@ -293,11 +330,20 @@ Hit::DeleteForwardMatrix(int Nq)
 void 
 Hit::AllocateBackwardMatrix(int Nq, int Nt)
 {
-  B_MM=new double*[Nq];
   B_MI=F_MI; 
   B_DG=F_DG; 
   B_IM=F_IM; 
   B_GD=F_GD; 
+  if (compact)
+    {
+      // Backward() keeps only two rows of B_MM, the posterior probabilities replace F_MM
+      B_MM=F_MM;
+      B_rows=new double*[Nq];
+      for (int i=0; i<Nq; i++) 
+	B_rows[i] = (i<2? new double[Nt] : B_rows[i%2]);
+      return;
+    }
+  B_MM=new double*[Nq];
   for (int i=0; i<Nq; i++) 
     {
       B_MM[i] = new double[Nt];
@@ -317,10 +363,19 @@ void Hit::DeleteBackwardMatrix(int Nq)
 {
 
     if (NULL != B_MM){ /* FS, r259 -> r260 */
-        for (int i=0; i<Nq; i++) {
-            delete[] B_MM[i]; B_MM[i] = NULL;  /* is this all? FS */
+        if (compact) {
+            // B_MM is F_MM, which is deleted in DeleteForwardMatrix()
+            delete[] B_rows[0]; 
+            delete[] B_rows[1];
+            delete[] B_rows; B_rows = NULL;
+        }
+        else {
+            for (int i=0; i<Nq; i++) {
+                delete[] B_MM[i]; B_MM[i] = NULL;  /* is this all? FS */
+            }
+            delete[] B_MM; 
         }
-        delete[] B_MM; B_MM = NULL;
+        B_MM = NULL;
         B_MM=B_MI=B_IM=B_DG=B_GD=NULL;
     }
 }
@@ -383,6 +438,11 @@ Hit::Viterbi(HMM& q, HMM& t, float** Sstruc)
     float sMM_i_j=0, sMI_i_j=0, sIM_i_j=0, sGD_i_j=0, sDG_i_j=0;
     float sMM_i_1_j_1=0, sMI_i_1_j_1=0, sIM_i_1_j_1=0, sGD_i_1_j_1=0, sDG_i_1_j_1=0;
     int jmin=0, jmax=0;
+    int stride = t.L+1;
+    float *tp = new float[20*stride];        // letter-major copy of t.p (see ProfileByLetter())
+    float *pAA = new float[stride];          // pAA[j] = ProbFwd(q.p[i],t.p[j]) for the present row i
+
+  ProfileByLetter(t.p,t.L,tp,stride);
 
   // Reset crossed out cells?
   if(irep==1) InitializeForAlignment(q,t);
@@ -435,6 +495,7 @@ Hit::Viterbi(HMM& q, HMM& t, float** Sstruc)
       if (jmax<t.L) // initialize at (i-1,jmmax) if upper right triagonal is excluded due to min overlap
 	sMM[jmax] = sIM[jmax] = sMI[jmax] = sDG[jmax] = sGD[jmax] = -FLT_MAX; 
       sIM[jmin-1] = sMI[jmin-1] = sDG[jmin-1] = sGD[jmin-1] = -FLT_MAX; // initialize at (i,jmin-1)
+      ProbFwdRow(q.p[i],tp,stride,jmin,jmax,pAA);
       
       for (j=jmin; j<=jmax; j++) // Loop through template positions j
 	{
@@ -462,7 +523,7 @@ Hit::Viterbi(HMM& q, HMM& t, float** Sstruc)
 			      sMI_i_1_j_1 + q.tr[i-1][M2M] + t.tr[j-1][I2M],
 			      bMM[i][j]
 			      );
- 	      sMM_i_j += Score(q.p[i],t.p[j]) + ScoreSS(q,t,i,j) + par.shift 
+ 	      sMM_i_j += fast_log2(pAA[j]) + ScoreSS(q,t,i,j) + par.shift 
 		+ (Sstruc==NULL? 0: Sstruc[i][j]); 
 	      
 
@@ -540,6 +601,8 @@ Hit::Viterbi(HMM& q, HMM& t, float** Sstruc)
   delete[] sDG; sDG = NULL;
   delete[] sIM; sIM = NULL;
   delete[] sMI; sMI = NULL;
+  delete[] tp; tp = NULL;
+  delete[] pAA; pAA = NULL;
 
   return;
 
@@ -562,6 +625,9 @@ Hit::Forward(HMM& q, HMM& t, float** Pstruc)
     double Pmax_i;                        // maximum of F_MM in row i
     double scale_prod=1.0;                // Prod_i=1^i (scale[i])
     int jmin;  
+    int stride = t.L+1;
+    float *tp = new float[20*stride];     // letter-major copy of t.p (see ProfileByLetter())
+    float *pAA = new float[stride];       // pAA[j] = ProbFwd(q.p[i],t.p[j]) for the present row i
     
     // First alignment of this pair of HMMs?
     if(irep==1) 
@@ -589,13 +655,15 @@ Hit::Forward(HMM& q, HMM& t, float** Pstruc)
     
     // Initialization of top row, i.e. cells (0,j)
     F_MM[1][0] = F_IM[1][0] = F_GD[1][0] =  F_MM[0][1] = F_MI[0][1] = F_DG[0][1] = 0.0;
+    ProfileByLetter(t.p,t.L,tp,stride);
+    ProbFwdRow(q.p[1],tp,stride,1,t.L,pAA);
     for (j=1; j<=t.L; j++) 
         {
             if (cell_off[1][j]) 
                 F_MM[1][j] = F_MI[1][j] = F_DG[1][j] = F_IM[1][j] = F_GD[1][j] = 0.0;
             else 
                 {
-                    F_MM[1][j] = ProbFwd(q.p[1],t.p[j]) * fpow2(ScoreSS(q,t,1,j)) * Cshift * (Pstruc==NULL? 1: Pstruc[1][j]) ;
+                    F_MM[1][j] = pAA[j] * fpow2(ScoreSS(q,t,1,j)) * Cshift * (Pstruc==NULL? 1: Pstruc[1][j]) ;
                     F_MI[1][j] = F_DG[1][j] = 0.0;
                     F_IM[1][j] = F_MM[1][j-1] * q.tr[1][M2I] * t.tr[j-1][M2M] + F_IM[1][j-1] * q.tr[1][I2I] * t.tr[j-1][M2M];
                     F_GD[1][j] = F_MM[1][j-1] * t.tr[j-1][M2D]                + F_GD[1][j-1] * t.tr[j-1][D2D];
@@ -611,13 +679,14 @@ Hit::Forward(HMM& q, HMM& t, float** Pstruc)
             if (self) jmin = imin(i+SELFEXCL+1,t.L); else jmin=1;
             
             if (scale_prod<DBL_MIN*100) scale_prod = 0.0; else scale_prod *= scale[i];
+            ProbFwdRow(q.p[i],tp,stride,jmin,t.L,pAA);
             
             // Initialize cells at (i,0)
             if (cell_off[i][jmin]) 
                 F_MM[i][jmin] = F_MI[i][jmin] = F_DG[i][jmin] = F_IM[i][jmin] = F_GD[i][jmin] = 0.0;
             else 
                 {
-                    F_MM[i][jmin] = scale_prod * ProbFwd(q.p[i],t.p[jmin]) * fpow2(ScoreSS(q,t,i,jmin)) * Cshift * (Pstruc==NULL? 1: Pstruc[i][jmin]);
+                    F_MM[i][jmin] = scale_prod * pAA[jmin] * fpow2(ScoreSS(q,t,i,jmin)) * Cshift * (Pstruc==NULL? 1: Pstruc[i][jmin]);
                     F_IM[i][jmin] = F_GD[i][jmin] = 0.0; 
                     F_MI[i][jmin] = scale[i] * (F_MM[i-1][jmin] * q.tr[i-1][M2M] * t.tr[jmin][M2I] + F_MI[i-1][jmin] * q.tr[i-1][M2M] * t.tr[jmin][I2I]);
                     F_DG[i][jmin] = scale[i] * (F_MM[i-1][jmin] * q.tr[i-1][M2D]                   + F_DG[i-1][jmin] * q.tr[i-1][D2D]);
@@ -633,7 +702,7 @@ Hit::Forward(HMM& q, HMM& t, float** Pstruc)
                         F_MM[i][j] = F_MI[i][j] = F_DG[i][j] = F_IM[i][j] = F_GD[i][j] = 0.0;
                     else
                         {
-                            F_MM[i][j] = ProbFwd(q.p[i],t.p[j]) * fpow2(ScoreSS(q,t,i,j)) * Cshift * (Pstruc==NULL? 1: Pstruc[i][j]) * scale[i] *
+                            F_MM[i][j] = pAA[j] * fpow2(ScoreSS(q,t,i,j)) * Cshift * (Pstruc==NULL? 1: Pstruc[i][j]) * scale[i] *
                                 ( pmin
                                   + F_MM[i-1][j-1] * q.tr[i-1][M2M] * t.tr[j-1][M2M] // BB -> MM (BB = Begin/Begin, for local alignment)
                                   + F_GD[i-1][j-1] * q.tr[i-1][M2M] * t.tr[j-1][D2M] // GD -> MM
@@ -671,6 +740,8 @@ Hit::Forward(HMM& q, HMM& t, float** Pstruc)
             //      scale[i+1] = 1.0;
             
         } // end for i
+    delete[] tp; tp = NULL;
+    delete[] pAA; pAA = NULL;
     
     // Calculate P_forward * Product_{i=1}^{Lq+1}(scale[i])
     if (par.loc) 
@@ -708,8 +779,8 @@ Hit::Forward(HMM& q, HMM& t, float** Pstruc)
                 score=score-log(t.L*q.L)/LAMDA+14.; // +14.0 to get approx same mean as for -global
         }
     
-    // Debugging output
-    if (v>=6) 
+    // Debugging output (needs the full matrices)
+    if (v>=6 && !compact) 
         {
             const int i0=0, i1=q.L;
             const int j0=0, j1=t.L;
@@ -772,7 +843,15 @@ Hit::Backward(HMM& q, HMM& t)
     double Cshift = pow(2.0,par.shift);   // score offset transformed into factor in lin-space
     double scale_prod=scale[q.L+1];
     int jmin;
+    int stride = t.L+1;
+    float *tp = new float[20*stride];     // letter-major copy of t.p (see ProfileByLetter())
+    float *pAA = new float[stride];       // pAA[j] = ProbFwd(q.p[i+1],t.p[j]) for the present row i
     //double dMaxB = -1.0;
+
+    // compact: B_MM holds only the rows i and i+1 during the recursion. As soon as row i+1 
+    // is no longer needed, its posterior probabilities are written to F_MM; 
+    // B_MM and F_MM are the same matrix afterwards (see AllocateForwardMatrix()).
+    if (compact) B_MM = B_rows;
     
     // Initialization of top row, i.e. cells (0,j)
     for (j=t.L; j>=1; j--) 
@@ -785,6 +864,7 @@ Hit::Backward(HMM& q, HMM& t)
             B_IM[q.L][j] = B_MI[q.L][j] = B_DG[q.L][j] = B_GD[q.L][j] = 0.0;
         }
     if (par.loc) pmin = scale[q.L+1]; // transform pmin (for local alignment) to scale of present (i'th) row 
+    ProfileByLetter(t.p,t.L,tp,stride);
     
     // Backward algorithm
     for (i=q.L-1; i>=1; i--) // Loop through query positions i
@@ -805,6 +885,7 @@ Hit::Backward(HMM& q, HMM& t)
             //dMaxB = dMaxB>B_MM[i][t.L]?dMaxB:B_MM[i][t.L];
             B_IM[i][t.L] = B_MI[i][t.L] = B_DG[i][t.L] = B_GD[i][t.L] = 0.0; 
             pmin *= scale[i+1]; // transform pmin (for local alignment) to scale of present (i'th) row 
+            ProbFwdRow(q.p[i+1],tp,stride,jmin+1,t.L,pAA);
             
             for (j=t.L-1; j>=jmin; j--) // Loop through template positions j
                 {
@@ -814,7 +895,7 @@ Hit::Backward(HMM& q, HMM& t)
                         B_MM[i][j] = B_GD[i][j] = B_IM[i][j] = B_DG[i][j] = B_MI[i][j] = 0.0;  
                     else 
                         {
-                            double pmatch = B_MM[i+1][j+1] * ProbFwd(q.p[i+1],t.p[j+1]) * fpow2(ScoreSS(q,t,i+1,j+1)) * Cshift * scale[i+1];
+                            double pmatch = B_MM[i+1][j+1] * pAA[j+1] * fpow2(ScoreSS(q,t,i+1,j+1)) * Cshift * scale[i+1];
                             //if (isnan(pmatch)||isinf(pmatch)){
                             //  printf("."); /* <DEBUG> FS*/
                             //}
@@ -859,10 +940,22 @@ Hit::Backward(HMM& q, HMM& t)
                     
                 } //end for j
             
+            if (compact) 
+                for (j=1; j<=t.L; j++) 
+                    F_MM[i+1][j] = B_MM[i+1][j] * (F_MM[i+1][j]/Pforward);
+            
         } // end for i
+    delete[] tp; tp = NULL;
+    delete[] pAA; pAA = NULL;
+    if (compact) 
+        {
+            for (j=1; j<=t.L; j++) 
+                F_MM[1][j] = B_MM[1][j] * (F_MM[1][j]/Pforward);
+            B_MM = F_MM;
+        }
     
-    // Debugging output
-    if (v>=6)
+    // Debugging output (needs the full matrices)
+    if (v>=6 && !compact)
         {
             const int i0=0, i1=q.L;
             const int j0=0, j1=t.L;
@@ -901,6 +994,7 @@ Hit::Backward(HMM& q, HMM& t)
     if (v>=4) printf("\nForward total probability ratio: %8.3G\n",Pforward);
     
     // Calculate Posterior matrix and overwrite Backward matrix with it
+    if (!compact)
     for (i=1; i<=q.L; i++) {
         for (j=1; j<=t.L; j++) { 
             B_MM[i][j] *= F_MM[i][j]/Pforward;
@@ -1017,8 +1111,8 @@ Hit::MACAlignment(HMM& q, HMM& t)
       
     } // end for i
   
-  // DEBUG
-  if (v>=5) 
+  // DEBUG (needs the full matrix S)
+  if (v>=5 && !compact) 
     {
       printf("\nScore  ");
       for (j=0; j<=t.L; j++) printf("%3i   ",j);
@@ -1772,6 +1866,116 @@ ProbFwd(float* qi, float* tj)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////
+// Row kernels for Viterbi(), Forward() and Backward()
+/////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The recursions need ProbFwd(q.p[i],t.p[j]) (or its log, Score()) for every
+ * cell of a row. ProbFwdRow() computes it for a range of template columns at
+ * once, several columns at a time with SSE2 or AVX, from a letter-major copy
+ * of t.p. Every value is summed with the same float operations in the same
+ * order as in ProbFwd(), so the results are exactly those of the scalar code.
+ */
+
+enum HHSimdLevel {HHSIMD_NONE, HHSIMD_SSE2, HHSIMD_AVX};
+
+static HHSimdLevel
+DetectSimd()
+{
+#if HHHIT_AVX
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx"))
+    return HHSIMD_AVX;
+#endif
+#if HHHIT_SSE2
+  return HHSIMD_SSE2;
+#else
+  return HHSIMD_NONE;
+#endif
+}
+
+/**
+ * @brief Letter-major copy of a profile: tp[a*stride+j] = p[j][a] for j=0..L
+ */
+inline void
+ProfileByLetter(float** p, int L, float* tp, int stride)
+{
+  for (int a=0; a<20; a++)
+    for (int j=0; j<=L; j++)
+      tp[a*stride+j] = p[j][a];
+}
+
+static void
+ProbFwdRowScalar(float* qi, const float* tp, int stride, int jfirst, int jlast, float* row)
+{
+  for (int j=jfirst; j<=jlast; j++)
+    {
+      float sum = tp[j]*qi[0];
+      for (int a=1; a<20; a++)
+	sum += tp[a*stride+j]*qi[a];
+      row[j] = sum;
+    }
+}
+
+#if HHHIT_SSE2
+static void
+ProbFwdRowSSE2(float* qi, const float* tp, int stride, int jfirst, int jlast, float* row)
+{
+  int j=jfirst;
+  for (; j+3<=jlast; j+=4)
+    {
+      __m128 sum = _mm_mul_ps(_mm_loadu_ps(tp+j), _mm_set1_ps(qi[0]));
+      for (int a=1; a<20; a++)
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(tp+a*stride+j), _mm_set1_ps(qi[a])));
+      _mm_storeu_ps(row+j, sum);
+    }
+  ProbFwdRowScalar(qi, tp, stride, j, jlast, row);
+}
+#endif
+
+#if HHHIT_AVX
+__attribute__((target("avx")))
+static void
+ProbFwdRowAVX(float* qi, const float* tp, int stride, int jfirst, int jlast, float* row)
+{
+  int j=jfirst;
+  for (; j+7<=jlast; j+=8)
+    {
+      __m256 sum = _mm256_mul_ps(_mm256_loadu_ps(tp+j), _mm256_set1_ps(qi[0]));
+      for (int a=1; a<20; a++)
+	sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(tp+a*stride+j), _mm256_set1_ps(qi[a])));
+      _mm256_storeu_ps(row+j, sum);
+    }
+  ProbFwdRowScalar(qi, tp, stride, j, jlast, row);
+}
+#endif
+
+/**
+ * @brief row[j] = ProbFwd(qi,t.p[j]) for jfirst<=j<=jlast; tp is the copy made by ProfileByLetter()
+ */
+inline void
+ProbFwdRow(float* qi, const float* tp, int stride, int jfirst, int jlast, float* row)
+{
+  static const HHSimdLevel level = DetectSimd();
+  switch (level)
+    {
+#if HHHIT_AVX
+    case HHSIMD_AVX:
+      ProbFwdRowAVX(qi, tp, stride, jfirst, jlast, row);
+      return;
+#endif
+#if HHHIT_SSE2
+    case HHSIMD_SSE2:
+      ProbFwdRowSSE2(qi, tp, stride, jfirst, jlast, row);
+      return;
+#endif
+    default:
+      ProbFwdRowScalar(qi, tp, stride, jfirst, jlast, row);
+    }
+}
+
+
 /**
  * @brief Calculate secondary structure score between columns i and j of two HMMs (query and template)
  */
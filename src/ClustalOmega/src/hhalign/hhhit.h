@@ -104,7 +104,7 @@ class Hit
   // Allocate/delete memory for dynamic programming matrix
   void AllocateBacktraceMatrix(int Nq, int Nt);
   void DeleteBacktraceMatrix(int Nq);
-  void AllocateForwardMatrix(int Nq, int Nt);
+  void AllocateForwardMatrix(int Nq, int Nt, char compact=0);
   void DeleteForwardMatrix(int Nq);
   void AllocateBackwardMatrix(int Nq, int Nt);
   void DeleteBackwardMatrix(int Nq);
@@ -176,6 +176,9 @@ private:
   double** B_IM;        // end gaps are not penalized!
   double** B_MI;        // 
 
+  char compact;         // 1: F_MM is the only full matrix for Forward/Backward/MAC (see AllocateForwardMatrix())
+  double** B_rows;      // compact: Backward values of MM, only rows i and i+1 are kept
+
   void InitializeBacktrace(HMM& q, HMM& t);
   void InitializeForAlignment(HMM& q, HMM& t);
 };
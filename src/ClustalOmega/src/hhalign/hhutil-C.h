@@ -21,6 +21,9 @@
 #define PARAMETERSFROMFILE 0
 
 extern bool nucleomode;
+#ifdef _OPENMP
+#pragma omp threadprivate(nucleomode)
+#endif
  
 //////////////////////////////////////////////////////////////////////////////
 // Transform a character to lower case and '.' to '-' and vice versa
@@ -97,6 +97,10 @@ inline float fast_log2(float x)
   return a + lg2[b] + diff[b]*(float)(c);
 }
 
+// Fill in the tables of fast_log2() when the program is loaded, before hhalign()
+// is run in several threads (the check of 'initialized' above is not thread-safe)
+static struct FastLog2Init { FastLog2Init() { fast_log2(1.0f); } } fast_log2_init;
+
 /////////////////////////////////////////////////////////////////////////////////////
 // fast 2^x
 // ATTENTION: need to compile with g++ -fno-strict-aliasing when using -O2 or -O3!!!
@@ -19,11 +19,11 @@ void AddKMeansLogging(std::ostream *out, bool verbose);
 */
 Scalar
 RunKMeansPlusPlus(int n, int k, int d, Scalar *points, int attempts,
-                         Scalar *centers, int *assignments);
+                         Scalar *centers, int *assignments, unsigned int seed);
 
 Scalar
 RunKMeans(int n, int k, int d, Scalar *points, int attempts,
-                 Scalar *centers, int *assignments);
+                 Scalar *centers, int *assignments, unsigned int seed);
 #else
 #include "KMeans.h"
 #endif
@@ -35,16 +35,16 @@ RunKMeans(int n, int k, int d, Scalar *points, int attempts,
 #ifdef CLUSTALO
 extern "C" double
 KMeans(int n, int k, int d, Scalar *points, int attempts, int use_lloyds_method,
-       double *centers, int *assignments)
+       double *centers, int *assignments, unsigned int seed)
 {
     if (use_lloyds_method) {
         /*fprintf(stderr, "FIXME using LLoyd's method\n");*/
         return RunKMeans(n, k, d, points, attempts,
-                          centers, assignments);
+                          centers, assignments, seed);
     } else {
         /*fprintf(stderr, "FIXME using KMeansPP method\n");*/
         return RunKMeansPlusPlus(n, k, d, points, attempts,
-                                  centers, assignments);
+                                  centers, assignments, seed);
     }
 }
 #endif
@@ -132,7 +132,7 @@ void LogMetaStats(Scalar min_cost, Scalar max_cost, Scalar total_cost,
 
 // See KMeans.h
 Scalar RunKMeans(int n, int k, int d, Scalar *points, int attempts,
-                 Scalar *ret_centers, int *ret_assignment) {
+                 Scalar *ret_centers, int *ret_assignment, unsigned int seed) {
   KM_ASSERT(k >= 1);
   
   // Create the tree and log
@@ -146,6 +146,8 @@ Scalar RunKMeans(int n, int k, int d, Scalar *points, int attempts,
   KM_ASSERT(centers != 0 && unused_centers != 0);
   Scalar min_cost = -1, max_cost = -1, total_cost = 0;
   double min_time = -1, max_time = -1, total_time = 0;
+  KmRandomState random_state;
+  KmSeedRandom(&random_state, seed);
   
   // Handle k > n
   if (k > n) {
@@ -162,7 +164,7 @@ Scalar RunKMeans(int n, int k, int d, Scalar *points, int attempts,
       unused_centers[i] = i;
     int num_unused_centers = n;
     for (int i = 0; i < k; i++) {
-      int j = GetRandom(num_unused_centers--);
+      int j = GetRandom(&random_state, num_unused_centers--);
       memcpy(centers + i*d, points + unused_centers[j]*d, d*sizeof(Scalar));
       unused_centers[j] = unused_centers[num_unused_centers];
     }
@@ -181,7 +183,7 @@ Scalar RunKMeans(int n, int k, int d, Scalar *points, int attempts,
 
 // See KMeans.h
 Scalar RunKMeansPlusPlus(int n, int k, int d, Scalar *points, int attempts,
-                         Scalar *ret_centers, int *ret_assignment) {
+                         Scalar *ret_centers, int *ret_assignment, unsigned int seed) {
   KM_ASSERT(k >= 1);
 
   // Create the tree and log
@@ -194,13 +196,15 @@ Scalar RunKMeansPlusPlus(int n, int k, int d, Scalar *points, int attempts,
   KM_ASSERT(centers != 0);
   Scalar min_cost = -1, max_cost = -1, total_cost = 0;
   double min_time = -1, max_time = -1, total_time = 0;
+  KmRandomState random_state;
+  KmSeedRandom(&random_state, seed);
 
   // Run all the attempts
   for (int attempt = 0; attempt < attempts; attempt++) {
     double start_time = GetSeconds();
 
     // Choose centers using k-means++ seeding
-    tree.SeedKMeansPlusPlus(k, centers);
+    tree.SeedKMeansPlusPlus(k, centers, &random_state);
     
     // Run k-means
     RunKMeansOnce(tree, n, k, d, points, centers, &min_cost, &max_cost, &total_cost, start_time,
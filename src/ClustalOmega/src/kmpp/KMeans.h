@@ -33,24 +33,26 @@ void AddKMeansLogging(std::ostream *out, bool verbose);
 //   - assignments: This can either be null or an array of size n. In the latter case, it will be
 //                  filled with the cluster that each point is assigned to (an integer between 0
 //                  and k-1 inclusive).
+//   - seed: Seed for the random choice of starting centers. The same seed gives the same result.
 // The final cost of the clustering is also returned.
 // The final cost of the clustering is also returned.
 Scalar RunKMeans(int n, int k, int d, Scalar *points, int attempts,
-                 Scalar *centers, int *assignments);
+                 Scalar *centers, int *assignments, unsigned int seed);
 
 // Runs k-means++ on the given set of points. Set RunKMeans for info on the parameters.
 Scalar RunKMeansPlusPlus(int n, int k, int d, Scalar *points, int attempts,
-                         Scalar *centers, int *assignments);
+                         Scalar *centers, int *assignments, unsigned int seed);
 
 #else
 
 /* CLUSTALO PATCH:
  * same as above, with one addition: if use_lloyds_method is false, kmpp will be used
  * otherwise the 'classical' i.e. Looyd's method will be used
+ * Calls with different point sets may run concurrently.
  */
 extern double
 KMeans(int n, int k, int d, double *points, int attempts, int use_lloyds_method,
-                 double *centers, int *assignments);
+                 double *centers, int *assignments, unsigned int seed);
 
 #endif
 #endif
@@ -284,13 +284,13 @@ bool KmTree::ShouldBePruned(Scalar *box_median, Scalar *box_radius, Scalar *cent
   return (lhs >= 2*rhs);
 }
 
-Scalar KmTree::SeedKMeansPlusPlus(int k, Scalar *centers) const {
+Scalar KmTree::SeedKMeansPlusPlus(int k, Scalar *centers, KmRandomState *random_state) const {
   Scalar *dist_sq = (Scalar*)malloc(n_ * sizeof(Scalar));
   KM_ASSERT(dist_sq != 0);
 
   // Choose an initial center uniformly at random
   SeedKmppSetClusterIndex(top_node_, 0);
-  int i = GetRandom(n_);
+  int i = GetRandom(random_state, n_);
   memcpy(centers, points_ + point_indices_[i]*d_, d_*sizeof(Scalar));
   Scalar total_cost = 0;
   for (int j = 0; j < n_; j++) {
@@ -301,7 +301,7 @@ Scalar KmTree::SeedKMeansPlusPlus(int k, Scalar *centers) const {
   // Repeatedly choose more centers
   for (int new_cluster = 1; new_cluster < k; new_cluster++) {
     while (1) {
-      Scalar cutoff = (rand() / Scalar(RAND_MAX)) * total_cost;
+      Scalar cutoff = (KmRandom(random_state) / Scalar(KM_RAND_MAX)) * total_cost;
       Scalar cur_cost = 0;
       for (i = 0; i < n_; i++) {
         cur_cost += dist_sq[i];
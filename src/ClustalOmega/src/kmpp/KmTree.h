@@ -38,8 +38,8 @@ class KmTree {
 
   // Choose k initial centers for k-means using the kmeans++ seeding procedure. The resulting
   // centers are returned via the centers variable, which should be pre-allocated to size k*d.
-  // The cost of the initial clustering is returned.
-  Scalar SeedKMeansPlusPlus(int k, Scalar *centers) const;
+  // The cost of the initial clustering is returned. Random numbers are taken from random_state.
+  Scalar SeedKMeansPlusPlus(int k, Scalar *centers, KmRandomState *random_state) const;
 
  private:
   struct Node {
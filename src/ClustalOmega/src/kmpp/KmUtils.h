@@ -74,12 +74,34 @@ int __KMeansAssertionFailure(const char *file, int line, const char *expression)
 // Miscellaneous utilities
 // =======================
 
-// Returns a random integer chosen uniformly from the range [0, n-1]. Note that RAND_MAX could be
-// less than n. On Visual Studio, it is only 32767. For larger values of RAND_MAX, we need to be
-// careful of overflow.
-inline int GetRandom(int n) {
-  int u = rand() * RAND_MAX + rand();
-  return ((u % n) + n) % n;
+// CLUSTALO PATCH: random numbers come from a small generator (xorshift) whose state is passed
+// explicitly instead of rand(). Runs of k-means can then be done in parallel, and each run is
+// reproducible from its seed.
+typedef unsigned int KmRandomState;
+#define KM_RAND_MAX 0x7fffffff
+
+inline void KmSeedRandom(KmRandomState *state, unsigned int seed) {
+  // Spread consecutive seeds; the state must not be 0
+  unsigned int x = seed * 2654435761u + 0x6d2b79f5u;
+  x ^= x >> 15;
+  x *= 0x2c1b3c6du;
+  x ^= x >> 12;
+  *state = (x != 0? x : 1);
+}
+
+// Returns a random integer chosen uniformly from the range [0, KM_RAND_MAX].
+inline int KmRandom(KmRandomState *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return (int)(x >> 1);
+}
+
+// Returns a random integer chosen uniformly from the range [0, n-1].
+inline int GetRandom(KmRandomState *state, int n) {
+  return KmRandom(state) % n;
 }
 
 #endif
@@ -469,7 +469,9 @@ main(int argc, char **argv)
 
     ConvertOldCmdline(&new_argc, &new_argv, argc, argv);
     
+    AlnRowsInit(&msaOutput.msa);
     executeClustalOmega(new_argc, new_argv, &msaInput, &msaOutput);
+    AlnRowsFree(&msaOutput.msa);
     
     for (i=0; i<new_argc; i++) {
         free(new_argv[i]);
@@ -1177,7 +1177,7 @@ executeClustalOmega(int argc, char **argv, ClustalOmegaInput *msaInput, ClustalO
         if (cmdline_opts.aln_opts.iMaxHMMIterations >= 0){
             if (WriteAlignment(prMSeq, cmdline_opts.pcAlnOutfile,
                                cmdline_opts.iAlnOutFormat, cmdline_opts.iWrap, cmdline_opts.bResno,
-                               &msaOutput->msa_c, &msaOutput->msa_v)) {
+                               &msaOutput->msa)) {
                 Log(&rLog, LOG_FATAL, "Could not save alignment to %s", cmdline_opts.pcAlnOutfile);
             }
         }
@@ -1197,7 +1197,7 @@ executeClustalOmega(int argc, char **argv, ClustalOmegaInput *msaInput, ClustalO
         }
         if (WriteAlignment(prMSeqProfile1, cmdline_opts.pcAlnOutfile,
                            cmdline_opts.iAlnOutFormat, cmdline_opts.iWrap, cmdline_opts.bResno,
-                           &msaOutput->msa_c, &msaOutput->msa_v)) {
+                           &msaOutput->msa)) {
             Log(&rLog, LOG_FATAL, "Could not save alignment to %s", cmdline_opts.pcAlnOutfile);
         }
     }
@@ -16,6 +16,8 @@
  *  RCS $Id: mymain.h 97 2010-07-12 15:30:26Z andreas $
  */
 
+#include "../../AlignedRows.h"
+
 typedef struct {
 	int seqLength;
 	char **inputSeqs;
@@ -24,8 +26,7 @@ typedef struct {
 } ClustalOmegaInput;
 
 typedef struct { //can be use for further result objects
-	char **msa_v; //multiple sequence alignment
-	int msa_c;
+	aln_rows_t msa; //multiple sequence alignment
 } ClustalOmegaOutput;
 
 
@@ -45,9 +45,10 @@ Help::Help()
 " \n"
 " The UPGMA algorithm has been added to allow faster tree construction. The user now\n"
 " has the choice of using Neighbour Joining or UPGMA. The default is still NJ, but the\n"
-" user can change this by setting the clustering parameter.\n"
+" user can change this by setting the clustering parameter. FASTNJ builds the same\n"
+" tree as NJ, but searches the pair to join faster on large data sets.\n"
 " \n"
-" -CLUSTERING=   :NJ or UPGMA\n"
+" -CLUSTERING=   :NJ, UPGMA or FASTNJ\n"
 " \n"
 "==ITERATION==\n"
 "\n"
@@ -727,7 +728,7 @@ Help::Help()
 "-KIMURA        :use Kimura's correction.   \n"
 "-TOSSGAPS      :ignore positions with gaps.\n"
 "-BOOTLABELS=node OR branch :position of bootstrap values in tree display\n"
-"-CLUSTERING=   :NJ or UPGMA\n"
+"-CLUSTERING=   :NJ, UPGMA or FASTNJ\n"
 "";
     sections.push_back(s);
 
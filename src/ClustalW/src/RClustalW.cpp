@@ -614,6 +614,15 @@ SEXP RClustalW(SEXP rInputSeqs,
             args.push_back(std::string(" TOPDIAGS=" + topdiags));
         }
 
+        //params$threads
+        if (hasClustalWEntry(rparam, "threads")) {
+            int threads2 = as<int>(rparam["threads"]);
+            stringstream threads1;
+            threads1<<threads2;
+            string threads = threads1.str();
+            args.push_back(std::string(" THREADS=" + threads));
+        }
+
         //params$tossgaps
         if (hasClustalWEntry(rparam, "tossgaps")) {
             bool tossgaps = as<bool>(rparam["tossgaps"]);
@@ -668,7 +677,7 @@ SEXP RClustalW(SEXP rInputSeqs,
 
         //return a more sophisticated object in later versions,
         //for now, we only return multiple sequence alignment
-        retList = Rcpp::List::create(Rcpp::Named("msa") = Rcpp::CharacterVector(output.msa.begin(), output.msa.end()));
+        retList = AlnRowsToR(&output.msa);
 
         if (fileExists("internalRsequence.aln")) {
         	remove("internalRsequence.aln");
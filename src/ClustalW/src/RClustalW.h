@@ -2,6 +2,7 @@
 #define RCLUSTALW_H
 
 #include <Rcpp.h>
+#include "../../AlignedRows.h"
  
 /*
  * note : RcppExport is an alias to `extern "C"` defined by Rcpp.
@@ -31,7 +32,12 @@ struct ClustalWInput {
 };
 
 struct ClustalWOutput { //can be use for further result objects
-    std::vector<std::string> msa; //multiple sequence alignment
+    aln_rows_t msa; //multiple sequence alignment
+
+    ClustalWOutput() { AlnRowsInit(&msa); }
+    ~ClustalWOutput() { AlnRowsFree(&msa); }
+    ClustalWOutput(const ClustalWOutput &) = delete;
+    ClustalWOutput &operator=(const ClustalWOutput &) = delete;
 };
 
 #endif
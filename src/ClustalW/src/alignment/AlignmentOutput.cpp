@@ -138,7 +138,7 @@ void AlignmentOutput::createAlignmentOutput(Alignment* alignPtr, int firstSeq, i
         {
             //if(clustalOutFile.get() != 0 && clustalOutFile->is_open())
             //{
-                clustalOut(alignPtr, partToOutput, output);
+                alignedRowsOut(alignPtr, partToOutput, output);
                 //if(clustalOutFile->is_open())
                 //{
                     clustalOutFile->close();
@@ -219,7 +219,7 @@ void AlignmentOutput::createAlignmentOutput(Alignment* alignPtr, int firstSeq, i
         {
             //if(fastaOutFile.get() != 0 && fastaOutFile->is_open())
             //{
-                fastaOut(alignPtr, partToOutput, output);
+                alignedRowsOut(alignPtr, partToOutput, output);
                 //if(fastaOutFile->is_open())
                 //{
                     fastaOutFile->close();
@@ -576,126 +576,6 @@ string AlignmentOutput::openOutputFile(auto_ptr<ofstream>& outFile, string promp
     return _fileName;
 }
 
-/*
- * fastaOut: output the alignment in FASTA format
- */
-void AlignmentOutput::fastaOut(Alignment* alignPtr, outputRegion partToOutput, ClustalWOutput *output)
-{
-	stringstream line;
-    char residue;
-    int val;
-    int i, ii;
-    int j, slen;    
-    int lineLength;
-    int firstRes = partToOutput._firstRes;
-    int lastRes = partToOutput._lastRes;
-    int firstSeq = partToOutput._firstSeq;
-    int lastSeq = partToOutput._lastSeq;
-    rangeNum rnum;  
-    cout << "firstres = " << firstRes << " lastres = " << lastRes << "\n";
-    try
-    {
-        const SeqArray* alignment = alignPtr->getSeqArray(); //NOTE june29
-        vector<char> sequence;
-        sequence.assign(lastRes + 1, '0');     
-    
-        lineLength = PAGEWIDTH - alignPtr->getMaxNames();
-                
-        lineLength = lineLength - lineLength % 10; // round to a multiple of 10
-        if (lineLength > LINELENGTH || lineLength <= 0) // Mark 18-7-07
-        {    
-            lineLength = LINELENGTH;
-        }
-
-
-        for(ii = firstSeq; ii <= lastSeq; ii++) 
-        {
-            i = alignPtr->getOutputIndex(ii - 1);
-            slen = 0;
-            //for(j = firstRes; j < firstRes + lastRes; j++) //- nige
-            for(j = firstRes; j <= lastRes; j++) //- nige
-            {
-                if (j <= alignPtr->getSeqLength(i))
-                {
-                    //val = alignPtr.getResidue(i, j);
-                    val = (*alignment)[i][j]; // NOTE june29
-                }
-                else
-                { 
-                    val = -3;
-                }
-                if((val == -3) || (val == 253))
-                {
-                    break;
-                }
-                else if((val < 0) || (val > userParameters->getMaxAA())) 
-                {
-                    residue = '-';
-                }
-                else 
-                {
-                    residue = userParameters->getAminoAcidCode(val);
-                }
-                if (userParameters->getLowercase())
-                {    
-                    sequence[j - firstRes] = residue;
-                }
-                else
-                {
-                    sequence[j - firstRes] = residue;
-                }
-                slen++;
-            }
-
-            //(*fastaOutFile) << ">" << nameonly(alignPtr->getName(i));
-            line << ">" << nameonly(alignPtr->getName(i));
-            if(userParameters->getSeqRange()) 
-            {
-                findRangeValues(alignPtr, &rnum, firstRes, lastRes, ii);
-                //(*fastaOutFile) << "/" << rnum.start << "-" << rnum.end;
-                line << "/" << rnum.start << "-" << rnum.end;
-                
-            }
-            //(*fastaOutFile) << "\n";
-            output->msa.push_back(line.str());
-            for(j = 1; j <= slen; j++) 
-            {
-                //(*fastaOutFile) << sequence[j-1];
-            	line.str("");
-                line << sequence[j-1];
-            	if((j % lineLength == 0) || (j == slen))
-                { 
-                    //(*fastaOutFile) << "\n";
-            		output->msa.push_back(line.str());
-                }
-            }
-        }
-        //fastaOutFile->close();
-        cout << "FASTA string created!\n";
-    }
-    catch(const bad_alloc& e)
-    {
-        //fastaOutFile->close();
-        cerr << "A bad_alloc exception has occured in the fastaOut function.\n"
-             << e.what() << "\n";
-        throw 1;
-    }
-    catch(VectorOutOfRange e)
-    {
-        //fastaOutFile->close();
-        cerr << "An exception has occured in the fastaOut function.\n"
-             << e.what() << "\n";
-        throw 1;
-    }
-    catch(...)
-    {
-        //fastaOutFile->close();
-        cerr << "An exception has occured in the fastaOut function.\n";
-        throw 1;
-    }
-    return;
-}
-
 /* 
  * gcgOut: output the alignment in gcg file format
  */
@@ -1582,594 +1462,91 @@ void AlignmentOutput::nbrfOut(Alignment* alignPtr, outputRegion partToOutput)
     }    
 }
 
-/* 
- * The function clustalOut is used to ouput the Alignment into a clustal format
- * file.
+/*
+ * The function alignedRowsOut hands the alignment to R: one row per sequence
+ * (in output order) with the residues firstRes to lastRes, gaps and the
+ * positions after the end of a sequence as '-', and the first word of the
+ * sequence name. It replaces the clustal and fasta formatted output, which
+ * the R interface only parsed back into rows.
  */
-void AlignmentOutput::clustalOut(Alignment* alignPtr, outputRegion partToOutput, ClustalWOutput *output)
+void AlignmentOutput::alignedRowsOut(Alignment* alignPtr, outputRegion partToOutput, ClustalWOutput *output)
 {
-	stringstream line;
     int firstRes = partToOutput._firstRes;
     int lastRes = partToOutput._lastRes;
     int firstSeq = partToOutput._firstSeq;
     int lastSeq = partToOutput._lastSeq;
-        
+    int _maxAA = userParameters->getMaxAA();
+    int length = lastRes - firstRes + 1;
+    int i, ii, j, val;
+
+    if(lastSeq > alignPtr->getNumSeqs())
+    {
+        lastSeq = alignPtr->getNumSeqs();
+    }
+    if(length < 0)
+    {
+        length = 0;
+    }
+
     try
     {
-        vector<char> seq1;    
-        vector<int> seqNo;
-        vector<int> printSeqNo;    
-        vector<char> ss_mask1, ss_mask2;
         const SeqArray* alignment = alignPtr->getSeqArray();
-        char  temp[MAXLINE];
-        char c;
-        int val;
-        int ii, lv1, catident1[NUMRES], catident2[NUMRES], ident, chunks;
-        int i, j, k, l;
-        int pos, ptr;
-        int lineLength;
-
-        rangeNum rnum;
-        string tmpStr = "";
-        string sequenceLine = "";
-
-
-        int _numSequences = alignPtr->getNumSeqs();
-        // PMcG revert to Clustalw1.83 output format for name width
-        const int NAMESWIDTH=std::max(std::min(MAXNAMESTODISPLAY,alignPtr->getMaxNames()) , MINNAMESTODISPLAY); 
 
-        seqNo.assign(_numSequences + 1, 0);
-        printSeqNo.assign(_numSequences + 1, 0);
-    
-        // check that lastSeq <= _numSequences
-        if(lastSeq > _numSequences)
+        if(AlnRowsAlloc(&output->msa, lastSeq >= firstSeq ? lastSeq - firstSeq + 1 : 0,
+                        length) != 0)
         {
-            lastSeq = _numSequences;
-        }
-    
-        for (i = firstSeq; i <= lastSeq; i++)
-        {
-            printSeqNo[i] = seqNo[i] = 0;
-            for(j = 1; j < firstRes; j++) 
-            {
-                //val = alignPtr.getResidue(i, j);
-                val = (*alignment)[i][j]; // NOTE june29
-                if((val >= 0) || (val <= userParameters->getMaxAA()))
-                { 
-                    seqNo[i]++;
-                }
-            }
+            throw bad_alloc();
         }
+        string version = "CLUSTAL " + userParameters->getRevisionLevel() + " ";
+        AlnRowsSetVersion(&output->msa, version.c_str());
 
-        seq1.assign(alignPtr->getMaxAlnLength() + 1, 0);
-        // Check if we have secondary structure in file 1 and if we want to output it.
-        if (userParameters->getStructPenalties1() == SECST && 
-            userParameters->getUseSS1() == true) 
+        for(ii = firstSeq; ii <= lastSeq; ++ii)
         {
-            int lengthSeq1 = alignPtr->getSeqLength(1);
-            ss_mask1.assign(lengthSeq1 + 10, 0);
-            vector<char>* _secStructMask1 = alignPtr->getSecStructMask1();
-        
-            for (i = 0; i < lengthSeq1; i++)
-            {
-                ss_mask1[i] = _secStructMask1->at(i);
-            }
-            printSecStructMask(lengthSeq1, _secStructMask1, &ss_mask1);
-          
-        }
-        
-        // Check if we have secondary structure in file 2 and if we want to output it.
-        if (userParameters->getStructPenalties2() == SECST && 
-            userParameters->getUseSS2() == true &&
-            userParameters->getProfile2Empty() == false)
-        {
-            // AW added test getProfile2Empty was meant to fix bug
-            // 141, but only prevents segfault, output still faulty.
-            // Has to be fixed somewhere else
-            int indexProfile2FirstSeq = alignPtr->getProfile1NumSeqs() + 1;
-            int lengthSeqProfile2 = alignPtr->getSeqLength(indexProfile2FirstSeq);
-            ss_mask2.assign(lengthSeqProfile2 + 10, 0);
-            vector<char>* _secStructMask2 = alignPtr->getSecStructMask2();
-            for (i = 0; i < lengthSeqProfile2; i++)
-            {
-                ss_mask2[i] = _secStructMask2->at(i);
-            }
-            printSecStructMask(lengthSeqProfile2, _secStructMask2, &ss_mask2);
-        }
-    
-        //(*clustalOutFile) << "CLUSTAL "<< userParameters->getRevisionLevel()
-        //                  << " multiple sequence alignment\n\n";
-        line << "CLUSTAL "<< userParameters->getRevisionLevel()
-			 << " ";
-        output->msa.push_back(line.str());
-        output->msa.push_back("");
-        // decide the line length for this alignment - maximum is LINELENGTH
-
-        //PMcG  9-2-2008 make line output same as 1.83
-        //lineLength = PAGEWIDTH - alignPtr->getMaxNames();
-        lineLength = PAGEWIDTH - NAMESWIDTH;
-        lineLength = lineLength - lineLength % 10; // round to a multiple of 10
-        if (lineLength > LINELENGTH || lineLength <= 0) // Mark 18-7-07
-        { 
-            lineLength = LINELENGTH;
-        }
-    
-        int length = lastRes - firstRes + 1; //- nige
-
-        chunks = length / lineLength; //- nige
-        if(length % lineLength != 0) //- nige
-        {
-          ++chunks;
-        }
-        //printf("firstRes=%d,lastRes=%d,length=%d,chunks=%d\n",
-        //       firstRes, lastRes, length, chunks);
-
-        // This will loop through each of the blocks.
-        line.str("");
-        for(lv1 = 1; lv1 <= chunks; ++lv1) 
-        {
-            // pos is begining of chunk, ptr is the end of the chunk to be displayed.
-            pos = ((lv1 - 1) * lineLength) + 1; 
-            ptr = (length < pos + lineLength - 1) ? length : pos + lineLength - 1; //- nige
-   
-            //(*clustalOutFile) << "\n";
-            output->msa.push_back(line.str());
-            int _outStructPenalty = userParameters->getOutputStructPenalties();
-            
-            string secStructName1 = alignPtr->getSecStructName1(); // Mark 18-7-07
-            
-            if((int)secStructName1.size() > MAXNAMESTODISPLAY)
-            {
-                //secStructName1 = secStructName1.substr(0, MAXNAMESTODISPLAY);
-                secStructName1 = secStructName1.substr(0, NAMESWIDTH);
-            }            
-            if (_outStructPenalty == 0 || _outStructPenalty == 2) 
-            {
-                if (userParameters->getStructPenalties1() == SECST && 
-                    userParameters->getUseSS1() == true) 
-                {
-                    for(i = pos; i <= ptr; ++i) 
-                    {
-                        // Check if we can access mask position first
-                        if((int)ss_mask1.size() > i + firstRes - 2)  
-                        {
-                            val = ss_mask1[i + firstRes - 2]; 
-                            if (val == userParameters->getGapPos1() || 
-                                val == userParameters->getGapPos2())
-                            {
-                                temp[i - pos] = '-';
-                            }
-                            else
-                            {
-                                temp[i - pos] = val;
-                            }
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    temp[i - pos] = EOS;  
-                                      
-                    if(userParameters->getSeqRange())
-                    {
-                        //(*clustalOutFile) << "!SS_" << setw(MAXNAMESTODISPLAY +
-                        //(*clustalOutFile) << "!SS_" << setw(NAMESWIDTH +
-                        //                                    clusSecStructOffset)
-                        //                  << left << secStructName1
-                        //                  << "  " << temp << "\n";
-                        line.str("");
-                        line << "!SS_" << setw(NAMESWIDTH + clusSecStructOffset)
-                        	 << left << secStructName1 << "  " << temp;
-                        output->msa.push_back(line.str());
-                    }
-                    else
-                    {
-                        //(*clustalOutFile) << "!SS_" << setw(MAXNAMESTODISPLAY)
-                        //(*clustalOutFile) << "!SS_" << setw(NAMESWIDTH)
-                        //                  << left << secStructName1 << "  "
-                        //                  << temp << "\n";
-                        line.str("");
-                        line << "!SS_" << setw(NAMESWIDTH)
-                             << left << secStructName1 << "  "
-                             << temp;
-                        output->msa.push_back(line.str());
-                    }
-                }
-            }
-            if (_outStructPenalty == 1 || _outStructPenalty == 2) 
-            {
-                if (userParameters->getStructPenalties1() != NONE && 
-                    userParameters->getUseSS1() == true) 
-                {
-                    vector<char>* _gapPenaltyMask1 = alignPtr->getGapPenaltyMask1();       
-                    for(i = pos; i <= ptr; ++i) 
-                    {
-                        if((int)_gapPenaltyMask1->size() > i + firstRes - 2) 
-                        {
-                            val = _gapPenaltyMask1->at(i + firstRes - 2); 
-                            if (val == userParameters->getGapPos1() || 
-                                val == userParameters->getGapPos2())
-                            {
-                                temp[i - pos] = '-';
-                            }
-                            else
-                            {
-                                temp[i - pos] = val;
-                            }
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    temp[i - pos] = EOS;
-                    
-                    //(*clustalOutFile) << "!GM_" << setw(MAXNAMESTODISPLAY) << left
-                    //(*clustalOutFile) << "!GM_" << setw(NAMESWIDTH) << left
-                    //                  << secStructName1 << "  "
-                    //                  << temp << "\n";
-                    line.str("");
-					line << "!GM_" << setw(NAMESWIDTH)
-						 << left << secStructName1 << "  "
-						 << temp;
-					output->msa.push_back(line.str());
-                }
-            }
-            
-            
-            string secStructName2 = alignPtr->getSecStructName2(); // Mark 18-7-07
-            //if((int)secStructName2.size() > MAXNAMESTODISPLAY)
-            if((int)secStructName2.size() > NAMESWIDTH)
-            {
-                //secStructName2 = secStructName2.substr(0, MAXNAMESTODISPLAY);
-                secStructName2 = secStructName2.substr(0, NAMESWIDTH);
-            }
-                                
-            if (_outStructPenalty == 0 || _outStructPenalty == 2) 
-            {
-                if (userParameters->getStructPenalties2() == SECST && 
-                    userParameters->getUseSS2() == true) 
-                {
-                    for(i = pos; i <= ptr; ++i) 
-                    {
-                        if((int)ss_mask2.size() > i + firstRes - 2)
-                        {
-                            val = ss_mask2[i + firstRes - 2]; 
-                            if (val == userParameters->getGapPos1() || 
-                                val == userParameters->getGapPos2())
-                            {
-                                temp[i - pos] = '-';
-                            }
-                            else
-                            {
-                                temp[i - pos] = val;
-                            }
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    temp[i - pos] = EOS;
-                    
-                                        
-                    if (userParameters->getSeqRange())
-                    {
-                        //(*clustalOutFile) << "!SS_" << setw(MAXNAMESTODISPLAY +
-                        //(*clustalOutFile) << "!SS_" << setw(NAMESWIDTH +
-                        //                                    clusSecStructOffset)
-                        //                  << left << secStructName2;
-                        //(*clustalOutFile) << "  " << temp << "\n";
-                        line.str("");
-						line << "!SS_" << setw(NAMESWIDTH + clusSecStructOffset)
-							 << left << secStructName2 << "  "
-							 << temp;
-						output->msa.push_back(line.str());
-                    }
-                    else
-                    {
-                        //(*clustalOutFile) << "!SS_" << setw(MAXNAMESTODISPLAY)
-                        //(*clustalOutFile) << "!SS_" << setw(NAMESWIDTH)
-                        //                  << left << secStructName2 << "  "
-                        //                  << temp << "\n";
-                        line.str("");
-						line << "!SS_" << setw(NAMESWIDTH)
-							 << left << secStructName2 << "  "
-							 << temp;
-						output->msa.push_back(line.str());
-                    }
-                }
-            }
-            
-            if (_outStructPenalty == 1 || _outStructPenalty == 2) 
-            {
-                if (userParameters->getStructPenalties2() != NONE && 
-                    userParameters->getUseSS2() == true) 
-                {
-                    vector<char>* _gapPenaltyMask2 = alignPtr->getGapPenaltyMask2();
-                    for(i = pos; i <= ptr; ++i) 
-                    {
-                        if((int)_gapPenaltyMask2->size() > i + firstRes - 2)
-                        {
-                            val = _gapPenaltyMask2->at(i + firstRes - 2); 
-                            if (val == userParameters->getGapPos1() || 
-                                val == userParameters->getGapPos2())
-                            {
-                                temp[i - pos] = '-';
-                            }
-                            else
-                            {
-                                temp[i - pos] = val;
-                            }
-                        }
-                        else
-                        {
-                            break;
-                        }
-                    }
-                    temp[i - pos] = EOS;
-                    
-                    //(*clustalOutFile) << "!GM_" << setw(MAXNAMESTODISPLAY) << left
-                    //(*clustalOutFile) << "!GM_" << setw(NAMESWIDTH) << left
-                    //                  << secStructName2 << "  "
-                    //                  << temp << "\n";
-                    line.str("");
-					line << "!GM_" << setw(NAMESWIDTH)
-						 << left << secStructName2 << "  "
-						 << temp;
-					output->msa.push_back(line.str());
-                }
-            }
-        
-            for(ii = firstSeq; ii <= lastSeq; ++ii) 
-            {
-                i = alignPtr->getOutputIndex(ii - 1); 
-                printSeqNo[i] = 0;
-                for(j = pos; j <= ptr; ++j) 
-                {
-                    if (j + firstRes - 1 <= alignPtr->getSeqLength(i))
-                    {
-                        //val = alignPtr.getResidue(i, j + firstRes - 1);
-                        val = (*alignment)[i][j + firstRes - 1]; // NOTE june29
-                    }
-                    else
-                    { 
-                        val = -3;
-                    }
-                    if((val == -3) || (val == 253)) 
-                    {
-                        break;
-                    }
-                    else if((val < 0) || (val > userParameters->getMaxAA()))
-                    {
-                        seq1[j] = '-';
-                    }
-                    else 
-                    {
-                        seq1[j] = userParameters->getAminoAcidCode(val);
-                        seqNo[i]++;
-                        printSeqNo[i] = 1;
-                    } 
-                }
-                for(; j <= ptr; ++j) 
-                {
-                    seq1[j]='-';
-                }
-            
-                sequenceLine = "";
-
-                for(int index = pos; index < ptr + 1; index++)
-                {
-                    sequenceLine += seq1[index];
-                }
-                
-                string seqName = alignPtr->getName(i);
-                //if((int)seqName.size() > MAXNAMESTODISPLAY)
-                if((int)seqName.size() > NAMESWIDTH)
-                {
-                    //seqName = seqName.substr(0, MAXNAMESTODISPLAY);
-                    seqName = seqName.substr(0, NAMESWIDTH);
-                }
-                
-                if (!userParameters->getSeqRange()) 
-                {
-                    // NOTE I made a change here from + 5, to + 6.
-                    //(*clustalOutFile) << setw(alignPtr->getMaxNames() + 6) << left
-                    //                  << alignPtr->getName(i);
-
-                    //(*clustalOutFile) << setw(MAXNAMESTODISPLAY + 6) << left
-                    //                  << seqName; 
-                    // PMcG changed this to revert to behaviour of clustalw1.83
-                    // 
-                    //(*clustalOutFile) << setw(std::max(std::min(MAXNAMESTODISPLAY,alignPtr->getMaxNames()) , MINNAMESTODISPLAY) + 6)
-                    //(*clustalOutFile) << setw(NAMESWIDTH + 6) << left << seqName;
-                    line.str("");
-                    line << setw(NAMESWIDTH + 6) << left << seqName;
-
-
-                }
-                else // Put the sequence range information in! 
-                {
-                    findRangeValues(alignPtr, &rnum, firstRes, lastRes, ii);
-                    string nameOnly = nameonly(seqName);
-                    std::stringstream ss;
-                    std::stringstream ss2;
-                    string rangeStart;
-                    string rangeEnd;
-                    ss << rnum.start;
-                    ss >> rangeStart;
-                    ss2 << rnum.end;
-                    ss2 >> rangeEnd;
-                    tmpStr = nameOnly + "/" + rangeStart + "-" + rangeEnd;
-                    //(*clustalOutFile) << setw(MAXNAMESTODISPLAY + clusSequenceOffset) 
-                    //(*clustalOutFile) << setw(NAMESWIDTH + clusSequenceOffset)
-                    //                  << left << tmpStr;
-                    line.str("");
-                    line << setw(NAMESWIDTH + clusSequenceOffset) << left << tmpStr;
-                }
-            
-                //(*clustalOutFile) << sequenceLine;
-                line << sequenceLine;
+            i = alignPtr->getOutputIndex(ii - 1);
+            const vector<int>& seq = (*alignment)[i];
+            int lenSeq = alignPtr->getSeqLength(i);
+            char* row = AlnRowsRow(&output->msa, ii - firstSeq);
 
-                if (userParameters->getClSeqNumbers() && printSeqNo[i])
-                {
-                    //(*clustalOutFile) << " " << seqNo[i];
-                	line << " " << seqNo[i];
-                }
-            
-                //(*clustalOutFile) << "\n";
-                output->msa.push_back(line.str());
-                line.str("");
-            }
-        
-            // Now print out the conservation information!
-            for(i = pos; i <= ptr; ++i) 
+            for(j = firstRes; j <= lastRes; ++j)
             {
-                seq1[i] = ' ';
-                ident = 0;
-
-                for(j = 1; j <= (int)strongGroup.size(); j++)
-                {
-                    catident1[j - 1] = 0;
-                }
-                for(j = 1; j <= (int)weakGroup.size(); j++) 
+                val = (j <= lenSeq) ? seq[j] : -3;
+                if((val == -3) || (val == 253))
                 {
-                    catident2[j - 1] = 0;
+                    break;
                 }
-                
-                for(j = firstSeq; j <= lastSeq; ++j) 
+                else if((val < 0) || (val > _maxAA))
                 {
-                    if((i + firstRes - 1 <= alignPtr->getSeqLength(j)) &&
-                       (i + firstRes - 1 <= alignPtr->getSeqLength(firstSeq)))
-                    {// NOTE june29
-                        if(((*alignment)[firstSeq][i + firstRes - 1] >= 0) && 
-                            ((*alignment)[firstSeq][i + firstRes - 1] <=
-                            userParameters->getMaxAA())) 
-                        {
-                            // Count how many are identical to the first sequence
-                            if((*alignment)[firstSeq][i + firstRes - 1] == 
-                                (*alignment)[j][i + firstRes - 1])
-                            {
-                                ++ident;
-                            }
-                            // Count how many are in the same category.
-                            for(k = 1; k <= (int)strongGroup.size(); k++) 
-                            {
-                                for(l = 0; (c = strongGroup[k - 1][l]); l++) 
-                                {
-                                    int resCode = (*alignment)[j][i + firstRes - 1];
-                                    if(resCode <= userParameters->getMaxAA() + 1)
-                                    {
-                                        if (userParameters->getAminoAcidCode(resCode) == c)
-                                        {
-                                            catident1[k - 1]++;
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-                            for(k = 1; k <= (int)weakGroup.size(); k++) 
-                            {
-                                for(l = 0; (c = weakGroup[k - 1][l]); l++) 
-                                {//NOTE june29
-                                    int resCode = (*alignment)[j][i + firstRes - 1];
-                                    if(resCode <= userParameters->getMaxAA() + 1)
-                                    {
-                                        if (userParameters->getAminoAcidCode(resCode) == c)
-                                        {
-                                            catident2[k - 1]++;
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }    
+                    row[j - firstRes] = '-';
                 }
-            
-                // Now do the conservation part for each block. 
-                if(ident == lastSeq - firstSeq + 1)
+                else
                 {
-                    seq1[i] = '*'; // All residues the same!
-                }
-                else if (!userParameters->getDNAFlag()) 
-                {
-                    for(k = 1; k <= (int)strongGroup.size(); k++) 
-                    {
-                        if (catident1[k - 1] == lastSeq - firstSeq + 1) 
-                        {
-                            seq1[i] = ':'; // All residues member of the same category
-                            break;
-                        }
-                    }
-                    if(seq1[i] == ' ')
-                    {
-                        for(k = 1; k <= (int)weakGroup.size(); k++) 
-                        {
-                            if (catident2[k - 1] == lastSeq - firstSeq + 1) 
-                            {
-                                seq1[i] = '.'; // All residues member of the same category
-                                break;
-                            }
-                        }
-                    }
+                    row[j - firstRes] = userParameters->getAminoAcidCode(val);
                 }
             }
-
-            sequenceLine = "";
-            for(int index = pos; index < ptr + 1; index++)
+            for(; j <= lastRes; ++j)
             {
-                sequenceLine += seq1[index];
+                row[j - firstRes] = '-';
             }
 
-            //for(k = 0; k < MAXNAMESTODISPLAY + 6; k++)
-            for(k = 0; k < NAMESWIDTH + 6; k++)
-            { 
-                //(*clustalOutFile) << " ";
-            	line << " ";
-            }
-            if(userParameters->getSeqRange()) 
+            if(AlnRowsSetName(&output->msa, ii - firstSeq,
+                              alignPtr->getName(i).c_str()) != 0)
             {
-
-                //(*clustalOutFile) << "          ";
-            	line << "          ";
+                throw bad_alloc();
             }
-
-            //(*clustalOutFile) << sequenceLine << "\n";
-            line << sequenceLine;
-            output->msa.push_back(line.str());
-            line.str("");
         }
-        //clustalOutFile->close();
     }
     catch(const bad_alloc& e)
     {
-        //clustalOutFile->close();
-        cerr << "A bad_alloc exception has occured in the clustalOut function.\n"
+        cerr << "A bad_alloc exception has occured in the alignedRowsOut function.\n"
              << e.what() << "\n";
         throw 1;
     }
     catch(VectorOutOfRange e)
     {
-        //clustalOutFile->close();
-        cerr << "An exception has occured in the clustalOut function.\n"
+        cerr << "An exception has occured in the alignedRowsOut function.\n"
              << e.what() << "\n";
         throw 1;
     }
-    catch(exception e)
-    {
-        //clustalOutFile->close();
-        cerr << "An exception has occured in the clustalOut function.\n"
-             << e.what() << "\n";
-        throw 1;
-    }
-    catch(...)
-    {
-        //clustalOutFile->close();
-        cerr << "An exception has occured in the clustalOut function.\n";
-        throw 1;
-    }    
     return;
 }
 
@@ -56,8 +56,7 @@ class AlignmentOutput
 
     private:
         /* Functions */
-        void fastaOut(Alignment* alignPtr, outputRegion partToOutput, ClustalWOutput *output);
-        void clustalOut(Alignment* alignPtr, outputRegion partToOutput, ClustalWOutput *output);
+        void alignedRowsOut(Alignment* alignPtr, outputRegion partToOutput, ClustalWOutput *output);
         void gcgOut(Alignment* alignPtr, outputRegion partToOutput);
         void nexusOut(Alignment* alignPtr, outputRegion partToOutput);
         void phylipOut(Alignment* alignPtr, outputRegion partToOutput);
@@ -7,6 +7,7 @@
     #include "config.h"
 #endif
 #include <sstream>
+#include <algorithm>
 #include "ObjectiveScore.h"
 #include "Alignment.h"
 #include "../general/userparams.h"
@@ -22,7 +23,11 @@ ObjectiveScore::ObjectiveScore()
    sagaGapEx(12),
    sagaGapOp(8),
    gapPos1(userParameters->getGapPos1()),
-   gapPos2(userParameters->getGapPos2())
+   gapPos2(userParameters->getGapPos2()),
+   numSeqs(0),
+   numCols(0),
+   gapOpen(0),
+   gapExtend(0)
 {
 
 }
@@ -49,52 +54,34 @@ long ObjectiveScore::getScore(const Alignment* alnToScore)
         utilityObject->error("Matrix for alignment scoring not found\n");
         return 0;
     }
+    gapOpen = userParameters->getGapOpen();
+    gapExtend = userParameters->getGapExtend();
     
     const vector<int>* seqWeight = alignToScore->getSeqWeights();
     vector<float> normalisedSeqWeights;
     
     calcNormalisedSeqWeights(seqWeight, &normalisedSeqWeights);
-        
-    int seq1, seq2;
-
-    float w1, w2 = 1.0;
-    float weight = 1.0;
-    score = 0;
-    float pwScoreLetters = 0, pwScoreGaps = 0, pwScore = 0;
-    float scoreTotal = 0.0;
-    int numSeqs = alignToScore->getNumSeqs();
+    
+    numSeqs = alignToScore->getNumSeqs();
+    numCols = numSeqs > 0 ? alignToScore->getSeqLength(1) : 0;
     int sizeNormalSeqWeight = normalisedSeqWeights.size();
     
-    for (seq1 = 1; seq1 <= numSeqs && seq1 <= sizeNormalSeqWeight; seq1++) 
+    // Sequences without a weight, or that are not as long as the alignment,
+    // do not contribute to the score.
+    weight.assign(numSeqs + 1, 0.0);
+    for(int seq = 1; seq <= numSeqs && seq <= sizeNormalSeqWeight; seq++)
     {
-        w1 = normalisedSeqWeights[seq1 - 1];
-        
-        for (seq2 = seq1 + 1; seq2 <= numSeqs && seq2 <= sizeNormalSeqWeight; seq2++)
+        if(alignToScore->getSeqLength(seq) == numCols)
         {
-            w2 = normalisedSeqWeights[seq2 - 1];
-            weight = w1 * w2;
-            
-            pwScoreLetters = scoreLetters(seq1, seq2);
-            pwScoreGaps = scoreGaps(seq1, seq2);
-            pwScore = pwScoreLetters + pwScoreGaps;
-                       
-            scoreTotal += weight * pwScore;
-            #if DEBUGFULL
-                if(logObject && DEBUGLOG)
-                {    
-                    ostringstream outs;
-                    outs << " weight = " << weight 
-                         << " scoreLetters = " << pwScoreLetters << " scoreGaps = " 
-                         << pwScoreGaps << " scorePair = " 
-                         << pwScore << "\n"
-                         << "scoreTotal = " << scoreTotal << "\n";
-                    logObject->logMsg(outs.str());
-                }
-            #endif             
+            weight[seq] = normalisedSeqWeights[seq - 1];
         }
     }
+    
+    colScore.assign(numCols + 1, 0.0);
+    vector<int> prevRes(numSeqs + 1, 0);
+    scoreColumns(1, numCols, &prevRes);
 
-    score = static_cast<long>(scoreTotal);
+    score = totalScore();
     #if DEBUGFULL
         if(logObject && DEBUGLOG)
         {    
@@ -108,118 +95,226 @@ long ObjectiveScore::getScore(const Alignment* alnToScore)
     return score;
 }
 
-float ObjectiveScore::scoreLetters(int seq1, int seq2)
+/**
+ * Rescores the alignment after the contents of columns firstCol to lastCol
+ * have changed. Besides the changed columns, only the following columns in
+ * which a sequence has its first residue after the change have to be
+ * rescored, as the gap opening penalties depend on the previous residue.
+ */
+long ObjectiveScore::updateColumns(int firstCol, int lastCol)
 {
     if(!alignToScore)
     {
         return 0;
     }
-    const unsigned numColsSeq1 = alignToScore->getSeqLength(seq1);
-    const unsigned numColsSeq2 = alignToScore->getSeqLength(seq2);
-    
-    if(numColsSeq1 != numColsSeq2)
-    {
-        return 0; // The sequences should be the same length after alignment.
-    }
+    firstCol = std::max(firstCol, 1);
+    lastCol = std::min(lastCol, numCols);
     
-    float scoreLetters = 0;
-    unsigned colStart = 1;
-    bool gap1, gap2;
+    const SeqArray* seqArray = alignToScore->getSeqArray();
+    vector<int> prevRes(numSeqs + 1, 0);
+    int nextCol = lastCol;
     
-    for(unsigned col = 1; col < numColsSeq1; col++)
+    for(int seq = 1; seq <= numSeqs; seq++)
     {
-        gap1 = alignToScore->isGap(seq1, col);
-        gap2 = alignToScore->isGap(seq2, col);
-        
-        if(!gap1 || !gap2)
+        if(weight[seq] == 0.0)
         {
-            colStart = col;
-            break;
+            continue;
         }
-    }
- 
-    unsigned colEnd = numColsSeq1;
-    
-    for(unsigned col = numColsSeq1; col >= 1; --col)
-    {
-        gap1 = alignToScore->isGap(seq1, col);
-        gap2 = alignToScore->isGap(seq2, col);
-        
-        if(!gap1 || !gap2)
+        const vector<int>& row = (*seqArray)[seq];
+        for(int col = firstCol - 1; col >= 1; col--)
         {
-            colEnd = col;
-            break;
+            if(row[col] != gapPos1 && row[col] != gapPos2)
+            {
+                prevRes[seq] = col;
+                break;
+            }
+        }
+        for(int col = lastCol + 1; col <= numCols; col++)
+        {
+            if(row[col] != gapPos1 && row[col] != gapPos2)
+            {
+                nextCol = std::max(nextCol, col);
+                break;
+            }
         }
     }
     
-    const SeqArray* seqArray = alignToScore->getSeqArray();
-    int scoreMatch = 0;
+    scoreColumns(firstCol, nextCol, &prevRes);
+    return totalScore();
+}
 
-        
-    for(unsigned col = colStart; col <= colEnd; col++)
+/**
+ * Subtracts the pairs of sequence seq from the score. Call this before
+ * changing the row and addRow() afterwards.
+ */
+void ObjectiveScore::removeRow(int seq)
+{
+    if(!alignToScore || seq < 1 || seq > numSeqs)
     {
-        int res1 = (*seqArray)[seq1][col];
-        int res2 = (*seqArray)[seq2][col];
-        scoreMatch = matrix[res1][res2];
-        scoreLetters += scoreMatch;
-    }   
-    
-    return scoreLetters;
+        return;
+    }
+    for(int other = 1; other <= numSeqs; other++)
+    {
+        if(other != seq)
+        {
+            scorePairColumns(seq, other, -weight[seq] * weight[other]);
+        }
+    }
 }
 
-float ObjectiveScore::scoreGaps(int seq1, int seq2)
+long ObjectiveScore::addRow(int seq)
 {
     if(!alignToScore)
     {
         return 0;
     }
-    const unsigned numColsSeq1 = alignToScore->getSeqLength(seq1);
-    const unsigned numColsSeq2 = alignToScore->getSeqLength(seq2);
-    
-    if(numColsSeq1 != numColsSeq2)
+    if(seq >= 1 && seq <= numSeqs)
     {
-        return 0; // The sequences should be the same length after alignment.
+        for(int other = 1; other <= numSeqs; other++)
+        {
+            if(other != seq)
+            {
+                scorePairColumns(seq, other, weight[seq] * weight[other]);
+            }
+        }
     }
+    return totalScore();
+}
+
+/**
+ * Scores columns firstCol to lastCol from the weighted counts of the residues
+ * in each column. prevRes holds, for every sequence, the last column before
+ * firstCol in which it has a residue (0 if none) and is advanced to lastCol.
+ *
+ * A pair of sequences scores a gap opening in a column in which the first
+ * has a gap and the second a residue if the first had a residue where the
+ * second had its previous one (or if the second has no previous residue),
+ * and a gap extension otherwise.
+ */
+void ObjectiveScore::scoreColumns(int firstCol, int lastCol, vector<int>* prevRes)
+{
+    const SeqArray* seqArray = alignToScore->getSeqArray();
+    double resWeight[NUMRES], resWeightSq[NUMRES];
+    int present[NUMRES];
+    vector<int> gapSeqs;
+    vector<pair<int, double> > resPrev; // (previous residue column, weight)
     
-    unsigned colStart = 1;
-    bool gap1, gap2;
+    for(int res = 0; res < NUMRES; res++)
+    {
+        resWeight[res] = resWeightSq[res] = 0.0;
+    }
+    gapSeqs.reserve(numSeqs);
+    resPrev.reserve(numSeqs);
     
-    for(unsigned col = 1; col < numColsSeq1; col++)
+    for(int col = firstCol; col <= lastCol; col++)
     {
-        gap1 = alignToScore->isGap(seq1, col);
-        gap2 = alignToScore->isGap(seq2, col);
+        int numPresent = 0;
+        double gapWeight = 0.0, resTotal = 0.0;
+        gapSeqs.clear();
+        resPrev.clear();
+        
+        for(int seq = 1; seq <= numSeqs; seq++)
+        {
+            double w = weight[seq];
+            if(w == 0.0)
+            {
+                continue;
+            }
+            int res = (*seqArray)[seq][col];
+            if(res == gapPos1 || res == gapPos2)
+            {
+                gapSeqs.push_back(seq);
+                gapWeight += w;
+                continue;
+            }
+            if(resWeight[res] == 0.0)
+            {
+                present[numPresent++] = res;
+            }
+            resWeight[res] += w;
+            resWeightSq[res] += w * w;
+            resTotal += w;
+            resPrev.push_back(make_pair((*prevRes)[seq], w));
+            (*prevRes)[seq] = col;
+        }
         
-        if(!gap1 || !gap2)
+        double letters = 0.0;
+        for(int i = 0; i < numPresent; i++)
         {
-            colStart = col;
-            break;
+            int res1 = present[i];
+            double rowSum = 0.0;
+            for(int j = 0; j < numPresent; j++)
+            {
+                rowSum += resWeight[present[j]] * matrix[res1][present[j]];
+            }
+            letters += resWeight[res1] * rowSum - 
+                       resWeightSq[res1] * matrix[res1][res1];
+        }
+        for(int i = 0; i < numPresent; i++)
+        {
+            resWeight[present[i]] = resWeightSq[present[i]] = 0.0;
         }
-    }
- 
-    unsigned colEnd = numColsSeq1;
-    
-    for(unsigned col = numColsSeq1; col >= 1; --col)
-    {
-        gap1 = alignToScore->isGap(seq1, col);
-        gap2 = alignToScore->isGap(seq2, col);
         
-        if(!gap1 || !gap2)
+        double opens = 0.0;
+        if(!gapSeqs.empty() && !resPrev.empty())
         {
-            colEnd = col;
-            break;
+            if(resPrev.front().first != resPrev.back().first)
+            {
+                sort(resPrev.begin(), resPrev.end());
+            }
+            for(int i = 0; i < (int)resPrev.size(); )
+            {
+                int prevCol = resPrev[i].first;
+                double groupWeight = 0.0;
+                for(; i < (int)resPrev.size() && resPrev[i].first == prevCol; i++)
+                {
+                    groupWeight += resPrev[i].second;
+                }
+                double gapWeightAtPrev = 0.0;
+                if(prevCol == 0)
+                {
+                    gapWeightAtPrev = gapWeight;
+                }
+                else
+                {
+                    for(int k = 0; k < (int)gapSeqs.size(); k++)
+                    {
+                        int res = (*seqArray)[gapSeqs[k]][prevCol];
+                        if(res != gapPos1 && res != gapPos2)
+                        {
+                            gapWeightAtPrev += weight[gapSeqs[k]];
+                        }
+                    }
+                }
+                opens += groupWeight * gapWeightAtPrev;
+            }
         }
+        
+        colScore[col] = 0.5 * letters + gapExtend * gapWeight * resTotal +
+                        (gapOpen - gapExtend) * opens;
+    }
+}
+
+/**
+ * Adds factor times the score of the pair seq1, seq2 to the scores of the
+ * columns it is made of.
+ */
+void ObjectiveScore::scorePairColumns(int seq1, int seq2, double factor)
+{
+    if(factor == 0.0)
+    {
+        return;
     }
- 
+    const SeqArray* seqArray = alignToScore->getSeqArray();
+    const vector<int>& row1 = (*seqArray)[seq1];
+    const vector<int>& row2 = (*seqArray)[seq2];
     bool inGap1 = false;
     bool inGap2 = false;
-    float gapOpen = userParameters->getGapOpen();
-    float gapExtend = userParameters->getGapExtend();
     
-    float scoreGaps = 0;
-    for(unsigned col = colStart; col <= colEnd; col++)
+    for(int col = 1; col <= numCols; col++)
     {
-        gap1 = alignToScore->isGap(seq1, col);
-        gap2 = alignToScore->isGap(seq2, col);
+        bool gap1 = row1[col] == gapPos1 || row1[col] == gapPos2;
+        bool gap2 = row2[col] == gapPos1 || row2[col] == gapPos2;
         
         if(gap1 && gap2)
         {
@@ -227,38 +322,32 @@ float ObjectiveScore::scoreGaps(int seq1, int seq2)
         }
         if(gap1)
         {
-            if(!inGap1)
-            {
-                // NOTE I left out the option of having different end gaps stuff.
-                scoreGaps += gapOpen;
-                inGap1 = true; // Opening a gap in seq1
-            }
-            else
-            {
-                // Already in a gap
-                scoreGaps += gapExtend;
-            }
-            continue;
+            colScore[col] += factor * (inGap1 ? gapExtend : gapOpen);
+            inGap1 = true;
         }
         else if(gap2)
         {
-            if(!inGap2)
-            {
-                // NOTE I left out the option of having different end gaps stuff.
-                scoreGaps += gapOpen;
-                inGap2 = true; // Opening a gap in seq2
-            }
-            else
-            {
-                // Already in a gap
-                scoreGaps += gapExtend;
-            }
-            continue;        
+            colScore[col] += factor * (inGap2 ? gapExtend : gapOpen);
+            inGap2 = true;
+        }
+        else
+        {
+            colScore[col] += factor * matrix[row1[col]][row2[col]];
+            inGap1 = inGap2 = false;
         }
-        inGap1 = inGap2 = false;    
-    }       
-    return scoreGaps;
-} 
+    }
+}
+
+long ObjectiveScore::totalScore()
+{
+    double scoreTotal = 0.0;
+    for(int col = 1; col <= numCols; col++)
+    {
+        scoreTotal += colScore[col];
+    }
+    score = static_cast<long>(scoreTotal);
+    return score;
+}
 
 void ObjectiveScore::calcNormalisedSeqWeights(const vector<int>* seqWeight, 
                                               vector<float>* normSeqWeight)
@@ -13,6 +13,7 @@
 #define OBJECTIVESCORE_H
 #include "../general/clustalw.h"
 #include "../substitutionMatrix/globalmatrix.h" 
+#include <vector>
 namespace clustalw
 {
 
@@ -23,15 +24,31 @@ typedef struct
     int second; 
 } Pair;  
 
+/**
+ * The score is the weighted sum of pairs score of the alignment. It is
+ * computed column by column from the weighted residue counts of each column
+ * in O(N*L) (plus O(N) for every distinct position at which the sequences
+ * with a residue in a column had their previous residue) instead of scoring
+ * all N*(N-1)/2 pairs of sequences. The score of each column is kept, so that
+ * after an edit of one row or of a range of columns only the changed part has
+ * to be rescored.
+ */
 class ObjectiveScore
 {   
     public:
         ObjectiveScore();
-        long getScore(const Alignment* alnToScore);    
+        long getScore(const Alignment* alnToScore);
+        
+        /* Incremental rescoring of the alignment last passed to getScore. The
+         * number of sequences and columns and the weights must not change. */
+        long updateColumns(int firstCol, int lastCol);
+        void removeRow(int seq);
+        long addRow(int seq);
     private:
         
-        float scoreLetters(int seq1, int seq2);
-        float scoreGaps(int seq1, int seq2);
+        void scoreColumns(int firstCol, int lastCol, vector<int>* prevRes);
+        void scorePairColumns(int seq1, int seq2, double factor);
+        long totalScore();
         void calcNormalisedSeqWeights(const vector<int>* seqWeight, 
                                       vector<float>* normSeqWeight);
         long score;
@@ -41,6 +58,10 @@ class ObjectiveScore
         int weightScale;
         int sagaGapEx, sagaGapOp;
         int gapPos1, gapPos2;
+        int numSeqs, numCols;
+        float gapOpen, gapExtend;
+        vector<double> weight; // normalised weight of each sequence
+        vector<double> colScore; // score of each column
         static const int BOTHGAPS = 0;
         static const int NOGAPS = -1;
         static const int GAPINSEQB = 1;
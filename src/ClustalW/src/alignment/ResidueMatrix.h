@@ -0,0 +1,114 @@
+/**
+ * The ResidueMatrix class stores a block of an alignment (rows are sequences,
+ * columns are alignment positions) column by column in one contiguous array
+ * with one byte per residue code. The loops that look at all sequences of one
+ * column (profile construction, conservation line, distance matrices) then read
+ * consecutive bytes instead of one element of every vector of a SeqArray.
+ *
+ * It is a read-only snapshot: the SeqArray of the Alignment is still the
+ * store that is edited. Residue codes, the gap codes and ENDALN fit into a
+ * signed char; codes that do not (none are used at the moment) are stored as
+ * -3, which like the original codes is not a residue.
+ */
+#ifndef RESIDUEMATRIX_H
+#define RESIDUEMATRIX_H
+
+#include <vector>
+#include <cstddef>
+
+namespace clustalw
+{
+using namespace std;
+
+class ResidueMatrix
+{
+    public:
+        /** strided access to one row (sequence) of the matrix */
+        class RowView
+        {
+            public:
+                RowView(const signed char* first, size_t stride)
+                 : first(first),
+                   stride(stride)
+                {}
+                inline int operator[](int col) const
+                {
+                    return first[col * stride];
+                }
+            private:
+                const signed char* first;
+                size_t stride;
+        };
+
+        ResidueMatrix() : numRows(0), numCols(0){;}
+        ResidueMatrix(int rows, int cols, int fill = 0)
+         : numRows(0),
+           numCols(0)
+        {
+            resize(rows, cols, fill);
+        }
+
+        /** Discards the old contents. Every element is set to fill. */
+        void resize(int rows, int cols, int fill = 0)
+        {
+            numRows = rows;
+            numCols = cols;
+            elements.assign((size_t)rows * cols, toCode(fill));
+        }
+
+        /**
+         * Copies the codes (*seq)[first], (*seq)[first + 1], ... into the given
+         * row. Columns past the end of seq are set to pad.
+         */
+        void setRow(int row, const vector<int>* seq, int first, int pad)
+        {
+            int len = (int)seq->size() - first;
+            int col;
+
+            if (len > numCols)
+            {
+                len = numCols;
+            }
+            for (col = 0; col < len; col++)
+            {
+                set(row, col, (*seq)[first + col]);
+            }
+            for (; col < numCols; col++)
+            {
+                set(row, col, pad);
+            }
+        }
+
+        inline void set(int row, int col, int code)
+        {
+            elements[(size_t)col * numRows + row] = toCode(code);
+        }
+        inline int get(int row, int col) const
+        {
+            return elements[(size_t)col * numRows + row];
+        }
+        /** numRows consecutive codes, one per sequence */
+        inline const signed char* getColumn(int col) const
+        {
+            return elements.data() + (size_t)col * numRows;
+        }
+        inline RowView getRow(int row) const
+        {
+            return RowView(elements.data() + row, numRows);
+        }
+        int getNumRows() const {return numRows;}
+        int getNumCols() const {return numCols;}
+
+        static inline signed char toCode(int code)
+        {
+            return (code < -128 || code > 127) ? -3 : (signed char)code;
+        }
+
+    private:
+        vector<signed char> elements;
+        int numRows;
+        int numCols;
+};
+
+}
+#endif
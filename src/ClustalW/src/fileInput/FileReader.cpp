@@ -567,6 +567,16 @@ void FileReader::checkInfile(int *nseqs, auto_ptr<FileParser>& fileParser)
     int lengthLine = 0;
     *nseqs = 0;
 
+    // gzip-compressed input can only be FASTA (read by FastaScanner.h)
+    if (FastaIsGzip(sequenceFileName.c_str()))
+    {
+        fileParser.reset(new PearsonFileParser(sequenceFileName));
+        if(userParameters->getDisplayInfo())
+            cout << "Sequence format is Pearson\n";
+        *nseqs = fileParser->countSeqs();
+        return;
+    }
+
     while (fileIn->getline(_lineIn, MAXLINE + 1))
     {
         if (!utilityObject->blankLine(_lineIn))
@@ -36,13 +36,37 @@ namespace clustalw
 PearsonFileParser::PearsonFileParser(string filePath)
 {
     fileName = filePath;
+    fastaFileOpen = false;
     fillCharTab();
 }
 
+PearsonFileParser::~PearsonFileParser()
+{
+    if (fastaFileOpen)
+    {
+        FastaClose(&fastaFile);
+    }
+}
+
+/**
+ * Maps (or, if it is gzip-compressed, inflates) the whole file once; countSeqs
+ * and getSeqRange then scan it in memory.
+ * @return false if the file cannot be read.
+ */
+bool PearsonFileParser::openFastaFile()
+{
+    if (!fastaFileOpen)
+    {
+        fastaFileOpen = (FastaOpen(&fastaFile, fileName.c_str()) == 0);
+    }
+    return fastaFileOpen;
+}
+
 
 /**
  * reads fasta/pearson file in one go instead of calling getSeq for
- * each single sequence.
+ * each single sequence. The file is scanned in memory by FastaScanner.h and
+ * may be gzip-compressed.
  *
  * FIXME AW: only PearsonFileParser::getSeqRange is special, rest is the
  * same. should be defined in FileParser and then overloaded in special
@@ -54,99 +78,66 @@ PearsonFileParser::getSeqRange(int firstSeq, int nSeqsToRead, string *offendingS
     string characterSeq = "";
     string name = "";
     string title = "";
-    string blank = "";
-    string greater = ">";
-    //_line[0] = EOS;
     vector<Sequence> seqRangeVector;
-    
-    string line;
-    
-    
-    //int i, j;
+    fasta_record_t record;
+    unsigned char map[256];
     int nSeqsRead = 0;
-    unsigned char c;
-    char delim;
-    int _currentSeqNum = 0; // Not at any sequence yet!
-    
+    int i;
+
     try
     {
-       delim=FileParser::getDelimiter(fileName);
-       //cout << "delim = " << delim << endl;
-       ifstream _fileIn;
-       _fileIn.open(fileName.c_str(),ios::in);
+        if (!openFastaFile())
+        {
+            return seqRangeVector;
+        }
 
-        // Read in lines until we get to the begining of sequence firstSeq.
-        string line="";
+        // chartab only covers 7-bit characters, everything else is dropped
+        for (i = 0; i < 256; i++)
+        {
+            map[i] = (i < 128) ? (unsigned char)chartab[i] : FASTA_SKIP;
+        }
 
-        do {
-          std::getline(_fileIn,line,delim);
-          if(line.substr(0,1) == greater){
-              _currentSeqNum++;
-          }
-        } while(_currentSeqNum <firstSeq);
-        
-        
-        while (nSeqsRead < nSeqsToRead)
+        // Skip records until we get to the begining of sequence firstSeq.
+        fastaFile.pos = 0;
+        for (i = 1; i < firstSeq; i++)
+        {
+            FastaNextRecord(&fastaFile, &record);
+        }
+
+        while (nSeqsRead < nSeqsToRead && FastaNextRecord(&fastaFile, &record))
         {
-            // get sequence name from current line (excluded '>' and read up to first ' ' or MAXNAMES
-            // remove the first char i.e. '>'
-            name=line.substr(1,MAXNAMES);
-            //if(name.find(">") != string::npos){
-            //  andreas wilm: exit if angle bracket within header?
-            //}
-            
+            // get sequence name from the header (excluded '>' and read up to first ' ' or MAXNAMES
+            name = string(record.name, record.nameLen).substr(0, MAXNAMES);
+
             while(name.substr(0,1)==" "){
                 name=name.substr(1,MAXNAMES);
             }
-            //int i;
-            //i = name.find(" ");
             if(name.find(" ") != string::npos){
                 name=name.substr(0,name.find(" "));
             }
             utilityObject->rTrim(&name); // also replaces linef
 
             name=utilityObject->blankToUnderscore(name); // replace blanks with '_'
-            
-            
-            // Read in lines until we get to the begining of next sequence.
-            
+
             title = ""; // No title information
-            
-            while(std::getline(_fileIn,line,delim) ){
-                 
-               string::const_iterator iterator1 = line.begin();
-                while(iterator1 != line.end()){
-
-                    // Andreas Wilm (UCD): exit if angle brackets within sequence
-                    if(*iterator1=='>' && iterator1!=line.begin()) {
-                        /* error output handled in Clustal.cpp
-                        cerr << "\nMultiple angle brackets inside sequence found:"
-                             << " invalid format.\n"
-                             << "Maybe you forgot a linebreak between sequences?\n";
-                        */
-                        
-                        parseExitCode=BADFORMAT;
-                        _fileIn.close();
-                        seqRangeVector.clear();
-                        return seqRangeVector;
-                    }
-                       
-                    if(*iterator1 =='\n' || *iterator1 =='\r' || *iterator1 == EOS || *iterator1 =='>'){
-                        break;
-                    }
-                    c = *iterator1;
-
-                    c = chartab[c];
-                    if(c){
-                        characterSeq.append(1,c);
-                    }
-                    iterator1++;
-                }
-                if(*iterator1 == '>'){
-                    break;
-               } 
+
+            // Andreas Wilm (UCD): exit if angle brackets within sequence
+            // (a '>' at the start of a line already ends the record)
+            if (memchr(record.body, '>', record.bodyLen) != NULL)
+            {
+                /* error output handled in Clustal.cpp */
+                parseExitCode=BADFORMAT;
+                seqRangeVector.clear();
+                return seqRangeVector;
+            }
+
+            // translate the residues straight into the sequence string
+            characterSeq.resize(record.bodyLen);
+            if (record.bodyLen > 0)
+            {
+                characterSeq.resize(FastaEncode(&record, map, &characterSeq[0], NULL));
             }
-            
+
             // check sequence
             if ((int)characterSeq.length() > userParameters->getMaxAllowedSeqLength())
             {
@@ -154,7 +145,6 @@ PearsonFileParser::getSeqRange(int firstSeq, int nSeqsToRead, string *offendingS
                 parseExitCode=SEQUENCETOOBIG;
                 if (offendingSeq!=NULL)
                     offendingSeq->assign(name);
-                _fileIn.close();
                 seqRangeVector.clear();
                 return seqRangeVector;
             }
@@ -163,18 +153,14 @@ PearsonFileParser::getSeqRange(int firstSeq, int nSeqsToRead, string *offendingS
                 parseExitCode=EMPTYSEQUENCE;
                 if (offendingSeq!=NULL)
                     offendingSeq->assign(name);
-                _fileIn.close();
                 seqRangeVector.clear();
                 return seqRangeVector;
             }
 
             seqRangeVector.push_back(Sequence(characterSeq, name, title));
-            characterSeq = "";
             nSeqsRead++;
         } // while (nSeqsRead < nSeqsToRead)
 
-        _fileIn.close();
-
         return seqRangeVector;
     }
 
@@ -387,45 +373,17 @@ PearsonFileParser::getSeqRange(int firstSeq, int nSeqsToRead, string *offendingS
  */
 int PearsonFileParser::countSeqs()
 {
-    //char line[1000 + 1];
-    int _nseqs = 0;
-    string line2;
-    char delim;
-
     try
     {
-        //_fileIn = new InFileStream;  //nige
-        //_fileIn->open(fileName.c_str());  //nige
-        delim=FileParser::getDelimiter(fileName);
-        ifstream _fileIn;
-        _fileIn.open(fileName.c_str(),ios::in);
-
-    
-        if(!_fileIn.is_open())
+        if (!openFastaFile())
         {
             return 0; // No sequences found!
         }
-    
-        /* while ((*_fileIn) >> line2/@_fileIn->getline(line, 1000 + 1)@/)
-           {
-           /@if(_nseqs == 50)
-           {
-           cout << "\n\n" << line << "\n\n";
-           throw 1;
-           }@/
-            */
-        while (std::getline(_fileIn,line2,delim)) {                 
-            if (line2[0] == '>')
-                {
-                    _nseqs++;
-                }
-        }
-        _fileIn.close();
-        return _nseqs;
+        fastaFile.pos = 0;
+        return (int)FastaCountRecords(&fastaFile);
     }
     catch(...)
     {
-        freeFileResources(_fileIn);
         cerr << "An exception has occured in the function PearsonFileParser::countSeqs()\n"
              << "Program needs to terminate.\nPlease contact the Clustal developers\n";
         throw 1;
@@ -12,6 +12,7 @@
 
 #include <string>
 #include "FileParser.h"
+#include "../../../FastaScanner.h"
 
 namespace clustalw
 {
@@ -22,6 +23,7 @@ class PearsonFileParser : public FileParser
     public:
         /* Functions */
         PearsonFileParser(string filePath);
+        virtual ~PearsonFileParser();
         virtual vector<Sequence> getSeqRange(int firstSeq, int num, string *offendingSeq=NULL);
         virtual Sequence getSeq(int seqNum, string *offendingSeq=NULL);
         virtual int countSeqs();
@@ -33,9 +35,12 @@ class PearsonFileParser : public FileParser
 
     private:
         /* Functions */
+        bool openFastaFile();
 
         /* Attributes */
         string fileName;
+        fasta_file_t fastaFile; // whole file, shared by countSeqs and getSeqRange
+        bool fastaFileOpen;
 };
 
 }
@@ -5,7 +5,8 @@
  */
 /**
  * The SymMatrix class is used to store the distance matrix. It stores it in a double  
- * array.
+ * array. Very large arrays can be backed by a memory-mapped temporary file (see
+ * PackedDistMatrix.h).
  * This class throws an out_of_range exception if we try to access an element outside 
  * of the array bounds. It will throw a bad_alloc if we cannot allocate enough memory for 
  * the distance matrix.
@@ -20,6 +21,7 @@
 #include <stdexcept>
 #include <new>
 #include <cstdlib>
+#include "../../../PackedDistMatrix.h"
 
 namespace clustalw
 {
@@ -28,9 +30,10 @@ using namespace std;
 class SymMatrix
 {
     public:
-        SymMatrix() : elements(0), numSeqs(0), subElements(0), firstSeq(0), numSeqsInSub(0){;}
+        SymMatrix() : elements(0), elementsMapped(0), numSeqs(0), subElements(0), firstSeq(0), numSeqsInSub(0){;}
         SymMatrix(int size)
          : elements(0),
+           elementsMapped(0),
            numSeqs(0),
            subElements(0),
            firstSeq(0),
@@ -38,11 +41,10 @@ class SymMatrix
         {
             // Size is the numSeqs + 1
             numSeqs = size - 1;
-            sizeElements = ((numSeqs + 1) * (numSeqs + 2)) >> 1;
+            sizeElements = ((size_t)(numSeqs + 1) * (numSeqs + 2)) >> 1;
             try
             {
-                elements = new double[sizeElements];
-                setAllArrayToVal(elements, sizeElements, 0.0);
+                allocElements(0.0);
             }
             catch(bad_alloc& e)
             {
@@ -54,40 +56,35 @@ class SymMatrix
         }
         ~SymMatrix()
         {
-            if(elements)
-            {
-                delete [] elements;
-            }
+            freeElements();
             if(subElements)
             {
                 delete [] subElements;
             }
         }
         
+        // The index is kept local so that distinct cells can be written
+        // concurrently (see FullPairwiseAlign).
         inline void SetAt(int nRow, int nCol, const double& value)
         {
-            index = getIndex(nRow, nCol, numSeqs);
+            size_t index = getIndex(nRow, nCol, numSeqs);
             elements[index] = value; 
         }
         
         inline double GetAt(int nRow, int nCol) 
         {
-            index = getIndex(nRow, nCol, numSeqs);
+            size_t index = getIndex(nRow, nCol, numSeqs);
             return elements[index];
         }
    
         inline void ResizeRect(int size, double val = 0.0)
         {
             numSeqs = size - 1;
-            sizeElements = ((numSeqs + 1) * (numSeqs + 2)) >> 1;
-            if(elements)
-            {
-                delete [] elements;
-            }
+            freeElements();
+            sizeElements = ((size_t)(numSeqs + 1) * (numSeqs + 2)) >> 1;
             try
             {
-                elements = new double[sizeElements];
-                setAllArrayToVal(elements, sizeElements, val);
+                allocElements(val);
             }
             catch(bad_alloc& e)
             {
@@ -97,9 +94,9 @@ class SymMatrix
             }            
         }
         
-        inline void setAllArrayToVal(double* array, int size, double val)
+        inline void setAllArrayToVal(double* array, size_t size, double val)
         {
-            for(int i = 0; i < size; i++)
+            for(size_t i = 0; i < size; i++)
             {
                 array[i] = val;
             }
@@ -112,13 +109,8 @@ class SymMatrix
 
         inline void clearArray()
         {
-            sizeElements = 0;
+            freeElements();
             numSeqs = 0;
-            if(elements)
-            {
-                delete [] elements;
-                elements = 0;
-            }
             
             numSeqsInSub = 0;
             sizeSubElements = 0;
@@ -140,11 +132,11 @@ class SymMatrix
             printArray(subElements, sizeSubElements);
         }
         
-        void printArray(double* array, int size)
+        void printArray(double* array, size_t size)
         {
             int numThisTime = 1;
             int numSoFar = 0;
-            for(int i = 0; i < size; i++)
+            for(size_t i = 0; i < size; i++)
             {
                 
                 numSoFar++;
@@ -163,7 +155,7 @@ class SymMatrix
             cout << "\n";
         }
         
-        inline int getIndex(const int &i, const int &j, const int &nSeqs) const
+        inline size_t getIndex(const int &i, const int &j, const int &nSeqs) const
         {
             if(i == 0 || j == 0)
             {
@@ -177,7 +169,7 @@ class SymMatrix
                 {
                     throw out_of_range("index out of range\n");
                 }
-                return (_i * (_i + 3)) >> 1;
+                return ((size_t)_i * (_i + 3)) >> 1;
             }
 
             if (_i > _j) 
@@ -186,14 +178,14 @@ class SymMatrix
                 {
                     throw out_of_range("index out of range\n");
                 }
-                return ((_i * (_i + 1)) >> 1) + _j;
+                return (((size_t)_i * (_i + 1)) >> 1) + _j;
             }
 
             if ((_j >= nSeqs) || (_i < 0))
             {
                 throw out_of_range("index out of range\n");
             }
-            return  ((_j * (_j + 1)) >> 1) + _i;            
+            return  (((size_t)_j * (_j + 1)) >> 1) + _i;            
         }
         
         //inline
@@ -227,13 +219,13 @@ class SymMatrix
                     {
                         delete [] subElements;
                     }
-                    sizeSubElements = ((nSeqsInSub + 1) * (nSeqsInSub + 2)) >> 1;
+                    sizeSubElements = ((size_t)(nSeqsInSub + 1) * (nSeqsInSub + 2)) >> 1;
                     numSeqsInSub = nSeqsInSub;                    
                     
                     subElements = new double[sizeSubElements];
                     setAllArrayToVal(subElements, sizeSubElements, 0.0);
                     
-                    int currIndex = 0;
+                    size_t currIndex = 0;
                     subElements[0] = 0.0;
                     int lSeq = fSeq + numSeqsInSub - 1; // NOTE this is wrong!!!!! Need to fix
 
@@ -283,13 +275,37 @@ class SymMatrix
         }
         
     private:
+        // Zero-initialised, so only other values need to be set.
+        inline void allocElements(double val)
+        {
+            elements = (double *) PdmAllocBlock(sizeElements * sizeof(double),
+                                                &elementsMapped);
+            if(!elements)
+            {
+                sizeElements = 0;
+                throw bad_alloc();
+            }
+            if(val != 0.0)
+            {
+                setAllArrayToVal(elements, sizeElements, val);
+            }
+        }
+
+        inline void freeElements()
+        {
+            PdmFreeBlock(elements, sizeElements * sizeof(double), elementsMapped);
+            elements = 0;
+            elementsMapped = 0;
+            sizeElements = 0;
+        }
+
         double* elements;
-        int sizeElements;
+        int elementsMapped;
+        size_t sizeElements;
         int numSeqs;
-        int index;
         double* subElements; // To be used to return a sub matrix.
         int firstSeq, numSeqsInSub;
-        int sizeSubElements;
+        size_t sizeSubElements;
 };
 
 }
@@ -166,6 +166,7 @@ UserParameters::UserParameters(bool log)
     numIterations = 3;
     doRemoveFirstIteration = NONE; 
     maxAllowedSeqLength = INT_MAX;
+    numThreads = 1;
     
     clusterAlgorithm = NJ;
     displayInfo = true;
@@ -281,6 +282,7 @@ void UserParameters::setParamsToDefault()
     quiet = false;
     doRemoveFirstIteration = NONE;
     maxAllowedSeqLength = INT_MAX;
+    numThreads = 1;
 }
 
 /*
@@ -643,11 +645,41 @@ void UserParameters::setDNAFlag(bool value)
     DNAFlag = value;
 }
 
+/*
+ * distanceTree of the calling thread: -1 if it uses the shared flag,
+ * otherwise 0 or 1 (see beginThreadDistanceTree).
+ */
+static thread_local int threadDistanceTree = -1;
+
+bool UserParameters::getDistanceTree()
+{
+    if(threadDistanceTree >= 0)
+    {
+        return threadDistanceTree != 0;
+    }
+    return distanceTree;
+}
+
 void UserParameters::setDistanceTree(bool value)
 {
+    if(threadDistanceTree >= 0)
+    {
+        threadDistanceTree = value ? 1 : 0;
+        return;
+    }
     distanceTree = value;
 }
 
+void UserParameters::beginThreadDistanceTree(bool value)
+{
+    threadDistanceTree = value ? 1 : 0;
+}
+
+void UserParameters::endThreadDistanceTree()
+{
+    threadDistanceTree = -1;
+}
+
 void UserParameters::setSeqName(string value)
 {
     seqName = value;
@@ -76,8 +76,16 @@ class UserParameters
         void setMenuFlag(bool value);
         bool getDNAFlag(){return DNAFlag;};
         void setDNAFlag(bool value);
-        bool getDistanceTree(){return distanceTree;};
+        bool getDistanceTree();
         void setDistanceTree(bool value);
+        /**
+         * The tree reading and profile alignment stages switch distanceTree.
+         * Threads which run these stages side by side (see Iteration) use
+         * their own copy of the flag, set to value, until
+         * endThreadDistanceTree() is called.
+         */
+        void beginThreadDistanceTree(bool value);
+        void endThreadDistanceTree();
         string getSeqName(){return seqName;};
         void setSeqName(string value);
         float getDNAGapOpen(){return DNAGapOpen;};
@@ -324,6 +332,8 @@ class UserParameters
         void setFullHelpFlag(bool b) {fullHelpFlag = b;}
         void setMaxAllowedSeqLength(int num){maxAllowedSeqLength = num;}
         int getMaxAllowedSeqLength(){return maxAllowedSeqLength;}
+        void setNumThreads(int num){numThreads = num;}
+        int getNumThreads(){return numThreads;}
 
         bool ResetGapsIsEnabled() {return (resetAlignmentsNew || resetAlignmentsAll);};
 
@@ -463,6 +473,7 @@ class UserParameters
         bool quiet;
         
         int maxAllowedSeqLength;
+        int numThreads;
 };
 }
 #endif
@@ -202,6 +202,7 @@ const int  GCG_LINELENGTH = 50;
 
 const int NJ = 1;
 const int UPGMA = 2;
+const int FASTNJ = 3;
 
 const int ALIGNMENT = 1;
 const int TREE = 2;
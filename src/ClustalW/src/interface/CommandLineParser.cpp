@@ -99,7 +99,8 @@ CommandLineParser::CommandLineParser(StringArray* args, bool xmenus)
     setTreeAlgorithm(-1),
     setMaxSeqLen(-1),
     setStatsFile(-1),
-    setOutputPim(-1)
+    setOutputPim(-1),
+    setNumThreads(-1)
 {
     int ctr=0;
     
@@ -120,7 +121,7 @@ CommandLineParser::CommandLineParser(StringArray* args, bool xmenus)
         outputTreeArg = new StringArray(5);
         outputSecStrArg = new StringArray(5);
         cmdLineType = new StringArray(6);
-        clusterAlgorithm = new StringArray(3);
+        clusterAlgorithm = new StringArray(4);
         iterationArg = new StringArray(4);
         
         params = new StringArray; // Wait until I need it!!!!!!!!!
@@ -191,7 +192,8 @@ CommandLineParser::CommandLineParser(StringArray* args, bool xmenus)
     
     (*clusterAlgorithm)[0] = "nj";
     (*clusterAlgorithm)[1] = "upgma";
-    (*clusterAlgorithm)[2] = "";
+    (*clusterAlgorithm)[2] = "fastnj";
+    (*clusterAlgorithm)[3] = "";
 
     (*iterationArg)[0] = "tree";
     (*iterationArg)[1] = "alignment";
@@ -307,6 +309,7 @@ CommandLineParser::CommandLineParser(StringArray* args, bool xmenus)
     cmdLinePara[ctr++] = getCmdLineDataStruct("maxseqlen", &setMaxSeqLen, INTARG, NULL);
     cmdLinePara[ctr++] = getCmdLineDataStruct("stats", &setStatsFile, FILARG, NULL);
     cmdLinePara[ctr++] = getCmdLineDataStruct("pim", &setOutputPim, NOARG, NULL);
+    cmdLinePara[ctr++] = getCmdLineDataStruct("threads", &setNumThreads, INTARG, NULL);
     cmdLinePara[ctr++] = getCmdLineDataStruct("", NULL, -1, NULL);
     // FIXME: final ctr index is hardcoded in CommandLineParser
 
@@ -437,6 +440,32 @@ void CommandLineParser::run(StringArray* args, bool xmenus, ClustalWInput *input
         
     }
 
+    if (setNumThreads != -1)
+    {
+        #if DEBUGFULL 
+            if(logObject && DEBUGLOG)
+            {
+                logObject->logMsg("    Setting number of threads.");
+            }    
+        #endif      
+        temp = 0;
+        if((*paramArg)[setNumThreads].length() > 0)
+        {
+            if (sscanf((*paramArg)[setNumThreads].c_str(),"%d", &temp) != 1) 
+            {
+                reportBadOptionAndExit("threads", "integer");
+            }
+        }
+        if(temp > 0)
+        {
+            userParameters->setNumThreads(temp);
+        }
+        else
+        {
+            cerr << "Number of threads must be positive. Using default"  << std::endl;
+        }
+    }
+
     if (setStatsFile != -1)
     {
         if((*paramArg)[setStatsFile].length() > 0) 
@@ -1452,7 +1481,7 @@ void CommandLineParser::setOptionalParam(Rcpp::NumericMatrix substitutionMatrix)
         #endif
         if((*paramArg)[setTreeAlgorithm].length() > 0) 
         { 
-            temp = findMatch((*paramArg)[setTreeAlgorithm], clusterAlgorithm, 2);
+            temp = findMatch((*paramArg)[setTreeAlgorithm], clusterAlgorithm, 3);
             if(temp == 0)
             {
                 userParameters->setClusterAlgorithm(NJ);
@@ -1461,6 +1490,10 @@ void CommandLineParser::setOptionalParam(Rcpp::NumericMatrix substitutionMatrix)
             {
                 userParameters->setClusterAlgorithm(UPGMA);
             }
+            else if(temp == 2)
+            {
+                userParameters->setClusterAlgorithm(FASTNJ);
+            }
             else
             {
                 cerr << "Unknown option for clustering algorithm. Using default\n";
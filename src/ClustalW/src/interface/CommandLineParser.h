@@ -160,6 +160,7 @@ class CommandLineParser
         int setMaxSeqLen;
         int setStatsFile;
         int setOutputPim;
+        int setNumThreads;
         
         string userMatrixName;
         string pwUserMatrixName;
@@ -168,7 +169,7 @@ class CommandLineParser
         
         CmdLineData cmdLineFile[4];
         CmdLineData cmdLineVerb[20];
-        CmdLineData cmdLinePara[56];
+        CmdLineData cmdLinePara[57];
         
         string clustalTreeName;
         string distTreeName;
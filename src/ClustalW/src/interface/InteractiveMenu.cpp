@@ -568,6 +568,10 @@ void InteractiveMenu::phylogeneticTreeMenu()
         {
             cout << "NJ\n\n";
         }
+        else if(userParameters->getClusterAlgorithm() == FASTNJ)
+        {
+            cout << "FASTNJ\n\n";
+        }
         else
         {
             cout << "UPGMA\n\n";
@@ -1202,6 +1206,10 @@ void InteractiveMenu::clusteringAlgorithmMenu()
         {
             currentAlgorithm = "Neighbour Joining";
         }
+        else if(userParameters->getClusterAlgorithm() == FASTNJ)
+        {
+            currentAlgorithm = "Fast Neighbour Joining";
+        }
         else
         {
             currentAlgorithm = "UPGMA";
@@ -1211,6 +1219,7 @@ void InteractiveMenu::clusteringAlgorithmMenu()
         cout<<" ****** Clustering Algorithms ******\n\n\n";
         cout<<"     1. Neighbour Joining \n";
         cout<<"     2. UPGMA \n";
+        cout<<"     3. Fast Neighbour Joining \n";
         cout << "-- Current algorithm is "<< currentAlgorithm << " --\n\n\n";
 
         
@@ -1227,6 +1236,9 @@ void InteractiveMenu::clusteringAlgorithmMenu()
             case '2':
                 userParameters->setClusterAlgorithm(UPGMA);
                 break;
+            case '3':
+                userParameters->setClusterAlgorithm(FASTNJ);
+                break;
             default:
                 cout<< "\n\nUnrecognised Command\n\n";
                 break;
@@ -17,6 +17,11 @@
 #include "../tree/TreeInterface.h"
 #include "../clustalw_version.h"
 #include "MSA.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
 
 namespace clustalw
 {
@@ -135,7 +140,12 @@ void Iteration::printSeqArray(SeqArray* arrayToPrint)
  *         remove seq i
  *         if either of the profiles has all gaps, remove this column.
  *         realign using profileAlign
- *         if its better, keep it. If its not better, dont keep it. 
+ *      keep the best of these alignments if it is better than the one the
+ *      iteration started from, and start the next iteration from it.
+ * The sequences of one iteration are realigned independently of each other,
+ * by getNumThreads() threads. The best alignment is the one with the lowest
+ * score and, among equal scores, the lowest sequence number, so the result
+ * does not depend on the number of threads.
  * @param alnPtr The alignment object.
  * @return true if it has been successful, false if it has not been successful.
  */
@@ -146,17 +156,12 @@ bool Iteration::removeFirstIterate(Alignment* alnPtr)
         return false;
     }
     
-    string p1TreeName;
-    p1TreeName = "";
-    string p2TreeName;
     int nSeqs = alnPtr->getNumSeqs();
     
     if(nSeqs <= 2)
     {
         return false;
     }
-    DistMatrix distMat;    
-    distMat.ResizeRect(nSeqs + 1);
     
     ObjectiveScore scoreObj;
     int iterate = userParameters->getDoRemoveFirstIteration();
@@ -164,141 +169,158 @@ bool Iteration::removeFirstIterate(Alignment* alnPtr)
            
     double firstScore = scoreObj.getScore(alnPtr);
     //cout << "firstScore = " << firstScore << "\n";
-    double score = 0;
     double bestScore = firstScore;
     double dscore;
-    int count;
-    bool scoreImproved = false;
     bool scoreImprovedAnyIteration = false;
-    int prof1NumSeqs = 1;
-    
-    // This will be used for removing gaps!!!
-    vector<int> profile1;
-    vector<int> profile2;
-    profile1.resize(nSeqs + 1, 0);
-    profile1[1] = 1;
-    profile2.resize(nSeqs + 1, 1);
-    profile2[0] = 0;
-    profile2[1] = 0;
-    vector<int> prof1Weight, prof2Weight;
     int iterations = userParameters->getNumIterations();
     //cout << "Max num iterations = " << iterations << "\n";
+    int numThreads = utilityObject->MAX(1, utilityObject->MIN(userParameters->getNumThreads(),
+                                                              nSeqs));
+    // Every realignment starts with the flag as it is now (see realignSequence)
+    bool distanceTree = userParameters->getDistanceTree();
     Alignment bestAlignSoFar;
-    TreeInterface tree;
+    Alignment* iterationStart = alnPtr;
+    DistMatrix identDist;
+    
+    // Best realignment found by one thread in the current iteration
+    struct Candidate
+    {
+        int seqNum;
+        double score;
+        Alignment align;
+    };
+    vector<Candidate> best(numThreads);
+    
     // One iteration consists of removing each of the sequences, reseting all the gap
-    // only columns. If the score is better, the new alignment is kept.
+    // only columns. If the best score is better, the new alignment is kept.
     for(int n = 1; n <= iterations; n++)
     {
-        scoreImproved = false;
         cout << "ITERATION " << n << " OF " << iterations << "\n";
-        for(int i = 1; i <= nSeqs; i++)
+        
+        // Percent identity distances of the alignment the iteration starts from.
+        identDist.ResizeRect(nSeqs + 1);
+        for (int i = 1; i <= nSeqs; i++) 
         {
-            vector<Sequence> seqVector;
-            Alignment iterateAlign = *alnPtr;
-
-            iterateAlign.setProfile1NumSeqs(1);
-
-            // We remove the sequence i from the profile, and paste into the first position
-            // This is to make it easy to do the profile alignment.
-            vector<int> selected;
-            selected.resize(nSeqs + 1, 0);
-            selected[i] = 1;
-            seqVector = iterateAlign.cutSelectedSequencesFromAlignment(&selected);
-            iterateAlign.pasteSequencesIntoPosition(&seqVector, 0);
-
-            // Remove any gap only columns
-            iterateAlign.removeGapOnlyColsFromSelectedSeqs(&profile1);
-            iterateAlign.removeGapOnlyColsFromSelectedSeqs(&profile2);
-
-            // Calculate a simple distance matrix.
-            if(nSeqs - 1 >= 2) 
+            for (int j = i + 1; j <= nSeqs; j++) 
+            {
+                dscore = iterationStart->countid(i, j);
+                identDist(i, j) = (100.0 - dscore)/100.0;
+            }
+        }
+        
+        std::atomic<int> nextSeq(1);
+        std::exception_ptr workerError;
+        std::mutex errorMutex;
+        bool failed = false;
+        
+        auto worker = [&](int t)
+        {
+            Alignment iterateAlign;
+            double score;
+            int i;
+            
+            best[t].seqNum = 0;
+            userParameters->beginThreadDistanceTree(distanceTree);
+            try
             {
-                for (int i = 1; i <= nSeqs; i++) 
+                while ((i = nextSeq++) <= nSeqs)
                 {
-                    for (int j = i + 1; j <= nSeqs; j++) 
+                    if(!realignSequence(iterationStart, &identDist, i, &iterateAlign, &score))
+                    {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        failed = true;
+                        nextSeq = nSeqs + 1;
+                        break;
+                    }
+                    // the sequence numbers of one thread increase, so the
+                    // first of equal scores is kept
+                    if(best[t].seqNum == 0 || score < best[t].score)
                     {
-                        dscore = iterateAlign.countid(i, j);
-                        distMat(i, j) = (100.0 - dscore)/100.0;
+                        best[t].seqNum = i;
+                        best[t].score = score;
+                        std::swap(best[t].align, iterateAlign);
                     }
                 }
-
-                /* temporary tree file
-                 *  
-                 * can't use the safer mkstemp function here, because
-                 * we just pass down the filename :(
-                 */
-                char buffer[L_tmpnam];
-                tmpnam (buffer);
-                p2TreeName = buffer + string(".dnd");
-                // should test here if file is writable
             }
-            bool success = false;
-            prof1Weight.clear();
-            prof1Weight.resize(prof1NumSeqs);
-            prof2Weight.clear();
-            prof2Weight.resize(nSeqs);
-
-            tree.getWeightsForProfileAlign(&iterateAlign, &distMat, &p1TreeName, &prof1Weight,
-                                           &p2TreeName, &prof2Weight, nSeqs, prof1NumSeqs,
-                                           false, false, &success);
-            remove(p2TreeName.c_str());
-            if(!success)
+            catch(...)
             {
-                /* returning false only means alignment hasn't
-                 * changed, but here getWeightsForProfileAlign failed,
-                 * most likely because p2TreeName couldn't be read. an
-                 * error will be printed to console.  clustalw should
-                 * then exit, FIXME: clustalx users have to sit
-                 * through all error messages until someone
-                 * implements a way to return an exit code and react
-                 * appropriately
-                 */
-                // does anyone know how to use
-                // (userParameters->getMenuFlag() ||
-                // !userParameters->getInteractive() instead?
-                char buf[1024];
-                utilityObject->myname(buf);
-                if (strcasecmp(buf, "clustalw")==0) {
-                    throw EXIT_FAILURE;
-                } else {
-                    // the next two lines were here before the exit
-                    // was added. keeping it for clustalx although it
-                    // doesnt seem to make any sens
-                    userParameters->setDoRemoveFirstIteration(iterate);
-                    return false;
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!workerError)
+                {
+                    workerError = std::current_exception();
                 }
+                nextSeq = nSeqs + 1; // stop the other workers early
             }
-                        
-            MSA* msaObj = new MSA();
-
-            iterateAlign.resetProfile1();
-            iterateAlign.resetProfile2();
-            // Do the profile alignment.
-            count = msaObj->doProfileAlign(&iterateAlign, &distMat, 
-                                            &prof1Weight, &prof2Weight);   
-            delete msaObj;
-            // Check if its better
-            score = scoreObj.getScore(&iterateAlign);
-            iterateAlign.setProfile1NumSeqs(0);
-            
-            if(score < bestScore) // Might be a problem with this.
+            userParameters->endThreadDistanceTree();
+        };
+        
+        vector<std::thread> threads;
+        for (int t = 1; t < numThreads; t++)
+        {
+            threads.push_back(std::thread(worker, t));
+        }
+        worker(0);
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            threads[t].join();
+        }
+        
+        if (workerError)
+        {
+            userParameters->setDoRemoveFirstIteration(iterate);
+            std::rethrow_exception(workerError);
+        }
+        if(failed)
+        {
+            /* returning false only means alignment hasn't
+             * changed, but here getWeightsForProfileAlign failed,
+             * most likely because p2TreeName couldn't be read. an
+             * error will be printed to console.  clustalw should
+             * then exit, FIXME: clustalx users have to sit
+             * through all error messages until someone
+             * implements a way to return an exit code and react
+             * appropriately
+             */
+            // does anyone know how to use
+            // (userParameters->getMenuFlag() ||
+            // !userParameters->getInteractive() instead?
+            char buf[1024];
+            utilityObject->myname(buf);
+            if (strcasecmp(buf, "clustalw")==0) {
+                throw EXIT_FAILURE;
+            } else {
+                // the next two lines were here before the exit
+                // was added. keeping it for clustalx although it
+                // doesnt seem to make any sens
+                userParameters->setDoRemoveFirstIteration(iterate);
+                return false;
+            }
+        }
+        
+        int bestThread = -1;
+        for (int t = 0; t < numThreads; t++)
+        {
+            if(best[t].seqNum != 0 &&
+               (bestThread < 0 || best[t].score < best[bestThread].score ||
+                (best[t].score == best[bestThread].score &&
+                 best[t].seqNum < best[bestThread].seqNum)))
             {
-                //cout << "**********************************************\n";
-                //cout << "***** Better score found using iteration *****\n";
-                //cout << "**********************************************\n";
-                bestScore = score;
-                bestAlignSoFar = iterateAlign;
-                scoreImproved = true;
-                scoreImprovedAnyIteration = true;
+                bestThread = t;
             }
-            distMat.clearArray();
-            distMat.ResizeRect(nSeqs + 1);   
         }
-        if(scoreImproved == false)
+        
+        if(bestThread < 0 || !(best[bestThread].score < bestScore)) // Might be a problem with this.
         {
             cout << "Score was not improved in last iteration. Exiting...\n";
             break;
         }
+        //cout << "**********************************************\n";
+        //cout << "***** Better score found using iteration *****\n";
+        //cout << "**********************************************\n";
+        bestScore = best[bestThread].score;
+        std::swap(bestAlignSoFar, best[bestThread].align);
+        iterationStart = &bestAlignSoFar;
+        scoreImprovedAnyIteration = true;
     }
     
     //
@@ -324,5 +346,114 @@ bool Iteration::removeFirstIterate(Alignment* alnPtr)
     return true; // It was successful.
 }
 
+/**
+ * Removes sequence seqNum from a copy of baseAlign, pastes it into the first
+ * position, realigns it to the other sequences and scores the result.
+ * baseAlign is only read, so several threads can realign sequences of the
+ * same alignment. Each call keeps the distanceTree flag it changes private to
+ * the calling thread (see UserParameters::beginThreadDistanceTree).
+ * @param baseAlign alignment the sequence is removed from
+ * @param identDist percent identity distances of baseAlign
+ * @param seqNum number of the sequence in baseAlign
+ * @param candidate receives the new alignment
+ * @param score receives its score
+ * @return false if the sequence weights could not be calculated.
+ */
+bool Iteration::realignSequence(Alignment* baseAlign, DistMatrix* identDist, int seqNum,
+                                Alignment* candidate, double* score)
+{
+    string p1TreeName;
+    p1TreeName = "";
+    string p2TreeName;
+    int nSeqs = baseAlign->getNumSeqs();
+    int prof1NumSeqs = 1;
+    double dscore;
+    bool distanceTree = userParameters->getDistanceTree();
+    
+    // This will be used for removing gaps!!!
+    vector<int> profile1;
+    vector<int> profile2;
+    profile1.resize(nSeqs + 1, 0);
+    profile1[1] = 1;
+    profile2.resize(nSeqs + 1, 1);
+    profile2[0] = 0;
+    profile2[1] = 0;
+    vector<int> prof1Weight, prof2Weight;
+    vector<Sequence> seqVector;
+    DistMatrix distMat;
+    TreeInterface tree;
+    ObjectiveScore scoreObj;
+    
+    *candidate = *baseAlign;
+    candidate->setProfile1NumSeqs(1);
+    // We remove the sequence i from the profile, and paste into the first position
+    // This is to make it easy to do the profile alignment.
+    vector<int> selected;
+    selected.resize(nSeqs + 1, 0);
+    selected[seqNum] = 1;
+    seqVector = candidate->cutSelectedSequencesFromAlignment(&selected);
+    candidate->pasteSequencesIntoPosition(&seqVector, 0);
+
+    // Remove any gap only columns
+    candidate->removeGapOnlyColsFromSelectedSeqs(&profile1);
+    candidate->removeGapOnlyColsFromSelectedSeqs(&profile2);
+
+    // Calculate a simple distance matrix. Removing the columns which are gaps
+    // in all of profile 2 does not change the identities within profile 2, so
+    // these are taken from baseAlign.
+    distMat.ResizeRect(nSeqs + 1);
+    for (int j = 2; j <= nSeqs; j++) 
+    {
+        dscore = candidate->countid(1, j);
+        distMat(1, j) = (100.0 - dscore)/100.0;
+    }
+    for (int i = 2; i <= nSeqs; i++) 
+    {
+        int baseI = (i - 1 < seqNum) ? i - 1 : i;
+        for (int j = i + 1; j <= nSeqs; j++) 
+        {
+            int baseJ = (j - 1 < seqNum) ? j - 1 : j;
+            distMat(i, j) = (*identDist)(baseI, baseJ);
+        }
+    }
+
+    /* temporary tree file
+     *  
+     * can't use the safer mkstemp function here, because
+     * we just pass down the filename :(
+     */
+    char buffer[L_tmpnam];
+    tmpnam (buffer);
+    p2TreeName = buffer + string(".dnd");
+    // should test here if file is writable
+
+    bool success = false;
+    prof1Weight.resize(prof1NumSeqs);
+    prof2Weight.resize(nSeqs);
+
+    tree.getWeightsForProfileAlign(candidate, &distMat, &p1TreeName, &prof1Weight,
+                                   &p2TreeName, &prof2Weight, nSeqs, prof1NumSeqs,
+                                   false, false, &success);
+    remove(p2TreeName.c_str());
+    if(!success)
+    {
+        userParameters->setDistanceTree(distanceTree);
+        return false;
+    }
+                
+    MSA* msaObj = new MSA();
+
+    candidate->resetProfile1();
+    candidate->resetProfile2();
+    // Do the profile alignment.
+    msaObj->doProfileAlign(candidate, &distMat, &prof1Weight, &prof2Weight);   
+    delete msaObj;
+    // Check if its better
+    *score = scoreObj.getScore(candidate);
+    candidate->setProfile1NumSeqs(0);
+    
+    userParameters->setDistanceTree(distanceTree);
+    return true;
 }
 
+}
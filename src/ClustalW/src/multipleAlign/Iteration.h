@@ -20,6 +20,8 @@ class Iteration
         bool removeFirstIterate(Alignment* alnPtr);
     private:
         void printSeqArray(SeqArray* arrayToPrint);
+        bool realignSequence(Alignment* baseAlign, DistMatrix* identDist, int seqNum,
+                             Alignment* candidate, double* score);
 };
 
 }
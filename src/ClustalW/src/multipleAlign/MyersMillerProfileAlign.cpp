@@ -11,9 +11,91 @@
 #include "Iteration.h"
 #include <math.h>
 
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define PRFSCORE_SSE2 1
+#include <immintrin.h>
+// GCC on Windows does not align the stack for 256-bit spills.
+#if !defined(_WIN32)
+#define PRFSCORE_AVX2 1
+#else
+#define PRFSCORE_AVX2 0
+#endif
+#else
+#define PRFSCORE_SSE2 0
+#define PRFSCORE_AVX2 0
+#endif
+
 namespace clustalw
 {
 
+/*
+ * Dot products of two packed profile rows of 32 16-bit entries. The products
+ * are summed in 32-bit integers, so the result is the same as the sum over the
+ * int profile entries.
+ */
+typedef int (*PrfDotFunc)(const short* row1, const short* row2);
+
+static int prfDotScalar(const short* row1, const short* row2)
+{
+    int score = 0;
+    for (int ix = 0; ix < NUMRES; ix++)
+    {
+        score += row1[ix] * row2[ix];
+    }
+    return score;
+}
+
+#if PRFSCORE_SSE2
+static int prfDotSSE2(const short* row1, const short* row2)
+{
+    __m128i sum = _mm_setzero_si128();
+    for (int ix = 0; ix < NUMRES; ix += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(row1 + ix));
+        __m128i b = _mm_loadu_si128((const __m128i*)(row2 + ix));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, b));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+#if PRFSCORE_AVX2
+__attribute__((target("avx2")))
+static int prfDotAVX2(const short* row1, const short* row2)
+{
+    __m256i sum = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*)row1),
+                                    _mm256_loadu_si256((const __m256i*)row2));
+    sum = _mm256_add_epi32(sum, 
+              _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 16)),
+                                _mm256_loadu_si256((const __m256i*)(row2 + 16))));
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+static PrfDotFunc detectPrfDot()
+{
+#if PRFSCORE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return prfDotAVX2;
+    }
+#endif
+#if PRFSCORE_SSE2
+    return prfDotSSE2;
+#else
+    return prfDotScalar;
+#endif
+}
+
+static const PrfDotFunc prfDot = detectPrfDot();
+
 /**
  * 
  * @return 
@@ -322,21 +404,29 @@ int MyersMillerProfileAlign::profileAlign(Alignment* alnPtr, DistMatrix* distMat
     
     gaps.resize(alnPtr->getMaxAlnLength() + 1);
     
+    // The profile calculations scan the columns of both profiles; give them a
+    // column-major copy of seqArray.
+    ResidueMatrix residues(nseqs1 + nseqs2, utilityObject->MAX(prfLength1, prfLength2));
+    for (i = 0; i < nseqs1 + nseqs2; i++)
+    {
+        residues.setRow(i, &seqArray[i], 0, _gapPos1);
+    }
+
     bool profile1Pen; 
     if (switchProfiles == false)
     {
         profile1Pen = userParameters->getStructPenalties1() && userParameters->getUseSS1();
-        profileWithSub->calcGapCoeff(&seqArray, &gaps, profile1Pen,
+        profileWithSub->calcGapCoeff(&residues, &gaps, profile1Pen,
                                      alnPtr->getGapPenaltyMask1(), gapcoef1, lencoef1);
     }
     else
     {
         profile1Pen = userParameters->getStructPenalties2() && userParameters->getUseSS2();
-        profileWithSub->calcGapCoeff(&seqArray, &gaps, profile1Pen,
+        profileWithSub->calcGapCoeff(&residues, &gaps, profile1Pen,
                                      alnPtr->getGapPenaltyMask2(), gapcoef1, lencoef1);
     }
     // calculate the profile matrix.
-    profileWithSub->calcProfileWithSub(&seqArray, &gaps, matrix, &alnWeight);
+    profileWithSub->calcProfileWithSub(&residues, &gaps, matrix, &alnWeight);
     profile1 = profileWithSub->getProfilePtr();
     
     if (userParameters->getDebug() > 4)
@@ -365,19 +455,19 @@ int MyersMillerProfileAlign::profileAlign(Alignment* alnPtr, DistMatrix* distMat
     if (switchProfiles == false)
     {
         profile2Pen = userParameters->getStructPenalties2() && userParameters->getUseSS2();
-        profileStandard->calcGapCoeff(&seqArray, &gaps, profile2Pen,
+        profileStandard->calcGapCoeff(&residues, &gaps, profile2Pen,
                                       alnPtr->getGapPenaltyMask2(), gapcoef2, lencoef2);
     }
     else
     {
         profile2Pen = userParameters->getStructPenalties1() && userParameters->getUseSS1();
-        profileStandard->calcGapCoeff(&seqArray, &gaps, profile2Pen,
+        profileStandard->calcGapCoeff(&residues, &gaps, profile2Pen,
                                       alnPtr->getGapPenaltyMask1(), gapcoef2, lencoef2);
     }
 
     // calculate the profile matrix.
     
-    profileStandard->calcStandardProfile(&seqArray, &alnWeight);
+    profileStandard->calcStandardProfile(&residues, &alnWeight);
     profile2 = profileStandard->getProfilePtr();
     
     if (userParameters->getDebug() > 4)
@@ -401,6 +491,8 @@ int MyersMillerProfileAlign::profileAlign(Alignment* alnPtr, DistMatrix* distMat
         }
     }
     alnWeight.clear();
+    
+    packProfiles();
 
     int _maxAlnLength = alnPtr->getMaxAlnLength();
     
@@ -495,6 +587,8 @@ int MyersMillerProfileAlign::profileAlign(Alignment* alnPtr, DistMatrix* distMat
     
     delete profileWithSub;
     delete profileStandard;
+    prfScores1.clear();
+    prfScores2.clear();
 
     int retScore = (score / 100);
 
@@ -521,11 +615,11 @@ int MyersMillerProfileAlign::progDiff(int A, int B, int M, int N, int go1, int g
     int midi, midj, type;
     int midh;
 
-    static int t, tl, g, h;
+    int t, tl, g, h;
 
     {
-        static int i, j;
-        static int hh, f, e, s;
+        int i, j;
+        int hh, f, e, s;
 
         /* Boundary cases: M <= 1 or N == 0 */
         if (userParameters->getDebug() > 2)
@@ -1002,6 +1096,10 @@ inline int MyersMillerProfileAlign::prfScore(int n, int m)
     int ix;
     int score;
 
+    if (packedScores)
+    {
+        return prfDot(&prfScores1[n * PRFSTRIDE], &prfScores2[m * PRFSTRIDE]) / 10;
+    }
     score = 0;
     int _maxAA = userParameters->getMaxAA(); // NOTE Change here!
     for (ix = 0; ix <= _maxAA; ix++)
@@ -1013,6 +1111,50 @@ inline int MyersMillerProfileAlign::prfScore(int n, int m)
     return (score / 10);
 }
 
+/**
+ * Copies the entries of profile1 and profile2 that prfScore multiplies into
+ * contiguous rows of 16-bit integers (zero in all other entries), so that
+ * prfScore is one SIMD dot product, and the gap penalty columns into plain
+ * arrays. If an entry does not fit into 16 bits, prfScore uses the profiles.
+ */
+void MyersMillerProfileAlign::packProfiles()
+{
+    const SeqArray* profiles[2] = {profile1, profile2};
+    vector<short>* packed[2] = {&prfScores1, &prfScores2};
+    vector<int>* gapCols[2] = {&gapCol1, &gapCol2};
+    vector<int>* lenCols[2] = {&lenCol1, &lenCol2};
+    int _maxAA = userParameters->getMaxAA();
+    
+    endGapPenalties = userParameters->getEndGapPenalties();
+    packedScores = true;
+    for (int p = 0; p < 2; p++)
+    {
+        const SeqArray& prf = *profiles[p];
+        int numRows = prf.size();
+        packed[p]->assign(numRows * PRFSTRIDE, 0);
+        gapCols[p]->resize(numRows);
+        lenCols[p]->resize(numRows);
+        for (int i = 0; i < numRows; i++)
+        {
+            (*gapCols[p])[i] = prf[i][GAPCOL];
+            (*lenCols[p])[i] = prf[i][LENCOL];
+            short* row = &(*packed[p])[i * PRFSTRIDE];
+            for (int ix = 0; ix < PRFSTRIDE; ix++)
+            {
+                if (ix > _maxAA && ix != _gapPos1 && ix != _gapPos2)
+                {
+                    continue;
+                }
+                int value = prf[i][ix];
+                if (value < -32767 || value > 32767)
+                {
+                    packedScores = false;
+                }
+                row[ix] = static_cast<short>(value);
+            }
+        }
+    }
+}
 
 /**
  * 
@@ -1124,12 +1266,12 @@ void MyersMillerProfileAlign::progAlign()
 inline int MyersMillerProfileAlign::openPenalty1(int i, int j) // NOTE Change here!
 {
     int g;
-    if (!userParameters->getEndGapPenalties() && (i == 0 || i == prfLength1))
+    if (!endGapPenalties && (i == 0 || i == prfLength1))
     {
         return (0);
     }
 
-    g = (*profile2)[j][GAPCOL] + (*profile1)[i][GAPCOL];
+    g = gapCol2[j] + gapCol1[i];
     return (g);
 }
 
@@ -1144,12 +1286,12 @@ inline int MyersMillerProfileAlign::extPenalty1(int i, int j) // NOTE Change her
 {
     int h;
 
-    if (!userParameters->getEndGapPenalties() && (i == 0 || i == prfLength1))
+    if (!endGapPenalties && (i == 0 || i == prfLength1))
     {
         return (0);
     }
 
-    h = (*profile2)[j][LENCOL];
+    h = lenCol2[j];
     return (h);
 }
 
@@ -1171,15 +1313,15 @@ int MyersMillerProfileAlign::gapPenalty1(int i, int j, int k)
     {
         return (0);
     }
-    if (!userParameters->getEndGapPenalties() && (i == 0 || i == prfLength1))
+    if (!endGapPenalties && (i == 0 || i == prfLength1))
     {
         return (0);
     }
 
-    g = (*profile2)[j][GAPCOL] + (*profile1)[i][GAPCOL];
+    g = gapCol2[j] + gapCol1[i];
     for (ix = 0; ix < k && ix + j < prfLength2; ix++)
     {
-        h += (*profile2)[ix + j][LENCOL];
+        h += lenCol2[ix + j];
     }
 
     gp = g + h;
@@ -1197,12 +1339,12 @@ inline int MyersMillerProfileAlign::openPenalty2(int i, int j) // NOTE Change he
 {
     int g;
 
-    if (!userParameters->getEndGapPenalties() && (j == 0 || j == prfLength2))
+    if (!endGapPenalties && (j == 0 || j == prfLength2))
     {
         return (0);
     }
 
-    g = (*profile1)[i][GAPCOL] + (*profile2)[j][GAPCOL];
+    g = gapCol1[i] + gapCol2[j];
     return (g);
 }
 
@@ -1217,12 +1359,12 @@ inline int MyersMillerProfileAlign::extPenalty2(int i, int j) // NOTE Change her
 {
     int h;
 
-    if (!userParameters->getEndGapPenalties() && (j == 0 || j == prfLength2))
+    if (!endGapPenalties && (j == 0 || j == prfLength2))
     {
         return (0);
     }
 
-    h = (*profile1)[i][LENCOL];
+    h = lenCol1[i];
     return (h);
 }
 
@@ -1244,15 +1386,15 @@ int MyersMillerProfileAlign::gapPenalty2(int i, int j, int k)
     {
         return (0);
     }
-    if (!userParameters->getEndGapPenalties() && (j == 0 || j == prfLength2))
+    if (!endGapPenalties && (j == 0 || j == prfLength2))
     {
         return (0);
     }
 
-    g = (*profile1)[i][GAPCOL] + (*profile2)[j][GAPCOL];
+    g = gapCol1[i] + gapCol2[j];
     for (ix = 0; ix < k && ix + i < prfLength1; ix++)
     {
-        h += (*profile1)[ix + i][LENCOL];
+        h += lenCol1[ix + i];
     }
 
     gp = g + h;
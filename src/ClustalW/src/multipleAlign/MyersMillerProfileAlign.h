@@ -28,6 +28,7 @@ class MyersMillerProfileAlign : public ProfileAlignAlgorithm
     /* Functions */
         void addGGaps(Alignment* alnPtr, SeqArray* seqArray);
         void addGGapsMask(vector<char>* mask,int len, vector<int>* path1, vector<int>* path2);
+        void packProfiles();
         int prfScore(int n, int m);
         int progTracepath();
         void progDel(int k);
@@ -62,6 +63,16 @@ class MyersMillerProfileAlign : public ProfileAlignAlgorithm
         bool switchProfiles;
         const SeqArray* profile1;
         const SeqArray* profile2;
+        /* 16-bit copies of the score columns of profile1 and profile2, one
+         * row of PRFSTRIDE entries per position, with zeros in the entries
+         * that prfScore does not use, and their gap penalty columns. */
+        static const int PRFSTRIDE = NUMRES;
+        vector<short> prfScores1;
+        vector<short> prfScores2;
+        bool packedScores;
+        vector<int> gapCol1, lenCol1;
+        vector<int> gapCol2, lenCol2;
+        bool endGapPenalties;
         int _gapPos1, _gapPos2;
         int alignmentLength;                   
 };
@@ -49,14 +49,14 @@ ProfileBase::ProfileBase(int prfLen, int firstS, int lastS)
  * @param gapCoef 
  * @param lenCoef 
  */
-void ProfileBase::calcGapCoeff(SeqArray* seqArray, vector<int>* gaps,  
+void ProfileBase::calcGapCoeff(const ResidueMatrix* seqArray, vector<int>* gaps,  
          bool useStructPenalties, vector<char>* gapPenaltyMask, int gapCoef, int lenCoef)
 {
     int c;
     int i, j;
     int is, ie;
     int _numSeq, val, pcid;
-    vector<int> gapPos;
+    vector<int> gapPos, seqStart, seqEnd;
     vector<int> vWeight, resWeight, hydWeight;
     float scale;
     int _maxAA = userParameters->getMaxAA();
@@ -64,7 +64,7 @@ void ProfileBase::calcGapCoeff(SeqArray* seqArray, vector<int>* gaps,
     _numSeq = lastSeq - firstSeq;
     if(_numSeq == 2)
     {
-        pcid = static_cast<int>(percentId(&(*seqArray)[firstSeq], &(*seqArray)[firstSeq + 1]));
+        pcid = static_cast<int>(percentId(seqArray, firstSeq, firstSeq + 1));
     }
     else 
         pcid = 0;
@@ -94,17 +94,20 @@ void ProfileBase::calcGapCoeff(SeqArray* seqArray, vector<int>* gaps,
         gdist = userParameters->getGapDist();
     }                  
      
-    for (i = firstSeq; i < lastSeq; i++)
+    // Include end gaps as gaps ?
+    seqStart.assign(_numSeq, 0);
+    seqEnd.assign(_numSeq, prfLength);
+    if (userParameters->getUseEndGaps() == false && 
+        userParameters->getEndGapPenalties() == false)
     {
-        // Include end gaps as gaps ?
-        is = 0;
-        ie = prfLength;
-        if (userParameters->getUseEndGaps() == false && 
-            userParameters->getEndGapPenalties() == false)
+        for (i = firstSeq; i < lastSeq; i++)
         {
+            ResidueMatrix::RowView row = seqArray->getRow(i);
+            is = 0;
+            ie = prfLength;
             for (j = 0; j < prfLength; j++)
             {
-                c = (*seqArray)[i][j];
+                c = row[j];
                 if ((c < 0) || (c > _maxAA))
                     is++;
                 else
@@ -112,17 +115,24 @@ void ProfileBase::calcGapCoeff(SeqArray* seqArray, vector<int>* gaps,
             }
             for (j = prfLength - 1; j >= 0; j--)
             {
-                c = (*seqArray)[i][j];
+                c = row[j];
                 if ((c < 0) || (c > _maxAA))
                     ie--;
                 else
                     break;
             }
+            seqStart[i - firstSeq] = is;
+            seqEnd[i - firstSeq] = ie;
         }
+    }
 
-        for (j = is; j < ie; j++)
+    for (j = 0; j < prfLength; j++)
+    {
+        const signed char* column = seqArray->getColumn(j) + firstSeq;
+        for (i = 0; i < _numSeq; i++)
         {
-            if (((*seqArray)[i][j] < 0) || ((*seqArray)[i][j] > _maxAA))
+            c = column[i];
+            if (((c < 0) || (c > _maxAA)) && j >= seqStart[i] && j < seqEnd[i])
             {
                 (*gaps)[j]++;
             }
@@ -307,12 +317,14 @@ void ProfileBase::calcGapCoeff(SeqArray* seqArray, vector<int>* gaps,
  * @param aln 
  * @param weight 
  */
-void ProfileBase::calcVPenalties(SeqArray* aln, vector<int>* weight)
+void ProfileBase::calcVPenalties(const ResidueMatrix* aln, vector<int>* weight)
 {
     int ix1, ix2;
     int i, j, t;
     int _maxAA = userParameters->getMaxAA();
     int aminoCodeix1, aminoCodeix2;
+    ResidueMatrix::RowView seq1 = aln->getRow(firstSeq);
+    ResidueMatrix::RowView seq2 = aln->getRow(firstSeq + 1);
     
     for (i = 0; i < prfLength; i++)
     {
@@ -322,8 +334,8 @@ void ProfileBase::calcVPenalties(SeqArray* aln, vector<int>* weight)
         {
             if(j >= 0 && j < prfLength)
             {
-                ix1 = (*aln)[firstSeq][j];
-                ix2 = (*aln)[firstSeq + 1][j];
+                ix1 = seq1[j];
+                ix2 = seq2[j];
                 if ((ix1 < 0) || (ix1 > _maxAA) || (ix2 < 0) || (ix2 > _maxAA))
                 { 
                     continue;
@@ -352,31 +364,39 @@ void ProfileBase::calcVPenalties(SeqArray* aln, vector<int>* weight)
  * @param aln 
  * @param weight 
  */
-void ProfileBase::calcResidueSpecificPen(SeqArray* aln, vector<int>* weight)
+void ProfileBase::calcResidueSpecificPen(const ResidueMatrix* aln, vector<int>* weight)
 {
-    char ix;
+    int ix;
     int j, k, _numSeq;
     int i;
     int _maxAA = userParameters->getMaxAA();
     int _pascarellaNumRes = pascarellaRes.size();
+    vector<int> resPen(_maxAA + 1, 0);
     
+    // weight of every residue code, 0 if it is not one of pascarellaRes
+    for (ix = 0; ix <= _maxAA; ix++)
+    {
+        for (j = 0; j < _pascarellaNumRes; j++)
+        {
+            if (userParameters->getAminoAcidCode(ix) == pascarellaRes[j])
+            {
+                resPen[ix] = 180 - pascarellaProb[j];
+                break;
+            }
+        }
+    }
+
     _numSeq = lastSeq - firstSeq;
     for (i = 0; i < prfLength; i++)
     {
+        const signed char* column = aln->getColumn(i) + firstSeq;
         (*weight)[i] = 0;
-        for (k = firstSeq; k < lastSeq; k++)
+        for (k = 0; k < _numSeq; k++)
         {
-            for (j = 0; j < _pascarellaNumRes; j++)
-            {
-                ix = (*aln)[k][i];
-                if ((ix < 0) || (ix > _maxAA)) 
-                    continue;
-                if (userParameters->getAminoAcidCode(ix) == pascarellaRes[j])
-                {
-                    (*weight)[i] += (180 - pascarellaProb[j]);
-                    break;
-                }
-            }
+            ix = column[k];
+            if ((ix < 0) || (ix > _maxAA)) 
+                continue;
+            (*weight)[i] += resPen[ix];
         }
         (*weight)[i] /= _numSeq;
     }
@@ -387,7 +407,7 @@ void ProfileBase::calcResidueSpecificPen(SeqArray* aln, vector<int>* weight)
  * @param aln 
  * @param weight 
  */
-void ProfileBase::calcHydrophilicPen(SeqArray* aln, vector<int>* weight)
+void ProfileBase::calcHydrophilicPen(const ResidueMatrix* aln, vector<int>* weight)
 {
     int res;
     int numHydResidues, j, k;
@@ -405,23 +425,27 @@ void ProfileBase::calcHydrophilicPen(SeqArray* aln, vector<int>* weight)
         (*weight)[i] = 0;
     }
 
-    for (k = firstSeq; k < lastSeq; k++)
+    vector<int> isHyd(_maxAA + 1, 0);
+    for (res = 0; res <= _maxAA; res++)
     {
-        for (i = 0; i < prfLength; i++)
+        for (j = 0; j < numHydResidues; j++)
         {
-            hyd[i] = 0;
-            for (j = 0; j < numHydResidues; j++)
+            if (userParameters->getAminoAcidCode(res) == _hydResidues[j])
             {
-                res = (*aln)[k][i];
-                if ((res < 0) || (res > _maxAA)) 
-                    continue;
-                if (userParameters->getAminoAcidCode(res) == _hydResidues[j])
-                {
-                    hyd[i] = 1;
-                    break;
-                }
+                isHyd[res] = 1;
+                break;
             }
         }
+    }
+
+    for (k = firstSeq; k < lastSeq; k++)
+    {
+        ResidueMatrix::RowView row = aln->getRow(k);
+        for (i = 0; i < prfLength; i++)
+        {
+            res = row[i];
+            hyd[i] = ((res < 0) || (res > _maxAA)) ? 0 : isHyd[res];
+        }
         i = 0;
         while (i < prfLength)
         {
@@ -504,28 +528,34 @@ int ProfileBase::localPenalty(int penalty, int n, vector<int>* resWeight,
 
 /**
  * 
+ * @param aln 
  * @param s1 
  * @param s2 
  * @return 
  */
-float ProfileBase::percentId(vector<int>* s1, vector<int>* s2)
+float ProfileBase::percentId(const ResidueMatrix* aln, int s1, int s2)
 {
     int i;
     int count, total;
     float score;
+    int res1, res2;
+    ResidueMatrix::RowView seq1 = aln->getRow(s1);
+    ResidueMatrix::RowView seq2 = aln->getRow(s2);
 
     count = total = 0;
     for (i = 0; i < prfLength; i++) 
     {
-        if (((*s1)[i] >= 0) && ((*s1)[i] < userParameters->getMaxAA())) 
+        res1 = seq1[i];
+        res2 = seq2[i];
+        if ((res1 >= 0) && (res1 < userParameters->getMaxAA())) 
         {
             total++;
-            if ((*s1)[i] == (*s2)[i])
+            if (res1 == res2)
             { 
                 count++;
             }
         }
-        if ((*s1)[i]==(-3) || (*s2)[i]==(-3))
+        if (res1 == (-3) || res2 == (-3))
         { 
             break; // I dont have -3 at the end!
         }
@@ -12,6 +12,7 @@
 #define PROFILEBASE_H
 
 #include "../alignment/Alignment.h"
+#include "../alignment/ResidueMatrix.h"
 
 namespace clustalw
 {
@@ -21,7 +22,7 @@ class ProfileBase
     public:
         /* Functions */
         ProfileBase(int prfLen, int firstS, int lastS);
-        void calcGapCoeff(SeqArray* seqArray, vector<int>* gaps,  bool useStructPenalties,
+        void calcGapCoeff(const ResidueMatrix* seqArray, vector<int>* gaps,  bool useStructPenalties,
                           vector<char>* gapPenaltyMask, int gapCoef, int lenCoef);
         const SeqArray* getProfilePtr(){return &profile;};
         void resetProfile(){for(int i = 0; i < (int)profile.size();i++)
@@ -34,12 +35,12 @@ class ProfileBase
 
     protected:
         /* Functions */
-        void calcVPenalties(SeqArray* aln, vector<int>* weight); 
-        void calcResidueSpecificPen(SeqArray* aln, vector<int>* weight); 
-        void calcHydrophilicPen(SeqArray* aln, vector<int>* weight); 
+        void calcVPenalties(const ResidueMatrix* aln, vector<int>* weight); 
+        void calcResidueSpecificPen(const ResidueMatrix* aln, vector<int>* weight); 
+        void calcHydrophilicPen(const ResidueMatrix* aln, vector<int>* weight); 
         int localPenalty(int penalty, int n, vector<int>* resWeight, vector<int>* hydWeight,
                          vector<int>* vWeight);  
-        float percentId(vector<int>* s1, vector<int>* s2);
+        float percentId(const ResidueMatrix* aln, int s1, int s2);
 
         /* Attributes */
         vector<vector<int> > profile;
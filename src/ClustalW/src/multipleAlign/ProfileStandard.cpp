@@ -38,11 +38,12 @@ void ProfileStandard::resetPrf2()
  * @param seqArray 
  * @param seqWeight 
  */
-void ProfileStandard::calcStandardProfile(SeqArray* seqArray, vector<int>* seqWeight)
+void ProfileStandard::calcStandardProfile(const ResidueMatrix* seqArray, vector<int>* seqWeight)
 {
     /** DONT FORGET TO CHECK THE SIZES ARE CORRECT */
     
-    int sum1, sum2;
+    int sum2;
+    int codeWeight[NUMRES];
     int i, d;
     int r;
     int _maxAA = userParameters->getMaxAA();
@@ -76,38 +77,27 @@ void ProfileStandard::calcStandardProfile(SeqArray* seqArray, vector<int>* seqWe
         }
         else
         {
-            for (d = 0; d <= _maxAA; d++)
+            // summed weights of the sequences with each code, in one pass
+            const signed char* column = seqArray->getColumn(r);
+            for (d = 0; d < NUMRES; d++)
             {
-                sum1 = 0;
-                for (i = firstSeq; i < lastSeq; i++)
-                {
-                    if (d == (*seqArray)[i][r])
-                    {
-                        sum1 += (*seqWeight)[i];
-                    }
-                }
-                profile[r + 1][d] = (int)(10 *(float)sum1 / (float)sum2);
+                codeWeight[d] = 0;
             }
-            sum1 = 0;
-
             for (i = firstSeq; i < lastSeq; i++)
             {
-                if (_gapPos1 == (*seqArray)[i][r])
+                d = column[i];
+                if (d >= 0 && d < NUMRES)
                 {
-                    sum1 += (*seqWeight)[i];
+                    codeWeight[d] += (*seqWeight)[i];
                 }
             }
-            profile[r + 1][_gapPos1] = (int)(10 *(float)sum1 / (float)sum2);
-            sum1 = 0;
 
-            for (i = firstSeq; i < lastSeq; i++)
+            for (d = 0; d <= _maxAA; d++)
             {
-                if (_gapPos2 == (*seqArray)[i][r])
-                {
-                    sum1 += (*seqWeight)[i];
-                }
+                profile[r + 1][d] = (int)(10 *(float)codeWeight[d] / (float)sum2);
             }
-            profile[r + 1][_gapPos2] = (int)(10 *(float)sum1 / (float)sum2);
+            profile[r + 1][_gapPos1] = (int)(10 *(float)codeWeight[_gapPos1] / (float)sum2);
+            profile[r + 1][_gapPos2] = (int)(10 *(float)codeWeight[_gapPos2] / (float)sum2);
         }
     }
 
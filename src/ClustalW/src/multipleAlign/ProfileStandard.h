@@ -18,7 +18,7 @@ class ProfileStandard : public ProfileBase
         /* Functions */
         ProfileStandard(int prfLen, int firstS, int lastS);
         void resetPrf2();
-        void calcStandardProfile(SeqArray* alignment, vector<int>* seqWeight); 
+        void calcStandardProfile(const ResidueMatrix* alignment, vector<int>* seqWeight); 
 
         /* Attributes */
 
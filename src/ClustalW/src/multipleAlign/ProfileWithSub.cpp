@@ -39,7 +39,7 @@ void ProfileWithSub::resetPrf1()
  * @param matrix[][] 
  * @param seqWeight 
  */
-void ProfileWithSub::calcProfileWithSub(SeqArray* seqArray, vector<int>* gaps, 
+void ProfileWithSub::calcProfileWithSub(const ResidueMatrix* seqArray, vector<int>* gaps, 
                               int matrix[NUMRES][NUMRES], vector<int>* seqWeight)
 {
     vector<vector<int> > weighting;
@@ -62,35 +62,24 @@ void ProfileWithSub::calcProfileWithSub(SeqArray* seqArray, vector<int>* gaps,
         sum2 += (*seqWeight)[seq];
     }
 
+    // one pass over each column: add the weight of every sequence to the
+    // entry of its residue (or gap) code
     for (col = 0; col < prfLength; col++)
     {
+        const signed char* column = seqArray->getColumn(col);
         for (aa = 0; aa <= _maxAA; aa++)
         {
             weighting[aa][col] = 0;
-
-            for (seq = firstSeq; seq < lastSeq; seq++)
-                if (aa == (*seqArray)[seq][col])
-                {
-                    weighting[aa][col] += (*seqWeight)[seq];
-                }
         }
         weighting[_gapPos1][col] = 0;
-
-        for (seq = firstSeq; seq < lastSeq; seq++)
-        {
-            if (_gapPos1 == (*seqArray)[seq][col])
-            {
-                weighting[_gapPos1][col] += (*seqWeight)[seq];
-            }
-        }
-
         weighting[_gapPos2][col] = 0;
 
         for (seq = firstSeq; seq < lastSeq; seq++)
         {
-            if (_gapPos2 == (*seqArray)[seq][col])
+            res = column[seq];
+            if ((res >= 0 && res <= _maxAA) || res == _gapPos1 || res == _gapPos2)
             {
-                weighting[_gapPos2][col] += (*seqWeight)[seq];
+                weighting[res][col] += (*seqWeight)[seq];
             }
         }
     }
@@ -18,7 +18,7 @@ class ProfileWithSub : public ProfileBase
         /* Functions */
         ProfileWithSub(int prfLen, int firstS, int lastS);
         void resetPrf1();
-        void calcProfileWithSub(SeqArray* seqArray, vector<int>* gaps, 
+        void calcProfileWithSub(const ResidueMatrix* seqArray, vector<int>* gaps, 
                                 int matrix[NUMRES][NUMRES], vector<int>* seqWeight); 
 
         /* Attributes */
@@ -8,6 +8,10 @@
 #endif
 #include "FullPairwiseAlign.h"
 #include <math.h>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 namespace clustalw
 {
@@ -23,6 +27,9 @@ FullPairwiseAlign::FullPairwiseAlign()
   seq1(0),
   seq2(0),
   maxScore(0),
+  _matAvgScore(0),
+  gapOpenScale(0),
+  gapExtendScale(0),
   sb1(0),
   sb2(0),
   se1(0),
@@ -33,13 +40,7 @@ FullPairwiseAlign::FullPairwiseAlign()
 
 void FullPairwiseAlign::pairwiseAlign(Alignment *alignPtr, DistMatrix *distMat, int iStart, int iEnd, int jStart, int jEnd)
 {
-    int si, sj, i;
-    int n, m, len1, len2;
     int maxRes;
-    int _matAvgScore;
-    int res;
-    double _score;
-    float gapOpenScale, gapExtendScale;
     
     try
     {
@@ -66,10 +67,6 @@ void FullPairwiseAlign::pairwiseAlign(Alignment *alignPtr, DistMatrix *distMat,
         }
     
         int num = (2 * _maxAlnLength) + 1;
-        bool _DNAFlag = userParameters->getDNAFlag();
-        float _pwGapOpen, _pwGapExtend;
-        _pwGapOpen = userParameters->getPWGapOpen();
-        _pwGapExtend = userParameters->getPWGapExtend();
         
         displ.resize(num);
         HH.resize(_maxAlnLength);
@@ -89,118 +86,236 @@ void FullPairwiseAlign::pairwiseAlign(Alignment *alignPtr, DistMatrix *distMat,
         gapOpenScale = scaleValues.gapOpenScale;
         gapExtendScale = scaleValues.gapExtendScale;
     
-        int _gapPos1, _gapPos2;
-        _gapPos1 = userParameters->getGapPos1();
-        _gapPos2 = userParameters->getGapPos2();
-        const SeqArray* _ptrToSeqArray = alignPtr->getSeqArray(); //This is faster! 
+        int numThreads = userParameters->getNumThreads();
+        if (numThreads > 1)
+        {
+            parallelAlign(alignPtr, distMat, iStart, iEnd, jStart, jEnd, numThreads);
+        }
+        else
+        {
+            alignPairs(alignPtr, distMat, iStart, iEnd, jStart, jEnd);
+        }
+
+        displ.clear();
+        HH.clear();
+        DD.clear();
+        RR.clear();
+        SS.clear();
+    }
+    catch(const exception& e)
+    {
+        cerr << "An exception has occured in the FullPairwiseAlign class.\n"
+             << e.what() << "\n";
+        throw 1;
+    }
+}
+
+/**
+ * Aligns all pairs (si, sj) with si in [iStart, iEnd) and sj in
+ * [max(si + 1, jStart + 1), jEnd) and stores the distances in distMat.
+ * The substitution matrix, the scale values and the DP buffers must have
+ * been set up by pairwiseAlign() before.
+ */
+void FullPairwiseAlign::alignPairs(Alignment *alignPtr, DistMatrix *distMat, int iStart, int iEnd, int jStart, int jEnd)
+{
+    int si, sj, i;
+    int n, m, len1, len2;
+    int res;
+    double _score;
+
+    int _numSeqs = alignPtr->getNumSeqs();
+    bool _DNAFlag = userParameters->getDNAFlag();
+    float _pwGapOpen, _pwGapExtend;
+    _pwGapOpen = userParameters->getPWGapOpen();
+    _pwGapExtend = userParameters->getPWGapExtend();
+
+    int _gapPos1, _gapPos2;
+    _gapPos1 = userParameters->getGapPos1();
+    _gapPos2 = userParameters->getGapPos2();
+    const SeqArray* _ptrToSeqArray = alignPtr->getSeqArray(); //This is faster! 
     
-        for (si = utilityObject->MAX(0, iStart); si < _numSeqs && si < iEnd; si++)
+    for (si = utilityObject->MAX(0, iStart); si < _numSeqs && si < iEnd; si++)
+    {
+        n = alignPtr->getSeqLength(si + 1);
+        len1 = 0;
+        for (i = 1; i <= n; i++)
         {
-            n = alignPtr->getSeqLength(si + 1);
-            len1 = 0;
-            for (i = 1; i <= n; i++)
+            res = (*_ptrToSeqArray)[si + 1][i];
+            if ((res != _gapPos1) && (res != _gapPos2))
             {
-                res = (*_ptrToSeqArray)[si + 1][i];
-                if ((res != _gapPos1) && (res != _gapPos2))
-                {
-                    len1++;
-                }
+                len1++;
             }
+        }
 
-            for (sj = utilityObject->MAX(si+1, jStart+1); sj < _numSeqs && sj < jEnd; sj++)
+        for (sj = utilityObject->MAX(si+1, jStart+1); sj < _numSeqs && sj < jEnd; sj++)
+        {
+            m = alignPtr->getSeqLength(sj + 1);
+            if (n == 0 || m == 0)
             {
-                m = alignPtr->getSeqLength(sj + 1);
-                if (n == 0 || m == 0)
-                {
-                    distMat->SetAt(si + 1, sj + 1, 1.0);
-                    distMat->SetAt(sj + 1, si + 1, 1.0);
-                    continue;
-                }
-                len2 = 0;
-                for (i = 1; i <= m; i++)
+                distMat->SetAt(si + 1, sj + 1, 1.0);
+                distMat->SetAt(sj + 1, si + 1, 1.0);
+                continue;
+            }
+            len2 = 0;
+            for (i = 1; i <= m; i++)
+            {
+                res = (*_ptrToSeqArray)[sj + 1][i];
+                if ((res != _gapPos1) && (res != _gapPos2))
                 {
-                    res = (*_ptrToSeqArray)[sj + 1][i];
-                    if ((res != _gapPos1) && (res != _gapPos2))
-                    {
-                        len2++;
-                    }
+                    len2++;
                 }
+            }
 
-                if (_DNAFlag)
+            if (_DNAFlag)
+            {
+                _gapOpen = static_cast<int>(2 * _pwGapOpen * intScale *
+                                gapOpenScale);
+                _gapExtend = static_cast<int>(_pwGapExtend * intScale * gapExtendScale);
+            }
+            else
+            {
+                if (_matAvgScore <= 0)
                 {
-                    _gapOpen = static_cast<int>(2 * _pwGapOpen * intScale *
-                                    gapOpenScale);
-                    _gapExtend = static_cast<int>(_pwGapExtend * intScale * gapExtendScale);
+                    _gapOpen = 2 * static_cast<int>((_pwGapOpen +
+                           log(static_cast<double>(utilityObject->MIN(n, m)))) * intScale);
                 }
                 else
                 {
-                    if (_matAvgScore <= 0)
-                    {
-                        _gapOpen = 2 * static_cast<int>((_pwGapOpen +
-                               log(static_cast<double>(utilityObject->MIN(n, m)))) * intScale);
-                    }
-                    else
-                    {
-                        _gapOpen = static_cast<int>(2 * _matAvgScore * (_pwGapOpen +
-                        log(static_cast<double>(utilityObject->MIN(n, m)))) * gapOpenScale);
-                    }
-                    _gapExtend = static_cast<int>(_pwGapExtend * intScale);
+                    _gapOpen = static_cast<int>(2 * _matAvgScore * (_pwGapOpen +
+                    log(static_cast<double>(utilityObject->MIN(n, m)))) * gapOpenScale);
                 }
-                // align the sequences
-            
-                seq1 = si + 1;
-                seq2 = sj + 1;
+                _gapExtend = static_cast<int>(_pwGapExtend * intScale);
+            }
+            // align the sequences
+        
+            seq1 = si + 1;
+            seq2 = sj + 1;
 
-                _ptrToSeq1 = alignPtr->getSequence(seq1);
-                _ptrToSeq2 = alignPtr->getSequence(seq2);
-            
-                forwardPass(_ptrToSeq1, _ptrToSeq2, n, m);
-                reversePass(_ptrToSeq1, _ptrToSeq2);
+            _ptrToSeq1 = alignPtr->getSequence(seq1);
+            _ptrToSeq2 = alignPtr->getSequence(seq2);
+        
+            forwardPass(_ptrToSeq1, _ptrToSeq2, n, m);
+            reversePass(_ptrToSeq1, _ptrToSeq2);
 
-                lastPrint = 0;
-                printPtr = 1;
+            lastPrint = 0;
+            printPtr = 1;
 
-                // use Myers and Miller to align two sequences 
+            // use Myers and Miller to align two sequences 
 
-                maxScore = diff(sb1 - 1, sb2 - 1, se1 - sb1 + 1, se2 - sb2 + 1,
-                    (int)0, (int)0);
+            maxScore = diff(sb1 - 1, sb2 - 1, se1 - sb1 + 1, se2 - sb2 + 1,
+                (int)0, (int)0);
 
-                // calculate percentage residue identity
+            // calculate percentage residue identity
 
-                mmScore = tracePath(sb1, sb2);
+            mmScore = tracePath(sb1, sb2);
 
-                if (len1 == 0 || len2 == 0)
-                {
-                    mmScore = 0;
-                }
-                else
-                {
-                    mmScore /= (float)utilityObject->MIN(len1, len2);
-                }
+            if (len1 == 0 || len2 == 0)
+            {
+                mmScore = 0;
+            }
+            else
+            {
+                mmScore /= (float)utilityObject->MIN(len1, len2);
+            }
 
-                _score = ((float)100.0 - mmScore) / (float)100.0;
-                distMat->SetAt(si + 1, sj + 1, _score);
-                distMat->SetAt(sj + 1, si + 1, _score);
-                
-                if(userParameters->getDisplayInfo())
-                {
-                    utilityObject->info("Sequences (%d:%d) Aligned. Score:  %d",
-                                        si+1, sj+1, (int)mmScore);     
-                }
+            _score = ((float)100.0 - mmScore) / (float)100.0;
+            distMat->SetAt(si + 1, sj + 1, _score);
+            distMat->SetAt(sj + 1, si + 1, _score);
+            
+            if(userParameters->getDisplayInfo())
+            {
+                utilityObject->info("Sequences (%d:%d) Aligned. Score:  %d",
+                                    si+1, sj+1, (int)mmScore);     
             }
         }
+    }
+}
 
-        displ.clear();
-        HH.clear();
-        DD.clear();
-        RR.clear();
-        SS.clear();
+/**
+ * Splits the upper triangle of the pair range into square tiles of
+ * TILE_SIZE x TILE_SIZE pairs and lets numThreads workers pick them up.
+ * Every worker is a copy of this object, so it has its own DP buffers
+ * (displ, HH, DD, RR, SS) and its own copy of the substitution matrix.
+ * Each pair is computed exactly as in the serial code and every cell of
+ * distMat is written by one worker only, so the result does not depend on
+ * the number of threads.
+ */
+void FullPairwiseAlign::parallelAlign(Alignment *alignPtr, DistMatrix *distMat, int iStart, int iEnd, int jStart, int jEnd, int numThreads)
+{
+    int _numSeqs = alignPtr->getNumSeqs();
+    int rowFirst = utilityObject->MAX(0, iStart);
+    int rowLast = utilityObject->MIN(_numSeqs, iEnd);
+    int colFirst = jStart + 1;
+    int colLast = utilityObject->MIN(_numSeqs, jEnd);
+    
+    vector<PairTile> tiles;
+    for (int i0 = rowFirst; i0 < rowLast; i0 += TILE_SIZE)
+    {
+        int i1 = utilityObject->MIN(i0 + TILE_SIZE, rowLast);
+        // the smallest column partner of this row block is i0 + 1
+        int firstCol = utilityObject->MAX(i0 + 1, colFirst);
+        for (int j0 = firstCol; j0 < colLast; j0 += TILE_SIZE)
+        {
+            PairTile tile;
+            tile.iStart = i0;
+            tile.iEnd = i1;
+            tile.jStart = j0 - 1; // alignPairs starts at jStart + 1
+            tile.jEnd = utilityObject->MIN(j0 + TILE_SIZE, colLast);
+            tiles.push_back(tile);
+        }
     }
-    catch(const exception& e)
+    
+    if (tiles.size() <= 1)
     {
-        cerr << "An exception has occured in the FullPairwiseAlign class.\n"
-             << e.what() << "\n";
-        throw 1;
+        alignPairs(alignPtr, distMat, iStart, iEnd, jStart, jEnd);
+        return;
+    }
+    if ((int)tiles.size() < numThreads)
+    {
+        numThreads = tiles.size();
+    }
+    
+    std::atomic<size_t> nextTile(0);
+    std::exception_ptr workerError;
+    std::mutex errorMutex;
+    
+    auto worker = [&]()
+    {
+        try
+        {
+            FullPairwiseAlign local(*this);
+            size_t t;
+            while ((t = nextTile++) < tiles.size())
+            {
+                local.alignPairs(alignPtr, distMat, tiles[t].iStart, tiles[t].iEnd,
+                                 tiles[t].jStart, tiles[t].jEnd);
+            }
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!workerError)
+            {
+                workerError = std::current_exception();
+            }
+            nextTile = tiles.size(); // stop the other workers early
+        }
+    };
+    
+    vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+    {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    
+    if (workerError)
+    {
+        std::rethrow_exception(workerError);
     }
 }
 
@@ -414,7 +529,7 @@ int FullPairwiseAlign::diff(int A, int B, int M, int N, int tb, int te)
     int type;
     int midi, midj, i, j;
     int midh;
-    static int f, hh, e, s, t;
+    int f, hh, e, s, t;
 
     if (N <= 0)
     {
@@ -24,6 +24,10 @@ class FullPairwiseAlign : public PairwiseAlignBase
 
     private:
         /* Functions */
+        void alignPairs(Alignment *alignPtr, DistMatrix *distMat, int iStart, 
+                        int iEnd, int jStart, int jEnd);
+        void parallelAlign(Alignment *alignPtr, DistMatrix *distMat, int iStart, 
+                           int iEnd, int jStart, int jEnd, int numThreads);
         void add(int v);
         int calcScore(int iat, int jat, int v1, int v2); 
         float tracePath(int tsb1, int tsb2);
@@ -35,6 +39,15 @@ class FullPairwiseAlign : public PairwiseAlignBase
         int tbgap(int k, int tb);
         int tegap(int k, int te);
         /* Attributes */
+        // A block of the pair triangle handed to one worker thread.
+        struct PairTile
+        {
+            int iStart;
+            int iEnd;
+            int jStart;
+            int jEnd;
+        };
+        static const int TILE_SIZE = 16;
         // I have constant pointers to the data. This allows for the fastest access.
         const vector<int>* _ptrToSeq1;
         const vector<int>* _ptrToSeq2;
@@ -55,6 +68,9 @@ class FullPairwiseAlign : public PairwiseAlignBase
         int seq2;
         int matrix[NUMRES][NUMRES];
         int maxScore;
+        int _matAvgScore;
+        float gapOpenScale;
+        float gapExtendScale;
         int sb1;
         int sb2;
         int se1;
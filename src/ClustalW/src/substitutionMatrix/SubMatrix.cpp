@@ -12,7 +12,9 @@
 #include <exception>
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #include "SubMatrix.h"
+#include "../../../ScoreTableCache.h"
 #include "matrices.h"
 #include "../general/InvalidCombination.cpp"
 #include "../general/debuglogObject.h"
@@ -307,7 +309,8 @@ int SubMatrix::getPairwiseMatrix(int matrix[NUMRES][NUMRES], PairScaleValues& sc
             _matPtr = &pwUserDNAMat;
             _matXref = &pwDNAXref;
         }
-        _maxRes = getMatrix(_matPtr, _matXref, matrix, true, scale.intScale);
+        _maxRes = getCachedMatrix(matrixPointer, _matPtr, _matXref, matrix, true,
+                                  scale.intScale);
         
         if (_maxRes == 0)
         {
@@ -365,7 +368,8 @@ int SubMatrix::getPairwiseMatrix(int matrix[NUMRES][NUMRES], PairScaleValues& sc
             _matXref = &pwAAXref;
         }
 
-        _maxRes = getMatrix(_matPtr, _matXref, matrix, true, scale.intScale);
+        _maxRes = getCachedMatrix(matrixPointer, _matPtr, _matXref, matrix, true,
+                                  scale.intScale);
         
         if (_maxRes == 0)
         {
@@ -403,6 +407,7 @@ int SubMatrix::getPairwiseMatrix(int matrix[NUMRES][NUMRES], PairScaleValues& sc
 int SubMatrix::getProfileAlignMatrix(int matrix[NUMRES][NUMRES], double pcid, int minLen, 
                                   PrfScaleValues& scaleParam, int& matAvg)
 {
+    std::lock_guard<std::mutex> lock(matrixMutex);
     bool found = false;
     bool errorGiven = false;
     bool _negMatrix = userParameters->getUseNegMatrix();
@@ -449,8 +454,9 @@ int SubMatrix::getProfileAlignMatrix(int matrix[NUMRES][NUMRES], double pcid, in
             matrixPointer = "userDNAMat"; xrefPointer = "DNAXref";
         }
         
-        _maxRes = getMatrix(_matPtr, _matXref, matrix, _negMatrix,
-                            static_cast<int>(scaleParam.intScale)); // Mark change 17-5-07
+        _maxRes = getCachedMatrix(matrixPointer, _matPtr, _matXref, matrix,
+                                  _negMatrix,
+                                  static_cast<int>(scaleParam.intScale)); // Mark change 17-5-07
         if (_maxRes == 0)
         {
             return ((int) - 1);
@@ -651,8 +657,9 @@ int SubMatrix::getProfileAlignMatrix(int matrix[NUMRES][NUMRES], double pcid, in
             matrixPointer = "userMat";
         }
         
-        _maxRes = getMatrix(_matPtr, _matXref, matrix, _negMatrix,
-                            static_cast<int>(scaleParam.intScale));
+        _maxRes = getCachedMatrix(matrixPointer, _matPtr, _matXref, matrix,
+                                  _negMatrix,
+                                  static_cast<int>(scaleParam.intScale));
         if (_maxRes == 0)
         {
             cerr << "Error: matrix " << matrixName << " not found\n";
@@ -828,6 +835,54 @@ int SubMatrix::getMatrix(Matrix* matptr, Xref* xref, int matrix[NUMRES][NUMRES],
     return (maxRes);
 }
 
+/**
+ * The function getCachedMatrix returns the same as getMatrix, but the
+ * built-in matrices of matrices.h (the ones with a default cross reference)
+ * are prepared only once per process and then copied from the shared
+ * cache of ScoreTableCache.h. name identifies the built-in matrix; user
+ * defined matrices are always prepared by getMatrix.
+ * @param name 
+ * @param matptr 
+ * @param xref 
+ * @param matrix[][] 
+ * @param negFlag 
+ * @param scale 
+ * @return 
+ */
+int SubMatrix::getCachedMatrix(const string& name, Matrix* matptr, Xref* xref,
+                               int matrix[NUMRES][NUMRES], bool negFlag, int scale)
+{
+    if (xref != &defaultAAXref && xref != &defaultDNAXref)
+    {
+        return getMatrix(matptr, xref, matrix, negFlag, scale);
+    }
+
+    // everything getMatrix depends on besides the matrix itself
+    string key = "clustalw:" + name + ":";
+    ScoreTableKey(key, negFlag);
+    ScoreTableKey(key, scale);
+    ScoreTableKey(key, userParameters->getMaxAA());
+    ScoreTableKey(key, userParameters->getGapPos1());
+    ScoreTableKey(key, userParameters->getGapPos2());
+    key.append(reinterpret_cast<const char*>(&(*xref)[0]),
+               xref->size() * sizeof((*xref)[0]));
+
+    const PreparedMatrix* prepared = ScoreTableGet<PreparedMatrix>(key,
+        [&](PreparedMatrix& table)
+        {
+            table.maxRes = getMatrix(matptr, xref, table.matrix, negFlag, scale);
+            table.avgScore = matrixAvgScore;
+        });
+    if (prepared == NULL)
+    {
+        return getMatrix(matptr, xref, matrix, negFlag, scale);
+    }
+
+    memcpy(matrix, prepared->matrix, sizeof(prepared->matrix));
+    matrixAvgScore = prepared->avgScore;
+    return prepared->maxRes;
+}
+
 /**
  * The function getUserMatFromFile is used to read in a user defined matrix.
  * @param str
@@ -1819,6 +1874,7 @@ void SubMatrix::tempInterface(int alignResidueType, int alignType)
  */
 int SubMatrix::getAlnScoreMatrix(int matrix[NUMRES][NUMRES])
 {
+    std::lock_guard<std::mutex> lock(matrixMutex);
     int _maxNumRes;
     /* 
        //_maxNumRes = getMatrix(blosum45mtVec, &defaultAAXref, matrix, true, 100);
@@ -1826,7 +1882,8 @@ int SubMatrix::getAlnScoreMatrix(int matrix[NUMRES][NUMRES])
        //_maxNumRes = getMatrix(blosum62mt2Vec, &defaultAAXref, matrix, true, 100);
     */
     // 1.83 style
-    _maxNumRes = getMatrix(blosum45mtVec, &defaultAAXref, matrix, true, 100);
+    _maxNumRes = getCachedMatrix("blosum45mtVec", blosum45mtVec, &defaultAAXref,
+                                 matrix, true, 100);
 
     return _maxNumRes;
 }
@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <string>
+#include <mutex>
 #include "../general/clustalw.h"
 #include "../general/userparams.h"
 #include "../general/utils.h"
@@ -38,6 +39,14 @@ using namespace std;
 typedef vector<short> Xref;
 typedef vector<short> Matrix;
 
+// A matrix as returned by getMatrix, kept in the process-wide cache.
+struct PreparedMatrix
+{
+    int matrix[NUMRES][NUMRES];
+    int maxRes;
+    int avgScore;
+};
+
 class SubMatrix
 {
     public:
@@ -92,6 +101,8 @@ class SubMatrix
         /* Functions */
         int getMatrix(Matrix* matPtr, Xref* xref, int matrix[NUMRES][NUMRES],
                       bool negFlag, int scale, bool minimise = false); 
+        int getCachedMatrix(const string& name, Matrix* matPtr, Xref* xref,
+                            int matrix[NUMRES][NUMRES], bool negFlag, int scale);
         int readMatrixSeriesFromR(const Rcpp::NumericMatrix substitutionmatrix, Matrix& userMat, Xref& xref);
         int readUserMatrixFromR(const Rcpp::NumericMatrix substitutionMatrix, Matrix& userMat, Xref& xref);
         int readMatrixSeries(const char *fileName, Matrix& userMat, Xref& xref);
@@ -180,6 +191,9 @@ class SubMatrix
         Xref* xref;
         Matrix* _matPtr;
         Xref* _matXref;
+        // getProfileAlignMatrix and getAlnScoreMatrix use _matPtr, _matXref and
+        // matrixAvgScore, they can be called from several threads (Iteration).
+        std::mutex matrixMutex;
 
 };
 }
@@ -129,10 +129,61 @@ void ClusterTree::treeGapDelete(clustalw::Alignment *alignPtr)
     }
 }
 
+/**
+ * Copies the positions used for the distance matrix (bootPositions[1] to
+ * bootPositions[length], without those flagged in treeGaps if gaps are tossed)
+ * of the sequences first to first + num - 1 into residues. Row r is sequence
+ * first + r, column c is the c-th used position.
+ */
+void ClusterTree::treeResidues(clustalw::Alignment *alignPtr, int first, int num, int length,
+                               clustalw::ResidueMatrix* residues)
+{
+    vector<int> positions;
+    int i, j, seq, lenSeq;
+
+    positions.reserve(length);
+    for (i = 1; i <= length; ++i)
+    {
+        j = bootPositions[i];
+        if (!(clustalw::userParameters->getTossGaps() && (treeGaps[j] > 0)))
+        {
+            positions.push_back(j);
+        }
+    }
+
+    residues->resize(num, positions.size());
+    for (seq = 0; seq < num; ++seq)
+    {
+        const vector<int>* _seq = alignPtr->getSequence(first + seq);
+        lenSeq = alignPtr->getSeqLength(first + seq);
+        for (i = 0; i < (int)positions.size(); ++i)
+        {
+            j = positions[i];
+/** *******************************************************************************
+ * BUG!!!!!!!                                                                     *
+ * NOTE: the following if statements were coded in so as to produce               *
+ * the same distance results as the old clustal. Old clustal compares             *
+ * up to the length of the first sequence. If this is longer than the             *
+ * other sequences, then the -3 and 0's are compared at the end of the            *
+ * array. These should not be compared, but I need to stick to this to            *
+ * produce the same results as the old version for testing!                       *
+ **********************************************************************************/
+            if (j > lenSeq)
+            {
+                residues->set(seq, i, (j == lenSeq + 1) ? -3 : 0);
+            }
+            else
+            {
+                residues->set(seq, i, (*_seq)[j]);
+            }
+        }
+    }
+}
+
 int ClusterTree::dnaDistanceMatrix(ofstream* treeFile, clustalw::Alignment *alignPtr)
 {
     int m, n;
-    int j, i;
+    int i;
     int res1, res2;
     int overspill = 0;
     double p, q, e, a, b, k;
@@ -170,98 +221,70 @@ int ClusterTree::dnaDistanceMatrix(ofstream* treeFile, clustalw::Alignment *alig
     int _lenFirstSeq = alignPtr->getSeqLength(firstSeq);
     int _gapPos1 = clustalw::userParameters->getGapPos1();
     int _gapPos2 = clustalw::userParameters->getGapPos2();
-    int lenSeqM, lenSeqN;
-     // for every pair of sequence 
-    for (m = 1; m < lastSeq - firstSeq + 1; ++m)
+    int _numSeqsToUse = lastSeq - firstSeq + 1;
+    clustalw::ResidueMatrix residues;
+    treeResidues(alignPtr, firstSeq, _numSeqsToUse, _lenFirstSeq, &residues);
+    int _numCols = residues.getNumCols();
+
+    // codes that are not compared: gaps and, unless they are used, ambiguity codes
+    vector<char> skipRes(256, 0);
+    int _numCodes = clustalw::userParameters->getAminoAcidCodes().size();
+    for (i = -128; i < 128; ++i)
     {
-        const vector<int>* _seqM = alignPtr->getSequence(m + firstSeq - 1);
-        lenSeqM = alignPtr->getSeqLength(m + firstSeq - 1);
-        
-        for (n = m + 1; n <= lastSeq - firstSeq + 1; ++n)
+        if ((i == _gapPos1) || (i == _gapPos2))
         {
-            const vector<int>* _seqN = alignPtr->getSequence(n + firstSeq - 1);
-            lenSeqN = alignPtr->getSeqLength(n + firstSeq - 1);
-            
-            p = q = e = 0.0;
-            quickDistMat->SetAt(m, n, 0.0);
-            quickDistMat->SetAt(n ,m, 0.0);
-            
-            for (i = 1; i <= _lenFirstSeq; ++i)
+            skipRes[(unsigned char)i] = 1;
+        }
+        else if (!clustalw::userParameters->getUseAmbiguities())
+        {
+            skipRes[(unsigned char)i] = (i < 0 || i >= _numCodes) ? 1 : isAmbiguity(i);
+        }
+    }
+
+    vector<int> sites(_numSeqsToUse + 1), transitions(_numSeqsToUse + 1),
+                transversions(_numSeqsToUse + 1);
+     // for every pair of sequence 
+    for (m = 1; m < _numSeqsToUse; ++m)
+    {
+        // compare m with all later sequences, one column at a time
+        sites.assign(_numSeqsToUse + 1, 0);
+        transitions.assign(_numSeqsToUse + 1, 0);
+        transversions.assign(_numSeqsToUse + 1, 0);
+        for (i = 0; i < _numCols; ++i)
+        {
+            const signed char* column = residues.getColumn(i);
+            res1 = column[m - 1];
+            if (skipRes[(unsigned char)res1])
             {
-                j = bootPositions[i];
-                if (clustalw::userParameters->getTossGaps() && (treeGaps[j] > 0))
-                {
-                    goto skip;
-                }
-                // gap position 
-/** *******************************************************************************
- * BUG!!!!!!!      NOTE this was found for protein. Presuming the same here       *
- * NOTE: the following if statements were coded in so as to produce               *
- * the same distance results as the old clustal. Old clustal compares             *
- * up to the length of the first sequence. If this is longer than the             *
- * other sequences, then the -3 and 0's are compared at the end of the            *
- * array. These should not be compared, but I need to stick to this to            *
- * produce the same results as the old version for testing!                       *
- **********************************************************************************/
-                if(j > lenSeqM)
-                {
-                    if(j == lenSeqM + 1)
-                    {
-                        res1 = -3;
-                    }
-                    else
-                    {    
-                        res1 = 0;
-                    }
-                }
-                else
-                { 
-                    res1 = (*_seqM)[j];
-                }
-                if(j > lenSeqN)
-                {
-                    if(j == lenSeqN + 1)
-                    {
-                        res2 = -3;
-                    }
-                    else
-                    {    
-                        res2 = 0;
-                    }
-                }
-                else
-                {
-                    res2 = (*_seqN)[j];
-                }
-                if ((res1 == _gapPos1) || (res1 == _gapPos2) || (res2 == _gapPos1)
-                    || (res2 == _gapPos2))
-                {
-                    goto skip;
-                }
-                // gap in a seq
-                if (!clustalw::userParameters->getUseAmbiguities())
+                continue;
+            }
+            for (n = m + 1; n <= _numSeqsToUse; ++n)
+            {
+                res2 = column[n - 1];
+                if (skipRes[(unsigned char)res2])
                 {
-                    if (isAmbiguity(res1) || isAmbiguity(res2))
-                    {
-                        goto skip;
-                    }
+                    continue;
                 }
-                // ambiguity code in a seq
-                e = e+1.0;
+                ++sites[n];
                 if (res1 != res2)
                 {
                     if (transition(res1, res2))
                     {
-                        p = p + 1.0;
+                        ++transitions[n];
                     }
                     else
                     {
-                        q = q + 1.0;
+                        ++transversions[n];
                     }
                 }
-                skip: ;
             }
+        }
 
+        for (n = m + 1; n <= _numSeqsToUse; ++n)
+        {
+            e = sites[n];
+            p = transitions[n];
+            q = transversions[n];
 
             // Kimura's 2 parameter correction for multiple substitutions
 
@@ -384,7 +407,7 @@ int ClusterTree::dnaDistanceMatrix(ofstream* treeFile, clustalw::Alignment *alig
 int ClusterTree::protDistanceMatrix(ofstream* treeFile, clustalw::Alignment *alignPtr)
 {
     int m, n;
-    int j, i;
+    int i;
     int res1, res2;
     int overspill = 0;
     double p, e, k, tableEntry;
@@ -418,79 +441,44 @@ int ClusterTree::protDistanceMatrix(ofstream* treeFile, clustalw::Alignment *ali
     quickDistMat.reset(new clustalw::DistMatrix(_numSeqs + 1));
     int _gapPos1 = clustalw::userParameters->getGapPos1();
     int _gapPos2 = clustalw::userParameters->getGapPos2();
-    int lenSeqM, lenSeqN;
+    clustalw::ResidueMatrix residues;
+    treeResidues(alignPtr, 1, _numSeqs, _lenSeq1, &residues);
+    int _numCols = residues.getNumCols();
+
+    vector<int> sites(_numSeqs + 1), differences(_numSeqs + 1);
     // for every pair of sequence 
     for (m = 1; m < _numSeqs; ++m)
     {
-        const vector<int>* _seqM = alignPtr->getSequence(m);
-        lenSeqM = alignPtr->getSeqLength(m);
-        for (n = m + 1; n <= _numSeqs; ++n)
-        {
-            const vector<int>* _seqN = alignPtr->getSequence(n);
-            lenSeqN = alignPtr->getSeqLength(n);
-            p = e = 0.0;
-            quickDistMat->SetAt(m, n, 0.0);
-            quickDistMat->SetAt(n ,m, 0.0);
-            for (i = 1; i <= _lenSeq1; ++i) // It may be this here!
+        // compare m with all later sequences, one column at a time
+        sites.assign(_numSeqs + 1, 0);
+        differences.assign(_numSeqs + 1, 0);
+        for (i = 0; i < _numCols; ++i)
+        {
+            const signed char* column = residues.getColumn(i);
+            res1 = column[m - 1];
+            if ((res1 == _gapPos1) || (res1 == _gapPos2))
             {
-                j = bootPositions[i];
-                if (clustalw::userParameters->getTossGaps() && (treeGaps[j] > 0))
-                {
-                    goto skip;
-                }
-                // gap position
-/** *******************************************************************************
- * BUG!!!!!!!                                                                     *
- * NOTE: the following if statements were coded in so as to produce               *
- * the same distance results as the old clustal. Old clustal compares             *
- * up to the length of the first sequence. If this is longer than the             *
- * other sequences, then the -3 and 0's are compared at the end of the            *
- * array. These should not be compared, but I need to stick to this to            *
- * produce the same results as the old version for testing!                       *
- **********************************************************************************/
-                if(j > lenSeqM)
-                {
-                    if(j == lenSeqM + 1)
-                    {
-                        res1 = -3;
-                    }
-                    else
-                    {    
-                        res1 = 0;
-                    }
-                }
-                else
-                { 
-                    res1 = (*_seqM)[j];
-                }
-                if(j > lenSeqN)
-                {
-                    if(j == lenSeqN + 1)
-                    {
-                        res2 = -3;
-                    }
-                    else
-                    {    
-                        res2 = 0;
-                    }
-                }
-                else
-                {
-                    res2 = (*_seqN)[j];
-                }
-                if ((res1 == _gapPos1) || (res1 == _gapPos2) || (res2 == _gapPos1)
-                    || (res2 == _gapPos2))
+                continue;
+            }
+            for (n = m + 1; n <= _numSeqs; ++n)
+            {
+                res2 = column[n - 1];
+                if ((res2 == _gapPos1) || (res2 == _gapPos2))
                 {
-                    goto skip;
+                    continue;
                 }
-                // gap in a seq
-                e = e + 1.0;
+                ++sites[n];
                 if (res1 != res2)
                 {
-                    p = p + 1.0;
+                    ++differences[n];
                 }
-                skip: ;
             }
+        }
+
+        for (n = m + 1; n <= _numSeqs; ++n)
+        {
+            e = sites[n];
+            p = differences[n];
 
             if (p <= 0.0)
             {
@@ -998,6 +986,20 @@ void ClusterTree::printErrorMessageForBootstrap(int totalOverspill, int totalDis
     }
 }
 
+/**
+ * Returns the NJ implementation selected with the clustering parameter.
+ * RapidNJTree (FASTNJ) gives the same trees as NJTree, only faster for
+ * large numbers of sequences. Caller has to delete it.
+ */
+ClusterTreeAlgorithm* ClusterTree::newNJAlgorithm()
+{
+    if(userParameters->getClusterAlgorithm() == FASTNJ)
+    {
+        return new RapidNJTree();
+    }
+    return new NJTree();
+}
+
 bool ClusterTree::checkIfConditionsMet(int numSeqs, int min)
 {
     if (clustalw::userParameters->getEmpty())
@@ -18,7 +18,9 @@
 #include <vector>
 #include <exception>
 #include "../alignment/Alignment.h"
+#include "../alignment/ResidueMatrix.h"
 #include "NJTree.h"
+#include "RapidNJTree.h"
 #include "ClusterTreeOutput.h"
 #include "../general/OutputFile.h"
 #include "ClusterTreeAlgorithm.h"
@@ -41,6 +43,8 @@ class ClusterTree
         void treeGapDelete(clustalw::Alignment *alignPtr);   
         int dnaDistanceMatrix(ofstream* treeFile, clustalw::Alignment *alignPtr);
         int protDistanceMatrix(ofstream* treeFile, clustalw::Alignment *alignPtr);
+        void treeResidues(clustalw::Alignment *alignPtr, int first, int num, int length,
+                          clustalw::ResidueMatrix* residues);
         bool isAmbiguity(int c);
         void calcPercIdentity(ofstream* pfile, clustalw::Alignment *alignPtr);
         void compareTree(clustalw::PhyloTree* tree1, clustalw::PhyloTree* tree2, vector<int>* hits, int n);
@@ -65,6 +69,7 @@ class ClusterTree
         void promptForBoolSeedAndNumTrials();
         void printErrorMessageForBootstrap(int totalOverspill, int totalDists, int nfails);
         bool checkIfConditionsMet(int numSeqs, int min);
+        ClusterTreeAlgorithm* newNJAlgorithm();
         /* Attributes */
         ClusterTreeAlgorithm* clusAlgorithm;
         auto_ptr<clustalw::DistMatrix> quickDistMat;
@@ -163,10 +163,10 @@ void NJTree::generateTree(clustalw::PhyloTree* phyTree,
     
     register int i;
     int l[4], nude, k;
-    int nc, mini, minj, j, ii, jj;
+    int nc, mini, minj, j;
     double fnseqs, fnseqs2 = 0, sumd;
-    double diq, djq, dij, dio, djo, da;
-    double tmin, total, dmin;
+    double dio, djo, da;
+    double dmin;
     double bi, bj, b1, b2, b3, branch[4];
     int typei, typej; /* 0 = node; 1 = OTU */
 
@@ -183,13 +183,7 @@ void NJTree::generateTree(clustalw::PhyloTree* phyTree,
     
     /* IMPROVEMENT 2, STEP 0 : declare  variables */
     int loop_limit;
-    typedef struct _ValidNodeID
-    {
-        int n;
-        struct _ValidNodeID *prev;
-        struct _ValidNodeID *next;
-    } ValidNodeID;
-    ValidNodeID *tvalid,  *lpi,  *lpj,  *lpii,  *lpjj,  *lp_prev,  *lp_next;
+    ValidNodeID *tvalid,  *lpi,  *lpj,  *lp_prev,  *lp_next;
 
     /*
      * correspondence of the loop counter variables.
@@ -288,6 +282,8 @@ void NJTree::generateTree(clustalw::PhyloTree* phyTree,
         sumCols[j] = tmp_sum;
     }
 
+    startSearch(distMat, tvalid);
+
     /*********************** Enter The Main Cycle ***************************/
 
     for (nc = 1, loop_limit = (lastSeq - firstSeq + 1-3); nc <= loop_limit; ++nc)
@@ -299,75 +295,11 @@ void NJTree::generateTree(clustalw::PhyloTree* phyTree,
             sumd += sumCols[lpj->n];
         }
 
-        /* IMPROVEMENT 3, STEP 0 : multiply tmin and 2*fnseqs2 */
         fnseqs2 = fnseqs - 2.0; /* Set fnseqs2 at this point. */
-        tmin = 99999.0 * 2.0 * fnseqs2;
 
         /*.................compute SMATij values and find the smallest one ........*/
 
-        mini = minj = 0;
-
-        /* jj must starts at least 2 */
-        if ((tvalid[0].next != NULL) && (tvalid[0].next->n == 1))
-        {
-            lpjj = tvalid[0].next->next;
-        }
-        else
-        {
-            lpjj = tvalid[0].next;
-        }
-
-        for (; lpjj != NULL; lpjj = lpjj->next)
-        {
-            jj = lpjj->n;
-            for (lpii = tvalid[0].next; lpii->n < jj; lpii = lpii->next)
-            {
-                ii = lpii->n;
-                diq = djq = 0.0;
-
-                /* IMPROVEMENT 1, STEP 4 : use sum value */
-                diq = sumCols[ii] + sumRows[ii];
-                djq = sumCols[jj] + sumRows[jj];
-                /*
-                 * always ii < jj in this point. Use upper
-                 * triangle of score matrix.
-                 */
-                dij = (*distMat)(ii, jj);
-                /*
-                 * IMPROVEMENT 3, STEP 1 : fnseqs2 is
-                 * already calculated.
-                 */
-                /* fnseqs2 = fnseqs - 2.0 */
-
-                /* IMPROVEMENT 4 : transform the equation */
-                /*-------------------------------------------------------------------*
-                 * OPTIMIZE of expression 'total = d2r + fnseqs2*dij + dr*2.0'       *
-                 * total = d2r + fnseq2*dij + 2.0*dr                                 *
-                 *       = d2r + fnseq2*dij + 2(sumd - dij - d2r)                    *
-                 *       = d2r + fnseq2*dij + 2*sumd - 2*dij - 2*d2r                 *
-                 *       =       fnseq2*dij + 2*sumd - 2*dij - 2*d2r + d2r           *
-                 *       = fnseq2*dij + 2*sumd - 2*dij - d2r                         *
-                 *       = fnseq2*dij + 2*sumd - 2*dij - (diq + djq - 2*dij)         *
-                 *       = fnseq2*dij + 2*sumd - 2*dij - diq - djq + 2*dij           *
-                 *       = fnseq2*dij + 2*sumd - 2*dij + 2*dij - diq - djq           *
-                 *       = fnseq2*dij + 2*sumd  - diq - djq                          *
-                 *-------------------------------------------------------------------*/
-                total = fnseqs2 * dij + 2.0 * sumd - diq - djq;
-                /*
-                 * IMPROVEMENT 3, STEP 2 : abbrevlate
-                 * the division on comparison between
-                 * total and tmin.
-                 */
-                /* total = total / (2.0*fnseqs2); */
-
-                if (total < tmin)
-                {
-                    tmin = total;
-                    mini = ii;
-                    minj = jj;
-                }
-            }
-        }
+        findNeighbours(distMat, tvalid, sumCols, sumRows, sumd, fnseqs2, &mini, &minj);
 
         /* MEMO: always ii < jj in avobe loop, so mini < minj */
 
@@ -654,6 +586,8 @@ void NJTree::generateTree(clustalw::PhyloTree* phyTree,
             join[j] = 0.0;
         }
 
+        nodesJoined(distMat, tvalid, mini, minj);
+
     } /** end main cycle **/
 
     /******************************Last Cycle (3 Seqs. left)********************/
@@ -754,4 +688,83 @@ void NJTree::generateTree(clustalw::PhyloTree* phyTree,
     
 
 }
+
+void NJTree::findNeighbours(clustalw::DistMatrix* distMat,
+                            const ValidNodeID* tvalid,
+                            const double* sumCols, const double* sumRows,
+                            double sumd, double fnseqs2,
+                            int* mini, int* minj)
+{
+    int ii, jj;
+    double diq, djq, dij;
+    double tmin, total;
+    const ValidNodeID *lpii,  *lpjj;
+
+    /* IMPROVEMENT 3, STEP 0 : multiply tmin and 2*fnseqs2 */
+    tmin = 99999.0 * 2.0 * fnseqs2;
+
+    *mini = *minj = 0;
+
+    /* jj must starts at least 2 */
+    if ((tvalid[0].next != NULL) && (tvalid[0].next->n == 1))
+    {
+        lpjj = tvalid[0].next->next;
+    }
+    else
+    {
+        lpjj = tvalid[0].next;
+    }
+
+    for (; lpjj != NULL; lpjj = lpjj->next)
+    {
+        jj = lpjj->n;
+        for (lpii = tvalid[0].next; lpii->n < jj; lpii = lpii->next)
+        {
+            ii = lpii->n;
+            diq = djq = 0.0;
+
+            /* IMPROVEMENT 1, STEP 4 : use sum value */
+            diq = sumCols[ii] + sumRows[ii];
+            djq = sumCols[jj] + sumRows[jj];
+            /*
+             * always ii < jj in this point. Use upper
+             * triangle of score matrix.
+             */
+            dij = (*distMat)(ii, jj);
+            /*
+             * IMPROVEMENT 3, STEP 1 : fnseqs2 is
+             * already calculated.
+             */
+            /* fnseqs2 = fnseqs - 2.0 */
+
+            /* IMPROVEMENT 4 : transform the equation */
+            /*-------------------------------------------------------------------*
+             * OPTIMIZE of expression 'total = d2r + fnseqs2*dij + dr*2.0'       *
+             * total = d2r + fnseq2*dij + 2.0*dr                                 *
+             *       = d2r + fnseq2*dij + 2(sumd - dij - d2r)                    *
+             *       = d2r + fnseq2*dij + 2*sumd - 2*dij - 2*d2r                 *
+             *       =       fnseq2*dij + 2*sumd - 2*dij - 2*d2r + d2r           *
+             *       = fnseq2*dij + 2*sumd - 2*dij - d2r                         *
+             *       = fnseq2*dij + 2*sumd - 2*dij - (diq + djq - 2*dij)         *
+             *       = fnseq2*dij + 2*sumd - 2*dij - diq - djq + 2*dij           *
+             *       = fnseq2*dij + 2*sumd - 2*dij + 2*dij - diq - djq           *
+             *       = fnseq2*dij + 2*sumd  - diq - djq                          *
+             *-------------------------------------------------------------------*/
+            total = fnseqs2 * dij + 2.0 * sumd - diq - djq;
+            /*
+             * IMPROVEMENT 3, STEP 2 : abbrevlate
+             * the division on comparison between
+             * total and tmin.
+             */
+            /* total = total / (2.0*fnseqs2); */
+
+            if (total < tmin)
+            {
+                tmin = total;
+                *mini = ii;
+                *minj = jj;
+            }
+        }
+    }
+}
 }
@@ -37,9 +37,50 @@ class NJTree : public ClusterTreeAlgorithm
          *  if set to true, generateTree will need a log ofstream
          */
         virtual void setVerbose(bool choice){verbose = choice;};
-    private:
+    protected:
+        /** entry of the chain list of nodes which are not joined yet */
+        typedef struct _ValidNodeID
+        {
+            int n;
+            struct _ValidNodeID *prev;
+            struct _ValidNodeID *next;
+        } ValidNodeID;
+
+        /** called once before the main cycle, when the sums are set up
+         *
+         * @param distMat distance matrix
+         * @param tvalid head of the chain list of valid nodes
+         */
+        virtual void startSearch(clustalw::DistMatrix* /*distMat*/,
+                                 const ValidNodeID* /*tvalid*/){};
+
+        /** find the pair of nodes with the smallest SMATij value.
+         *
+         * Ties go to the pair with the smallest minj, then the smallest mini.
+         * mini < minj on return.
+         *
+         * @param distMat distance matrix
+         * @param tvalid head of the chain list of valid nodes
+         * @param sumCols, sumRows sums of the distances of each node
+         * @param sumd sum of all distances
+         * @param fnseqs2 number of valid nodes - 2
+         */
+        virtual void findNeighbours(clustalw::DistMatrix* distMat,
+                                    const ValidNodeID* tvalid,
+                                    const double* sumCols, const double* sumRows,
+                                    double sumd, double fnseqs2,
+                                    int* mini, int* minj);
+
+        /** called after minj has been joined into mini and the distances
+         *  of mini have been updated
+         */
+        virtual void nodesJoined(clustalw::DistMatrix* /*distMat*/,
+                                 const ValidNodeID* /*tvalid*/,
+                                 int /*mini*/, int /*minj*/){};
+
         vector<double> av;
         vector<int> tkill;
+    private:
         bool verbose;
 };
 
@@ -0,0 +1,196 @@
+/**
+ * RapidNJTree: neighbour joining with a bounded search for the closest pair.
+ * See RapidNJTree.h.
+ */
+#ifdef HAVE_CONFIG_H
+    #include "config.h"
+#endif
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <cmath>
+#include "RapidNJTree.h"
+
+namespace clustalw
+{
+
+namespace
+{
+    /* relative error allowed for the bounds, far above rounding errors */
+    const double boundEps = 1e-9;
+
+    struct SortedEntryLess
+    {
+        template<class T>
+        bool operator()(const T& a, const T& b) const
+        {
+            return a.dist < b.dist || (a.dist == b.dist && a.n < b.n);
+        }
+    };
+
+    /* nearest float which is not larger than d */
+    inline float floatNotAbove(double d)
+    {
+        float f = (float)d;
+        if ((double)f > d)
+        {
+            f = std::nextafter(f, -FLT_MAX);
+        }
+        return f;
+    }
+}
+
+void RapidNJTree::sortRow(clustalw::DistMatrix* distMat, const ValidNodeID* tvalid,
+                          int i, bool all)
+{
+    vector<SortedEntry>& row = rows[i];
+    const ValidNodeID *lpj;
+    SortedEntry entry;
+
+    row.clear();
+    for (lpj = tvalid[0].next; lpj != NULL; lpj = lpj->next)
+    {
+        int j = lpj->n;
+        if (j == i || (!all && j < i))
+        {
+            continue;
+        }
+        entry.dist = floatNotAbove(j > i ? (*distMat)(i, j) : (*distMat)(j, i));
+        entry.n = j;
+        row.push_back(entry);
+    }
+    std::sort(row.begin(), row.end(), SortedEntryLess());
+}
+
+void RapidNJTree::compactRow(int i)
+{
+    vector<SortedEntry>& row = rows[i];
+    size_t k = 0;
+
+    for (size_t p = 0; p < row.size(); ++p)
+    {
+        if (isValid(i, row[p].n))
+        {
+            row[k++] = row[p];
+        }
+    }
+    row.resize(k);
+    vector<SortedEntry>(row).swap(row);
+}
+
+void RapidNJTree::startSearch(clustalw::DistMatrix* distMat, const ValidNodeID* tvalid)
+{
+    const ValidNodeID *lpi;
+    int maxNode = 0;
+
+    numActive = 0;
+    for (lpi = tvalid[0].next; lpi != NULL; lpi = lpi->next)
+    {
+        maxNode = std::max(maxNode, lpi->n);
+        ++numActive;
+    }
+
+    cycle = 0;
+    rows.clear();
+    rows.resize(maxNode + 1);
+    rowStamp.assign(maxNode + 1, 0);
+    for (lpi = tvalid[0].next; lpi != NULL; lpi = lpi->next)
+    {
+        sortRow(distMat, tvalid, lpi->n, false);
+    }
+}
+
+void RapidNJTree::findNeighbours(clustalw::DistMatrix* distMat,
+                                 const ValidNodeID* tvalid,
+                                 const double* sumCols, const double* sumRows,
+                                 double sumd, double fnseqs2,
+                                 int* mini, int* minj)
+{
+    const ValidNodeID *lpi;
+    double rmax = -DBL_MAX;
+    double tmin = 99999.0 * 2.0 * fnseqs2;
+
+    *mini = *minj = 0;
+
+    for (lpi = tvalid[0].next; lpi != NULL; lpi = lpi->next)
+    {
+        rmax = std::max(rmax, sumCols[lpi->n] + sumRows[lpi->n]);
+    }
+
+    /*
+     * Two passes over the rows: the first one only looks at the closest
+     * valid node of each row, which gives a good tmin for the bounds of
+     * the second one.
+     */
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (lpi = tvalid[0].next; lpi != NULL; lpi = lpi->next)
+        {
+            const int i = lpi->n;
+            vector<SortedEntry>& row = rows[i];
+            const double ri = sumCols[i] + sumRows[i];
+            /* SMATij >= fnseqs2 * dij + base for every j of the row */
+            const double base = 2.0 * sumd - ri - rmax;
+            const double slack = boundEps * (fabs(2.0 * sumd) + fabs(ri) + fabs(rmax));
+
+            if (pass == 0 && row.size() > 2 * (size_t)numActive)
+            {
+                compactRow(i);
+            }
+
+            for (size_t p = 0; p < row.size(); ++p)
+            {
+                const SortedEntry& e = row[p];
+                if (!isValid(i, e.n))
+                {
+                    continue;
+                }
+
+                const double d = e.dist;
+                if (fnseqs2 * (d - boundEps * fabs(d)) + base - slack > tmin)
+                {
+                    break;
+                }
+
+                /* same expression and operand order as NJTree */
+                const int ii = std::min(i, e.n);
+                const int jj = std::max(i, e.n);
+                const double diq = sumCols[ii] + sumRows[ii];
+                const double djq = sumCols[jj] + sumRows[jj];
+                const double dij = (*distMat)(ii, jj);
+                const double total = fnseqs2 * dij + 2.0 * sumd - diq - djq;
+
+                /* NJTree scans jj, then ii in increasing order and keeps the first minimum */
+                if (total < tmin ||
+                    (total == tmin && *mini != 0 &&
+                     (jj < *minj || (jj == *minj && ii < *mini))))
+                {
+                    tmin = total;
+                    *mini = ii;
+                    *minj = jj;
+                }
+
+                if (pass == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void RapidNJTree::nodesJoined(clustalw::DistMatrix* distMat,
+                              const ValidNodeID* tvalid,
+                              int mini, int minj)
+{
+    --numActive;
+    ++cycle;
+
+    vector<SortedEntry>().swap(rows[minj]);
+
+    /* mini is a new node now: its old entries in other rows are out of date */
+    rowStamp[mini] = cycle;
+    sortRow(distMat, tvalid, mini, true);
+}
+
+}
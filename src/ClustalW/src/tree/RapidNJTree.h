@@ -0,0 +1,74 @@
+/**
+ * RapidNJTree: neighbour joining with a bounded search for the closest pair
+ * (Simonsen, Mailund and Pedersen (2008), "Rapid Neighbour-Joining",
+ * WABI 2008, LNCS 5251, 113-122).
+ *
+ * Every node keeps its distances to the other nodes in a row sorted by
+ * distance. For a row i and an upper bound of the row sums, the SMATij values
+ * of the row can only grow along the sorted row, so the scan of a row stops
+ * as soon as the bound exceeds the best value found so far. Usually only the
+ * first few entries of each row are looked at.
+ *
+ * The joins, branch lengths and distance updates are those of NJTree, and
+ * SMATij values are computed exactly as there. Ties go to the same pair as
+ * in NJTree, so both give the same tree.
+ */
+#ifndef RAPIDNJTREE_H
+#define RAPIDNJTREE_H
+
+#include <vector>
+#include "NJTree.h"
+
+namespace clustalw
+{
+
+class RapidNJTree : public NJTree
+{
+    public:
+        RapidNJTree(): numActive(0), cycle(0){};
+        virtual ~RapidNJTree(){};
+
+    protected:
+        virtual void startSearch(clustalw::DistMatrix* distMat,
+                                 const ValidNodeID* tvalid);
+        virtual void findNeighbours(clustalw::DistMatrix* distMat,
+                                    const ValidNodeID* tvalid,
+                                    const double* sumCols, const double* sumRows,
+                                    double sumd, double fnseqs2,
+                                    int* mini, int* minj);
+        virtual void nodesJoined(clustalw::DistMatrix* distMat,
+                                 const ValidNodeID* tvalid,
+                                 int mini, int minj);
+
+    private:
+        /** one entry of a sorted row. dist is never larger than the distance */
+        struct SortedEntry
+        {
+            float dist;
+            int n;
+        };
+
+        void sortRow(clustalw::DistMatrix* distMat, const ValidNodeID* tvalid,
+                     int i, bool all);
+        void compactRow(int i);
+        bool isValid(int i, int j) const
+        {
+            return !tkill[j] && rowStamp[j] <= rowStamp[i];
+        }
+
+        /*
+         * rows[i] holds node i's distances to the nodes which were valid when
+         * the row was sorted. rowStamp[i] is the cycle in which that happened
+         * (0 for the initial rows). An entry j of row i is out of date if j
+         * has been joined or has got a newer row; in that case the pair is
+         * found in row j. Initial rows only hold j > i, so that every pair is
+         * in exactly one row.
+         */
+        vector<vector<SortedEntry> > rows;
+        vector<int> rowStamp;
+        int numActive;
+        int cycle;
+};
+
+}
+#endif
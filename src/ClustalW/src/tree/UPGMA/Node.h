@@ -13,22 +13,12 @@ class Node
 {
     public:
     
-        Node(int seqNum, double *aptrToDistMatRow, int numDists);
-        double getDist(int index){return ptrToDistMatRow[index];}
-        void setDist(int index, double dist){ptrToDistMatRow[index] = dist;}
-        double* getPtrToDistMatRow(){return ptrToDistMatRow;}
-        void setDistMatRowToNull(){ptrToDistMatRow = 0;}
-        int getNumDists(){return numDists;}
-        double getMinDist(){return minDist;}
-        int getIndexToMinDist(){return indexToMinDist;}
-        void setMinDist(int index, double d){indexToMinDist = index; minDist = d;}
+        Node(int seqNum);
         int getOrder(){return order;}
         void setOrder(int o){order = o;}
         int getSeqNum(){return seqNum;}
         void setSeqNum(int sNum){seqNum = sNum;}
         void printNodeInfo();
-        void printDistMatRow();
-        void printMinDist();
         string elementsToString();        
         Node* getLeft(){return left;}
         Node* getRight(){return right;}
@@ -52,22 +42,16 @@ class Node
             }
         }
         
-        void merge(Node **rightNode, double _height);
-        void findMinDist();
+        void merge(Node *rightNode, double _height);
         void printElements();      
         void makeEmpty();
         void makeEmpty(Node* t);
         /* Attributes */ 
-        Node *next; // For linked list of nodes
         Node *left, *right;
         int size;
         int seqNum;
         double height;
         vector<int> allElements; // THis is for the groups!!!   
-        double *ptrToDistMatRow; 
-        double minDist; // minimal distance
-        int indexToMinDist; // index of minimal distance
-        int numDists;
         int order;
 };
 
@@ -22,7 +22,7 @@ RootedGuideTree::RootedGuideTree(Node* r)
 
 RootedGuideTree::~RootedGuideTree()
 {
-    root->makeEmpty();
+    makeEmpty();
 }
 
 void RootedGuideTree::setRoot(Node* r)
@@ -34,7 +34,12 @@ void RootedGuideTree::setRoot(Node* r)
  
 void RootedGuideTree::makeEmpty()
 {
-    root->makeEmpty();
+    // root is 0 until a tree has been set
+    if (root != 0)
+    {
+        root->makeEmpty();
+        root = 0;
+    }
 }
 
 void RootedGuideTree::orderNodes()
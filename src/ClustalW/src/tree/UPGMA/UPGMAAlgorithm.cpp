@@ -18,12 +18,15 @@ namespace clustalw
 UPGMAAlgorithm::UPGMAAlgorithm()
 : overwriteMatrix(false),
   numSeqs(0),
-  verbose(false),
-  orderNode1(0),
-  orderNode2(0),
-  orderNewNode(0)
+  verbose(false)
 {}
 
+/**
+ * The clusters are computed with the nearest-neighbor chain algorithm
+ * (UpgmaNNChain.h), which needs O(N^2) time and gives the same tree as
+ * always joining the closest pair of clusters. distMat is not changed, so
+ * overwrite is not needed any more.
+ */
 auto_ptr<AlignmentSteps> UPGMAAlgorithm::generateTree(RootedGuideTree* phyTree,
                                           DistMatrix* distMat,
                                           SeqInfo* seqInfo, bool overwrite,
@@ -43,72 +46,46 @@ auto_ptr<AlignmentSteps> UPGMAAlgorithm::generateTree(RootedGuideTree* phyTree,
           
     progSteps.reset(new AlignmentSteps);
     
-    Node** clusters; 
-    Node* root;
     numSeqs = seqInfo->numSeqs;
-    const int sizeDistMat = ((numSeqs + 1) * (numSeqs + 2)) / 2;
-        
-    double* elements = overwrite ? 
-                      distMat->getDistMatrix(seqInfo->firstSeq, seqInfo->numSeqs) : 
-                      (double *)memcpy(new double[sizeDistMat], 
-                      distMat->getDistMatrix(seqInfo->firstSeq, seqInfo->numSeqs),
-                      sizeDistMat * sizeof(double));
-       
-    clusters = initialiseNodes(elements, seqInfo->firstSeq);
-    root = doUPGMA(clusters, tree);
-    
-    phyTree->setRoot(root);
-    delete [] clusters;
+    const int firstSeq = seqInfo->firstSeq;
 
-    if(!overwrite)
+    pdm_t dists;
+    if (PdmNew(&dists, numSeqs, numSeqs, PDM_DOUBLE) != 0)
     {
-        delete [] elements;
+        cout << "Could not allocate a distance matrix for " << numSeqs 
+             << " seqs.\n";
+        throw bad_alloc();
     }
-    distMat->clearSubArray(); 
-    
-    return progSteps;  
-}
-
-
-Node** UPGMAAlgorithm::initialiseNodes(double* distanceMatrix, int fSeq)
-{    
-    int firstSeq = fSeq; 
-
-    
-    Node** nodes = new Node*[numSeqs];
-    Node** nodeIter = nodes;
-
-    *nodes = new Node(firstSeq, 0, 0);
-    
-    distanceMatrix++;
-    
-    // Move to first position in distanceMatrix.
-    for(int elementIndex = 1, e = numSeqs; elementIndex < e; 
-        distanceMatrix += ++elementIndex) 
+    for (int i = 0; i < numSeqs; i++)
     {
-        Node* newcluster = new Node(elementIndex + firstSeq, 
-                                    distanceMatrix, elementIndex);             
-        (*nodeIter++)->next = newcluster;
-        *nodeIter = newcluster;
+        for (int j = i + 1; j < numSeqs; j++)
+        {
+            PdmSet(&dists, i, j, distMat->GetAt(firstSeq + i, firstSeq + j));
+        }
     }
 
-  return nodes;
-}
-
-void UPGMAAlgorithm::printAllNodes(Node** nodes)
-{
-    int numNodes = 0;
-    for(Node* nodeIter = *nodes; nodeIter; nodeIter = nodeIter->next)
+    vector<nnc_join_t> joins(numSeqs > 1 ? numSeqs - 1 : 1);
+    int status = NncCluster(&dists, NNC_UPGMA, 0.0, &joins[0]);
+    PdmFree(&dists);
+    if (status != 0)
     {
-        numNodes++;
-        cout << "Node " << numNodes << "\n";
-        nodeIter->printElements();
-        cout << "\n\n";
+        cout << "Out of Memory!\n";
+        throw bad_alloc();
     }
-    cout << "There are " << numNodes << " nodes\n";  
+
+    Node* root = doUPGMA(joins, firstSeq, tree);
+    phyTree->setRoot(root);
+    
+    return progSteps;  
 }
 
-Node* UPGMAAlgorithm::doUPGMA(Node** nodes, ofstream* tree)
+/**
+ * Builds the tree from the joins of NncCluster(). The node of a cluster is
+ * the node of its first sequence, which becomes the parent of a copy of
+ * itself (left) and of the node of the other cluster (right).
+ */
+Node* UPGMAAlgorithm::doUPGMA(const vector<nnc_join_t>& joins, int firstSeq,
+                              ofstream* tree)
 {
     if (tree == 0 || !tree->is_open())
     {
@@ -116,74 +93,31 @@ Node* UPGMAAlgorithm::doUPGMA(Node** nodes, ofstream* tree)
     } 
         
     string type1, type2;
-    int step = 0;
+    vector<Node*> nodes(2 * numSeqs - 1);
+
+    for (int i = 0; i < numSeqs; i++)
+    {
+        nodes[i] = new Node(firstSeq + i);
+    }
     
-    while((*nodes)->next) // While there is more than 1 node.
+    for (int step = 1; step < numSeqs; step++)
     {        
-        step++;
+        const nnc_join_t& join = joins[step - 1];
+        Node* const nodeToJoin1 = nodes[join.left];
+        Node* const nodeToJoin2 = nodes[join.right];
+
         if (verbose)
         {
             (*tree) <<  "\n Cycle" << setw(4) << step << "     = ";
         }
-        Node** ptrNodeWithMin;
-        
-        /** 
-         * STEP 1 find node with min distance
-         */
-        ptrNodeWithMin = getNodeWithMinDist(nodes); 
-        Node* nodeToJoin2 = *ptrNodeWithMin; 
-        const int indexToMinDist = nodeToJoin2->indexToMinDist; 
-        Node* const nodeToJoin1 = nodes[indexToMinDist];
-
-        orderNode1 = nodeToJoin1->size;
-        orderNode2 = nodeToJoin2->size;
-        orderNewNode = orderNode1 + orderNode2;
 
         /**
-         * STEP 2 Recompute the dist Matrix row for nodeToJoin1
-         * example: Join nodes 2 and 6
-         * 
-         * 1  0
-         * 2  X 0
-         * 3  0 0 0
-         * 4  0 0 0 0
-         * 5  0 0 0 0 0
-         * 6  0 0 0 0 0 0
-         * 7  0 0 0 0 0 0 0
-         */
-        double* nodeToJoin2DistIter = nodeToJoin2->ptrToDistMatRow;
-                
-        if (indexToMinDist != 0)
-        {
-            recomputeNodeToJoin1DistMatRow(nodeToJoin1, &nodeToJoin2DistIter);
-        }
-        
-        /**
-         * STEP 3 Recompute all distances in column 
-         * example: Join nodes 2 and 6
-         * 
-         * 1  0
-         * 2  C 0
-         * 3  0 X 0
-         * 4  0 X 0 0
-         * 5  0 X 0 0 0
-         * 6  0 0 0 0 0 0
-         * 7  0 X 0 0 0 0 0
-         */
-                 
-        computeAllOtherDistsToNewNode(nodeToJoin1, nodeToJoin2, &nodeToJoin2DistIter);
-
-        /**
-         * STEP 4 Add the step to the progSteps.
+         * Add the step to the progSteps.
          * This creates the multiple alignment steps.
          */     
         addAlignmentStep(&nodeToJoin1->allElements, &nodeToJoin2->allElements);
 
-        
-        double minDistance = (*ptrNodeWithMin)->minDist;
-        
-        double height = 0.0;                                  
-        height = minDistance / 2.0;
+        double height = join.dist / 2.0;
         
         if(verbose)
         {
@@ -208,222 +142,12 @@ Node* UPGMAAlgorithm::doUPGMA(Node** nodes, ofstream* tree)
                     << setw(4) << nodeToJoin2->allElements[0] << " (" 
                     << setw(9) << setprecision(5) << height << ")";
         }
-        /**
-         * STEP 5 merge 2 nodes
-         */              
-        nodeToJoin1->merge(ptrNodeWithMin, height);
-  
-    }
-
-    return *nodes; 
-}
 
-/**
- * This function returns a Node object that has the minimum distance of
- * all the nodes left.
- */
-Node** UPGMAAlgorithm::getNodeWithMinDist(Node** nodes)
-{
-    Node** ptrMinNode = NULL;
-    double minDistance = numeric_limits<double>::max();
-    //Start at node 1, check see if it points to something, then move on the next one.
-    Node** nodeIter;
-    for(nodeIter = &((*nodes)->next); *nodeIter; 
-        nodeIter = &(*nodeIter)->next)
-    {
-        if ((*nodeIter)->getMinDist() < minDistance) 
-        {
-            minDistance = (*nodeIter)->getMinDist();
-            ptrMinNode = nodeIter; // ptrMinNode will hold a ptr to node with sm'st dist
-        }
-    }
-    return ptrMinNode;    
-}
-
-/**
- * This function is used to recompute the nodeToJoin1 dist mat row. Each row in the distance
- * matrix has the distances to all nodes before it, not after. For example the dist mat row
- * for Node 3 would have the distances to nodes 1 and 2.
-         * 1  0
-         * 2  0 0
-         * 3  X X 0      Dists to node 1 and 2.
-         * 4  0 0 0 0
-         * 5  0 0 0 0 0
-         * 6  0 0 0 0 0 0
-         * 7  0 0 0 0 0 0 0 
- */
-void UPGMAAlgorithm::recomputeNodeToJoin1DistMatRow(Node* nodeToJoin1, 
-                                                    double** nodeToJoin2DistIter)
-{
-    double* nodeToJoin1DistIter = nodeToJoin1->ptrToDistMatRow;
-    // calculate new distance
-    *nodeToJoin1DistIter = calcNewDist(*nodeToJoin1DistIter, **nodeToJoin2DistIter);
-                             
-    const double* minIndex1 = nodeToJoin1DistIter;
-    nodeToJoin1DistIter++; 
-    (*nodeToJoin2DistIter)++;
-    int numDistToUpdate = nodeToJoin1->numDists - 1;
-            
-    // For each of the distances in nodeToJoin1           
-    while(numDistToUpdate > 0)
-    {
-        if (*nodeToJoin1DistIter >= 0) 
-        {
-            // Calculate the average
-            *nodeToJoin1DistIter = calcNewDist(*nodeToJoin1DistIter, **nodeToJoin2DistIter);
-            
-            if (*nodeToJoin1DistIter < *minIndex1)
-            {
-                minIndex1 = nodeToJoin1DistIter;
-            }
-        }
-        nodeToJoin1DistIter++;
-        (*nodeToJoin2DistIter)++;
-        numDistToUpdate--;
-    }
-
-    // We have found the minimum distance            
-    nodeToJoin1->minDist = *minIndex1;
-    nodeToJoin1->indexToMinDist = minIndex1 - nodeToJoin1->ptrToDistMatRow;
-}
-
-/**
- * This function is used to recompute all the other distances. It does this by calling
- * two other functions. We first compute all the distances until we get to node 2. 
- * Then we call another function to do the rest. This is because nodes after node 2 may
- * have had EITHER node1 of node2 as their min distance.
- */
-void UPGMAAlgorithm::computeAllOtherDistsToNewNode(Node* nodeToJoin1, Node* nodeToJoin2,
-                                                   double** nodeToJoin2DistIter)
-{
-    computeDistsUpToNodeToJoin2(nodeToJoin1, nodeToJoin2, nodeToJoin2DistIter);
-    computeDistsForNodesAfterNode2(nodeToJoin2);
-}
-
-/**
- * STEP 3A:
- * This function recomputes the distances in column until we get to nodeToJoin2 
- * example: Join nodes 2 and 6
- * 
- * 1  0
- * 2  C 0
- * 3  0 X 0
- * 4  0 X 0 0
- * 5  0 X 0 0 0
- * 6  0 0 0 0 0 0
- * 7  0 0 0 0 0 0 0
- *
- * For each node until we get to nodeToJoin2    
- *    If newdistance is less than the old min distance, set it to this.
- *    else if its greater than old minDist and indexTominDist is the same, recompute min
- *    else leave the min the same as it hasnt changed.
- */
-void UPGMAAlgorithm::computeDistsUpToNodeToJoin2(Node* nodeToJoin1, Node* nodeToJoin2, double** nodeToJoin2DistIter)
-{
-    const int indexToMinDist = nodeToJoin2->indexToMinDist;
-    
-    movePtrPastUnusedDistances(nodeToJoin2DistIter);
-    
-    Node* nodeIter;
-    // For each node until we get to the second node we are joining           
-    for(nodeIter = nodeToJoin1->next; nodeIter != nodeToJoin2; nodeIter = nodeIter->next) 
-    {            
-        (*nodeToJoin2DistIter)++; // Skip the distance to the node we are joining with
-        movePtrPastUnusedDistances(nodeToJoin2DistIter);
-                       
-        double distToNode = nodeIter->ptrToDistMatRow[indexToMinDist];
-            
-        double newDistToNode = calcNewDist(distToNode, **nodeToJoin2DistIter);
-        nodeIter->ptrToDistMatRow[indexToMinDist] = newDistToNode;
-            
-                        
-        if (newDistToNode < nodeIter->minDist)
-        { /** new value is smaller than current min. */
-            nodeIter->minDist = newDistToNode;
-            nodeIter->indexToMinDist = indexToMinDist;
-        }
-        else if ((newDistToNode > nodeIter->minDist) && 
-                 (nodeIter->indexToMinDist == indexToMinDist)) 
-        { /** indexToMinDist was the min dist, but it is now a larger num, recompute */
-            nodeIter->findMinDist();
-        }
-            
+        nodeToJoin1->merge(nodeToJoin2, height);
+        nodes[numSeqs + step - 1] = nodeToJoin1;
     }
 
-}
-
-/**
- * STEP 3B Recompute distance for nodes after nodeToJoin2
- * example: Join nodes 2 and 6
- * 
- * 1  0
- * 2  C 0
- * 3  0 C 0
- * 4  0 C 0 0
- * 5  0 C 0 0 0
- * 6  0 0 0 0 0 0
- * 7  0 X 0 0 0 0 0
- *
- * For each node until we get to the end.            
- *     if dist is less than minDist, set mindist to new distance, set index to index
- *     else if dist is greater than mindist and the index was either nodetojoin1 or
- *     nodetojoin2, recompute distance, set entry for nodetojoin2 to NOTUSED
- *     else set the distance to unused. 
- */        
-
-void UPGMAAlgorithm::computeDistsForNodesAfterNode2(Node* nodeToJoin2)
-{
-    int indexToNode2 = nodeToJoin2->numDists;
-    const int indexToMinDist = nodeToJoin2->indexToMinDist;
-    
-    Node* nodeIter;       
-
-    for(nodeIter = nodeToJoin2->next; nodeIter; nodeIter = nodeIter->next) 
-    {              
-        double &distUpdate = nodeIter->ptrToDistMatRow[indexToMinDist];
-        
-        distUpdate = 
-	  ((distUpdate * orderNode1) + 
-	   (nodeIter->ptrToDistMatRow[indexToNode2] * orderNode2)) 
-	  / orderNewNode;
-
-	/* The comparison (distUpdate > nodeIter->minDist) is unsafe. 
-	 * Specifically, we get different results for 32/64bit machines, 
-	 * which leads to different branching in the if/else statement 
-	 * and nasty behaviour down the line. 
-	 * Using all of Pfam as a benchmark distUpdate can 'wobble' by 40 ULPs
-         * (Unit of Least Precision) which is difficult to translate into 
-	 * a maximum relative error, so we pick COMPARE_REL_EPSILON 
-	 * phenomenologically: approx 2E-15 was the biggest we saw in Pfam, 
-	 * but suggest 1E-14 (for good measure). 
-	 * Using ULPs, eg, *(long long int*)&(distUpdate),
-	 * would be better (more elegant?) but gives problems 
-	 * with aliasing and/or performance reduction. 
-	 * FS, 2009-04-30 
-	 */
-#define COMPARE_REL_EPSILON 1E-14
-        if ( (distUpdate < nodeIter->minDist) &&
-	     ((nodeIter->minDist-distUpdate) /
-	      nodeIter->minDist > COMPARE_REL_EPSILON) )
-	  { /** new distance is smaller */
-            nodeIter->minDist = distUpdate;
-            nodeIter->indexToMinDist = indexToMinDist;
-	  }
-        else if (((distUpdate > nodeIter->minDist) &&
-		  ((distUpdate-nodeIter->minDist) / 
-		   distUpdate > COMPARE_REL_EPSILON) &&
-		  (nodeIter->indexToMinDist == indexToMinDist)) ||
-		 (nodeIter->indexToMinDist == indexToNode2))
-	  { /** if old min dist was to either nodeToJoin1 or nodeToJoin2 */
-            nodeIter->ptrToDistMatRow[indexToNode2] = UPGMA_BLANKDIST;
-            nodeIter->findMinDist();
-	  }
-        else
-	  {
-            nodeIter->ptrToDistMatRow[indexToNode2] = UPGMA_BLANKDIST;
-	  }
-    }        
-
+    return nodes[2 * numSeqs - 2]; 
 }
 
 void UPGMAAlgorithm::addAlignmentStep(vector<int>* group1, vector<int>* group2)
@@ -447,14 +171,5 @@ void UPGMAAlgorithm::addAlignmentStep(vector<int>* group1, vector<int>* group2)
     
     progSteps->saveSet(&groups); 
 }
-
-/**
- * At the moment we are only using average distance, UPGMA, but we can also use this 
- * function to have different distance measures, min, max etc.
- */
-double UPGMAAlgorithm::calcNewDist(double dist1, double dist2)
-{
-    return ((dist1 * orderNode1) + (dist2 * orderNode2)) / orderNewNode;
-}
   
 }
@@ -11,6 +11,9 @@
 #include "RandomGenerator.h"
 #include <math.h>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <exception>
 #include "../general/OutputFile.h"
 
 namespace clustalw
@@ -66,9 +69,7 @@ void UnRootedClusterTree::treeFromAlignment(TreeNames* treeNames, Alignment *ali
     
         TreeGroups saveTree(numSeqs + 1, vector<int>(numSeqs + 1));
     
-        // NOTE at the moment there is only one type of clustering algorithm, but there will
-        // be more!
-        clusAlgorithm = new NJTree();
+        clusAlgorithm = newNJAlgorithm();
 
         utilityObject->getPath(userParameters->getSeqName(), &path);
 
@@ -218,7 +219,7 @@ void UnRootedClusterTree::treeFromDistMatrix(DistMatrix* distMat,
         }
                 
         // Not sure about bootstrapping here!
-        clusAlgorithm = new NJTree();
+        clusAlgorithm = newNJAlgorithm();
         outputTree = new ClusterTreeOutput(&info, 0);
         
         ofstream* ptrToFile = phylipPhyTreeFile.getPtrToFile();
@@ -276,8 +277,7 @@ void UnRootedClusterTree::treeFromDistMatrix(DistMatrix* distMat,
  */
 void UnRootedClusterTree::bootstrapTree(TreeNames* treeNames, Alignment *alignPtr)
 {
-    int i, j;
-    int ranno;
+    int j;
     string path;
     
     OutputFile clustalPhyTreeFile;
@@ -288,7 +288,6 @@ void UnRootedClusterTree::bootstrapTree(TreeNames* treeNames, Alignment *alignPt
     try
     {
         phyloTree = new PhyloTree; 
-        PhyloTree sampleTree;
         PhyloTree standardTree;
         PhyloTree saveTree;
         int totalDists, overspill = 0, totalOverspill = 0;
@@ -296,7 +295,7 @@ void UnRootedClusterTree::bootstrapTree(TreeNames* treeNames, Alignment *alignPt
         numSeqs = alignPtr->getNumSeqs(); 
         firstSeq = 1;
         lastSeq = numSeqs;
-        clusAlgorithm = new NJTree(); 
+        clusAlgorithm = newNJAlgorithm();
 
         SeqInfo info;
         info.firstSeq = firstSeq;
@@ -385,8 +384,6 @@ void UnRootedClusterTree::bootstrapTree(TreeNames* treeNames, Alignment *alignPt
         verbose = false; // Turn OFF screen output
         clusAlgorithm->setVerbose(false);
         
-        sampleTree.treeDesc.resize(numSeqs + 1, vector<int>(numSeqs + 1));
-    
         if (userParameters->getMenuFlag())
         {
             cout <<  "\n\nEach dot represents 10 trials\n\n";
@@ -394,52 +391,130 @@ void UnRootedClusterTree::bootstrapTree(TreeNames* treeNames, Alignment *alignPt
     
         totalOverspill = 0;
         nfails = 0;
+        
+        /*
+         * The trials are shared out among getNumThreads() threads. Each thread
+         * has its own distance matrix, NJ tree and counts of the clades. The
+         * positions of the trials are drawn from randGenerator in the order of
+         * the trials, so the result does not depend on the number of threads.
+         */
+        int numTrials = userParameters->getBootNumTrials();
+        int numThreads = utilityObject->MAX(1, utilityObject->MIN(userParameters->getNumThreads(),
+                                                                  numTrials));
         int lenSeq1 = alignPtr->getSeqLength(1);
-        for (i = 1; i <= userParameters->getBootNumTrials(); ++i)
+        bool _DNAFlag = userParameters->getDNAFlag();
+        int nextTrial = 1, trialsDone = 0;
+        std::mutex bootMutex;
+        std::exception_ptr workerError;
+        vector<vector<int> > hits(numThreads);
+        vector<int> overspills(numThreads, 0), fails(numThreads, 0);
+        
+        auto worker = [&](int t)
         {
-            for (j = 1; j <= alignPtr->getSeqLength(firstSeq); ++j)
-            {
-                // select alignment positions for            
-                ranno = randGenerator.addRand((unsigned long)lenSeq1) + 1;
-                bootPositions[j] = ranno; // bootstrap sample 
-            }
-            
-            overspill = calcQuickDistMatForSubSet(clustalPhyTreeFile.getPtrToFile(),
-                phylipPhyTreeFile.getPtrToFile(), nexusPhyTreeFile.getPtrToFile(), alignPtr,
-                true);
+            UnRootedClusterTree sample;
+            PhyloTree sampleTree;
+            int k, sampleOverspill;
             
-            if (overspill > 0)
+            sample.numSeqs = numSeqs;
+            sample.firstSeq = firstSeq;
+            sample.lastSeq = lastSeq;
+            sample.verbose = false;
+            sample.bootPositions.resize(_lenFirstSeq + 2);
+            sample.clusAlgorithm = newNJAlgorithm();
+            sample.clusAlgorithm->setVerbose(false);
+            sampleTree.treeDesc.resize(numSeqs + 1, vector<int>(numSeqs + 1));
+            hits[t].assign(numSeqs + 1, 0);
+            try
             {
-                totalOverspill = totalOverspill + overspill;
-                nfails++;
+                while (true)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(bootMutex);
+                        if (nextTrial > numTrials)
+                        {
+                            break;
+                        }
+                        nextTrial++;
+                        for (k = 1; k <= _lenFirstSeq; ++k)
+                        {
+                            // select alignment positions for the bootstrap sample
+                            sample.bootPositions[k] =
+                                randGenerator.addRand((unsigned long)lenSeq1) + 1;
+                        }
+                    }
+                    
+                    if (_DNAFlag)
+                    {
+                        sampleOverspill = sample.dnaDistanceMatrix(NULL, alignPtr);
+                    }
+                    else
+                    {
+                        sampleOverspill = sample.protDistanceMatrix(NULL, alignPtr);
+                    }
+                    if (sampleOverspill > 0)
+                    {
+                        overspills[t] += sampleOverspill;
+                        fails[t]++;
+                    }
+                    sample.treeGaps.clear();
+                    
+                    sample.clusAlgorithm->generateTree(&sampleTree, sample.quickDistMat.get(),
+                                                       &info, NULL);
+                    sampleTree.leftBranch.clear();
+                    sampleTree.rightBranch.clear();
+                    
+                    sample.compareTree(phyloTree, &sampleTree, &hits[t], lastSeq - firstSeq + 1);
+                    
+                    if (userParameters->getMenuFlag())
+                    {
+                        std::lock_guard<std::mutex> lock(bootMutex);
+                        ++trialsDone;
+                        if (trialsDone % 10 == 0)
+                        {
+                            cout <<  ".";
+                        }
+                        if (trialsDone % 100 == 0)
+                        {
+                            cout << "\n";
+                        }
+                    }
+                }
             }
-
-            treeGaps.clear();
-        
-            if (userParameters->getOutputTreeClustal() ||
-                userParameters->getOutputTreePhylip() || userParameters->getOutputTreeNexus())
+            catch(...)
             {
-                // NOTE this is bad to pass in clustalPhyTreeFile
-                clusAlgorithm->generateTree(&sampleTree, quickDistMat.get(), &info,
-                                            clustalPhyTreeFile.getPtrToFile());
+                std::lock_guard<std::mutex> lock(bootMutex);
+                if (!workerError)
+                {
+                    workerError = std::current_exception();
+                }
+                nextTrial = numTrials + 1; // stop the other workers early
             }
-
-            sampleTree.leftBranch.clear();
-            sampleTree.rightBranch.clear();
-
-            compareTree(phyloTree, &sampleTree, &bootTotals, lastSeq - firstSeq + 1);
+            delete sample.clusAlgorithm;
+        };
         
-            if (userParameters->getMenuFlag())
+        vector<std::thread> threads;
+        for (int t = 1; t < numThreads; t++)
+        {
+            threads.push_back(std::thread(worker, t));
+        }
+        worker(0);
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            threads[t].join();
+        }
+        if (workerError)
+        {
+            std::rethrow_exception(workerError);
+        }
+        
+        for (int t = 0; t < numThreads; t++)
+        {
+            for (j = 1; j <= numSeqs; ++j)
             {
-                if (i % 10 == 0)
-                {
-                    cout <<  ".";
-                }
-                if (i % 100 == 0)
-                {
-                    cout << "\n";
-                }
+                bootTotals[j] += hits[t][j];
             }
+            totalOverspill += overspills[t];
+            nfails += fails[t];
         }
 
         // check if any distances overflowed the distance corrections 
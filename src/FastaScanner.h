@@ -0,0 +1,282 @@
+/*
+ * File FastaScanner.h: FASTA file input shared by ClustalW, ClustalOmega,
+ * and MUSCLE
+ *
+ * The file is mapped into memory as a whole (or, if it is gzip-compressed,
+ * inflated into one buffer) and is then scanned record by record without
+ * copying: FastaNextRecord() only returns pointers to the header line and
+ * to the raw sequence text of the next record. FastaEncode() translates the
+ * raw text through a 256-entry table supplied by the engine (its alphabet,
+ * case folding, and the characters to drop) directly into the engine's own
+ * sequence storage, so every residue is touched once and no intermediate
+ * lines or strings are built.
+ *
+ * Everything is defined in this header (static inline functions) so that it
+ * can be used by the C and C++ sources of all three libraries.
+ */
+
+#ifndef _FastaScanner_H_
+
+#define _FastaScanner_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* FastaEncode() table entries: drop the byte, or drop and count it */
+#define FASTA_SKIP    0
+#define FASTA_INVALID 0xff
+
+typedef struct {
+    char *data;        /* contents of the (inflated) file */
+    size_t size;
+    size_t pos;        /* start of the next record */
+    int mapped;        /* data is mmap()ed rather than malloc()ed */
+    int junk;          /* non-blank text was found before the first '>' */
+} fasta_file_t;
+
+typedef struct {
+    const char *name;  /* header line without '>' and line terminator */
+    size_t nameLen;
+    const char *body;  /* sequence lines, including line terminators */
+    size_t bodyLen;
+} fasta_record_t;
+
+static inline int FastaIsGzip(const char *path)
+{
+    unsigned char magic[2];
+    FILE *f = fopen(path, "rb");
+    int gz;
+
+    if (NULL == f)
+        return 0;
+    gz = fread(magic, 1, 2, f) == 2 && 0x1f == magic[0] && 0x8b == magic[1];
+    fclose(f);
+    return gz;
+}
+
+static inline int FastaReadGzip(fasta_file_t *f, const char *path)
+{
+    gzFile gz;
+    size_t cap = 1 << 20;
+    int n;
+
+    if (NULL == (gz = gzopen(path, "rb")))
+        return -1;
+    gzbuffer(gz, 1 << 17);
+    if (NULL == (f->data = (char *) malloc(cap))) {
+        gzclose(gz);
+        return -1;
+    }
+    for (;;) {
+        if (f->size == cap) {
+            char *grown = (char *) realloc(f->data, 2 * cap);
+            if (NULL == grown) {
+                gzclose(gz);
+                return -1;
+            }
+            f->data = grown;
+            cap *= 2;
+        }
+        n = gzread(gz, f->data + f->size,
+                   (unsigned) (cap - f->size < (1u << 30) ? cap - f->size : (1u << 30)));
+        if (n < 0) {
+            gzclose(gz);
+            return -1;
+        }
+        if (0 == n)
+            break;
+        f->size += (size_t) n;
+    }
+    gzclose(gz);
+    return 0;
+}
+
+static inline int FastaReadPlain(fasta_file_t *f, const char *path)
+{
+#if !defined(_WIN32)
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    void *p;
+
+    if (fd < 0)
+        return -1;
+    if (0 != fstat(fd, &st)) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != p) {
+            close(fd);
+#if defined(MADV_SEQUENTIAL)
+            madvise(p, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+            f->data = (char *) p;
+            f->size = (size_t) st.st_size;
+            f->mapped = 1;
+            return 0;
+        }
+    }
+    close(fd);
+#endif
+    {
+        FILE *in = fopen(path, "rb");
+        size_t cap = 1 << 20, n;
+
+        if (NULL == in)
+            return -1;
+        if (NULL == (f->data = (char *) malloc(cap))) {
+            fclose(in);
+            return -1;
+        }
+        while ((n = fread(f->data + f->size, 1, cap - f->size, in)) > 0) {
+            f->size += n;
+            if (f->size == cap) {
+                char *grown = (char *) realloc(f->data, 2 * cap);
+                if (NULL == grown) {
+                    fclose(in);
+                    return -1;
+                }
+                f->data = grown;
+                cap *= 2;
+            }
+        }
+        fclose(in);
+        return 0;
+    }
+}
+
+static inline void FastaClose(fasta_file_t *f)
+{
+#if !defined(_WIN32)
+    if (f->mapped)
+        munmap(f->data, f->size);
+    else
+#endif
+        free(f->data);
+    f->data = NULL;
+    f->size = f->pos = 0;
+    f->mapped = f->junk = 0;
+}
+
+/*
+ * Opens path, which may be gzip-compressed. Returns -1 if the file cannot
+ * be opened or read.
+ */
+static inline int FastaOpen(fasta_file_t *f, const char *path)
+{
+    int ret;
+
+    f->data = NULL;
+    f->size = f->pos = 0;
+    f->mapped = f->junk = 0;
+    ret = FastaIsGzip(path) ? FastaReadGzip(f, path) : FastaReadPlain(f, path);
+    if (0 != ret)
+        FastaClose(f);
+    return ret;
+}
+
+/*
+ * Finds the next record, i.e. the next '>' at the start of a line, and
+ * the end of its body (the next '>' at the start of a line or the end of
+ * the file). Returns 0 at the end of the file.
+ */
+static inline int FastaNextRecord(fasta_file_t *f, fasta_record_t *r)
+{
+    const char *p = f->data + f->pos, *end = f->data + f->size, *q;
+
+    if (0 == f->pos) {
+        while (p < end && '>' != *p) {
+            q = p;
+            while (p < end && '\n' != *p && '\r' != *p)
+                p++;
+            while (q < p && NULL != strchr(" \t\f\v", *q))
+                q++;
+            if (q < p)
+                f->junk = 1;
+            if (p < end)
+                p++;
+        }
+    }
+    if (p >= end)
+        return 0;
+
+    r->name = ++p;
+    while (p < end && '\n' != *p && '\r' != *p)
+        p++;
+    r->nameLen = (size_t) (p - r->name);
+
+    r->body = p;
+    for (;;) {
+        q = (const char *) memchr(p, '>', (size_t) (end - p));
+        if (NULL == q) {
+            p = end;
+            break;
+        }
+        p = q + 1;
+        if ('\n' == q[-1] || '\r' == q[-1]) {
+            p = q;
+            break;
+        }
+    }
+    r->bodyLen = (size_t) (p - r->body);
+    f->pos = (size_t) (p - f->data);
+    return 1;
+}
+
+/*
+ * Counts the records left in the file without decoding them.
+ */
+static inline size_t FastaCountRecords(fasta_file_t *f)
+{
+    fasta_record_t r;
+    size_t pos = f->pos, n = 0;
+
+    while (FastaNextRecord(f, &r))
+        n++;
+    f->pos = pos;
+    return n;
+}
+
+/*
+ * Translates the body of r through map into out, which must hold
+ * r->bodyLen characters, and returns the number of characters written.
+ * Bytes mapped to FASTA_SKIP (line terminators, white space, ...) are
+ * dropped, bytes mapped to FASTA_INVALID are dropped and counted in
+ * *nInvalid (if not NULL).
+ */
+static inline size_t FastaEncode(const fasta_record_t *r,
+                                 const unsigned char *map, char *out,
+                                 size_t *nInvalid)
+{
+    const unsigned char *s = (const unsigned char *) r->body;
+    const unsigned char *end = s + r->bodyLen;
+    char *o = out;
+    size_t invalid = 0;
+    unsigned char c;
+
+    for (; s < end; s++) {
+        c = map[*s];
+        if (FASTA_SKIP == c)
+            continue;
+        if (FASTA_INVALID == c) {
+            invalid++;
+            continue;
+        }
+        *o++ = (char) c;
+    }
+    if (NULL != nInvalid)
+        *nInvalid = invalid;
+    return (size_t) (o - out);
+}
+
+#endif
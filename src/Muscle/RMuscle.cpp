@@ -1,11 +1,16 @@
 #include "RMuscle.h"
+#include "musclecontext.h"
 using namespace std;
 #include <stdio.h>
 #include <stdlib.h>
 //#include "seqvect.h"
 #include <R.h>
 #include <Rinternals.h>
+#include "../AlignedRows.h"
 #include "seq.h"
+#include <atomic>
+#include <exception>
+#include <thread>
 #ifdef	WIN32
 //#include <windows.h>	// for SetPriorityClass()
 #include <io.h>			// for isatty()
@@ -29,319 +34,304 @@ bool hasMuscleEntry(Rcpp::List params, const char* entry) {
 	return false;
 }
 
-SEXP RMuscle(SEXP rInputSeqs,
-             SEXP rCluster,
-             SEXP rGapOpening,
-             SEXP rGapExtension,
-             SEXP rMaxiters,
-             SEXP rSubstitutionMatrix,
-             SEXP rType,
-             SEXP rVerbose,
-             SEXP rParams) {
+static void readMuscleSeqs(SEXP rInputSeqs, SeqVect &seqs) {
+	//inputSeq, seqNames
+	CharacterVector inputSeqs(rInputSeqs);
+	vector<string> seqNames = as<vector<string> >(inputSeqs.attr("names"));
+	Seq seq;
 
-	Rcpp::List retList;
-	try {
-		Rcpp::List params(rParams); // Get parameters in params.
-
-		bool inputFlag = false;
-		if (hasMuscleEntry(params, "inputSeqIsFileFlag")) {
-			inputFlag = as<bool>(params["inputSeqIsFileFlag"]);
-		}
-
-		stringstream ss;
-		MuscleInput input;
-		Seq* seq = new Seq(); //valgrind
-
-		if (inputFlag) {
-			string inputFile = as<string>(rInputSeqs);
-			ss << "-in " << inputFile;
-		} else {
-			ss << "-in noFile";
-
-			//inputSeq, seqNames
-			CharacterVector inputSeqs(rInputSeqs);
-			vector<string> seqNames = as<vector<string> >(inputSeqs.attr("names"));
+	for (int i = 0, n = inputSeqs.size(); i < n; i++) {
+		seq.FromString(inputSeqs[i], seqNames[i].c_str()); //FIXME if string is too long, the string is omitted
+		seqs.AppendSeq(seq);
+	}
+}
 
-			for (int i = 0, n = inputSeqs.size(); i < n; i++) {
-				seq->FromString(inputSeqs[i], seqNames[i].c_str()); //FIXME if string is too long, the string is omitted
-				input.inputSeqs.AppendSeq(*seq);
+static void readMuscleSubstitutionMatrix(SEXP rSubstitutionMatrix,
+                                         MuscleInput &input) {
+	//substitutionMatrix TODO --> domuscle->DoMuscle --> ReadMX
+	//vector<int> substitutionMatrix =
+	//                 Rcpp::as<vector<int>(rSubstitutionMatrix);
+	if (!Rf_isNull(rSubstitutionMatrix)) {
+		NumericMatrix substitutionMatrix(rSubstitutionMatrix);
+		int nrows = substitutionMatrix.nrow();
+		int ncolumns = substitutionMatrix.ncol();
+		for (int i = 0; i < ncolumns; i++) {
+			for (int j = 0; j < nrows; j++) {
+				input.substitutionMatrix[i][j] = substitutionMatrix(i,j);
 			}
 		}
-		//cluster
-		if (!Rf_isNull(rCluster)) {
-			string cluster = as<string>(rCluster);
-			ss << " -cluster " << cluster;
-		}
 
-		//gapOpen
-		if (!Rf_isNull(rGapOpening)) {
-			double gapOpening = as<double>(rGapOpening);
-			ss << " -gapOpen " << gapOpening;
-		}
+		Function colnamesFun("colnames");
+		input.colNames = as<vector<string> >(colnamesFun(substitutionMatrix));
+		input.hasSubstitutionMatrix = true;
+	} else {
+		input.hasSubstitutionMatrix = false;
+	}
+}
 
+static bool appendMuscleArgs(stringstream &ss,
+                             SEXP rCluster,
+                             SEXP rGapOpening,
+                             SEXP rGapExtension,
+                             SEXP rMaxiters,
+                             SEXP rType,
+                             SEXP rVerbose,
+                             Rcpp::List params) {
+	//cluster
+	if (!Rf_isNull(rCluster)) {
+		string cluster = as<string>(rCluster);
+		ss << " -cluster " << cluster;
+	}
 
-		//gapExtend
-		if (!Rf_isNull(rGapExtension)) {
-			double gapExtension = as<double>(rGapExtension);
-			ss << " -gapExtend " << gapExtension;
-		}
+	//gapOpen
+	if (!Rf_isNull(rGapOpening)) {
+		double gapOpening = as<double>(rGapOpening);
+		ss << " -gapOpen " << gapOpening;
+	}
 
 
-		//maxiters
-		if (!Rf_isNull(rMaxiters)) {
-			int maxIters = as<int>(rMaxiters);
-			ss << " -maxiters " << maxIters;
-		}
+	//gapExtend
+	if (!Rf_isNull(rGapExtension)) {
+		double gapExtension = as<double>(rGapExtension);
+		ss << " -gapExtend " << gapExtension;
+	}
 
-		//substitutionMatrix TODO --> domuscle->DoMuscle --> ReadMX
-		//vector<int> substitutionMatrix =
-		//                 Rcpp::as<vector<int>(rSubstitutionMatrix);
-		if (!Rf_isNull(rSubstitutionMatrix)) {
-			NumericMatrix substitutionMatrix(rSubstitutionMatrix);
-			int nrows = substitutionMatrix.nrow();
-			int ncolumns = substitutionMatrix.ncol();
-			for (int i = 0; i < ncolumns; i++) {
-				for (int j = 0; j < nrows; j++) {
-					input.substitutionMatrix[i][j] = substitutionMatrix(i,j);
-				}
-			}
 
-			Function colnamesFun("colnames");
-			input.colNames = as<vector<string> >(colnamesFun(substitutionMatrix));
-			input.hasSubstitutionMatrix = true;
-		} else {
-			input.hasSubstitutionMatrix = false;
-		}
+	//maxiters
+	if (!Rf_isNull(rMaxiters)) {
+		int maxIters = as<int>(rMaxiters);
+		ss << " -maxiters " << maxIters;
+	}
 
-		//type
-		if (!Rf_isNull(rType)) {
-			string type = as<string>(rType);
-			ss << " -seqtype " << type;
-		}
+	//type
+	if (!Rf_isNull(rType)) {
+		string type = as<string>(rType);
+		ss << " -seqtype " << type;
+	}
 
 
-		//verbose
-		bool verbose = false;
-		if (!Rf_isNull(rVerbose)) {
-			verbose = as<bool>(rVerbose);
-			if (!verbose) {
-				ss << " -quiet";
-			}
+	//verbose
+	bool verbose = false;
+	if (!Rf_isNull(rVerbose)) {
+		verbose = as<bool>(rVerbose);
+		if (!verbose) {
+			ss << " -quiet";
 		}
+	}
 
-		//params
+	//params
 
-		if (hasMuscleEntry(params, "anchorspacing")) {
-			int anchorspacing = as<int>(params["anchorspacing"]);
-			ss << " -anchorspacing " << anchorspacing;
-		}
+	if (hasMuscleEntry(params, "anchorspacing")) {
+		int anchorspacing = as<int>(params["anchorspacing"]);
+		ss << " -anchorspacing " << anchorspacing;
+	}
 
-		if (hasMuscleEntry(params, "center")) {
-			double center = as<double>(params["center"]);
-			ss << " -center " << center;
-		}
+	if (hasMuscleEntry(params, "center")) {
+		double center = as<double>(params["center"]);
+		ss << " -center " << center;
+	}
 
-		if (hasMuscleEntry(params, "cluster1")) {
-			string cluster1 = as<string>(params["cluster1"]);
-			ss << " -cluster1 " << cluster1;
-		}
+	if (hasMuscleEntry(params, "cluster1")) {
+		string cluster1 = as<string>(params["cluster1"]);
+		ss << " -cluster1 " << cluster1;
+	}
 
-		if (hasMuscleEntry(params, "cluster2")) {
-			string cluster2 = as<string>(params["cluster2"]);
-			ss << " -cluster2 " << cluster2;
-		}
+	if (hasMuscleEntry(params, "cluster2")) {
+		string cluster2 = as<string>(params["cluster2"]);
+		ss << " -cluster2 " << cluster2;
+	}
 
-		if (hasMuscleEntry(params, "diagbreak")) {
-			int diagbreak = as<int>(params["diagbreak"]);
-			ss << " -diagbreak " << diagbreak;
-		}
+	if (hasMuscleEntry(params, "diagbreak")) {
+		int diagbreak = as<int>(params["diagbreak"]);
+		ss << " -diagbreak " << diagbreak;
+	}
 
-		if (hasMuscleEntry(params, "diaglength")) {
-			int diaglength = as<int>(params["diaglength"]);
-			ss << " -diaglength " << diaglength;
-		}
+	if (hasMuscleEntry(params, "diaglength")) {
+		int diaglength = as<int>(params["diaglength"]);
+		ss << " -diaglength " << diaglength;
+	}
 
-		if (hasMuscleEntry(params, "diagmargin")) {
-			int diagmargin = as<int>(params["diagmargin"]);
-			ss << " -diagmargin " << diagmargin;
-		}
+	if (hasMuscleEntry(params, "diagmargin")) {
+		int diagmargin = as<int>(params["diagmargin"]);
+		ss << " -diagmargin " << diagmargin;
+	}
 
-		if (hasMuscleEntry(params, "distance1")) {
-			string distance1 = as<string>(params["distance1"]);
-			ss << " -distance1 " << distance1;
-		}
+	if (hasMuscleEntry(params, "distance1")) {
+		string distance1 = as<string>(params["distance1"]);
+		ss << " -distance1 " << distance1;
+	}
 
-		if (hasMuscleEntry(params, "distance2")) {
-			string distance2 = as<string>(params["distance2"]);
-			ss << " -distance2 " << distance2;
-		}
+	if (hasMuscleEntry(params, "distance2")) {
+		string distance2 = as<string>(params["distance2"]);
+		ss << " -distance2 " << distance2;
+	}
 
-		if (hasMuscleEntry(params, "hydro")) {
-			int hydro = as<int>(params["hydro"]);
-			ss << " -hydro " << hydro;
-		}
+	if (hasMuscleEntry(params, "hydro")) {
+		int hydro = as<int>(params["hydro"]);
+		ss << " -hydro " << hydro;
+	}
 
-		if (hasMuscleEntry(params, "hydrofactor")) {
-			double hydrofactor = as<double>(params["hydrofactor"]);
-			ss << " -hydrofactor " << hydrofactor;
-		}
+	if (hasMuscleEntry(params, "hydrofactor")) {
+		double hydrofactor = as<double>(params["hydrofactor"]);
+		ss << " -hydrofactor " << hydrofactor;
+	}
 
-		if (hasMuscleEntry(params, "in1")) {
-			string in1 = as<string>(params["in1"]);
-			ss << " -in1 " << in1;
-		}
+	if (hasMuscleEntry(params, "in1")) {
+		string in1 = as<string>(params["in1"]);
+		ss << " -in1 " << in1;
+	}
 
-		if (hasMuscleEntry(params, "in2")) {
-			string in2 = as<string>(params["in2"]);
-			ss << " -in2 " << in2;
-		}
+	if (hasMuscleEntry(params, "in2")) {
+		string in2 = as<string>(params["in2"]);
+		ss << " -in2 " << in2;
+	}
 
-		if (hasMuscleEntry(params, "maxhours")) {
-			double maxhours = as<double>(params["maxhours"]);
-			if (maxhours != -1) {
-				ss << " -maxhours " << maxhours;
-			}
+	if (hasMuscleEntry(params, "maxhours")) {
+		double maxhours = as<double>(params["maxhours"]);
+		if (maxhours != -1) {
+			ss << " -maxhours " << maxhours;
 		}
+	}
 
-		if (hasMuscleEntry(params, "maxtrees")) {
-			int maxtrees = as<int>(params["maxtrees"]);
-			ss << " -maxtrees " << maxtrees;
-		}
+	if (hasMuscleEntry(params, "maxtrees")) {
+		int maxtrees = as<int>(params["maxtrees"]);
+		ss << " -maxtrees " << maxtrees;
+	}
 
-		if (hasMuscleEntry(params, "minbestcolscore")) {
-			double minbestcolscore = as<double>(params["minbestcolscore"]);
-			ss << " -minbestcolscore " << minbestcolscore;
-		}
+	if (hasMuscleEntry(params, "minbestcolscore")) {
+		double minbestcolscore = as<double>(params["minbestcolscore"]);
+		ss << " -minbestcolscore " << minbestcolscore;
+	}
 
-		if (hasMuscleEntry(params, "minsmoothscore")) {
-			double minsmoothscore = as<double>(params["minsmoothscore"]);
-			ss << " -minsmoothscore " << minsmoothscore;
-		}
+	if (hasMuscleEntry(params, "minsmoothscore")) {
+		double minsmoothscore = as<double>(params["minsmoothscore"]);
+		ss << " -minsmoothscore " << minsmoothscore;
+	}
 
-		if (hasMuscleEntry(params, "objscore")) {
-			string objscore = as<string>(params["objscore"]);
-			ss << " -objscore " << objscore;
-		}
+	if (hasMuscleEntry(params, "objscore")) {
+		string objscore = as<string>(params["objscore"]);
+		ss << " -objscore " << objscore;
+	}
 
-		if (hasMuscleEntry(params, "refinewindow")) {
-			int refinewindow = as<int>(params["refinewindow"]);
-			ss << " -refinewindow " << refinewindow;
-		}
+	if (hasMuscleEntry(params, "refinewindow")) {
+		int refinewindow = as<int>(params["refinewindow"]);
+		ss << " -refinewindow " << refinewindow;
+	}
 
-		if (hasMuscleEntry(params, "root1")) {
-			string root1 = as<string>(params["root1"]);
-			ss << " -root1 " << root1;
-		}
+	if (hasMuscleEntry(params, "root1")) {
+		string root1 = as<string>(params["root1"]);
+		ss << " -root1 " << root1;
+	}
 
-		if (hasMuscleEntry(params, "root2")) {
-			string root2 = as<string>(params["root2"]);
-			ss << " -root2 " << root2;
-		}
+	if (hasMuscleEntry(params, "root2")) {
+		string root2 = as<string>(params["root2"]);
+		ss << " -root2 " << root2;
+	}
 
-		if (hasMuscleEntry(params, "smoothscoreceil")) {
-			double smoothscoreceil = as<double>(params["smoothscoreceil"]);
-			ss << " -smoothscoreceil " << smoothscoreceil;
-		}
+	if (hasMuscleEntry(params, "smoothscoreceil")) {
+		double smoothscoreceil = as<double>(params["smoothscoreceil"]);
+		ss << " -smoothscoreceil " << smoothscoreceil;
+	}
 
-		if (hasMuscleEntry(params, "smoothwindow")) {
-			int smoothwindow = as<int>(params["smoothwindow"]);
-			ss << " -smoothwindow " << smoothwindow;
-		}
+	if (hasMuscleEntry(params, "smoothwindow")) {
+		int smoothwindow = as<int>(params["smoothwindow"]);
+		ss << " -smoothwindow " << smoothwindow;
+	}
 
-		if (hasMuscleEntry(params, "SUEFF")) {
-			double SUEFF = as<double>(params["SUEFF"]);
-			ss << " -SUEFF " << SUEFF;
-		}
+	if (hasMuscleEntry(params, "SUEFF")) {
+		double SUEFF = as<double>(params["SUEFF"]);
+		ss << " -SUEFF " << SUEFF;
+	}
 
-		if (hasMuscleEntry(params, "weight1")) {
-			string weight1 = as<string>(params["weight1"]);
-			ss << " -weight1 " << weight1;
-		}
+	if (hasMuscleEntry(params, "weight1")) {
+		string weight1 = as<string>(params["weight1"]);
+		ss << " -weight1 " << weight1;
+	}
 
-		if (hasMuscleEntry(params, "weight2")) {
-			string weight2 = as<string>(params["weight2"]);
-			ss << " -weight2 " << weight2;
-		}
+	if (hasMuscleEntry(params, "weight2")) {
+		string weight2 = as<string>(params["weight2"]);
+		ss << " -weight2 " << weight2;
+	}
 
-		if (hasMuscleEntry(params, "anchors")) {
-			bool anchors = as<bool>(params["anchors"]);
-			if (anchors) {
-				ss << " -anchors ";
-			}
+	if (hasMuscleEntry(params, "anchors")) {
+		bool anchors = as<bool>(params["anchors"]);
+		if (anchors) {
+			ss << " -anchors ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "brenner")) {
-			bool brenner = as<bool>(params["brenner"]);
-			if (brenner) {
-				ss << " -brenner ";
-			}
+	if (hasMuscleEntry(params, "brenner")) {
+		bool brenner = as<bool>(params["brenner"]);
+		if (brenner) {
+			ss << " -brenner ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "core")) {
-			bool core = as<bool>(params["core"]);
-			if (core) {
-				ss << " -core ";
-			}
+	if (hasMuscleEntry(params, "core")) {
+		bool core = as<bool>(params["core"]);
+		if (core) {
+			ss << " -core ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "diags")) {
-			bool diags = as<bool>(params["diags"]);
-			if (diags) {
-				ss << " -diags ";
-			}
+	if (hasMuscleEntry(params, "diags")) {
+		bool diags = as<bool>(params["diags"]);
+		if (diags) {
+			ss << " -diags ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "diags1")) {
-			bool diags1 = as<bool>(params["diags1"]);
-			if (diags1) {
-				ss << " -diags1 ";
-			}
+	if (hasMuscleEntry(params, "diags1")) {
+		bool diags1 = as<bool>(params["diags1"]);
+		if (diags1) {
+			ss << " -diags1 ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "diags2")) {
-			bool diags2 = as<bool>(params["diags2"]);
-			if (diags2) {
-				ss << " -diags2 ";
-			}
+	if (hasMuscleEntry(params, "diags2")) {
+		bool diags2 = as<bool>(params["diags2"]);
+		if (diags2) {
+			ss << " -diags2 ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "dimer")) {
-			bool dimer = as<bool>(params["dimer"]);
-			if (dimer) {
-				ss << " -dimer ";
-			}
+	if (hasMuscleEntry(params, "dimer")) {
+		bool dimer = as<bool>(params["dimer"]);
+		if (dimer) {
+			ss << " -dimer ";
 		}
+	}
 
-		/*
-		if (hasMuscleEntry(params, "group")) {
-			bool group = as<bool>(params["group"]);
-			//Rprintf("Group: %s\n", params["group"] ? "True" : "False");
-			if (group) {
-				ss << " -group ";
-			}
+	/*
+	if (hasMuscleEntry(params, "group")) {
+		bool group = as<bool>(params["group"]);
+		//Rprintf("Group: %s\n", params["group"] ? "True" : "False");
+		if (group) {
+			ss << " -group ";
 		}
-		*/
+	}
+	*/
 
-		if (hasMuscleEntry(params, "le")) {
-			bool le = as<bool>(params["le"]);
-			if (le) {
-				ss << " -le ";
-			}
+	if (hasMuscleEntry(params, "le")) {
+		bool le = as<bool>(params["le"]);
+		if (le) {
+			ss << " -le ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "noanchors")) {
-			bool noanchors = as<bool>(params["noanchors"]);
-			if (noanchors) {
-				ss << " -noanchors ";
-			}
+	if (hasMuscleEntry(params, "noanchors")) {
+		bool noanchors = as<bool>(params["noanchors"]);
+		if (noanchors) {
+			ss << " -noanchors ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "nocore")) {
-			bool nocore = as<bool>(params["nocore"]);
-			if (nocore) {
-				ss << " -nocore ";
-			}
+	if (hasMuscleEntry(params, "nocore")) {
+		bool nocore = as<bool>(params["nocore"]);
+		if (nocore) {
+			ss << " -nocore ";
 		}
+	}
 
         if (hasMuscleEntry(params, "profile")) {
             bool profile = as<bool>(params["profile"]);
@@ -357,97 +347,142 @@ SEXP RMuscle(SEXP rInputSeqs,
             }
         }
 
-		if (hasMuscleEntry(params, "refinew")) {
-			bool refinew = as<bool>(params["refinew"]);
-			if (refinew) {
-				ss << " -refinew ";
-			}
+	if (hasMuscleEntry(params, "refinew")) {
+		bool refinew = as<bool>(params["refinew"]);
+		if (refinew) {
+			ss << " -refinew ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "sp")) {
-			bool sp = as<bool>(params["sp"]);
-			if (sp) {
-				ss << " -sp ";
-			}
+	if (hasMuscleEntry(params, "sp")) {
+		bool sp = as<bool>(params["sp"]);
+		if (sp) {
+			ss << " -sp ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "spn")) {
-			bool spn = as<bool>(params["spn"]);
-			if (spn) {
-				ss << " -spn ";
-			}
+	if (hasMuscleEntry(params, "spn")) {
+		bool spn = as<bool>(params["spn"]);
+		if (spn) {
+			ss << " -spn ";
 		}
+	}
 
-		if (hasMuscleEntry(params, "spscore")) {
-			bool spscore = as<bool>(params["spscore"]);
-			if (spscore) {
-				ss << " -spscore ";
-			}
+	if (hasMuscleEntry(params, "spscore")) {
+		bool spscore = as<bool>(params["spscore"]);
+		if (spscore) {
+			ss << " -spscore ";
 		}
+	}
 
-		/*
-		if (hasMuscleEntry(params, "stable")) {
-			bool stable = as<bool>(params["stable"]);
-			//Rprintf("Stable: %s\n", params["stable"] ? "True" : "False");
-			if (stable) {
-				ss << " -stable ";
-			}
-		}*/
+	/*
+	if (hasMuscleEntry(params, "stable")) {
+		bool stable = as<bool>(params["stable"]);
+		//Rprintf("Stable: %s\n", params["stable"] ? "True" : "False");
+		if (stable) {
+			ss << " -stable ";
+		}
+	}*/
 
-		if (hasMuscleEntry(params, "sv")) {
-			bool sv = as<bool>(params["sv"]);
-			if (sv) {
-				ss << " -sv ";
-			}
+	if (hasMuscleEntry(params, "sv")) {
+		bool sv = as<bool>(params["sv"]);
+		if (sv) {
+			ss << " -sv ";
 		}
+	}
 
-		/*
-		if (hasMuscleEntry(params, "termgaps4")) {
-			bool termgaps4 = as<bool>(params["termgaps4"]);
-			//Rprintf("Termgaps4: %s\n", params["termgaps4"] ? "True" : "False");
-			if (termgaps4) {
-				ss << " -termgaps4 ";
-			}
-		}*/
-
-		/*
-		if (hasMuscleEntry(params, "termgapsfull")) {
-			bool termgapsfull = as<bool>(params["termgapsfull"]);
-			//Rprintf("Termgapsfull: %s\n", params["termgapsfull"] ? "True" : "False");
-			if (termgapsfull) {
-				ss << " -termgapsfull ";
-			}
-		}*/
+	/*
+	if (hasMuscleEntry(params, "termgaps4")) {
+		bool termgaps4 = as<bool>(params["termgaps4"]);
+		//Rprintf("Termgaps4: %s\n", params["termgaps4"] ? "True" : "False");
+		if (termgaps4) {
+			ss << " -termgaps4 ";
+		}
+	}*/
 
+	/*
+	if (hasMuscleEntry(params, "termgapsfull")) {
+		bool termgapsfull = as<bool>(params["termgapsfull"]);
+		//Rprintf("Termgapsfull: %s\n", params["termgapsfull"] ? "True" : "False");
+		if (termgapsfull) {
+			ss << " -termgapsfull ";
+		}
+	}*/
 
-		/*
-		if (hasMuscleEntry(params, "termgapshalf")) {
-			bool termgapshalf = as<bool>(params["termgapshalf"]);
-			Rprintf("Termgapshalf: %s\n", params["termgapshalf"] ? "True" : "False");
-			if (termgapshalf) {
-				ss << " -termgapshalf ";
-			}
-		}*/
 
+	/*
+	if (hasMuscleEntry(params, "termgapshalf")) {
+		bool termgapshalf = as<bool>(params["termgapshalf"]);
+		Rprintf("Termgapshalf: %s\n", params["termgapshalf"] ? "True" : "False");
+		if (termgapshalf) {
+			ss << " -termgapshalf ";
+		}
+	}*/
 
-		/*
-		if (hasMuscleEntry(params, "termgapshalflonger")) {
-			bool termgapshalflonger = as<bool>(params["termgapshalflonger"]);
-			//Rprintf("Termgapshalflonger: %s\n", params["termgapshalflonger"] ? "True" : "False");
-			if (termgapshalflonger) {
-				ss << " -termgapshalflonger ";
-			}
-		}*/
 
-		if (hasMuscleEntry(params, "version")) {
-			bool version = as<bool>(params["version"]);
-			if (version) {
-				ss << " -version ";
-			}
+	/*
+	if (hasMuscleEntry(params, "termgapshalflonger")) {
+		bool termgapshalflonger = as<bool>(params["termgapshalflonger"]);
+		//Rprintf("Termgapshalflonger: %s\n", params["termgapshalflonger"] ? "True" : "False");
+		if (termgapshalflonger) {
+			ss << " -termgapshalflonger ";
+		}
+	}*/
+
+	if (hasMuscleEntry(params, "version")) {
+		bool version = as<bool>(params["version"]);
+		if (version) {
+			ss << " -version ";
 		}
+	}
+
+	//static params
+	ss << " -clwstrict ";
 
-		//static params
-		ss << " -clwstrict ";
+	return verbose;
+}
+
+SEXP RMuscle(SEXP rInputSeqs,
+             SEXP rCluster,
+             SEXP rGapOpening,
+             SEXP rGapExtension,
+             SEXP rMaxiters,
+             SEXP rSubstitutionMatrix,
+             SEXP rType,
+             SEXP rVerbose,
+             SEXP rParams) {
+
+	Rcpp::List retList;
+	try {
+		Rcpp::List params(rParams); // Get parameters in params.
+
+		bool inputFlag = false;
+		if (hasMuscleEntry(params, "inputSeqIsFileFlag")) {
+			inputFlag = as<bool>(params["inputSeqIsFileFlag"]);
+		}
+
+		stringstream ss;
+		MuscleInput input;
+
+		if (inputFlag) {
+			string inputFile = as<string>(rInputSeqs);
+			ss << "-in " << inputFile;
+		} else {
+			ss << "-in noFile";
+			readMuscleSeqs(rInputSeqs, input.inputSeqs);
+		}
+
+		readMuscleSubstitutionMatrix(rSubstitutionMatrix, input);
+
+		bool verbose = appendMuscleArgs(ss, rCluster, rGapOpening, rGapExtension,
+		                                rMaxiters, rType, rVerbose, params);
+
+		//threads (not part of appendMuscleArgs: in RMuscleBatch,
+		//"threads" is the number of sets aligned at the same time)
+		if (hasMuscleEntry(params, "threads")) {
+			int threads = as<int>(params["threads"]);
+			ss << " -threads " << threads;
+		}
 
 		string s = ss.str();
 		if (verbose) {
@@ -464,38 +499,173 @@ SEXP RMuscle(SEXP rInputSeqs,
 		//#endif
 
 		SetNewHandler();
-		SetStartTime();
-		ProcessArgStr(s.c_str());
-		SetParams();
-		SetLogFile();
 
-		if (g_bVersion) {
-			printf("%s\n", MUSCLE_LONG_VERSION);
+		MuscleOutput output;
+		MuscleContext context(s);
+		context.Run(&input, &output);
+
+		//CleanupNewHandler(); //valgrind
+
+		retList = AlnRowsToR(&output.msa);
+
+	} catch(int i) {
+		if (i == 0) {
+			//Rprintf("MUSCLE finished successfully");
+		} else {
+			Rf_error("MUSCLE finished with errors");
+		}
+	} catch( std::exception &ex ) {
+		forward_exception_to_r(ex);
+	} catch(...) {
+		Rf_error("MUSCLE finished by an unknown reason");
+	}
+	return retList;
+}
+
+SEXP RMuscleBatch(SEXP rInputSeqsList,
+                  SEXP rCluster,
+                  SEXP rGapOpening,
+                  SEXP rGapExtension,
+                  SEXP rMaxiters,
+                  SEXP rSubstitutionMatrix,
+                  SEXP rType,
+                  SEXP rVerbose,
+                  SEXP rParams) {
+
+	Rcpp::List retList;
+	int failedSet = 0;
+	try {
+		Rcpp::List params(rParams); // Get parameters in params.
+		Rcpp::List inputSeqsList(rInputSeqsList);
+		int n = inputSeqsList.size();
+
+		int threads = 1;
+		if (hasMuscleEntry(params, "threads")) {
+			threads = as<int>(params["threads"]);
 		}
 
-		if (!g_bQuiet)
-			Credits();
-	
-		if (MissingCommand() && isatty(0)) {
-			Usage();
+		stringstream ss;
+		ss << "-in noFile";
+
+		bool verbose = appendMuscleArgs(ss, rCluster, rGapOpening, rGapExtension,
+		                                rMaxiters, rType, rVerbose, params);
+
+		string s = ss.str();
+		if (verbose) {
+			Rprintf("params: %s\n", s.c_str());
 		}
 
-		MuscleOutput output;
-	
-		if (g_bCatchExceptions) {
-			try	{
-				Run(&input, &output);
-			} catch (...) {
-				OnException();
+		//all R objects are read here, the workers only see MuscleInput
+		vector<MuscleInput> inputs(n);
+		vector<MuscleOutput> outputs(n);
+		for (int i = 0; i < n; i++) {
+			readMuscleSeqs(inputSeqsList[i], inputs[i].inputSeqs);
+			readMuscleSubstitutionMatrix(rSubstitutionMatrix, inputs[i]);
+		}
+
+		SetNewHandler();
+
+		//every worker takes the next sequence set and aligns it in a
+		//MuscleContext of its own
+		vector<exception_ptr> errors(n);
+		atomic<int> next(0);
+		auto worker = [&]() {
+			for (int i = next++; i < n; i = next++) {
+				try {
+					MuscleContext context(s);
+					context.Run(&inputs[i], &outputs[i]);
+				} catch (...) {
+					errors[i] = current_exception();
+				}
+			}
+		};
+
+		vector<thread> pool;
+		try {
+			for (int t = 1; t < threads && t < n; t++) {
+				pool.push_back(thread(worker));
+			}
+		} catch (...) {
+			//continue with the workers started so far
+		}
+		worker();
+		for (size_t t = 0; t < pool.size(); t++) {
+			pool[t].join();
+		}
+
+		for (int i = 0; i < n; i++) {
+			if (errors[i]) {
+				failedSet = i + 1;
+				rethrow_exception(errors[i]);
 			}
+		}
+
+		retList = Rcpp::List(n);
+		for (int i = 0; i < n; i++) {
+			retList[i] = AlnRowsToR(&outputs[i].msa);
+			AlnRowsFree(&outputs[i].msa);
+		}
+
+	} catch(int i) {
+		if (i == 0) {
+			//Rprintf("MUSCLE finished successfully");
 		} else {
-			Run(&input, &output);
+			Rf_error("MUSCLE finished with errors (sequence set %d)", failedSet);
 		}
+	} catch( std::exception &ex ) {
+		forward_exception_to_r(ex);
+	} catch(...) {
+		Rf_error("MUSCLE finished by an unknown reason");
+	}
+	return retList;
+}
 
-		//CleanupNewHandler(); //valgrind
-		delete(seq);
+SEXP RMuscleAddSeqs(SEXP rProfileSeqs,
+                    SEXP rInputSeqs,
+                    SEXP rGapOpening,
+                    SEXP rGapExtension,
+                    SEXP rSubstitutionMatrix,
+                    SEXP rType,
+                    SEXP rVerbose,
+                    SEXP rParams) {
+
+	Rcpp::List retList;
+	try {
+		Rcpp::List params(rParams); // Get parameters in params.
+
+		stringstream ss;
+		MuscleInput input;
+
+		ss << "-in noFile";
+		readMuscleSeqs(rProfileSeqs, input.profileSeqs);
+		readMuscleSeqs(rInputSeqs, input.inputSeqs);
+
+		readMuscleSubstitutionMatrix(rSubstitutionMatrix, input);
+
+		bool verbose = appendMuscleArgs(ss, R_NilValue, rGapOpening,
+		                                rGapExtension, R_NilValue, rType,
+		                                rVerbose, params);
+
+		ss << " -profdb";
+
+		//threads: number of new sequences aligned to the profile at once
+		if (hasMuscleEntry(params, "threads")) {
+			int threads = as<int>(params["threads"]);
+			ss << " -threads " << threads;
+		}
+
+		string s = ss.str();
+		if (verbose) {
+			Rprintf("params: %s\n", s.c_str());
+		}
+
+		SetNewHandler();
+
+		MuscleOutput output;
+		MuscleContext context(s);
+		context.Run(&input, &output);
 
-		retList = Rcpp::List::create(Rcpp::Named("msa") = Rcpp::CharacterVector(output.msa.begin(), output.msa.end()));
+		retList = AlnRowsToR(&output.msa);
 
 	} catch(int i) {
 		if (i == 0) {
@@ -27,8 +27,40 @@ RcppExport SEXP RMuscle(SEXP rInputSeq,
                         SEXP rVerbose,
                         SEXP rParams);
 
+/*
+ * Aligns every sequence set of the list rInputSeqsList with the same
+ * parameters. The sets are distributed over params$threads workers,
+ * each of which runs its alignments in a MuscleContext of its own.
+ */
+RcppExport SEXP RMuscleBatch(SEXP rInputSeqsList,
+                             SEXP rCluster,
+                             SEXP rGapOpening,
+                             SEXP rGapExtension,
+                             SEXP rMaxiters,
+                             SEXP rSubstitutionMatrix,
+                             SEXP rType,
+                             SEXP rVerbose,
+                             SEXP rParams);
+
+/*
+ * Aligns the sequences rInputSeqs to the fixed alignment rProfileSeqs
+ * (the rows of a reference alignment) and returns the reference
+ * alignment with the new sequences added. The new sequences are
+ * aligned to the profile of the reference independently of each
+ * other, using params$threads threads.
+ */
+RcppExport SEXP RMuscleAddSeqs(SEXP rProfileSeqs,
+                               SEXP rInputSeqs,
+                               SEXP rGapOpening,
+                               SEXP rGapExtension,
+                               SEXP rSubstitutionMatrix,
+                               SEXP rType,
+                               SEXP rVerbose,
+                               SEXP rParams);
+
 struct MuscleInput {
     SeqVect inputSeqs;
+    SeqVect profileSeqs; //rows of the reference alignment (-profdb)
     std::vector<std::string> seqNames;
     std::vector<std::string> colNames;
     bool hasSubstitutionMatrix;
@@ -36,10 +68,18 @@ struct MuscleInput {
 };
 
 struct MuscleOutput { //can be used for further result objects
-    std::vector<std::string> msa; //multiple sequence alignment
+    aln_rows_t msa; //multiple sequence alignment
+
+    MuscleOutput() { AlnRowsInit(&msa); }
+    ~MuscleOutput() { AlnRowsFree(&msa); }
+    MuscleOutput(const MuscleOutput &) = delete;
+    MuscleOutput &operator=(const MuscleOutput &) = delete;
 };
 
+void SetMuscleAlphaAndMatrix(MuscleInput *msaInput);
 void DoMuscle(MuscleInput *msaInput, MuscleOutput *msaOutput);
+void AddSeqsToProfile(MuscleInput *msaInput, MuscleOutput *msaOutput);
+void DoRefineW(MuscleInput *msaInput, MuscleOutput *msaOutput);
 void Run(MuscleInput *msaInput, MuscleOutput *msaOutput);
 
 #endif
@@ -91,83 +91,26 @@ void MSA::ToAlnFile(TextFile &File) const
 		}
 	}
 
-vector<string> MSA::ToAlnFile() const
+// The rows of the alignment for R (see AlignedRows.h), in upper case
+// and named by the first word of the sequence names, like the ids of
+// an aln file.
+void MSA::ToAlnRows(aln_rows_t *Rows) const
 	{
+	const unsigned uSeqCount = GetSeqCount();
+	const unsigned uColCount = GetColCount();
 
-	string line = "";
-	vector<string> result;
-	line = string(MUSCLE_LONG_VERSION) + string(" ");
-	result.push_back(line);
-	line = "";
-	result.push_back("");
+	if (0 != AlnRowsAlloc(Rows, uSeqCount, uColCount))
+		Quit("Out of memory");
+	AlnRowsSetVersion(Rows, (string(MUSCLE_LONG_VERSION) + string(" ")).c_str());
 
-	result.push_back("");
-
-	int iLongestNameLength = 0;
-	for (unsigned uSeqIndex = 0; uSeqIndex < GetSeqCount(); ++uSeqIndex)
-		{
-		const char *ptrName = GetSeqName(uSeqIndex);
-		const char *ptrBlank = strchr(ptrName, ' ');
-		int iLength;
-		if (0 != ptrBlank)
-			iLength = (int) (ptrBlank - ptrName);
-		else
-			iLength = (int) strlen(ptrName);
-		if (iLength > iLongestNameLength)
-			iLongestNameLength = iLength;
-		}
-	if (iLongestNameLength > MAX_NAME)
-		iLongestNameLength = MAX_NAME;
-	if (iLongestNameLength < MIN_NAME)
-		iLongestNameLength = MIN_NAME;
-
-	unsigned uLineCount = (GetColCount() - 1)/uCharsPerLine + 1;
-	for (unsigned uLineIndex = 0; uLineIndex < uLineCount; ++uLineIndex)
+	for (unsigned uSeqIndex = 0; uSeqIndex < uSeqCount; ++uSeqIndex)
 		{
-		result.push_back("");
-		unsigned uStartColIndex = uLineIndex*uCharsPerLine;
-		unsigned uEndColIndex = uStartColIndex + uCharsPerLine - 1;
-		if (uEndColIndex >= GetColCount())
-			uEndColIndex = GetColCount() - 1;
-		char Name[MAX_NAME+1];
-		for (unsigned uSeqIndex = 0; uSeqIndex < GetSeqCount(); ++uSeqIndex)
-			{
-			const char *ptrName = GetSeqName(uSeqIndex);
-			const char *ptrBlank = strchr(ptrName, ' ');
-			int iLength;
-			if (0 != ptrBlank)
-				iLength = (int) (ptrBlank - ptrName);
-			else
-				iLength = (int) strlen(ptrName);
-			if (iLength > MAX_NAME)
-				iLength = MAX_NAME;
-			memset(Name, ' ', MAX_NAME);
-			memcpy(Name, ptrName, iLength);
-			Name[iLongestNameLength] = 0;
-
-			line = string(Name) + string("      ");
-			for (unsigned uColIndex = uStartColIndex; uColIndex <= uEndColIndex;
-			  ++uColIndex)
-				{
-				const char c = GetChar(uSeqIndex, uColIndex);
-			    line.append(1, toupper(c));
-				}
-			result.push_back(line);
-			}
-
-		memset(Name, ' ', MAX_NAME);
-		Name[iLongestNameLength] = 0;
-
-		line = string(Name) + string("      ");
-		for (unsigned uColIndex = uStartColIndex; uColIndex <= uEndColIndex;
-		  ++uColIndex)
-			{
-			const char c = GetAlnConsensusChar(*this, uColIndex);
-			line.append(1, c);
-			}
-		result.push_back(line);
+		char *ptrRow = AlnRowsRow(Rows, uSeqIndex);
+		for (unsigned uColIndex = 0; uColIndex < uColCount; ++uColIndex)
+			ptrRow[uColIndex] = toupper(GetChar(uSeqIndex, uColIndex));
+		if (0 != AlnRowsSetName(Rows, uSeqIndex, GetSeqName(uSeqIndex)))
+			Quit("Out of memory");
 		}
-	return result;
 	}
 
 static char GetAlnConsensusChar(const MSA &a, unsigned uColIndex)
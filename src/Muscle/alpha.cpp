@@ -29,20 +29,20 @@ IUPAC-IUB SYMBOLS FOR NUCLEOTIDE NOMENCLATURE:
          Cornish-Bowden (1985) Nucl. Acids Res. 13: 3021-3030.
 ***/
 
-unsigned g_CharToLetter[MAX_CHAR];
-unsigned g_CharToLetterEx[MAX_CHAR];
+MUSCLE_TLS unsigned g_CharToLetter[MAX_CHAR];
+MUSCLE_TLS unsigned g_CharToLetterEx[MAX_CHAR];
 
-char g_LetterToChar[MAX_ALPHA];
-char g_LetterExToChar[MAX_ALPHA_EX];
+MUSCLE_TLS char g_LetterToChar[MAX_ALPHA];
+MUSCLE_TLS char g_LetterExToChar[MAX_ALPHA_EX];
 
-char g_UnalignChar[MAX_CHAR];
-char g_AlignChar[MAX_CHAR];
+MUSCLE_TLS char g_UnalignChar[MAX_CHAR];
+MUSCLE_TLS char g_AlignChar[MAX_CHAR];
 
-bool g_IsWildcardChar[MAX_CHAR];
-bool g_IsResidueChar[MAX_CHAR];
+MUSCLE_TLS bool g_IsWildcardChar[MAX_CHAR];
+MUSCLE_TLS bool g_IsResidueChar[MAX_CHAR];
 
-ALPHA g_Alpha = ALPHA_Undefined;
-unsigned g_AlphaSize = 0;
+MUSCLE_TLS ALPHA g_Alpha = ALPHA_Undefined;
+MUSCLE_TLS unsigned g_AlphaSize = 0;
 
 #define Res(c, Letter)												\
 	{																\
@@ -250,8 +250,8 @@ bool IsRNA(char c)
 	return strchr("AGCUNagcun", c) != 0;
 	}
 
-static char InvalidLetters[256];
-static int InvalidLetterCount = 0;
+static MUSCLE_TLS char InvalidLetters[256];
+static MUSCLE_TLS int InvalidLetterCount = 0;
 
 void ClearInvalidLetterWarning()
 	{
@@ -7,17 +7,17 @@ void ClearInvalidLetterWarning();
 void InvalidLetterWarning(char c, char w);
 void ReportInvalidLetters();
 
-extern unsigned g_CharToLetter[];
-extern unsigned g_CharToLetterEx[];
+extern MUSCLE_TLS unsigned g_CharToLetter[];
+extern MUSCLE_TLS unsigned g_CharToLetterEx[];
 
-extern char g_LetterToChar[];
-extern char g_LetterExToChar[];
+extern MUSCLE_TLS char g_LetterToChar[];
+extern MUSCLE_TLS char g_LetterExToChar[];
 
-extern char g_UnalignChar[];
-extern char g_AlignChar[];
+extern MUSCLE_TLS char g_UnalignChar[];
+extern MUSCLE_TLS char g_AlignChar[];
 
-extern bool g_IsWildcardChar[];
-extern bool g_IsResidueChar[];
+extern MUSCLE_TLS bool g_IsWildcardChar[];
+extern MUSCLE_TLS bool g_IsResidueChar[];
 
 #define CharToLetter(c)		(g_CharToLetter[(unsigned char) (c)])
 #define CharToLetterEx(c)	(g_CharToLetterEx[(unsigned char) (c)])
@@ -94,8 +94,8 @@ const unsigned MAX_ALPHA = 20;
 const unsigned MAX_ALPHA_EX = AX_COUNT;
 const unsigned MAX_CHAR = 256;
 
-extern ALPHA g_Alpha;
-extern unsigned g_AlphaSize;
+extern MUSCLE_TLS ALPHA g_Alpha;
+extern MUSCLE_TLS unsigned g_AlphaSize;
 
 void SetAlpha(ALPHA Alpha);
 char GetWildcardChar();
@@ -118,8 +118,8 @@ SCORE DiffObjScore(
 #endif
 
 #if	COMPARE_3_52
-	extern SCORE g_SPScoreLetters;
-	extern SCORE g_SPScoreGaps;
+	extern MUSCLE_TLS SCORE g_SPScoreLetters;
+	extern MUSCLE_TLS SCORE g_SPScoreGaps;
 	SCORE SP1 = ObjScoreSP(msa1);
 	SCORE SPLetters1 = g_SPScoreLetters;
 	SCORE SPGaps1 = g_SPScoreGaps;
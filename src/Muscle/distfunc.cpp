@@ -4,7 +4,7 @@
 
 DistFunc::DistFunc()
 	{
-	m_Dists = 0;
+	memset(&m_Dists, 0, sizeof(m_Dists));
 	m_uCount = 0;
 	m_uCacheCount = 0;
 	m_Names = 0;
@@ -18,14 +18,15 @@ DistFunc::~DistFunc()
 		for (unsigned i = 0; i < m_uCount; ++i)
 			free(m_Names[i]);
 		}
-	delete[] m_Dists;
+	PdmFree(&m_Dists);
 	delete[] m_Names;
 	delete[] m_Ids;
 	}
 
 float DistFunc::GetDist(unsigned uIndex1, unsigned uIndex2) const
 	{
-	return m_Dists[VectorIndex(uIndex1, uIndex2)];
+	assert(uIndex1 < m_uCount && uIndex2 < m_uCount);
+	return (float) PdmGet(&m_Dists, uIndex1, uIndex2);
 	}
 
 unsigned DistFunc::GetCount() const
@@ -38,32 +39,22 @@ void DistFunc::SetCount(unsigned uCount)
 	m_uCount = uCount;
 	if (uCount <= m_uCacheCount)
 		return;
-	delete[] m_Dists;
-	m_Dists = new float[VectorLength()];
+// Triangle incl. diagonal, zeroed
+	PdmFree(&m_Dists);
+	if (0 != PdmNew(&m_Dists, m_uCount, m_uCount, PDM_FLOAT))
+		Quit("DistFunc::SetCount, out of memory (%u seqs)", m_uCount);
 	m_Names = new char *[m_uCount];
 	m_Ids = new unsigned[m_uCount];
 	m_uCacheCount = uCount;
 
 	memset(m_Names, 0, m_uCount*sizeof(char *));
 	memset(m_Ids, 0xff, m_uCount*sizeof(unsigned));
-	memset(m_Dists, 0, VectorLength()*sizeof(float));
 	}
 
 void DistFunc::SetDist(unsigned uIndex1, unsigned uIndex2, float dDist)
-	{
-	m_Dists[VectorIndex(uIndex1, uIndex2)] = dDist;
-	m_Dists[VectorIndex(uIndex2, uIndex1)] = dDist;
-	}
-
-unsigned DistFunc::VectorIndex(unsigned uIndex1, unsigned uIndex2) const
 	{
 	assert(uIndex1 < m_uCount && uIndex2 < m_uCount);
-	return uIndex1*m_uCount + uIndex2;
-	}
-
-unsigned DistFunc::VectorLength() const
-	{
-	return m_uCount*m_uCount;
+	PdmSet(&m_Dists, uIndex1, uIndex2, dDist);
 	}
 
 void DistFunc::SetName(unsigned uIndex, const char szName[])
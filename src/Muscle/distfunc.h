@@ -1,6 +1,8 @@
 #ifndef DistFunc_h
 #define DistFunc_h
 
+#include "../PackedDistMatrix.h"
+
 class DistFunc
 	{
 public:
@@ -21,14 +23,10 @@ public:
 
 	void LogMe() const;
 
-protected:
-	unsigned VectorIndex(unsigned uIndex, unsigned uIndex2) const;
-	unsigned VectorLength() const;
-
 private:
 	unsigned m_uCount;
 	unsigned m_uCacheCount;
-	float *m_Dists;
+	pdm_t m_Dists;
 	char **m_Names;
 	unsigned *m_Ids;
 	};
@@ -19,24 +19,10 @@ static char g_strUseTreeWarning[] =
 "please refer to the user guide. To disable this\n"
 "warning, use -usetree_nowarn <treefilename>.\n\n";
 
-void DoMuscle(MuscleInput *msaInput, MuscleOutput *msaOutput)
+// Alphabet from -seqtype (or guessed from the input sequences) and
+// substitution matrix from -matrix or from R.
+void SetMuscleAlphaAndMatrix(MuscleInput *msaInput)
 	{
-	SetOutputFileName(g_pstrOutFileName);
-	SetInputFileName(g_pstrInFileName);
-
-	SetMaxIters(g_uMaxIters);
-	SetSeqWeightMethod(g_SeqWeight1);
-
-	if (msaInput->inputSeqs.Length() == 0) {
-		TextFile fileIn(g_pstrInFileName);
-		msaInput->inputSeqs.FromFASTAFile(fileIn);
-	}
-
-	const unsigned uSeqCount = msaInput->inputSeqs.Length();
-
-	if (0 == uSeqCount)
-		Quit("No sequences in input file");
-
 	ALPHA Alpha = ALPHA_Undefined;
 	switch (g_SeqType)
 		{
@@ -88,6 +74,25 @@ void DoMuscle(MuscleInput *msaInput, MuscleOutput *msaOutput)
 
 	if (0 != UserMatrix)
 		g_ptrScoreMatrix = UserMatrix;
+	}
+
+void DoMuscle(MuscleInput *msaInput, MuscleOutput *msaOutput)
+	{
+	SetOutputFileName(g_pstrOutFileName);
+	SetInputFileName(g_pstrInFileName);
+
+	SetMaxIters(g_uMaxIters);
+	SetSeqWeightMethod(g_SeqWeight1);
+
+	if (msaInput->inputSeqs.Length() == 0)
+		msaInput->inputSeqs.FromFASTAFile(g_pstrInFileName);
+
+	const unsigned uSeqCount = msaInput->inputSeqs.Length();
+
+	if (0 == uSeqCount)
+		Quit("No sequences in input file");
+
+	SetMuscleAlphaAndMatrix(msaInput);
 
 	unsigned uMaxL = 0;
 	unsigned uTotL = 0;
@@ -200,7 +205,7 @@ void DoMuscle(MuscleInput *msaInput, MuscleOutput *msaOutput)
 		//TextFile fileOut(g_pstrOutFileName, true);
 		//MHackEnd(msa);
 		//msa.ToFile(fileOut);
-		msaOutput->msa = DoMuscleOutput(msa);
+		DoMuscleOutput(msa, &msaOutput->msa);
 		GuideTree.Clear();
 		return;
 		}
@@ -247,7 +252,7 @@ void DoMuscle(MuscleInput *msaInput, MuscleOutput *msaOutput)
 	//TextFile fileOut(g_pstrOutFileName, true);
 	//MHackEnd(msa);
 	//msa.ToFile(fileOut);
-	msaOutput->msa = DoMuscleOutput(msa);
+	DoMuscleOutput(msa, &msaOutput->msa);
 
 	//GuideTree = 0;
 	extern void DeleteProgNode(ProgNode &Node);
@@ -275,12 +280,14 @@ void Run(MuscleInput *msaInput, MuscleOutput *msaOutput)
 	if (g_bRefine)
 		Refine();
 	else if (g_bRefineW)
+		DoRefineW(msaInput, msaOutput);
+	else if (g_bProfDB)
 		{
-		extern void DoRefineW();
-		DoRefineW();
+		if (msaInput->profileSeqs.Length() > 0)
+			AddSeqsToProfile(msaInput, msaOutput);
+		else
+			ProfDB();
 		}
-	else if (g_bProfDB)
-		ProfDB();
 	else if (g_bSW)
 		Local();
 	else if (0 != g_pstrSPFileName)
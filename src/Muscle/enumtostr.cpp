@@ -1,7 +1,7 @@
 #include "muscle.h"
 #include <stdio.h>
 
-static char szMsg[64];
+static MUSCLE_TLS char szMsg[64];
 
 // Define XXXToStr(XXX x) functions for each enum type XXX.
 #define s(t)	const char *t##ToStr(t x) { switch (x) { case t##_Undefined: return "Undefined";
@@ -10,7 +10,7 @@ struct TripleCount
 	unsigned m_uSeqCount;			// How many sequences have this triple?
 	unsigned short *m_Counts;		// m_Counts[s] = nr of times triple found in seq s
 	};
-static TripleCount *TripleCounts;
+static MUSCLE_TLS TripleCount *TripleCounts;
 
 // WARNING: Sequences MUST be stripped of gaps and upper case!
 void DistKmer20_3(const SeqVect &v, DistFunc &DF)
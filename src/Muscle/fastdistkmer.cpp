@@ -62,7 +62,7 @@ const unsigned TABLE_SIZE = N_4;
 // For debug output
 const char *KmerToStr(unsigned Kmer)
 	{
-	static char s[5];
+	static MUSCLE_TLS char s[5];
 
 	unsigned c3 = (Kmer/N_3)%N;
 	unsigned c2 = (Kmer/N_2)%N;
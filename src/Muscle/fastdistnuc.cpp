@@ -9,8 +9,8 @@
 #define MAX(x, y)	(((x) > (y)) ? (x) : (y))
 
 const unsigned TUPLE_COUNT = 6*6*6*6*6*6;
-static unsigned char Count1[TUPLE_COUNT];
-static unsigned char Count2[TUPLE_COUNT];
+static MUSCLE_TLS unsigned char Count1[TUPLE_COUNT];
+static MUSCLE_TLS unsigned char Count2[TUPLE_COUNT];
 
 // Nucleotide groups according to MAFFT (sextet5)
 // 0 =  A
@@ -6,7 +6,7 @@
 
 const unsigned KTUP = 5;
 const unsigned KTUPS = 6*6*6*6*6;
-static unsigned TuplePos[KTUPS];
+static MUSCLE_TLS unsigned TuplePos[KTUPS];
 
 static char *TupleToStr(int t)
 	{
@@ -7,7 +7,7 @@
 #define pow4(i)	(1 << (2*i))	// 4^i = 2^(2*i)
 const unsigned K = 7;
 const unsigned KTUPS = pow4(K);
-static unsigned TuplePos[KTUPS];
+static MUSCLE_TLS unsigned TuplePos[KTUPS];
 
 static char *TupleToStr(int t)
 	{
@@ -14,7 +14,7 @@ TICKS g_ticksDP = 0;
 #endif
 
 #if	1
-extern bool g_bKeepSimpleDP;
+extern MUSCLE_TLS bool g_bKeepSimpleDP;
 SCORE NWSmall(const ProfPos *PA, unsigned uLengthA, const ProfPos *PB,
   unsigned uLengthB, PWPath &Path);
 SCORE NWDASmall(const ProfPos *PA, unsigned uLengthA, const ProfPos *PB,
@@ -9,8 +9,8 @@
 #define TRACE_PATH	0
 #define LIST_DIAGS	0
 
-static double g_dDPAreaWithoutDiags = 0.0;
-static double g_dDPAreaWithDiags = 0.0;
+static MUSCLE_TLS double g_dDPAreaWithoutDiags = 0.0;
+static MUSCLE_TLS double g_dDPAreaWithDiags = 0.0;
 
 static void OffsetPath(PWPath &Path, unsigned uOffsetA, unsigned uOffsetB)
 	{
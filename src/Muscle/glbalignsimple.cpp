@@ -8,13 +8,13 @@
 
 #if	1 // SINGLE_AFFINE
 
-extern bool g_bKeepSimpleDP;
-extern SCORE *g_DPM;
-extern SCORE *g_DPD;
-extern SCORE *g_DPI;
-extern char *g_TBM;
-extern char *g_TBD;
-extern char *g_TBI;
+extern MUSCLE_TLS bool g_bKeepSimpleDP;
+extern MUSCLE_TLS SCORE *g_DPM;
+extern MUSCLE_TLS SCORE *g_DPD;
+extern MUSCLE_TLS SCORE *g_DPI;
+extern MUSCLE_TLS char *g_TBM;
+extern MUSCLE_TLS char *g_TBD;
+extern MUSCLE_TLS char *g_TBI;
 
 static const char *LocalScoreToStr(SCORE s)
 	{
@@ -22,7 +22,7 @@ struct DP_MEMORY
 	int **TraceBack;
 	};
 
-static struct DP_MEMORY DPM;
+static MUSCLE_TLS struct DP_MEMORY DPM;
 
 static void AllocDPMem(unsigned uLengthA, unsigned uLengthB)
 	{
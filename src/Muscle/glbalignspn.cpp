@@ -22,7 +22,7 @@ struct DP_MEMORY
 	int **TraceBack;
 	};
 
-static struct DP_MEMORY DPM;
+static MUSCLE_TLS struct DP_MEMORY DPM;
 
 void FreeDPMemSPN()
 	{
@@ -54,6 +54,7 @@ void FreeDPMemSPN()
 	delete[] DPM.FreqsA;
 	delete[] DPM.ScoreMxB;
 	delete[] DPM.TraceBack;
+	DPM.uLength = 0;
 	}
 
 static void AllocDPMem(unsigned uLengthA, unsigned uLengthB)
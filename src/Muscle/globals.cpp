@@ -17,10 +17,10 @@
 #define	MAX_PATH	260
 #endif
 
-static char g_strListFileName[MAX_PATH];
-static bool g_bListFileAppend = false;
+static MUSCLE_TLS char g_strListFileName[MAX_PATH];
+static MUSCLE_TLS bool g_bListFileAppend = false;
 
-static SEQWEIGHT g_SeqWeight = SEQWEIGHT_Undefined;
+static MUSCLE_TLS SEQWEIGHT g_SeqWeight = SEQWEIGHT_Undefined;
 
 void SetSeqWeightMethod(SEQWEIGHT Method)
 	{
@@ -44,7 +44,7 @@ void Log(const char szFormat[], ...)
 	if (0 == g_strListFileName[0])
 		return;
 
-	static FILE *f = NULL;
+	static MUSCLE_TLS FILE *f = NULL;
 	const char *mode;
 	if (g_bListFileAppend)
 		mode = "a";
@@ -68,11 +68,18 @@ void Log(const char szFormat[], ...)
 
 const char *GetTimeAsStr()
 	{
-	static char szStr[32];
+	static MUSCLE_TLS char szStr[32];
 	time_t t;
 	time(&t);
+#ifdef	_WIN32
+// The Windows CRT keeps these buffers per thread
 	struct tm *ptmCurrentTime = localtime(&t);
 	strcpy(szStr, asctime(ptmCurrentTime));
+#else
+	struct tm tmCurrentTime;
+	localtime_r(&t, &tmCurrentTime);
+	asctime_r(&tmCurrentTime, szStr);
+#endif
 	assert('\n' == szStr[24]);
 	szStr[24] = 0;
 	return szStr;
@@ -266,7 +273,7 @@ void Call_MY_ASSERT(const char *file, int line, bool b, const char *msg)
 	Quit("%s(%d): MY_ASSERT(%s)", file, line, msg);
 	}
 
-static size_t g_MemTotal;
+static MUSCLE_TLS size_t g_MemTotal;
 
 void MemPlus(size_t Bytes, char *Where)
 	{
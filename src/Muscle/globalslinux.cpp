@@ -41,8 +41,8 @@ const char *GetCmdLine()
 
 double GetMemUseMB()
 	{
-	static char statm[64];
-	static int PageSize;
+	static MUSCLE_TLS char statm[64];
+	static MUSCLE_TLS int PageSize;
 	if (0 == statm[0])
 		{
 		PageSize = sysconf(_SC_PAGESIZE);
@@ -60,7 +60,7 @@ double GetMemUseMB()
 
 	if (n <= 0)
 		{
-		static bool Warned = false;
+		static MUSCLE_TLS bool Warned = false;
 		if (!Warned)
 			{
 			Warned = true;
@@ -85,7 +85,7 @@ void SaveCmdLine(int argc, char *argv[])
 		}
 	}
 
-double dPeakMemUseMB = 0;
+MUSCLE_TLS double dPeakMemUseMB = 0;
 
 double GetPeakMemUseMB()
 	{
@@ -112,14 +112,14 @@ void CheckMemUse()
 double GetRAMSizeMB()
 	{
 	const double DEFAULT_RAM = 500;
-	static double RAMMB = 0;
+	static MUSCLE_TLS double RAMMB = 0;
 	if (RAMMB != 0)
 		return RAMMB;
 
 	int fd = open("/proc/meminfo", O_RDONLY);
 	if (-1 == fd)
 		{
-		static bool Warned = false;
+		static MUSCLE_TLS bool Warned = false;
 		if (!Warned)
 			{
 			Warned = true;
@@ -135,7 +135,7 @@ double GetRAMSizeMB()
 
 	if (n <= 0)
 		{
-		static bool Warned = false;
+		static MUSCLE_TLS bool Warned = false;
 		if (!Warned)
 			{
 			Warned = true;
@@ -148,7 +148,7 @@ double GetRAMSizeMB()
 	char *pMem = strstr(Buffer, "MemTotal: ");
 	if (0 == pMem)
 		{
-		static bool Warned = false;
+		static MUSCLE_TLS bool Warned = false;
 		if (!Warned)
 			{
 			Warned = true;
@@ -33,7 +33,7 @@ double g_dNAN = GetNAN();
 
 double GetRAMSize()
 	{
-	static double CACHED_RAM = 0;
+	static MUSCLE_TLS double CACHED_RAM = 0;
 	if (CACHED_RAM != 0)
 		return CACHED_RAM;
 
@@ -49,7 +49,7 @@ double GetRAMSizeMB()
 	return GetRAMSize()/1e6;
 	}
 
-static double g_uPeakMemUseBytes;
+static MUSCLE_TLS double g_uPeakMemUseBytes;
 
 double GetMaxMemUseBytes()
 	{
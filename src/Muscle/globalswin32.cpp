@@ -45,7 +45,7 @@ const char *GetCmdLine()
 	return GetCommandLine();
 	}
 
-static unsigned uPeakMemUseBytes;
+static MUSCLE_TLS unsigned uPeakMemUseBytes;
 
 double GetRAMSizeMB()
 	{
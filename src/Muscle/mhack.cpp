@@ -10,7 +10,7 @@ immediately by gaps.
 Hack this by treating terminal M like X.
 ***/
 
-static bool *M;
+static MUSCLE_TLS bool *M;
 
 void MHackStart(SeqVect &v)
 	{
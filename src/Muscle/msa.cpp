@@ -6,7 +6,7 @@
 
 const unsigned DEFAULT_SEQ_LENGTH = 500;
 
-unsigned MSA::m_uIdCount = 0;
+MUSCLE_TLS unsigned MSA::m_uIdCount = 0;
 
 MSA::MSA()
 	{
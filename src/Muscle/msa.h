@@ -29,7 +29,7 @@ public:
 	void ToFASTAFile(TextFile &File) const;
 	void ToMSFFile(TextFile &File, const char *ptrComment = 0) const;
 	void ToAlnFile(TextFile &File) const;
-	vector<string> ToAlnFile() const;
+	void ToAlnRows(aln_rows_t *Rows) const;
 	void ToHTMLFile(TextFile &File) const;
 	void ToPhySequentialFile(TextFile &File) const;
 	void ToPhyInterleavedFile(TextFile &File) const;
@@ -123,6 +123,10 @@ public:
 	  unsigned uSeqIndex2);
 
 	static void SetIdCount(unsigned uIdCount);
+	static unsigned GetIdCount()
+		{
+		return m_uIdCount;
+		}
 
 private:
 	friend void SetMSAWeightsMuscle(MSA &msa);
@@ -157,7 +161,7 @@ private:
 	char **m_szSeqs;
 	char **m_szNames;
 
-	static unsigned m_uIdCount;
+	static MUSCLE_TLS unsigned m_uIdCount;
 
 	unsigned *m_IdToSeqIndex;
 	unsigned *m_SeqIndexToId;
@@ -9,9 +9,9 @@
 // used to divide the tree. The three-way weighting
 // scheme needs to know this edge in order to compute
 // sequence weights.
-static const Tree *g_ptrMuscleTree = 0;
-unsigned g_uTreeSplitNode1 = NULL_NEIGHBOR;
-unsigned g_uTreeSplitNode2 = NULL_NEIGHBOR;
+static MUSCLE_TLS const Tree *g_ptrMuscleTree = 0;
+MUSCLE_TLS unsigned g_uTreeSplitNode1 = NULL_NEIGHBOR;
+MUSCLE_TLS unsigned g_uTreeSplitNode2 = NULL_NEIGHBOR;
 
 void MSA::GetFractionalWeightedCounts(unsigned uColIndex, bool bNormalize,
   FCOUNT fcCounts[], FCOUNT *ptrfcGapStart, FCOUNT *ptrfcGapEnd,
@@ -383,8 +383,8 @@ void SetMSAWeightsMuscle(MSA &msa)
 	Quit("SetMSAWeightsMuscle, Invalid method=%d", Method);
 	}
 
-static WEIGHT *g_MuscleWeights;
-static unsigned g_uMuscleIdCount;
+static MUSCLE_TLS WEIGHT *g_MuscleWeights;
+static MUSCLE_TLS unsigned g_uMuscleIdCount;
 
 WEIGHT GetMuscleSeqWeightById(unsigned uId)
 	{
@@ -412,6 +412,19 @@ void SetMuscleTree(const Tree &tree)
 	CalcClustalWWeights(tree, g_MuscleWeights);
 	}
 
+const Tree *GetMuscleTree()
+	{
+	return g_ptrMuscleTree;
+	}
+
+void FreeMuscleWeights()
+	{
+	delete[] g_MuscleWeights;
+	g_MuscleWeights = 0;
+	g_uMuscleIdCount = 0;
+	g_ptrMuscleTree = 0;
+	}
+
 void SetClustalWWeightsMuscle(MSA &msa)
 	{
 	if (0 == g_MuscleWeights)
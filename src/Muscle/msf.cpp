@@ -13,7 +13,7 @@ const unsigned uCharsPerBlock = 10;
 // first, then pad with blanks up to PadLength.
 static const char *GetPaddedName(const char *Name, int PadLength)
 	{
-	static char PaddedName[MAX_NAME+1];
+	static MUSCLE_TLS char PaddedName[MAX_NAME+1];
 	memset(PaddedName, ' ', MAX_NAME);
 	size_t n = strcspn(Name, " \t");
 	memcpy(PaddedName, Name, n);
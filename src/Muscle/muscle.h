@@ -34,10 +34,16 @@ extern const char *MUSCLE_LONG_VERSION;
 #define SINGLE_AFFINE	1
 #define PAF				0
 
+// Per-alignment state (parameters, options, DP scratch buffers, alphabet
+// tables...) is thread-local so that independent alignments can run
+// concurrently in one process, see MuscleContext.
+#define MUSCLE_TLS	thread_local
+
 #include "types.h"
 #include "intmath.h"
 #include "alpha.h"
 #include "params.h"
+#include "../AlignedRows.h"
 
 #ifndef _WIN32
 #define stricmp strcasecmp
@@ -61,8 +67,8 @@ extern char **g_argv;
 
 const double VERY_LARGE_DOUBLE = 1e20;
 
-extern unsigned g_uTreeSplitNode1;
-extern unsigned g_uTreeSplitNode2;
+extern MUSCLE_TLS unsigned g_uTreeSplitNode1;
+extern MUSCLE_TLS unsigned g_uTreeSplitNode2;
 
 // Number of elements in array a[]
 #define countof(a)	(sizeof(a)/sizeof(a[0]))
@@ -329,7 +335,7 @@ void MHackEnd(MSA &msa);
 void WriteScoreFile(const MSA &msa);
 char ConsensusChar(const ProfPos &PP);
 void Stabilize(const MSA &msa, MSA &msaStable);
-std::vector<std::string> DoMuscleOutput(MSA &msa);
+void DoMuscleOutput(MSA &msa, aln_rows_t *Rows = 0);
 PTR_SCOREMATRIX ReadMx(TextFile &File);
 PTR_SCOREMATRIX ReadMxFromR(std::vector<std::string> colnames, float matrix[32][32]);
 void MemPlus(size_t Bytes, char *Where);
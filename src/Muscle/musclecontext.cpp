@@ -0,0 +1,86 @@
+#include "RMuscle.h"
+#include "musclecontext.h"
+#include "musclethreads.h"
+#ifdef	WIN32
+#include <io.h>			// for isatty()
+#else
+#include <unistd.h>		// for isatty()
+#endif
+
+MuscleContext::MuscleContext(const std::string &strArgs)
+	{
+	m_strArgs = strArgs;
+	}
+
+MuscleContext::~MuscleContext()
+	{
+	if (m_Thread.joinable())
+		m_Thread.join();
+	}
+
+void MuscleContext::ThreadBody(MuscleInput *ptrInput, MuscleOutput *ptrOutput)
+	{
+	try
+		{
+		SetStartTime();
+		ProcessArgStr(m_strArgs.c_str());
+		SetParams();
+		SetLogFile();
+
+		if (g_bVersion)
+			printf("%s\n", MUSCLE_LONG_VERSION);
+
+		if (!g_bQuiet)
+			Credits();
+
+		if (MissingCommand() && isatty(0))
+			Usage();
+
+		if (g_bCatchExceptions)
+			{
+			try
+				{
+				::Run(ptrInput, ptrOutput);
+				}
+			catch (...)
+				{
+				OnException();
+				}
+			}
+		else
+			::Run(ptrInput, ptrOutput);
+		}
+	catch (...)
+		{
+		m_Exception = std::current_exception();
+		}
+	FreeMuscleThreadMem();
+	}
+
+void MuscleContext::Start(MuscleInput *ptrInput, MuscleOutput *ptrOutput)
+	{
+	if (m_Thread.joinable())
+		Quit("MuscleContext::Start, already running");
+	m_Exception = std::exception_ptr();
+	m_Thread = std::thread(&MuscleContext::ThreadBody, this, ptrInput, ptrOutput);
+	}
+
+// Exceptions thrown by the run (Quit, OnException...) are
+// re-thrown here, in the caller's thread.
+void MuscleContext::Wait()
+	{
+	if (m_Thread.joinable())
+		m_Thread.join();
+	if (m_Exception)
+		{
+		std::exception_ptr e = m_Exception;
+		m_Exception = std::exception_ptr();
+		std::rethrow_exception(e);
+		}
+	}
+
+void MuscleContext::Run(MuscleInput *ptrInput, MuscleOutput *ptrOutput)
+	{
+	Start(ptrInput, ptrOutput);
+	Wait();
+	}
@@ -0,0 +1,36 @@
+#ifndef MuscleContext_h
+#define MuscleContext_h
+
+#include <exception>
+#include <string>
+#include <thread>
+
+struct MuscleInput;
+struct MuscleOutput;
+
+// One MUSCLE run with its own copy of the per-alignment state.
+// Parameters, options and DP buffers are thread-local (MUSCLE_TLS),
+// so each run executes on a fresh thread which starts from the
+// built-in defaults. Several contexts may run at the same time.
+class MuscleContext
+	{
+public:
+	MuscleContext(const std::string &strArgs);
+	virtual ~MuscleContext();
+
+	void Start(MuscleInput *ptrInput, MuscleOutput *ptrOutput);
+	void Wait();
+	void Run(MuscleInput *ptrInput, MuscleOutput *ptrOutput);
+
+private:
+	MuscleContext(const MuscleContext &);
+	MuscleContext &operator=(const MuscleContext &);
+
+	void ThreadBody(MuscleInput *ptrInput, MuscleOutput *ptrOutput);
+
+	std::string m_strArgs;
+	std::thread m_Thread;
+	std::exception_ptr m_Exception;
+	};
+
+#endif	// MuscleContext_h
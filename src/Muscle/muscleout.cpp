@@ -6,10 +6,9 @@
 #include <string>
 using namespace std;
 
-static vector<string> DoOutput(MSA &msa)
+static void DoOutput(MSA &msa, aln_rows_t *Rows)
 	{
 	bool AnyOutput = false;
-	vector<string> result;
 
 // Value options
 	if (g_pstrFASTAOutFileName)
@@ -29,14 +28,16 @@ static vector<string> DoOutput(MSA &msa)
 	if (g_pstrClwOutFileName)
 		{
 		TextFile File(g_pstrClwOutFileName, true);
-		result = msa.ToAlnFile();
+		if (0 != Rows)
+			msa.ToAlnRows(Rows);
 		AnyOutput = true;
 		}
 	if (g_pstrClwStrictOutFileName)
 		{
 		g_bClwStrict = true;
 		TextFile File(g_pstrClwStrictOutFileName, true);
-		result = msa.ToAlnFile();
+		if (0 != Rows)
+			msa.ToAlnRows(Rows);
 		AnyOutput = true;
 		}
 
@@ -75,7 +76,8 @@ static vector<string> DoOutput(MSA &msa)
 		}
 	else if (g_bAln)
 		{
-		result = msa.ToAlnFile();
+		if (0 != Rows)
+			msa.ToAlnRows(Rows);
 		AnyOutput = true;
 		}
 	else if (g_bHTML)
@@ -103,10 +105,9 @@ static vector<string> DoOutput(MSA &msa)
 	if (0 != g_pstrScoreFileName) {
 		WriteScoreFile(msa);
 	}
-	return result;
 }
 
-vector<string> DoMuscleOutput(MSA &msa)
+void DoMuscleOutput(MSA &msa, aln_rows_t *Rows)
 	{
 	MHackEnd(msa);
 	if (g_bStable)
@@ -114,7 +115,8 @@ vector<string> DoMuscleOutput(MSA &msa)
 		MSA msaStable;
 		Stabilize(msa, msaStable);
 		msa.Clear();	// save memory
-		return DoOutput(msaStable);
+		DoOutput(msaStable, Rows);
+		return;
 		}
-	return DoOutput(msa);
+	DoOutput(msa, Rows);
 	}
@@ -0,0 +1,222 @@
+#include "muscle.h"
+#include "tree.h"
+#include "msa.h"
+#include "profile.h"
+#include "musclethreads.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <algorithm>
+#include <vector>
+
+MuscleThreadState::MuscleThreadState()
+	{
+	m_Params = SaveParams();
+
+	m_Alpha = g_Alpha;
+	m_AlphaSize = g_AlphaSize;
+	memcpy(m_CharToLetter, g_CharToLetter, sizeof(m_CharToLetter));
+	memcpy(m_CharToLetterEx, g_CharToLetterEx, sizeof(m_CharToLetterEx));
+	memcpy(m_LetterToChar, g_LetterToChar, sizeof(m_LetterToChar));
+	memcpy(m_LetterExToChar, g_LetterExToChar, sizeof(m_LetterExToChar));
+	memcpy(m_UnalignChar, g_UnalignChar, sizeof(m_UnalignChar));
+	memcpy(m_AlignChar, g_AlignChar, sizeof(m_AlignChar));
+	memcpy(m_IsWildcardChar, g_IsWildcardChar, sizeof(m_IsWildcardChar));
+	memcpy(m_IsResidueChar, g_IsResidueChar, sizeof(m_IsResidueChar));
+
+	m_SeqWeight = GetSeqWeightMethod();
+	m_ptrMuscleTree = GetMuscleTree();
+	m_uIdCount = MSA::GetIdCount();
+	m_uTreeSplitNode1 = g_uTreeSplitNode1;
+	m_uTreeSplitNode2 = g_uTreeSplitNode2;
+	}
+
+MuscleThreadState::~MuscleThreadState()
+	{
+	DeleteParams(m_Params);
+	}
+
+void MuscleThreadState::Apply() const
+	{
+	RestoreParams(m_Params);
+
+	g_Alpha = m_Alpha;
+	g_AlphaSize = m_AlphaSize;
+	memcpy(g_CharToLetter, m_CharToLetter, sizeof(m_CharToLetter));
+	memcpy(g_CharToLetterEx, m_CharToLetterEx, sizeof(m_CharToLetterEx));
+	memcpy(g_LetterToChar, m_LetterToChar, sizeof(m_LetterToChar));
+	memcpy(g_LetterExToChar, m_LetterExToChar, sizeof(m_LetterExToChar));
+	memcpy(g_UnalignChar, m_UnalignChar, sizeof(m_UnalignChar));
+	memcpy(g_AlignChar, m_AlignChar, sizeof(m_AlignChar));
+	memcpy(g_IsWildcardChar, m_IsWildcardChar, sizeof(m_IsWildcardChar));
+	memcpy(g_IsResidueChar, m_IsResidueChar, sizeof(m_IsResidueChar));
+
+	SetSeqWeightMethod(m_SeqWeight);
+// Weights are recomputed from the same tree, so they are identical
+// to the ones of the calling thread.
+	if (0 != m_ptrMuscleTree)
+		SetMuscleTree(*m_ptrMuscleTree);
+	if (m_uIdCount > 0)
+		MSA::SetIdCount(m_uIdCount);
+	g_uTreeSplitNode1 = m_uTreeSplitNode1;
+	g_uTreeSplitNode2 = m_uTreeSplitNode2;
+	}
+
+void FreeMuscleThreadMem()
+	{
+	void FreeNWSmallCache();
+	void FreeScoreGapsMem();
+	void FreeMuscleWeights();
+	void FreeDPMemSPN();
+
+	FreeNWSmallCache();
+	FreeScoreGapsMem();
+	FreeMuscleWeights();
+	FreeDPMemSPN();
+	}
+
+void RunMuscleThreads(unsigned uThreadCount, const std::function<void ()> &Task)
+	{
+	if (uThreadCount <= 1)
+		{
+		Task();
+		return;
+		}
+
+	const MuscleThreadState State;
+	std::vector<std::exception_ptr> Exceptions(uThreadCount);
+	std::vector<std::thread> Threads;
+	for (unsigned uThreadIndex = 1; uThreadIndex < uThreadCount; ++uThreadIndex)
+		{
+		std::exception_ptr &e = Exceptions[uThreadIndex];
+		try
+			{
+			Threads.push_back(std::thread([&State, &Task, &e]()
+				{
+				try
+					{
+					State.Apply();
+					Task();
+					}
+				catch (...)
+					{
+					e = std::current_exception();
+					}
+				FreeMuscleThreadMem();
+				}));
+			}
+		catch (const std::system_error &)
+			{
+		// Could not create thread, carry on with the ones we have
+			break;
+			}
+		}
+
+	try
+		{
+		Task();
+		}
+	catch (...)
+		{
+		Exceptions[0] = std::current_exception();
+		}
+
+	for (unsigned i = 0; i < Threads.size(); ++i)
+		Threads[i].join();
+
+	for (unsigned uThreadIndex = 0; uThreadIndex < uThreadCount; ++uThreadIndex)
+		if (Exceptions[uThreadIndex])
+			std::rethrow_exception(Exceptions[uThreadIndex]);
+	}
+
+void ParallelFor(unsigned uThreadCount, unsigned uCount,
+  const std::function<void (unsigned i)> &Body)
+	{
+	if (uThreadCount > uCount)
+		uThreadCount = uCount;
+
+	std::atomic<unsigned> uNext(0);
+	RunMuscleThreads(uThreadCount, [&]()
+		{
+		for (;;)
+			{
+			const unsigned i = uNext++;
+			if (i >= uCount)
+				return;
+			Body(i);
+			}
+		});
+	}
+
+void ParallelPostorder(const Tree &tree, unsigned uThreadCount,
+  const std::function<void (unsigned uNodeIndex)> &Visit)
+	{
+	const unsigned uNodeCount = tree.GetNodeCount();
+	const unsigned uRootNodeIndex = tree.GetRootNodeIndex();
+
+// Ready is a stack. Leaves are pushed in reverse depth-first order and
+// a node is pushed as soon as its children are done, so a thread
+// tends to follow the sequential depth-first order.
+	std::vector<unsigned> ChildrenToDo(uNodeCount, 0);
+	std::vector<unsigned> Ready;
+	for (unsigned uNodeIndex = tree.FirstDepthFirstNode();
+	  NULL_NEIGHBOR != uNodeIndex;
+	  uNodeIndex = tree.NextDepthFirstNode(uNodeIndex))
+		{
+		if (tree.IsLeaf(uNodeIndex))
+			Ready.push_back(uNodeIndex);
+		else
+			ChildrenToDo[uNodeIndex] = 2;
+		}
+	std::reverse(Ready.begin(), Ready.end());
+
+	std::mutex Mutex;
+	std::condition_variable Cond;
+	bool bStop = false;
+
+	RunMuscleThreads(uThreadCount, [&]()
+		{
+		for (;;)
+			{
+			unsigned uNodeIndex;
+				{
+				std::unique_lock<std::mutex> Lock(Mutex);
+				Cond.wait(Lock, [&]() { return bStop || !Ready.empty(); });
+				if (bStop)
+					return;
+				uNodeIndex = Ready.back();
+				Ready.pop_back();
+				}
+
+			try
+				{
+				Visit(uNodeIndex);
+				}
+			catch (...)
+				{
+					{
+					std::lock_guard<std::mutex> Lock(Mutex);
+					bStop = true;
+					}
+				Cond.notify_all();
+				throw;
+				}
+
+				{
+				std::lock_guard<std::mutex> Lock(Mutex);
+				if (uRootNodeIndex == uNodeIndex)
+					bStop = true;
+				else
+					{
+					const unsigned uParent = tree.GetParent(uNodeIndex);
+					if (0 == --ChildrenToDo[uParent])
+						Ready.push_back(uParent);
+					}
+				}
+			Cond.notify_all();
+			}
+		});
+	}
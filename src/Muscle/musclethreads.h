@@ -0,0 +1,62 @@
+#ifndef MuscleThreads_h
+#define MuscleThreads_h
+
+#include <functional>
+
+class Tree;
+struct MuscleParams;
+
+// Settings of the thread that runs an alignment: parameters, alphabet,
+// sequence weighting and the tree used for MUSCLE weights. All of
+// these are thread-local (MUSCLE_TLS), so a helper thread must apply
+// them before it can do any work on behalf of the run.
+class MuscleThreadState
+	{
+public:
+	MuscleThreadState();
+	virtual ~MuscleThreadState();
+
+	void Apply() const;
+
+private:
+	MuscleThreadState(const MuscleThreadState &);
+	MuscleThreadState &operator=(const MuscleThreadState &);
+
+	MuscleParams *m_Params;
+	ALPHA m_Alpha;
+	unsigned m_AlphaSize;
+	unsigned m_CharToLetter[MAX_CHAR];
+	unsigned m_CharToLetterEx[MAX_CHAR];
+	char m_LetterToChar[MAX_ALPHA];
+	char m_LetterExToChar[MAX_ALPHA_EX];
+	char m_UnalignChar[MAX_CHAR];
+	char m_AlignChar[MAX_CHAR];
+	bool m_IsWildcardChar[MAX_CHAR];
+	bool m_IsResidueChar[MAX_CHAR];
+	SEQWEIGHT m_SeqWeight;
+	const Tree *m_ptrMuscleTree;
+	unsigned m_uIdCount;
+	unsigned m_uTreeSplitNode1;
+	unsigned m_uTreeSplitNode2;
+	};
+
+// Buffers which the aligners keep between calls for speed.
+// They belong to the calling thread.
+void FreeMuscleThreadMem();
+
+// Run Task in uThreadCount threads, one of them being the calling
+// thread, and wait until all have returned. The first exception
+// thrown by Task is re-thrown in the calling thread.
+void RunMuscleThreads(unsigned uThreadCount, const std::function<void ()> &Task);
+
+// Call Body(i) for 0 <= i < uCount, using up to uThreadCount threads.
+void ParallelFor(unsigned uThreadCount, unsigned uCount,
+  const std::function<void (unsigned i)> &Body);
+
+// Call Visit for every node of a rooted tree, a node only after both
+// of its children. Disjoint subtrees are visited concurrently by up
+// to uThreadCount threads.
+void ParallelPostorder(const Tree &tree, unsigned uThreadCount,
+  const std::function<void (unsigned uNodeIndex)> &Visit);
+
+#endif	// MuscleThreads_h
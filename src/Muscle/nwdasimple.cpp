@@ -6,17 +6,17 @@
 
 #define	TRACE	0
 
-bool g_bKeepSimpleDP;
-SCORE *g_DPM;
-SCORE *g_DPD;
-SCORE *g_DPE;
-SCORE *g_DPI;
-SCORE *g_DPJ;
-char *g_TBM;
-char *g_TBD;
-char *g_TBE;
-char *g_TBI;
-char *g_TBJ;
+MUSCLE_TLS bool g_bKeepSimpleDP;
+MUSCLE_TLS SCORE *g_DPM;
+MUSCLE_TLS SCORE *g_DPD;
+MUSCLE_TLS SCORE *g_DPE;
+MUSCLE_TLS SCORE *g_DPI;
+MUSCLE_TLS SCORE *g_DPJ;
+MUSCLE_TLS char *g_TBM;
+MUSCLE_TLS char *g_TBD;
+MUSCLE_TLS char *g_TBE;
+MUSCLE_TLS char *g_TBI;
+MUSCLE_TLS char *g_TBJ;
 
 #if	DOUBLE_AFFINE
 
@@ -6,17 +6,17 @@
 
 #define	TRACE	0
 
-extern bool g_bKeepSimpleDP;
-extern SCORE *g_DPM;
-extern SCORE *g_DPD;
-extern SCORE *g_DPE;
-extern SCORE *g_DPI;
-extern SCORE *g_DPJ;
-extern char *g_TBM;
-extern char *g_TBD;
-extern char *g_TBE;
-extern char *g_TBI;
-extern char *g_TBJ;
+extern MUSCLE_TLS bool g_bKeepSimpleDP;
+extern MUSCLE_TLS SCORE *g_DPM;
+extern MUSCLE_TLS SCORE *g_DPD;
+extern MUSCLE_TLS SCORE *g_DPE;
+extern MUSCLE_TLS SCORE *g_DPI;
+extern MUSCLE_TLS SCORE *g_DPJ;
+extern MUSCLE_TLS char *g_TBM;
+extern MUSCLE_TLS char *g_TBD;
+extern MUSCLE_TLS char *g_TBE;
+extern MUSCLE_TLS char *g_TBI;
+extern MUSCLE_TLS char *g_TBJ;
 
 static char XlatEdgeType(char c)
 	{
@@ -9,13 +9,13 @@
 #define	TRACE	0
 
 #if	TRACE
-extern bool g_bKeepSimpleDP;
-extern SCORE *g_DPM;
-extern SCORE *g_DPD;
-extern SCORE *g_DPI;
-extern char *g_TBM;
-extern char *g_TBD;
-extern char *g_TBI;
+extern MUSCLE_TLS bool g_bKeepSimpleDP;
+extern MUSCLE_TLS SCORE *g_DPM;
+extern MUSCLE_TLS SCORE *g_DPD;
+extern MUSCLE_TLS SCORE *g_DPI;
+extern MUSCLE_TLS char *g_TBM;
+extern MUSCLE_TLS char *g_TBD;
+extern MUSCLE_TLS char *g_TBI;
 #endif
 
 #if	TRACE
@@ -457,27 +457,43 @@ static inline void SetBitTBI(char **TB, unsigned i, unsigned j, char c)
 #define LogMatrices()	/* empty */
 #endif
 
-static unsigned uCachePrefixCountB;
-static unsigned uCachePrefixCountA;
-static SCORE *CacheMCurr;
-static SCORE *CacheMNext;
-static SCORE *CacheMPrev;
-static SCORE *CacheDRow;
-static char **CacheTB;
+static MUSCLE_TLS unsigned uCachePrefixCountB;
+static MUSCLE_TLS unsigned uCachePrefixCountA;
+static MUSCLE_TLS SCORE *CacheMCurr;
+static MUSCLE_TLS SCORE *CacheMNext;
+static MUSCLE_TLS SCORE *CacheMPrev;
+static MUSCLE_TLS SCORE *CacheDRow;
+static MUSCLE_TLS SCORE *CacheScoresB;
+static MUSCLE_TLS char **CacheTB;
 
-static void AllocCache(unsigned uPrefixCountA, unsigned uPrefixCountB)
+void FreeNWSmallCache()
 	{
-	if (uPrefixCountA <= uCachePrefixCountA && uPrefixCountB <= uCachePrefixCountB)
-		return;
-
 	delete[] CacheMCurr;
 	delete[] CacheMNext;
 	delete[] CacheMPrev;
 	delete[] CacheDRow;
+	delete[] CacheScoresB;
 	for (unsigned i = 0; i < uCachePrefixCountA; ++i)
 		delete[] CacheTB[i];
 	delete[] CacheTB;
 
+	CacheMCurr = 0;
+	CacheMNext = 0;
+	CacheMPrev = 0;
+	CacheDRow = 0;
+	CacheScoresB = 0;
+	CacheTB = 0;
+	uCachePrefixCountA = 0;
+	uCachePrefixCountB = 0;
+	}
+
+static void AllocCache(unsigned uPrefixCountA, unsigned uPrefixCountB)
+	{
+	if (uPrefixCountA <= uCachePrefixCountA && uPrefixCountB <= uCachePrefixCountB)
+		return;
+
+	FreeNWSmallCache();
+
 	uCachePrefixCountA = uPrefixCountA + 1024;
 	uCachePrefixCountB = uPrefixCountB + 1024;
 
@@ -485,12 +501,21 @@ static void AllocCache(unsigned uPrefixCountA, unsigned uPrefixCountB)
 	CacheMNext = new SCORE[uCachePrefixCountB];
 	CacheMPrev = new SCORE[uCachePrefixCountB];
 	CacheDRow = new SCORE[uCachePrefixCountB];
+	CacheScoresB = new SCORE[20*uCachePrefixCountB];
 
 	CacheTB = new char *[uCachePrefixCountA];
 	for (unsigned i = 0; i < uCachePrefixCountA; ++i)
 		CacheTB[i] = new char [uCachePrefixCountB];
 	}
 
+void SetScoresByLetter(const ProfPos *PB, unsigned uLengthB, SCORE *ScoresByLetter,
+  unsigned uStride);
+void ScoreProfPosRow(const ProfPos &PPA, const ProfPos *PB,
+  const SCORE *ScoresByLetter, unsigned uStride, unsigned uFrom, unsigned uTo,
+  SCORE Row[]);
+void RecurseDRow(SCORE DRow[], const SCORE MPrev[], SCORE scoreGapOpen,
+  SCORE e, char TBRow[], unsigned uFrom, unsigned uTo);
+
 SCORE NWSmall(const ProfPos *PA, unsigned uLengthA, const ProfPos *PB,
   unsigned uLengthB, PWPath &Path)
 	{
@@ -513,6 +538,10 @@ SCORE NWSmall(const ProfPos *PA, unsigned uLengthA, const ProfPos *PB,
 	SCORE *MPrev = CacheMPrev;
 	SCORE *DRow = CacheDRow;
 
+	SCORE *ScoresB = CacheScoresB;
+	const unsigned uStrideB = uCachePrefixCountB;
+	SetScoresByLetter(PB, uLengthB, ScoresB, uStrideB);
+
 	char **TB = CacheTB;
 	for (unsigned i = 0; i < uPrefixCountA; ++i)
 		memset(TB[i], 0, uPrefixCountB);
@@ -590,9 +619,10 @@ SCORE NWSmall(const ProfPos *PA, unsigned uLengthA, const ProfPos *PB,
 		SetDPM(i, 0, MCurr[0]);
 		SetDPM(i, 1, MCurr[1]);
 
-		for (unsigned j = 1; j < uLengthB; ++j)
-			MNext[j+1] = ScoreProfPos2(PA[i], PB[j]);
+	// MNext[j+1] = ScoreProfPos2(PA[i], PB[j]), 1 <= j < uLengthB
+		ScoreProfPosRow(PA[i], PB, ScoresB, uStrideB, 1, uLengthB, MNext + 1);
 
+#if	TRACE
 		for (unsigned j = 1; j < uLengthB; ++j)
 			{
 			RECURSE_D(i, j)
@@ -602,6 +632,18 @@ SCORE NWSmall(const ProfPos *PA, unsigned uLengthA, const ProfPos *PB,
 	// Special case for j=uLengthB
 		RECURSE_D_BTerm(i)
 		RECURSE_I_BTerm(i)
+#else
+	// D only depends on the previous row, do it for the whole row first
+		RecurseDRow(DRow, MPrev, PA[i-1].m_scoreGapOpen, e, TBRow, 1, uLengthB);
+
+		for (unsigned j = 1; j < uLengthB; ++j)
+			{
+			RECURSE_I(i, j)
+			RECURSE_M(i, j)
+			}
+	// Special case for j=uLengthB
+		RECURSE_I_BTerm(i)
+#endif
 
 	// Prev := Curr, Curr := Next, Next := Prev
 		Rotate(MPrev, MCurr, MNext);
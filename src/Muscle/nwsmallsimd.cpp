@@ -0,0 +1,235 @@
+#include "muscle.h"
+#include "profile.h"
+#include <math.h>
+
+// Row kernels for NWSmall.
+// ScoreProfPosRow computes ScoreProfPos2(PPA, PB[j]) for a range of j,
+// RecurseDRow does the D (gap-in-B) recurrence for a whole row.
+// Both give exactly the same results as the scalar code: every cell
+// is computed with the same float operations in the same order, only
+// several cells at a time.
+// On x86 the SSE2 or AVX kernel is picked at run time, elsewhere
+// the scalar reference code is used.
+
+#if	defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define	NWSMALL_SSE2	1
+#include <immintrin.h>
+// GCC on Windows does not align the stack for 256-bit spills.
+#if	!defined(_WIN32)
+#define	NWSMALL_AVX		1
+#else
+#define	NWSMALL_AVX		0
+#endif
+#else
+#define	NWSMALL_SSE2	0
+#define	NWSMALL_AVX		0
+#endif
+
+enum SIMD_LEVEL
+	{
+	SIMD_NONE,
+	SIMD_SSE2,
+	SIMD_AVX
+	};
+
+static SIMD_LEVEL DetectSIMD()
+	{
+#if	NWSMALL_AVX
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx"))
+		return SIMD_AVX;
+#endif
+#if	NWSMALL_SSE2
+	return SIMD_SSE2;
+#else
+	return SIMD_NONE;
+#endif
+	}
+
+static SIMD_LEVEL GetSIMD()
+	{
+	static const SIMD_LEVEL Level = DetectSIMD();
+	return Level;
+	}
+
+// Letter-major copy of PB[j].m_AAScores, so that the scores of one
+// letter for consecutive positions are contiguous.
+void SetScoresByLetter(const ProfPos *PB, unsigned uLengthB, SCORE *ScoresByLetter,
+  unsigned uStride)
+	{
+	for (unsigned uLetter = 0; uLetter < 20; ++uLetter)
+		{
+		SCORE *Row = ScoresByLetter + uLetter*uStride;
+		for (unsigned j = 0; j < uLengthB; ++j)
+			Row[j] = PB[j].m_AAScores[uLetter];
+		}
+	}
+
+// Sums[j] = sum_k Counts[k]*Scores[Letters[k]][j], for uFrom <= j < uTo.
+static void SumRowScalar(const unsigned Letters[], const FCOUNT Counts[],
+  unsigned uLetterCount, const SCORE *ScoresByLetter, unsigned uStride,
+  unsigned uFrom, unsigned uTo, SCORE Sums[])
+	{
+	for (unsigned j = uFrom; j < uTo; ++j)
+		{
+		SCORE Score = 0;
+		for (unsigned k = 0; k < uLetterCount; ++k)
+			Score += Counts[k]*ScoresByLetter[Letters[k]*uStride + j];
+		Sums[j] = Score;
+		}
+	}
+
+#if	NWSMALL_SSE2
+static void SumRowSSE2(const unsigned Letters[], const FCOUNT Counts[],
+  unsigned uLetterCount, const SCORE *ScoresByLetter, unsigned uStride,
+  unsigned uFrom, unsigned uTo, SCORE Sums[])
+	{
+	unsigned j = uFrom;
+	for (; j + 4 <= uTo; j += 4)
+		{
+		__m128 Score = _mm_setzero_ps();
+		for (unsigned k = 0; k < uLetterCount; ++k)
+			{
+			const __m128 Scores = _mm_loadu_ps(ScoresByLetter + Letters[k]*uStride + j);
+			Score = _mm_add_ps(Score, _mm_mul_ps(_mm_set1_ps(Counts[k]), Scores));
+			}
+		_mm_storeu_ps(Sums + j, Score);
+		}
+	SumRowScalar(Letters, Counts, uLetterCount, ScoresByLetter, uStride, j, uTo, Sums);
+	}
+#endif
+
+#if	NWSMALL_AVX
+__attribute__((target("avx")))
+static void SumRowAVX(const unsigned Letters[], const FCOUNT Counts[],
+  unsigned uLetterCount, const SCORE *ScoresByLetter, unsigned uStride,
+  unsigned uFrom, unsigned uTo, SCORE Sums[])
+	{
+	unsigned j = uFrom;
+	for (; j + 8 <= uTo; j += 8)
+		{
+		__m256 Score = _mm256_setzero_ps();
+		for (unsigned k = 0; k < uLetterCount; ++k)
+			{
+			const __m256 Scores = _mm256_loadu_ps(ScoresByLetter + Letters[k]*uStride + j);
+			Score = _mm256_add_ps(Score, _mm256_mul_ps(_mm256_set1_ps(Counts[k]), Scores));
+			}
+		_mm256_storeu_ps(Sums + j, Score);
+		}
+	SumRowScalar(Letters, Counts, uLetterCount, ScoresByLetter, uStride, j, uTo, Sums);
+	}
+#endif
+
+// Row[j] = ScoreProfPos2(PPA, PB[j]) for uFrom <= j < uTo.
+void ScoreProfPosRow(const ProfPos &PPA, const ProfPos *PB,
+  const SCORE *ScoresByLetter, unsigned uStride, unsigned uFrom, unsigned uTo,
+  SCORE Row[])
+	{
+	const SIMD_LEVEL Level = GetSIMD();
+	if (SIMD_NONE == Level)
+		{
+		for (unsigned j = uFrom; j < uTo; ++j)
+			Row[j] = ScoreProfPos2(PPA, PB[j]);
+		return;
+		}
+
+// Same letters and order as the loops in ScoreProfPos2xx
+	unsigned uMaxLetters = 20;
+	if (PPSCORE_SPN == g_PPScore)
+		uMaxLetters = 4;
+	else if (PPSCORE_SP != g_PPScore && PPSCORE_LE != g_PPScore &&
+	  PPSCORE_SV != g_PPScore)
+		Quit("Invalid g_PPScore");
+
+	unsigned Letters[20];
+	FCOUNT Counts[20];
+	unsigned uLetterCount = 0;
+	for (unsigned n = 0; n < uMaxLetters; ++n)
+		{
+		const unsigned uLetter = PPA.m_uSortOrder[n];
+		const FCOUNT fcLetter = PPA.m_fcCounts[uLetter];
+		if (0 == fcLetter)
+			break;
+		Letters[uLetterCount] = uLetter;
+		Counts[uLetterCount] = fcLetter;
+		++uLetterCount;
+		}
+
+#if	NWSMALL_AVX
+	if (SIMD_AVX == Level)
+		SumRowAVX(Letters, Counts, uLetterCount, ScoresByLetter, uStride, uFrom, uTo, Row);
+	else
+#endif
+#if	NWSMALL_SSE2
+		SumRowSSE2(Letters, Counts, uLetterCount, ScoresByLetter, uStride, uFrom, uTo, Row);
+#else
+		SumRowScalar(Letters, Counts, uLetterCount, ScoresByLetter, uStride, uFrom, uTo, Row);
+#endif
+
+	if (PPSCORE_LE == g_PPScore)
+		{
+		for (unsigned j = uFrom; j < uTo; ++j)
+			{
+			const SCORE Score = Row[j];
+			if (0 == Score)
+				{
+				Row[j] = (SCORE) -2.5;
+				continue;
+				}
+			SCORE logScore = logf(Score);
+			Row[j] = (SCORE) ((logScore - g_scoreCenter)*(PPA.m_fOcc * PB[j].m_fOcc));
+			}
+		}
+	else
+		{
+		for (unsigned j = uFrom; j < uTo; ++j)
+			Row[j] -= g_scoreCenter;
+		}
+	}
+
+// D recurrence (RECURSE_D in nwsmall.cpp) for uFrom <= j <= uTo.
+// D only depends on the previous row, so all cells of a row are
+// independent.
+void RecurseDRow(SCORE DRow[], const SCORE MPrev[], SCORE scoreGapOpen,
+  SCORE e, char TBRow[], unsigned uFrom, unsigned uTo)
+	{
+	unsigned j = uFrom;
+#if	NWSMALL_SSE2
+	if (SIMD_NONE != GetSIMD())
+		{
+		const __m128 E = _mm_set1_ps(e);
+		const __m128 GapOpen = _mm_set1_ps(scoreGapOpen);
+		for (; j + 3 <= uTo; j += 4)
+			{
+			const __m128 DD = _mm_add_ps(_mm_loadu_ps(DRow + j), E);
+			const __m128 MD = _mm_add_ps(_mm_loadu_ps(MPrev + j), GapOpen);
+			const __m128 IsDD = _mm_cmpgt_ps(DD, MD);
+			_mm_storeu_ps(DRow + j,
+			  _mm_or_ps(_mm_and_ps(IsDD, DD), _mm_andnot_ps(IsDD, MD)));
+
+			const int Bits = _mm_movemask_ps(IsDD);
+			if (0xf == Bits)
+				continue;
+			for (unsigned k = 0; k < 4; ++k)
+				if (0 == (Bits & (1 << k)))
+					{
+					TBRow[j+k] &= ~BIT_xD;
+					TBRow[j+k] |= BIT_MD;
+					}
+			}
+		}
+#endif
+	for (; j <= uTo; ++j)
+		{
+		SCORE DD = DRow[j] + e;
+		SCORE MD = MPrev[j] + scoreGapOpen;
+		if (DD > MD)
+			DRow[j] = DD;
+		else
+			{
+			DRow[j] = MD;
+			TBRow[j] &= ~BIT_xD;
+			TBRow[j] |= BIT_MD;
+			}
+		}
+	}
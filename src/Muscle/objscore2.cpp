@@ -14,8 +14,8 @@ extern SCOREMATRIX VTML_SP;
 extern SCOREMATRIX VTML_SPNoCenter;
 extern SCOREMATRIX NUC_SP;
 
-SCORE g_SPScoreLetters;
-SCORE g_SPScoreGaps;
+MUSCLE_TLS SCORE g_SPScoreLetters;
+MUSCLE_TLS SCORE g_SPScoreGaps;
 
 static SCORE TermGapScore(bool Gap)
 	{
@@ -368,9 +368,9 @@ SCORE ObjScoreDP_Profs(const ProfPos *PA, const ProfPos *PB, unsigned uColCount,
 
 		scoreTotal += scoreMatch + scoreGap;
 
-		extern bool g_bTracePPScore;
-		extern MSA *g_ptrPPScoreMSA1;
-		extern MSA *g_ptrPPScoreMSA2;
+		extern MUSCLE_TLS bool g_bTracePPScore;
+		extern MUSCLE_TLS MSA *g_ptrPPScoreMSA1;
+		extern MUSCLE_TLS MSA *g_ptrPPScoreMSA2;
 		if (g_bTracePPScore)
 			{
 			const MSA &msa1 = *g_ptrPPScoreMSA1;
@@ -13,13 +13,14 @@ struct FLAG_OPT
 	bool m_bSet;
 	};
 
-static VALUE_OPT ValueOpts[] =
+static MUSCLE_TLS VALUE_OPT ValueOpts[] =
 	{
 	"in",				0,
 	"in1",				0,
 	"in2",				0,
 	"out",				0,
 	"MaxIters",			0,
+	"Threads",			0,
 	"MaxHours",			0,
 	"GapOpen",			0,
 	"GapOpen2",			0,
@@ -84,7 +85,7 @@ static VALUE_OPT ValueOpts[] =
 	};
 static int ValueOptCount = sizeof(ValueOpts)/sizeof(ValueOpts[0]);
 
-static FLAG_OPT FlagOpts[] =
+static MUSCLE_TLS FLAG_OPT FlagOpts[] =
 	{
 	"LE",					false,
 	"SP",					false,
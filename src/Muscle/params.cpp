@@ -5,12 +5,12 @@
 
 const double DEFAULT_MAX_MB_FRACT = 0.8;
 
-SCORE g_scoreCenter = 0;
-SCORE g_scoreGapExtend = 0;
-SCORE g_scoreGapOpen2 = MINUS_INFINITY;
-SCORE g_scoreGapExtend2 = MINUS_INFINITY;
-SCORE g_scoreGapAmbig = 0;
-SCORE g_scoreAmbigFactor = 0;
+MUSCLE_TLS SCORE g_scoreCenter = 0;
+MUSCLE_TLS SCORE g_scoreGapExtend = 0;
+MUSCLE_TLS SCORE g_scoreGapOpen2 = MINUS_INFINITY;
+MUSCLE_TLS SCORE g_scoreGapExtend2 = MINUS_INFINITY;
+MUSCLE_TLS SCORE g_scoreGapAmbig = 0;
+MUSCLE_TLS SCORE g_scoreAmbigFactor = 0;
 
 extern SCOREMATRIX VTML_LA;
 extern SCOREMATRIX PAM200;
@@ -19,125 +19,126 @@ extern SCOREMATRIX VTML_SP;
 extern SCOREMATRIX VTML_SPNoCenter;
 extern SCOREMATRIX NUC_SP;
 
-PTR_SCOREMATRIX g_ptrScoreMatrix;
-
-const char *g_pstrInFileName = "-";
-const char *g_pstrOutFileName = "-";
-const char *g_pstrFASTAOutFileName = 0;
-const char *g_pstrMSFOutFileName = 0;
-const char *g_pstrClwOutFileName = 0;
-const char *g_pstrClwStrictOutFileName = 0;
-const char *g_pstrHTMLOutFileName = 0;
-const char *g_pstrPHYIOutFileName = 0;
-const char *g_pstrPHYSOutFileName = 0;
-const char *g_pstrDistMxFileName1 = 0;
-const char *g_pstrDistMxFileName2 = 0;
-
-const char *g_pstrFileName1 = 0;
-const char *g_pstrFileName2 = 0;
-
-const char *g_pstrSPFileName = 0;
-const char *g_pstrMatrixFileName = 0;
-
-const char *g_pstrUseTreeFileName = 0;
-bool g_bUseTreeNoWarn = false;
-
-const char *g_pstrComputeWeightsFileName;
-const char *g_pstrScoreFileName;
-
-const char *g_pstrProf1FileName = 0;
-const char *g_pstrProf2FileName = 0;
-
-unsigned g_uSmoothWindowLength = 7;
-unsigned g_uAnchorSpacing = 32;
-unsigned g_uMaxTreeRefineIters = 1;
-
-unsigned g_uRefineWindow = 200;
-unsigned g_uWindowFrom = 0;
-unsigned g_uWindowTo = 0;
-unsigned g_uSaveWindow = uInsane;
-unsigned g_uWindowOffset = 0;
-
-unsigned g_uMaxSubFamCount = 5;
-
-unsigned g_uHydrophobicRunLength = 5;
-float g_dHydroFactor = (float) 1.2;
-
-unsigned g_uMinDiagLength = 24;	// TODO alpha -- should depend on alphabet?
-unsigned g_uMaxDiagBreak = 1;
-unsigned g_uDiagMargin = 5;
-
-float g_dSUEFF = (float) 0.1;
-
-bool g_bPrecompiledCenter = true;
-bool g_bNormalizeCounts = false;
-bool g_bDiags1 = false;
-bool g_bDiags2 = false;
-bool g_bAnchors = true;
-bool g_bQuiet = false;
-bool g_bVerbose = false;
-bool g_bRefine = false;
-bool g_bRefineW = false;
-bool g_bProfDB = false;
-bool g_bLow = false;
-bool g_bSW = false;
-bool g_bClusterOnly = false;
-bool g_bProfile = false;
-bool g_bPPScore = false;
-bool g_bBrenner = false;
-bool g_bDimer = false;
-bool g_bVersion = false;
-bool g_bStable = false;
-bool g_bFASTA = false;
-bool g_bPAS = false;
-bool g_bTomHydro = false;
-bool g_bMakeTree = false;
+MUSCLE_TLS PTR_SCOREMATRIX g_ptrScoreMatrix;
+
+MUSCLE_TLS const char *g_pstrInFileName = "-";
+MUSCLE_TLS const char *g_pstrOutFileName = "-";
+MUSCLE_TLS const char *g_pstrFASTAOutFileName = 0;
+MUSCLE_TLS const char *g_pstrMSFOutFileName = 0;
+MUSCLE_TLS const char *g_pstrClwOutFileName = 0;
+MUSCLE_TLS const char *g_pstrClwStrictOutFileName = 0;
+MUSCLE_TLS const char *g_pstrHTMLOutFileName = 0;
+MUSCLE_TLS const char *g_pstrPHYIOutFileName = 0;
+MUSCLE_TLS const char *g_pstrPHYSOutFileName = 0;
+MUSCLE_TLS const char *g_pstrDistMxFileName1 = 0;
+MUSCLE_TLS const char *g_pstrDistMxFileName2 = 0;
+
+MUSCLE_TLS const char *g_pstrFileName1 = 0;
+MUSCLE_TLS const char *g_pstrFileName2 = 0;
+
+MUSCLE_TLS const char *g_pstrSPFileName = 0;
+MUSCLE_TLS const char *g_pstrMatrixFileName = 0;
+
+MUSCLE_TLS const char *g_pstrUseTreeFileName = 0;
+MUSCLE_TLS bool g_bUseTreeNoWarn = false;
+
+MUSCLE_TLS const char *g_pstrComputeWeightsFileName;
+MUSCLE_TLS const char *g_pstrScoreFileName;
+
+MUSCLE_TLS const char *g_pstrProf1FileName = 0;
+MUSCLE_TLS const char *g_pstrProf2FileName = 0;
+
+MUSCLE_TLS unsigned g_uSmoothWindowLength = 7;
+MUSCLE_TLS unsigned g_uAnchorSpacing = 32;
+MUSCLE_TLS unsigned g_uMaxTreeRefineIters = 1;
+
+MUSCLE_TLS unsigned g_uRefineWindow = 200;
+MUSCLE_TLS unsigned g_uWindowFrom = 0;
+MUSCLE_TLS unsigned g_uWindowTo = 0;
+MUSCLE_TLS unsigned g_uSaveWindow = uInsane;
+MUSCLE_TLS unsigned g_uWindowOffset = 0;
+
+MUSCLE_TLS unsigned g_uMaxSubFamCount = 5;
+
+MUSCLE_TLS unsigned g_uHydrophobicRunLength = 5;
+MUSCLE_TLS float g_dHydroFactor = (float) 1.2;
+
+MUSCLE_TLS unsigned g_uMinDiagLength = 24;	// TODO alpha -- should depend on alphabet?
+MUSCLE_TLS unsigned g_uMaxDiagBreak = 1;
+MUSCLE_TLS unsigned g_uDiagMargin = 5;
+
+MUSCLE_TLS float g_dSUEFF = (float) 0.1;
+
+MUSCLE_TLS bool g_bPrecompiledCenter = true;
+MUSCLE_TLS bool g_bNormalizeCounts = false;
+MUSCLE_TLS bool g_bDiags1 = false;
+MUSCLE_TLS bool g_bDiags2 = false;
+MUSCLE_TLS bool g_bAnchors = true;
+MUSCLE_TLS bool g_bQuiet = false;
+MUSCLE_TLS bool g_bVerbose = false;
+MUSCLE_TLS bool g_bRefine = false;
+MUSCLE_TLS bool g_bRefineW = false;
+MUSCLE_TLS bool g_bProfDB = false;
+MUSCLE_TLS bool g_bLow = false;
+MUSCLE_TLS bool g_bSW = false;
+MUSCLE_TLS bool g_bClusterOnly = false;
+MUSCLE_TLS bool g_bProfile = false;
+MUSCLE_TLS bool g_bPPScore = false;
+MUSCLE_TLS bool g_bBrenner = false;
+MUSCLE_TLS bool g_bDimer = false;
+MUSCLE_TLS bool g_bVersion = false;
+MUSCLE_TLS bool g_bStable = false;
+MUSCLE_TLS bool g_bFASTA = false;
+MUSCLE_TLS bool g_bPAS = false;
+MUSCLE_TLS bool g_bTomHydro = false;
+MUSCLE_TLS bool g_bMakeTree = false;
 
 #if	DEBUG
-bool g_bCatchExceptions = false;
+MUSCLE_TLS bool g_bCatchExceptions = false;
 #else
-bool g_bCatchExceptions = true;
+MUSCLE_TLS bool g_bCatchExceptions = true;
 #endif
 
-bool g_bMSF = false;
-bool g_bAln = false;
-bool g_bClwStrict = false;
-bool g_bHTML = false;
-bool g_bPHYI = false;
-bool g_bPHYS = false;
+MUSCLE_TLS bool g_bMSF = false;
+MUSCLE_TLS bool g_bAln = false;
+MUSCLE_TLS bool g_bClwStrict = false;
+MUSCLE_TLS bool g_bHTML = false;
+MUSCLE_TLS bool g_bPHYI = false;
+MUSCLE_TLS bool g_bPHYS = false;
 
-unsigned g_uMaxIters = 8;
-unsigned long g_ulMaxSecs = 0;
-unsigned g_uMaxMB = 500;
+MUSCLE_TLS unsigned g_uMaxIters = 8;
+MUSCLE_TLS unsigned long g_ulMaxSecs = 0;
+MUSCLE_TLS unsigned g_uMaxMB = 500;
+MUSCLE_TLS unsigned g_uThreads = 1;
 
-PPSCORE g_PPScore = PPSCORE_LE;
-OBJSCORE g_ObjScore = OBJSCORE_SPM;
+MUSCLE_TLS PPSCORE g_PPScore = PPSCORE_LE;
+MUSCLE_TLS OBJSCORE g_ObjScore = OBJSCORE_SPM;
 
-SEQWEIGHT g_SeqWeight1 = SEQWEIGHT_ClustalW;
-SEQWEIGHT g_SeqWeight2 = SEQWEIGHT_ClustalW;
+MUSCLE_TLS SEQWEIGHT g_SeqWeight1 = SEQWEIGHT_ClustalW;
+MUSCLE_TLS SEQWEIGHT g_SeqWeight2 = SEQWEIGHT_ClustalW;
 
-DISTANCE g_Distance1 = DISTANCE_Kmer6_6;
-DISTANCE g_Distance2 = DISTANCE_PctIdKimura;
+MUSCLE_TLS DISTANCE g_Distance1 = DISTANCE_Kmer6_6;
+MUSCLE_TLS DISTANCE g_Distance2 = DISTANCE_PctIdKimura;
 
-CLUSTER g_Cluster1 = CLUSTER_UPGMB;
-CLUSTER g_Cluster2 = CLUSTER_UPGMB;
+MUSCLE_TLS CLUSTER g_Cluster1 = CLUSTER_UPGMB;
+MUSCLE_TLS CLUSTER g_Cluster2 = CLUSTER_UPGMB;
 
-ROOT g_Root1 = ROOT_Pseudo;
-ROOT g_Root2 = ROOT_Pseudo;
+MUSCLE_TLS ROOT g_Root1 = ROOT_Pseudo;
+MUSCLE_TLS ROOT g_Root2 = ROOT_Pseudo;
 
-bool g_bDiags;
+MUSCLE_TLS bool g_bDiags;
 
-SEQTYPE g_SeqType = SEQTYPE_Auto;
+MUSCLE_TLS SEQTYPE g_SeqType = SEQTYPE_Auto;
 
-TERMGAPS g_TermGaps = TERMGAPS_Half;
+MUSCLE_TLS TERMGAPS g_TermGaps = TERMGAPS_Half;
 
 //------------------------------------------------------
 // These parameters depending on the chosen prof-prof
 // score (g_PPScore), initialized to "Undefined".
-float g_dSmoothScoreCeil = fInsane;
-float g_dMinBestColScore = fInsane;
-float g_dMinSmoothScore = fInsane;
-SCORE g_scoreGapOpen = fInsane;
+MUSCLE_TLS float g_dSmoothScoreCeil = fInsane;
+MUSCLE_TLS float g_dMinBestColScore = fInsane;
+MUSCLE_TLS float g_dMinSmoothScore = fInsane;
+MUSCLE_TLS SCORE g_scoreGapOpen = fInsane;
 //------------------------------------------------------
 
 static unsigned atou(const char *s)
@@ -163,6 +164,7 @@ void ListParams()
 	Log("Max trees                %u\n", g_uMaxTreeRefineIters);
 	Log("Max time                 %s\n", MaxSecsToStr());
 	Log("Max MB                   %u\n", g_uMaxMB);
+	Log("Threads                  %u\n", g_uThreads);
 	Log("Gap open                 %g\n", g_scoreGapOpen);
 	Log("Gap extend (dimer)       %g\n", g_scoreGapExtend);
 	Log("Gap ambig factor         %g\n", g_scoreAmbigFactor);
@@ -590,6 +592,9 @@ void SetParams()
 	UintParam("DiagMargin", &g_uDiagMargin);
 	UintParam("DiagBreak", &g_uMaxDiagBreak);
 	UintParam("MaxSubFam", &g_uMaxSubFamCount);
+	UintParam("Threads", &g_uThreads);
+	if (0 == g_uThreads)
+		g_uThreads = 1;
 
 	UintParam("Hydro", &g_uHydrophobicRunLength);
 	FlagParam("TomHydro", &g_bTomHydro, true);
@@ -629,3 +634,130 @@ void SetParams()
 	if (0 == ValueOpt("MaxMB"))
 		g_uMaxMB = (unsigned) (GetRAMSizeMB()*DEFAULT_MAX_MB_FRACT);
 	}
+
+// Snapshot of all parameters above. The parameters are thread-local,
+// so helper threads of a run start by restoring the snapshot taken
+// by the thread that runs the alignment.
+#define	FOR_ALL_PARAMS(X) \
+	X(g_scoreCenter) \
+	X(g_scoreGapExtend) \
+	X(g_scoreGapOpen2) \
+	X(g_scoreGapExtend2) \
+	X(g_scoreGapAmbig) \
+	X(g_scoreAmbigFactor) \
+	X(g_ptrScoreMatrix) \
+	X(g_pstrInFileName) \
+	X(g_pstrOutFileName) \
+	X(g_pstrFASTAOutFileName) \
+	X(g_pstrMSFOutFileName) \
+	X(g_pstrClwOutFileName) \
+	X(g_pstrClwStrictOutFileName) \
+	X(g_pstrHTMLOutFileName) \
+	X(g_pstrPHYIOutFileName) \
+	X(g_pstrPHYSOutFileName) \
+	X(g_pstrDistMxFileName1) \
+	X(g_pstrDistMxFileName2) \
+	X(g_pstrFileName1) \
+	X(g_pstrFileName2) \
+	X(g_pstrSPFileName) \
+	X(g_pstrMatrixFileName) \
+	X(g_pstrUseTreeFileName) \
+	X(g_bUseTreeNoWarn) \
+	X(g_pstrComputeWeightsFileName) \
+	X(g_pstrScoreFileName) \
+	X(g_pstrProf1FileName) \
+	X(g_pstrProf2FileName) \
+	X(g_uSmoothWindowLength) \
+	X(g_uAnchorSpacing) \
+	X(g_uMaxTreeRefineIters) \
+	X(g_uRefineWindow) \
+	X(g_uWindowFrom) \
+	X(g_uWindowTo) \
+	X(g_uSaveWindow) \
+	X(g_uWindowOffset) \
+	X(g_uMaxSubFamCount) \
+	X(g_uHydrophobicRunLength) \
+	X(g_dHydroFactor) \
+	X(g_uMinDiagLength) \
+	X(g_uMaxDiagBreak) \
+	X(g_uDiagMargin) \
+	X(g_dSUEFF) \
+	X(g_bPrecompiledCenter) \
+	X(g_bNormalizeCounts) \
+	X(g_bDiags1) \
+	X(g_bDiags2) \
+	X(g_bAnchors) \
+	X(g_bQuiet) \
+	X(g_bVerbose) \
+	X(g_bRefine) \
+	X(g_bRefineW) \
+	X(g_bProfDB) \
+	X(g_bLow) \
+	X(g_bSW) \
+	X(g_bClusterOnly) \
+	X(g_bProfile) \
+	X(g_bPPScore) \
+	X(g_bBrenner) \
+	X(g_bDimer) \
+	X(g_bVersion) \
+	X(g_bStable) \
+	X(g_bFASTA) \
+	X(g_bPAS) \
+	X(g_bTomHydro) \
+	X(g_bMakeTree) \
+	X(g_bCatchExceptions) \
+	X(g_bMSF) \
+	X(g_bAln) \
+	X(g_bClwStrict) \
+	X(g_bHTML) \
+	X(g_bPHYI) \
+	X(g_bPHYS) \
+	X(g_uMaxIters) \
+	X(g_ulMaxSecs) \
+	X(g_uMaxMB) \
+	X(g_uThreads) \
+	X(g_PPScore) \
+	X(g_ObjScore) \
+	X(g_SeqWeight1) \
+	X(g_SeqWeight2) \
+	X(g_Distance1) \
+	X(g_Distance2) \
+	X(g_Cluster1) \
+	X(g_Cluster2) \
+	X(g_Root1) \
+	X(g_Root2) \
+	X(g_bDiags) \
+	X(g_SeqType) \
+	X(g_TermGaps) \
+	X(g_dSmoothScoreCeil) \
+	X(g_dMinBestColScore) \
+	X(g_dMinSmoothScore) \
+	X(g_scoreGapOpen)
+
+struct MuscleParams
+	{
+#define	X(p)	decltype(::p) p;
+	FOR_ALL_PARAMS(X)
+#undef	X
+	};
+
+MuscleParams *SaveParams()
+	{
+	MuscleParams *Params = new MuscleParams;
+#define	X(p)	Params->p = ::p;
+	FOR_ALL_PARAMS(X)
+#undef	X
+	return Params;
+	}
+
+void RestoreParams(const MuscleParams *Params)
+	{
+#define	X(p)	::p = Params->p;
+	FOR_ALL_PARAMS(X)
+#undef	X
+	}
+
+void DeleteParams(MuscleParams *Params)
+	{
+	delete Params;
+	}
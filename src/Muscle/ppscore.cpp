@@ -5,9 +5,9 @@
 #include "profile.h"
 #include "objscore.h"
 
-bool g_bTracePPScore = false;
-MSA *g_ptrPPScoreMSA1 = 0;
-MSA *g_ptrPPScoreMSA2 = 0;
+MUSCLE_TLS bool g_bTracePPScore = false;
+MUSCLE_TLS MSA *g_ptrPPScoreMSA1 = 0;
+MUSCLE_TLS MSA *g_ptrPPScoreMSA2 = 0;
 
 static ProfPos *ProfileFromMSALocal(MSA &msa, Tree &tree)
 	{
@@ -1,4 +1,4 @@
-#include "muscle.h"
+#include "RMuscle.h"
 #include "textfile.h"
 #include "seqvect.h"
 #include "distfunc.h"
@@ -7,6 +7,13 @@
 #include "clust.h"
 #include "profile.h"
 #include "clustsetmsa.h"
+#include "pwpath.h"
+#include "musclethreads.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+bool TreeNeededForWeighting(SEQWEIGHT s);
 
 void ProfDB()
 	{
@@ -52,3 +59,182 @@ void ProfDB()
 	TextFile fileOut(g_pstrOutFileName, true);
 	msa1.ToFile(fileOut);
 	}
+
+// Add the sequences msaInput->inputSeqs to the alignment
+// msaInput->profileSeqs. Unlike ProfDB, the profile of the reference
+// alignment is built once and stays fixed: every new sequence is
+// aligned to it on its own (in parallel with -threads), and the
+// columns which new sequences insert between the reference columns
+// are merged in one final pass. Each new sequence gets the residues
+// it inserts between two reference columns left-justified in the
+// merged insert columns.
+void AddSeqsToProfile(MuscleInput *msaInput, MuscleOutput *msaOutput)
+	{
+	SetMaxIters(g_uMaxIters);
+	SetSeqWeightMethod(g_SeqWeight1);
+
+	SeqVect &v = msaInput->inputSeqs;
+	const SeqVect &vRef = msaInput->profileSeqs;
+	const unsigned uRefCount = vRef.Length();
+	const unsigned uSeqCount = v.Length();
+	if (0 == uRefCount)
+		Quit("No sequences in input alignment");
+	if (0 == uSeqCount)
+		Quit("No sequences to add");
+
+	v.StripGaps();
+	SetMuscleAlphaAndMatrix(msaInput);
+
+	const unsigned uColCount = vRef.GetSeq(0).Length();
+	if (0 == uColCount)
+		Quit("Input alignment has no columns");
+	MSA msaRef;
+	msaRef.SetSize(uRefCount, uColCount);
+	for (unsigned uRefIndex = 0; uRefIndex < uRefCount; ++uRefIndex)
+		{
+		const Seq &s = vRef.GetSeq(uRefIndex);
+		if (s.Length() != uColCount)
+			Quit("Sequences of the input alignment differ in length");
+		msaRef.SetSeqName(uRefIndex, s.GetName());
+		for (unsigned uColIndex = 0; uColIndex < uColCount; ++uColIndex)
+			{
+			char c = s[uColIndex];
+			if (IsGapChar(c))
+				c = '-';
+			else if (!IsResidueChar(c))
+				c = GetWildcardChar();
+			msaRef.SetChar(uRefIndex, uColIndex, c);
+			}
+		}
+
+	MSA::SetIdCount(uRefCount + uSeqCount);
+	for (unsigned uRefIndex = 0; uRefIndex < uRefCount; ++uRefIndex)
+		msaRef.SetSeqId(uRefIndex, uRefIndex);
+
+	Tree tree;
+	if (TreeNeededForWeighting(GetSeqWeightMethod()))
+		{
+		if (uRefCount < 3)
+			SetSeqWeightMethod(SEQWEIGHT_None);
+		else
+			{
+			TreeFromMSA(msaRef, tree, g_Cluster2, g_Distance2, g_Root1);
+			SetMuscleTree(tree);
+			}
+		}
+
+	SetProgressDesc("Align sequences to profile");
+	const ProfPos *PA = ProfileFromMSA(msaRef);
+
+// Every new sequence on its own is a profile with weight 1.
+	SetSeqWeightMethod(SEQWEIGHT_None);
+
+// Paths[i] holds the edge types of the alignment of sequence i
+// to the profile: 'M' and 'D' consume a reference column, 'I' is a
+// residue inserted before the next reference column.
+	vector<string> Paths(uSeqCount);
+	ParallelFor(g_uThreads, uSeqCount, [&](unsigned uSeqIndex)
+		{
+		const Seq &s = v.GetSeq(uSeqIndex);
+		string &strPath = Paths[uSeqIndex];
+		if (0 == s.Length())
+			{
+			strPath.assign(uColCount, 'D');
+			return;
+			}
+
+		MSA msaSeq;
+		msaSeq.FromSeq(s);
+		const ProfPos *PB = ProfileFromMSA(msaSeq);
+		PWPath Path;
+		GlobalAlign(PA, uColCount, PB, s.Length(), Path);
+		delete[] PB;
+
+		const unsigned uEdgeCount = Path.GetEdgeCount();
+		strPath.resize(uEdgeCount);
+		for (unsigned uEdgeIndex = 0; uEdgeIndex < uEdgeCount; ++uEdgeIndex)
+			strPath[uEdgeIndex] = Path.GetEdge(uEdgeIndex).cType;
+		});
+	delete[] PA;
+
+// InsertCount[k] is the largest number of residues any new sequence
+// inserts before reference column k (k == uColCount: after the last).
+	vector<unsigned> InsertCount(uColCount + 1, 0);
+	for (unsigned uSeqIndex = 0; uSeqIndex < uSeqCount; ++uSeqIndex)
+		{
+		const string &strPath = Paths[uSeqIndex];
+		unsigned uRefColIndex = 0;
+		unsigned uInserted = 0;
+		for (size_t n = 0; n < strPath.size(); ++n)
+			{
+			if ('I' == strPath[n])
+				{
+				if (++uInserted > InsertCount[uRefColIndex])
+					InsertCount[uRefColIndex] = uInserted;
+				continue;
+				}
+			++uRefColIndex;
+			uInserted = 0;
+			}
+		}
+
+// ColStart[k] is the output column of reference column k.
+	vector<unsigned> ColStart(uColCount + 1);
+	unsigned uOutColCount = 0;
+	for (unsigned uRefColIndex = 0; uRefColIndex <= uColCount; ++uRefColIndex)
+		{
+		uOutColCount += InsertCount[uRefColIndex];
+		ColStart[uRefColIndex] = uOutColCount;
+		++uOutColCount;
+		}
+	--uOutColCount;
+
+	MSA msaOut;
+	msaOut.SetSize(uRefCount + uSeqCount, uOutColCount);
+	for (unsigned uRefIndex = 0; uRefIndex < uRefCount; ++uRefIndex)
+		{
+		msaOut.SetSeqName(uRefIndex, msaRef.GetSeqName(uRefIndex));
+		msaOut.SetSeqId(uRefIndex, uRefIndex);
+		for (unsigned uColIndex = 0; uColIndex < uOutColCount; ++uColIndex)
+			msaOut.SetChar(uRefIndex, uColIndex, '-');
+		for (unsigned uColIndex = 0; uColIndex < uColCount; ++uColIndex)
+			msaOut.SetChar(uRefIndex, ColStart[uColIndex],
+			  msaRef.GetChar(uRefIndex, uColIndex));
+		}
+	msaRef.Clear();
+
+	for (unsigned uSeqIndex = 0; uSeqIndex < uSeqCount; ++uSeqIndex)
+		{
+		const Seq &s = v.GetSeq(uSeqIndex);
+		string &strPath = Paths[uSeqIndex];
+		const unsigned uOutIndex = uRefCount + uSeqIndex;
+		msaOut.SetSeqName(uOutIndex, s.GetName());
+		msaOut.SetSeqId(uOutIndex, uOutIndex);
+		for (unsigned uColIndex = 0; uColIndex < uOutColCount; ++uColIndex)
+			msaOut.SetChar(uOutIndex, uColIndex, '-');
+
+		unsigned uRefColIndex = 0;
+		unsigned uInserted = 0;
+		unsigned uPos = 0;
+		for (size_t n = 0; n < strPath.size(); ++n)
+			{
+			const char cType = strPath[n];
+			if ('I' == cType)
+				{
+				const unsigned uColIndex = ColStart[uRefColIndex] -
+				  InsertCount[uRefColIndex] + uInserted;
+				msaOut.SetChar(uOutIndex, uColIndex, s[uPos++]);
+				++uInserted;
+				continue;
+				}
+			if ('M' == cType)
+				msaOut.SetChar(uOutIndex, ColStart[uRefColIndex], s[uPos++]);
+			++uRefColIndex;
+			uInserted = 0;
+			}
+		string().swap(strPath);
+		}
+	ProgressStepsDone();
+
+	DoMuscleOutput(msaOut, &msaOutput->msa);
+	}
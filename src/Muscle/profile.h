@@ -54,7 +54,7 @@ struct ProgNode
 extern unsigned ResidueGroup[];
 const unsigned RESIDUE_GROUP_MULTIPLE = (unsigned) ~0;
 
-extern PTR_SCOREMATRIX g_ptrScoreMatrix;
+extern MUSCLE_TLS PTR_SCOREMATRIX g_ptrScoreMatrix;
 
 ProfPos *ProfileFromMSA(const MSA &a);
 
@@ -94,6 +94,7 @@ double PctIdToMAFFTDist(double dPctId);
 bool RefineBlocks(MSA &msa, const Tree &tree);
 bool RefineSubfams(MSA &msaIn, const Tree &tree, unsigned uIters);
 void SetMuscleTree(const Tree &tree);
+const Tree *GetMuscleTree();
 void CalcClustalWWeights(const Tree &tree, WEIGHT Weights[]);
 void RealignDiffs(const MSA &msaIn, const Tree &Diffs,
   const unsigned IdToDiffsTreeNodeIndex[], MSA &msaOut);
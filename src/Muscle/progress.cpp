@@ -5,15 +5,15 @@
 // Functions that provide visible feedback to the user
 // that progress is being made.
 
-static unsigned g_uIter = 0;		// Main MUSCLE iteration 1, 2..
-static unsigned g_uLocalMaxIters = 0;	// Max iters
-static FILE *g_fProgress = stderr;	// Default to standard error
-static char g_strFileName[32];		// File name
-static time_t g_tLocalStart;				// Start time
-static char g_strDesc[32];			// Description
-static bool g_bWipeDesc = false;
-static int g_nPrevDescLength;
-static unsigned g_uTotalSteps;
+static MUSCLE_TLS unsigned g_uIter = 0;		// Main MUSCLE iteration 1, 2..
+static MUSCLE_TLS unsigned g_uLocalMaxIters = 0;	// Max iters
+static MUSCLE_TLS FILE *g_fProgress = stderr;	// Default to standard error
+static MUSCLE_TLS char g_strFileName[32];		// File name
+static MUSCLE_TLS time_t g_tLocalStart;				// Start time
+static MUSCLE_TLS char g_strDesc[32];			// Description
+static MUSCLE_TLS bool g_bWipeDesc = false;
+static MUSCLE_TLS int g_nPrevDescLength;
+static MUSCLE_TLS unsigned g_uTotalSteps;
 
 const char *ElapsedTimeAsStr()
 	{
@@ -27,9 +27,9 @@ const char *MemToStr(double MB)
 	if (MB < 0)
 		return "";
 
-	static char Str[16];
-	static double MaxMB = 0;
-	static double RAMMB = 0;
+	static MUSCLE_TLS char Str[16];
+	static MUSCLE_TLS double MaxMB = 0;
+	static MUSCLE_TLS double RAMMB = 0;
 
 	if (RAMMB == 0)
 		RAMMB = GetRAMSizeMB();
@@ -6,9 +6,53 @@
 #include "msa.h"
 #include "pwpath.h"
 #include "distfunc.h"
+#include "musclethreads.h"
+#include <thread>
+#include <atomic>
 
 #define TRACE 0
 
+// Leaf: MSA from sequence. Internal node: align the MSAs of the two
+// children, which must be done already.
+static void ProgressiveAlignNode(const SeqVect &v, const Tree &GuideTree,
+  ProgNode *ProgNodes, unsigned uTreeNodeIndex)
+	{
+	const unsigned uSeqCount = v.Length();
+	const unsigned uNodeCount = 2*uSeqCount - 1;
+
+	if (GuideTree.IsLeaf(uTreeNodeIndex))
+		{
+		if (uTreeNodeIndex >= uNodeCount)
+			Quit("TreeNodeIndex=%u NodeCount=%u\n", uTreeNodeIndex, uNodeCount);
+		ProgNode &Node = ProgNodes[uTreeNodeIndex];
+		unsigned uId = GuideTree.GetLeafId(uTreeNodeIndex);
+		if (uId >= uSeqCount)
+			Quit("Seq index out of range");
+		const Seq &s = *(v[uId]);
+		Node.m_MSA.FromSeq(s);
+		Node.m_MSA.SetSeqId(0, uId);
+		Node.m_uLength = Node.m_MSA.GetColCount();
+		}
+	else
+		{
+		const unsigned uMergeNodeIndex = uTreeNodeIndex;
+		ProgNode &Parent = ProgNodes[uMergeNodeIndex];
+
+		const unsigned uLeft = GuideTree.GetLeft(uTreeNodeIndex);
+		const unsigned uRight = GuideTree.GetRight(uTreeNodeIndex);
+
+		ProgNode &Node1 = ProgNodes[uLeft];
+		ProgNode &Node2 = ProgNodes[uRight];
+
+		PWPath Path;
+		AlignTwoMSAs(Node1.m_MSA, Node2.m_MSA, Parent.m_MSA, Path);
+		Parent.m_uLength = Parent.m_MSA.GetColCount();
+
+		Node1.m_MSA.Clear();
+		Node2.m_MSA.Clear();
+		}
+	}
+
 void ProgressiveAlign(const SeqVect &v, const Tree &GuideTree, MSA &a)
 	{
 	assert(GuideTree.IsRooted());
@@ -23,48 +67,39 @@ void ProgressiveAlign(const SeqVect &v, const Tree &GuideTree, MSA &a)
 
 	ProgNode *ProgNodes = new ProgNode[uNodeCount];
 
-	unsigned uJoin = 0;
-	unsigned uTreeNodeIndex = GuideTree.FirstDepthFirstNode();
 	SetProgressDesc("Align node");
-	do
+	if (g_uThreads > 1)
 		{
-		if (GuideTree.IsLeaf(uTreeNodeIndex))
+	// Progress is only reported by this thread.
+		const std::thread::id MainThread = std::this_thread::get_id();
+		std::atomic<unsigned> uJoin(0);
+		ParallelPostorder(GuideTree, g_uThreads, [&](unsigned uTreeNodeIndex)
 			{
-			if (uTreeNodeIndex >= uNodeCount)
-				Quit("TreeNodeIndex=%u NodeCount=%u\n", uTreeNodeIndex, uNodeCount);
-			ProgNode &Node = ProgNodes[uTreeNodeIndex];
-			unsigned uId = GuideTree.GetLeafId(uTreeNodeIndex);
-			if (uId >= uSeqCount)
-				Quit("Seq index out of range");
-			const Seq &s = *(v[uId]);
-			Node.m_MSA.FromSeq(s);
-			Node.m_MSA.SetSeqId(0, uId);
-			Node.m_uLength = Node.m_MSA.GetColCount();
-			}
-		else
+			if (!GuideTree.IsLeaf(uTreeNodeIndex))
+				{
+				const unsigned uJoinIndex = uJoin++;
+				if (std::this_thread::get_id() == MainThread)
+					Progress(uJoinIndex, uSeqCount - 1);
+				}
+			ProgressiveAlignNode(v, GuideTree, ProgNodes, uTreeNodeIndex);
+			});
+		}
+	else
+		{
+		unsigned uJoin = 0;
+		unsigned uTreeNodeIndex = GuideTree.FirstDepthFirstNode();
+		do
 			{
-			Progress(uJoin, uSeqCount - 1);
-			++uJoin;
-
-			const unsigned uMergeNodeIndex = uTreeNodeIndex;
-			ProgNode &Parent = ProgNodes[uMergeNodeIndex];
-
-			const unsigned uLeft = GuideTree.GetLeft(uTreeNodeIndex);
-			const unsigned uRight = GuideTree.GetRight(uTreeNodeIndex);
-
-			ProgNode &Node1 = ProgNodes[uLeft];
-			ProgNode &Node2 = ProgNodes[uRight];
-
-			PWPath Path;
-			AlignTwoMSAs(Node1.m_MSA, Node2.m_MSA, Parent.m_MSA, Path);
-			Parent.m_uLength = Parent.m_MSA.GetColCount();
-
-			Node1.m_MSA.Clear();
-			Node2.m_MSA.Clear();
+			if (!GuideTree.IsLeaf(uTreeNodeIndex))
+				{
+				Progress(uJoin, uSeqCount - 1);
+				++uJoin;
+				}
+			ProgressiveAlignNode(v, GuideTree, ProgNodes, uTreeNodeIndex);
+			uTreeNodeIndex = GuideTree.NextDepthFirstNode(uTreeNodeIndex);
 			}
-		uTreeNodeIndex = GuideTree.NextDepthFirstNode(uTreeNodeIndex);
+		while (NULL_NEIGHBOR != uTreeNodeIndex);
 		}
-	while (NULL_NEIGHBOR != uTreeNodeIndex);
 	ProgressStepsDone();
 
 	unsigned uRootNodeIndex = GuideTree.GetRootNodeIndex();
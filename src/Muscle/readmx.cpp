@@ -1,13 +1,14 @@
 #include "muscle.h"
 #include "textfile.h"
+#include "../ScoreTableCache.h"
 
 #define TRACE	0
 
 const int MAX_LINE = 4096;
-const int MAX_HEADINGS = 20;
-static char Heading[MAX_HEADINGS];
-static unsigned HeadingCount = 0;
-static float Mx[32][32];
+const int MAX_HEADINGS = 32;
+static MUSCLE_TLS char Heading[MAX_HEADINGS];
+static MUSCLE_TLS unsigned HeadingCount = 0;
+static MUSCLE_TLS float Mx[32][32];
 
 static void LogMx()
 	{
@@ -157,7 +158,7 @@ ExitLoop:;
 	return &Mx;
 	}
 
-PTR_SCOREMATRIX ReadMxFromR(std::vector<std::string> colnames, float matrix[32][32]) {
+static void ParseMxFromR(const std::vector<std::string> &colnames, float matrix[32][32]) {
     // Read column headers
 	HeadingCount = colnames.size();
 	for (int i = 0, n = HeadingCount; i < n; i++) {
@@ -244,7 +245,36 @@ PTR_SCOREMATRIX ReadMxFromR(std::vector<std::string> colnames, float matrix[32][
 
 	if (g_bVerbose)
 		LogMx();
+}
 
-	return &Mx;
+// The translated matrix only depends on the alphabet, the headings and
+// the values, so it is prepared once per process (ScoreTableCache.h) and
+// shared by all alignments and threads that use the same matrix.
+PTR_SCOREMATRIX ReadMxFromR(std::vector<std::string> colnames, float matrix[32][32]) {
+	const unsigned n = (unsigned) colnames.size();
+	if (n > MAX_HEADINGS)
+		Quit("Error in matrix: > %d headers", MAX_HEADINGS);
+
+	std::string Key("muscle:R:");
+	ScoreTableKey(Key, g_Alpha);
+	for (unsigned i = 0; i < n; ++i)
+		Key += colnames[i].empty() ? ' ' : colnames[i].at(0);
+	for (unsigned i = 0; i < n; ++i)
+		Key.append((const char *) matrix[i], n*sizeof(float));
+
+	struct PreparedMx { SCOREMATRIX m; };
+	const PreparedMx *ptrPrepared = ScoreTableGet<PreparedMx>(Key,
+	  [&](PreparedMx &Prepared)
+		{
+		ParseMxFromR(colnames, matrix);
+		memcpy(Prepared.m, Mx, sizeof(Mx));
+		});
+	if (0 == ptrPrepared)
+		{
+		ParseMxFromR(colnames, matrix);
+		return &Mx;
+		}
+	return const_cast<PTR_SCOREMATRIX>(&ptrPrepared->m);
 }
 
+
@@ -5,23 +5,31 @@
 #include "profile.h"
 #include "scorehistory.h"
 #include "objscore.h"
+#include "musclethreads.h"
+#include <vector>
 
-unsigned g_uRefineHeightSubtree;
-unsigned g_uRefineHeightSubtreeTotal;
+MUSCLE_TLS unsigned g_uRefineHeightSubtree;
+MUSCLE_TLS unsigned g_uRefineHeightSubtreeTotal;
 
 #define TRACE			0
 #define DIFFOBJSCORE	0
 
+// If realigning the two groups improves the objective score, return
+// true and the new alignment in msaRealigned. msaIn is only changed
+// by setting its sequence weights.
 static bool TryRealign(MSA &msaIn, const Tree &tree, const unsigned Leaves1[],
   unsigned uCount1, const unsigned Leaves2[], unsigned uCount2,
   SCORE *ptrscoreBefore, SCORE *ptrscoreAfter,
-  bool bLockLeft, bool bLockRight)
+  bool bLockLeft, bool bLockRight, MSA &msaRealigned)
 	{
 #if	TRACE
 	Log("TryRealign, msaIn=\n");
 	msaIn.LogMe();
 #endif
 
+	*ptrscoreBefore = 0;
+	*ptrscoreAfter = 0;
+
 	const unsigned uSeqCount = msaIn.GetSeqCount();
 
 	unsigned *Ids1 = new unsigned[uSeqCount];
@@ -59,7 +67,6 @@ static bool TryRealign(MSA &msaIn, const Tree &tree, const unsigned Leaves1[],
 		return false;
 	}
 
-	MSA msaRealigned;
 	PWPath pathAfter;
 
 	AlignTwoMSAs(msa1, msa2, msaRealigned, pathAfter, bLockLeft, bLockRight);
@@ -67,8 +74,8 @@ static bool TryRealign(MSA &msaIn, const Tree &tree, const unsigned Leaves1[],
 	bool bAnyChanges = !pathAfter.Equal(pathBefore);
 	unsigned uDiffCount1;
 	unsigned uDiffCount2;
-	static unsigned Edges1[10000];
-	static unsigned Edges2[10000];
+	static MUSCLE_TLS unsigned Edges1[10000];
+	static MUSCLE_TLS unsigned Edges2[10000];
 	DiffPaths(pathBefore, pathAfter, Edges1, &uDiffCount1, Edges2, &uDiffCount2);
 
 #if	TRACE
@@ -114,13 +121,55 @@ static bool TryRealign(MSA &msaIn, const Tree &tree, const unsigned Leaves1[],
 	*ptrscoreAfter = scoreAfter;
 #endif
 
-	if (bAccept)
-		msaIn.Copy(msaRealigned);
 	delete[] Ids1;
 	delete[] Ids2;
 	return bAccept;
 	}
 
+// Realign the subtree under uNeighborNodeIndex (a child of
+// uInternalNodeIndex) against the rest of the tree.
+static bool RealignEdge(MSA &msaIn, const Tree &tree,
+  unsigned uInternalNodeIndex, unsigned uNeighborNodeIndex,
+  unsigned Leaves1[], unsigned Leaves2[],
+  SCORE *ptrscoreBefore, SCORE *ptrscoreAfter,
+  bool bLockLeft, bool bLockRight, MSA &msaRealigned)
+	{
+	const unsigned uRootNodeIndex = tree.GetRootNodeIndex();
+
+	g_uTreeSplitNode1 = uInternalNodeIndex;
+	g_uTreeSplitNode2 = uNeighborNodeIndex;
+
+	unsigned uCount1;
+	unsigned uCount2;
+
+	GetLeaves(tree, uNeighborNodeIndex, Leaves1, &uCount1);
+	GetLeavesExcluding(tree, uRootNodeIndex, uNeighborNodeIndex,
+	  Leaves2, &uCount2);
+
+#if	TRACE
+	Log("\nRefineHeightParts node %u\n", uInternalNodeIndex);
+	Log("Group1=");
+	for (unsigned n = 0; n < uCount1; ++n)
+		Log(" %u(%s)", Leaves1[n], tree.GetName(Leaves1[n]));
+	Log("\n");
+	Log("Group2=");
+	for (unsigned n = 0; n < uCount2; ++n)
+		Log(" %u(%s)", Leaves2[n], tree.GetName(Leaves2[n]));
+	Log("\n");
+#endif
+
+	return TryRealign(msaIn, tree, Leaves1, uCount1, Leaves2, uCount2,
+	  ptrscoreBefore, ptrscoreAfter, bLockLeft, bLockRight, msaRealigned);
+	}
+
+static unsigned GetNeighbor(const Tree &tree, unsigned uInternalNodeIndex,
+  bool bRight)
+	{
+	if (bRight)
+		return tree.GetRight(uInternalNodeIndex);
+	return tree.GetLeft(uInternalNodeIndex);
+	}
+
 static void RefineHeightParts(MSA &msaIn, const Tree &tree,
  const unsigned InternalNodeIndexes[], bool bReversed, bool bRight,
  unsigned uIter, 
@@ -135,45 +184,22 @@ static void RefineHeightParts(MSA &msaIn, const Tree &tree,
 	unsigned *Leaves1 = new unsigned[uSeqCount];
 	unsigned *Leaves2 = new unsigned[uSeqCount];
 
-	const unsigned uRootNodeIndex = tree.GetRootNodeIndex();
 	bool bAnyAccepted = false;
 	for (unsigned i = 0; i < uInternalNodeCount; ++i)
 		{
 		const unsigned uInternalNodeIndex = InternalNodeIndexes[i];
-		unsigned uNeighborNodeIndex;
 		if (tree.IsRoot(uInternalNodeIndex) && !bRight)
 			continue;
-		else if (bRight)
-			uNeighborNodeIndex = tree.GetRight(uInternalNodeIndex);
-		else
-			uNeighborNodeIndex = tree.GetLeft(uInternalNodeIndex);
-
-		g_uTreeSplitNode1 = uInternalNodeIndex;
-		g_uTreeSplitNode2 = uNeighborNodeIndex;
-
-		unsigned uCount1;
-		unsigned uCount2;
-
-		GetLeaves(tree, uNeighborNodeIndex, Leaves1, &uCount1);
-		GetLeavesExcluding(tree, uRootNodeIndex, uNeighborNodeIndex,
-		  Leaves2, &uCount2);
-
-#if	TRACE
-		Log("\nRefineHeightParts node %u\n", uInternalNodeIndex);
-		Log("Group1=");
-		for (unsigned n = 0; n < uCount1; ++n)
-			Log(" %u(%s)", Leaves1[n], tree.GetName(Leaves1[n]));
-		Log("\n");
-		Log("Group2=");
-		for (unsigned n = 0; n < uCount2; ++n)
-			Log(" %u(%s)", Leaves2[n], tree.GetName(Leaves2[n]));
-		Log("\n");
-#endif
+		const unsigned uNeighborNodeIndex = GetNeighbor(tree, uInternalNodeIndex, bRight);
 
 		SCORE scoreBefore;
 		SCORE scoreAfter;
-		bool bAccepted = TryRealign(msaIn, tree, Leaves1, uCount1, Leaves2, uCount2,
-		  &scoreBefore, &scoreAfter, bLockLeft, bLockRight);
+		MSA msaRealigned;
+		bool bAccepted = RealignEdge(msaIn, tree, uInternalNodeIndex,
+		  uNeighborNodeIndex, Leaves1, Leaves2, &scoreBefore, &scoreAfter,
+		  bLockLeft, bLockRight, msaRealigned);
+		if (bAccepted)
+			msaIn.Copy(msaRealigned);
 		SetCurrentAlignment(msaIn);
 
 		++g_uRefineHeightSubtree;
@@ -202,6 +228,115 @@ static void RefineHeightParts(MSA &msaIn, const Tree &tree,
 	*ptrbAnyChanges = bAnyAccepted;
 	}
 
+struct RealignResult
+	{
+	bool m_bAccepted;
+	SCORE m_scoreBefore;
+	SCORE m_scoreAfter;
+	MSA m_msaRealigned;
+	};
+
+// Same as RefineHeightParts, using g_uThreads threads.
+// The next g_uThreads edges are realigned at the same time, all
+// against the current alignment. The results are then used in edge
+// order, exactly as by the loop above. Once an edge is accepted the
+// alignment has changed, so the results of the following edges are
+// discarded and these edges are tried again against the new
+// alignment. Most edges are rejected, so little work is wasted and
+// the result is the same as with one thread.
+static void RefineHeightPartsThreads(MSA &msaIn, const Tree &tree,
+ const unsigned InternalNodeIndexes[], bool bReversed, bool bRight,
+ unsigned uIter,
+ ScoreHistory &History,
+ bool *ptrbAnyChanges, bool *ptrbOscillating, bool bLockLeft, bool bLockRight)
+	{
+	*ptrbOscillating = false;
+
+	const unsigned uSeqCount = msaIn.GetSeqCount();
+	const unsigned uInternalNodeCount = uSeqCount - 1;
+
+	std::vector<unsigned> Edges;
+	for (unsigned i = 0; i < uInternalNodeCount; ++i)
+		{
+		const unsigned uInternalNodeIndex = InternalNodeIndexes[i];
+		if (tree.IsRoot(uInternalNodeIndex) && !bRight)
+			continue;
+		Edges.push_back(uInternalNodeIndex);
+		}
+	const unsigned uEdgeCount = (unsigned) Edges.size();
+
+	const unsigned uBatchSize = g_uThreads;
+	RealignResult *Results = new RealignResult[uBatchSize];
+
+	bool bAnyAccepted = false;
+	unsigned uEdgeIndex = 0;
+	while (uEdgeIndex < uEdgeCount)
+		{
+		const unsigned uFirstEdgeIndex = uEdgeIndex;
+		unsigned uCount = uEdgeCount - uFirstEdgeIndex;
+		if (uCount > uBatchSize)
+			uCount = uBatchSize;
+
+		ParallelFor(g_uThreads, uCount, [&](unsigned k)
+			{
+			const unsigned uInternalNodeIndex = Edges[uFirstEdgeIndex + k];
+			const unsigned uNeighborNodeIndex = GetNeighbor(tree, uInternalNodeIndex, bRight);
+			RealignResult &Result = Results[k];
+
+		// TryRealign sets the weights of its input, so each edge
+		// gets its own copy.
+			MSA msaBase;
+			msaBase.Copy(msaIn);
+			Result.m_msaRealigned.Clear();
+			unsigned *Leaves1 = new unsigned[uSeqCount];
+			unsigned *Leaves2 = new unsigned[uSeqCount];
+			Result.m_bAccepted = RealignEdge(msaBase, tree, uInternalNodeIndex,
+			  uNeighborNodeIndex, Leaves1, Leaves2,
+			  &Result.m_scoreBefore, &Result.m_scoreAfter,
+			  bLockLeft, bLockRight, Result.m_msaRealigned);
+			delete[] Leaves1;
+			delete[] Leaves2;
+			});
+
+		for (unsigned k = 0; k < uCount; ++k)
+			{
+			const unsigned uInternalNodeIndex = Edges[uEdgeIndex];
+			const RealignResult &Result = Results[k];
+			++uEdgeIndex;
+
+			g_uTreeSplitNode1 = uInternalNodeIndex;
+			g_uTreeSplitNode2 = GetNeighbor(tree, uInternalNodeIndex, bRight);
+			if (Result.m_bAccepted)
+				msaIn.Copy(Result.m_msaRealigned);
+			SetCurrentAlignment(msaIn);
+
+			++g_uRefineHeightSubtree;
+			Progress(g_uRefineHeightSubtree, g_uRefineHeightSubtreeTotal);
+
+			const SCORE scoreBefore = Result.m_scoreBefore;
+			const SCORE scoreAfter = Result.m_scoreAfter;
+			SCORE scoreMax = scoreAfter > scoreBefore? scoreAfter : scoreBefore;
+			bool bRepeated = History.SetScore(uIter, uInternalNodeIndex, bRight, scoreMax);
+			if (bRepeated)
+				{
+				*ptrbOscillating = true;
+				goto Done;
+				}
+
+			if (Result.m_bAccepted)
+				{
+				bAnyAccepted = true;
+				break;
+				}
+			}
+		}
+
+Done:
+	delete[] Results;
+
+	*ptrbAnyChanges = bAnyAccepted;
+	}
+
 // Return true if any changes made
 bool RefineHoriz(MSA &msaIn, const Tree &tree, unsigned uIters, bool bLockLeft,
   bool bLockRight)
@@ -260,10 +395,16 @@ bool RefineHoriz(MSA &msaIn, const Tree &tree, unsigned uIters, bool bLockLeft,
 			default:
 				Quit("RefineHeight default case");
 				}
-			RefineHeightParts(msaIn, tree, Internals, bReverse, bRight,
-			  uIter, 
-			  History, 
-			  &bAnyChanges, &bOscillating, bLockLeft, bLockRight);
+			if (g_uThreads > 1)
+				RefineHeightPartsThreads(msaIn, tree, Internals, bReverse, bRight,
+				  uIter,
+				  History,
+				  &bAnyChanges, &bOscillating, bLockLeft, bLockRight);
+			else
+				RefineHeightParts(msaIn, tree, Internals, bReverse, bRight,
+				  uIter, 
+				  History, 
+				  &bAnyChanges, &bOscillating, bLockLeft, bLockRight);
 			if (bOscillating)
 				{
 				ProgressStepsDone();
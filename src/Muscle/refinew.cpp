@@ -1,7 +1,10 @@
-#include "muscle.h"
+#include "RMuscle.h"
 #include "msa.h"
 #include "seqvect.h"
 #include "textfile.h"
+#include "musclethreads.h"
+#include <mutex>
+#include <vector>
 
 #define MEMDEBUG	0
 
@@ -69,6 +72,12 @@ static void SeqVectFromMSACols(const MSA &msa, unsigned uColFrom, unsigned uColT
 		}
 	}
 
+// The windows are aligned independently of each other, up to
+// g_uThreads at a time. Every window starts from the same settings
+// (MUSCLE() changes some of them, e.g. the alphabet), so the result
+// does not depend on the number of threads. Finished windows are
+// appended to msaOut in order as soon as all windows before them are
+// done; only the windows that finished early are kept in memory.
 void RefineW(const MSA &msaIn, MSA &msaOut)
 	{
 	const unsigned uSeqCount = msaIn.GetSeqCount();
@@ -98,10 +107,30 @@ void RefineW(const MSA &msaIn, MSA &msaOut)
 		MSAFromColRange(msaIn, 0, g_uWindowOffset, msaOut);
 		}
 
-	fprintf(stderr, "\n");
-	for (unsigned uWindowIndex = g_uWindowFrom; uWindowIndex <= g_uWindowTo; ++uWindowIndex)
+	if (g_uWindowFrom > g_uWindowTo)
+		return;
+	const unsigned uRunCount = g_uWindowTo - g_uWindowFrom + 1;
+
+// Threads left over when there are fewer windows than threads are
+// used within the windows.
+	const unsigned uThreads = g_uThreads;
+	const bool bQuiet = g_bQuiet;
+	g_uThreads = uThreads > uRunCount ? uThreads/uRunCount : 1;
+	if (uThreads > 1 && uRunCount > 1)
+		g_bQuiet = true;
+	const MuscleThreadState State;
+
+	std::mutex Mutex;
+	std::vector<MSA *> Done(uRunCount, 0);
+	unsigned uNextAppend = 0;
+
+	if (!bQuiet)
+		fprintf(stderr, "\n");
+	ParallelFor(uThreads, uRunCount, [&](unsigned uRunIndex)
 		{
-		fprintf(stderr, "Window %d of %d    \r", uWindowIndex, uWindowCount);
+		State.Apply();
+
+		const unsigned uWindowIndex = g_uWindowFrom + uRunIndex;
 		const unsigned uColFrom = g_uWindowOffset + uWindowIndex*g_uRefineWindow;
 		unsigned uColTo = uColFrom + g_uRefineWindow - 1;
 		if (uColTo >= uColCount)
@@ -116,13 +145,11 @@ void RefineW(const MSA &msaIn, MSA &msaOut)
 		_CrtMemCheckpoint(&s1);
 #endif
 
-		MSA msaTmp;
-		MUSCLE(v, msaTmp);
-		AppendMSA(msaOut, msaTmp);
+		MSA *msaTmp = new MSA;
+		MUSCLE(v, *msaTmp);
 		if (uWindowIndex == g_uSaveWindow)
 			{
 			MSA msaInTmp;
-			unsigned uOutCols = msaOut.GetColCount();
 			unsigned un = uColTo - uColFrom + 1;
 			MSAFromColRange(msaIn, uColFrom, un, msaInTmp);
 
@@ -137,7 +164,7 @@ void RefineW(const MSA &msaIn, MSA &msaOut)
 
 			sprintf(fn, "win%d_outaln.tmp", uWindowIndex);
 			TextFile fOut(fn, true);
-			msaTmp.ToFile(fOut);
+			msaTmp->ToFile(fOut);
 			}
 
 #if	MEMDEBUG
@@ -157,13 +184,30 @@ void RefineW(const MSA &msaIn, MSA &msaOut)
 //#if	DEBUG
 //		AssertMSAEqIgnoreCaseAndGaps(msaInTmp, msaTmp);
 //#endif
-		}
-	fprintf(stderr, "\n");
+
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Done[uRunIndex] = msaTmp;
+		while (uNextAppend < uRunCount && 0 != Done[uNextAppend])
+			{
+			AppendMSA(msaOut, *Done[uNextAppend]);
+			delete Done[uNextAppend];
+			Done[uNextAppend] = 0;
+			++uNextAppend;
+			if (!bQuiet)
+				fprintf(stderr, "Window %u of %u    \r",
+				  g_uWindowFrom + uNextAppend, uWindowCount);
+			}
+		});
+	if (!bQuiet)
+		fprintf(stderr, "\n");
+
+	g_uThreads = uThreads;
+	g_bQuiet = bQuiet;
 
 //	AssertMSAEqIgnoreCaseAndGaps(msaIn, msaOut);//@@uncomment!
 	}
 
-void DoRefineW()
+void DoRefineW(MuscleInput *msaInput, MuscleOutput *msaOutput)
 	{
 	SetOutputFileName(g_pstrOutFileName);
 	SetInputFileName(g_pstrInFileName);
@@ -172,13 +216,37 @@ void DoRefineW()
 	SetMaxIters(g_uMaxIters);
 	SetSeqWeightMethod(g_SeqWeight1);
 
-	TextFile fileIn(g_pstrInFileName);
 	MSA msa;
-	msa.FromFile(fileIn);
+	const SeqVect &vIn = msaInput->inputSeqs;
+	if (0 == vIn.Length())
+		{
+		TextFile fileIn(g_pstrInFileName);
+		msa.FromFile(fileIn);
+		}
+	else
+		{
+	// Rows of the alignment from R, gaps included
+		const unsigned uColCount = vIn.GetSeq(0).Length();
+		msa.SetSize(vIn.Length(), uColCount);
+		for (unsigned uSeqIndex = 0; uSeqIndex < vIn.Length(); ++uSeqIndex)
+			{
+			const Seq &s = vIn.GetSeq(uSeqIndex);
+			if (s.Length() != uColCount)
+				Quit("Sequences of the input alignment differ in length");
+			msa.SetSeqName(uSeqIndex, s.GetName());
+			for (unsigned uColIndex = 0; uColIndex < uColCount; ++uColIndex)
+				{
+				const char c = s[uColIndex];
+				msa.SetChar(uSeqIndex, uColIndex, IsGapChar(c) ? '-' : c);
+				}
+			}
+		}
 
 	const unsigned uSeqCount = msa.GetSeqCount();
 	if (0 == uSeqCount)
 		Quit("No sequences in input file");
+	if (0 == msa.GetColCount())
+		Quit("Input alignment has no columns");
 
 	MSA::SetIdCount(uSeqCount);
 
@@ -223,5 +291,5 @@ void DoRefineW()
 
 //	TextFile fileOut(g_pstrOutFileName, true);
 //	msaOut.ToFile(fileOut);
-	DoMuscleOutput(msaOut);
+	DoMuscleOutput(msaOut, &msaOutput->msa);
 	}
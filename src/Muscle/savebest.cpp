@@ -3,8 +3,8 @@
 #include "textfile.h"
 #include <time.h>
 
-MSA *ptrBestMSA;
-static const char *pstrOutputFileName;
+MUSCLE_TLS MSA *ptrBestMSA;
+static MUSCLE_TLS const char *pstrOutputFileName;
 
 void SetOutputFileName(const char *out)
 	{
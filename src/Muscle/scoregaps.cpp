@@ -11,23 +11,28 @@ struct GAPINFO
 	unsigned End;
 	};
 
-static GAPINFO **g_Gaps;
-static GAPINFO *g_FreeList;
-static unsigned g_MaxSeqCount;
-static unsigned g_MaxColCount;
-static unsigned g_ColCount;
-static bool *g_ColDiff;
+static MUSCLE_TLS GAPINFO **g_Gaps;
+static MUSCLE_TLS GAPINFO *g_FreeList;
+static MUSCLE_TLS unsigned g_MaxSeqCount;
+static MUSCLE_TLS unsigned g_MaxColCount;
+static MUSCLE_TLS unsigned g_ColCount;
+static MUSCLE_TLS bool *g_ColDiff;
+static MUSCLE_TLS GAPINFO *g_BlockList;
 
 static GAPINFO *NewGapInfo()
 	{
 	if (0 == g_FreeList)
 		{
+// Element 0 of each block links the blocks so that
+// FreeScoreGapsMem can release them.
 		const int NEWCOUNT = 256;
-		GAPINFO *NewList = new GAPINFO[NEWCOUNT];
-		g_FreeList = &NewList[0];
-		for (int i = 0; i < NEWCOUNT-1; ++i)
+		GAPINFO *NewList = new GAPINFO[NEWCOUNT+1];
+		NewList[0].Next = g_BlockList;
+		g_BlockList = NewList;
+		g_FreeList = &NewList[1];
+		for (int i = 1; i < NEWCOUNT; ++i)
 			NewList[i].Next = &NewList[i+1];
-		NewList[NEWCOUNT-1].Next = 0;
+		NewList[NEWCOUNT].Next = 0;
 		}
 	GAPINFO *GI = g_FreeList;
 	g_FreeList = g_FreeList->Next;
@@ -40,6 +45,24 @@ static void FreeGapInfo(GAPINFO *GI)
 	g_FreeList = GI;
 	}
 
+void FreeScoreGapsMem()
+	{
+	while (0 != g_BlockList)
+		{
+		GAPINFO *Next = g_BlockList->Next;
+		delete[] g_BlockList;
+		g_BlockList = Next;
+		}
+	g_FreeList = 0;
+
+	delete[] g_Gaps;
+	delete[] g_ColDiff;
+	g_Gaps = 0;
+	g_ColDiff = 0;
+	g_MaxSeqCount = 0;
+	g_MaxColCount = 0;
+	}
+
 // TODO: This could be much faster, no need to look
 // at all columns.
 static void FindIntersectingGaps(const MSA &msa, unsigned SeqIndex)
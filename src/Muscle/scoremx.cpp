@@ -8,7 +8,7 @@ extern SCOREMATRIX VTML_SP;
 extern SCOREMATRIX VTML_SPNoCenter;
 extern SCOREMATRIX NUC_SP;
 
-PTR_SCOREMATRIX g_ptrScoreMatrix;
+MUSCLE_TLS PTR_SCOREMATRIX g_ptrScoreMatrix;
 
 void SetScoreMatrix()
 	{
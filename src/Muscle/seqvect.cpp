@@ -2,6 +2,7 @@
 #include "seqvect.h"
 #include "textfile.h"
 #include "msa.h"
+#include "../FastaScanner.h"
 
 const size_t MAX_FASTA_LINE = 16000;
 
@@ -54,6 +55,66 @@ void SeqVect::FromFASTAFile(TextFile &File)
 		}
 	}
 
+// Same as FromFASTAFile(TextFile &) (via GetFastaSeq), but the file is
+// scanned in memory and may be gzip-compressed; residues are uppercased
+// and written straight into the Seq without intermediate buffers.
+void SeqVect::FromFASTAFile(const char *FileName)
+	{
+	Clear();
+
+	unsigned char Map[256];
+	for (unsigned c = 0; c < 256; ++c)
+		{
+		if (isspace(c))
+			Map[c] = FASTA_SKIP;
+		else if (IsGapChar(c))
+			Map[c] = FASTA_SKIP;
+		else if (isalpha(c))
+			Map[c] = (unsigned char) toupper(c);
+		else
+			Map[c] = FASTA_INVALID;
+		}
+
+	fasta_file_t File;
+	if (0 != FastaOpen(&File, FileName))
+		Quit("Cannot open %s", FileName);
+
+	fasta_record_t Rec;
+	while (FastaNextRecord(&File, &Rec))
+		{
+		if (File.junk)
+			{
+			FastaClose(&File);
+			Quit("Invalid file format, expected '>' to start FASTA label");
+			}
+		if (0 != memchr(Rec.body, '>', Rec.bodyLen))
+			{
+			FastaClose(&File);
+			Quit("Unexpected '>' in FASTA sequence data");
+			}
+
+		Seq *ptrSeq = new Seq;
+		ptrSeq->resize(Rec.bodyLen);
+		size_t uInvalid = 0;
+		size_t uLength = Rec.bodyLen == 0 ? 0 :
+		  FastaEncode(&Rec, Map, &(*ptrSeq)[0], &uInvalid);
+		ptrSeq->resize(uLength);
+
+		const std::string Label(Rec.name, Rec.nameLen);
+		if (uInvalid > 0)
+			Warning("%u invalid characters in FASTA sequence data of %s, ignored",
+			  (unsigned) uInvalid, Label.c_str());
+		if (0 == uLength)
+			{
+			delete ptrSeq;
+			continue;
+			}
+		ptrSeq->SetName(Label.c_str());
+		push_back(ptrSeq);
+		}
+	FastaClose(&File);
+	}
+
 void SeqVect::PadToMSA(MSA &msa)
 	{
 	unsigned uSeqCount = Length();
@@ -24,6 +24,7 @@ public:
 		}
 
 	void FromFASTAFile(TextFile &File);
+	void FromFASTAFile(const char *FileName);
 	void ToFASTAFile(TextFile &File) const;
 
 	void ToFile(TextFile &File) const
@@ -11,7 +11,7 @@ void OnOutOfMemory()
 	free(EmergencyReserve);
 	fprintf(stderr, "\n*** OUT OF MEMORY ***\n");
 	fprintf(stderr, "Memory allocated so far %g MB\n", GetMemUseMB());
-	extern MSA *ptrBestMSA;
+	extern MUSCLE_TLS MSA *ptrBestMSA;
 	if (ptrBestMSA == 0)
 		fprintf(stderr, "No alignment generated\n");
 	else
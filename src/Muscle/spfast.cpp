@@ -24,7 +24,7 @@ static const char *GapTypeToStr(int GapType)
 	return "?";
 	}
 
-static SCORE GapScoreMatrix[4][4];
+static MUSCLE_TLS SCORE GapScoreMatrix[4][4];
 
 static void InitGapScoreMatrix()
 	{
@@ -3,7 +3,7 @@
 
 const char *SecsToStr(unsigned long Secs)
 	{
-	static char Str[100]; // [UB] waste some memory to prevent overflow warning
+	static MUSCLE_TLS char Str[100]; // [UB] waste some memory to prevent overflow warning
 	long hh, mm, ss;
 
 	hh = Secs/(60*60);
@@ -27,8 +27,8 @@ const char *ScoreToStr(SCORE Score)
 // times in a printf-like argument list it works OK.
 	const int iBufferCount = 16;
 	const int iBufferLength = 16;
-	static char szStr[iBufferCount*iBufferLength];
-	static int iBufferIndex = 0;
+	static MUSCLE_TLS char szStr[iBufferCount*iBufferLength];
+	static MUSCLE_TLS int iBufferIndex = 0;
 	iBufferIndex = (iBufferIndex + 1)%iBufferCount;
 	char *pStr = szStr + iBufferIndex*iBufferLength;
 	sprintf(pStr, "%8g", Score);
@@ -44,8 +44,8 @@ const char *ScoreToStrL(SCORE Score)
 // times in a printf-like argument list it works OK.
 	const int iBufferCount = 16;
 	const int iBufferLength = 16;
-	static char szStr[iBufferCount*iBufferLength];
-	static int iBufferIndex = 0;
+	static MUSCLE_TLS char szStr[iBufferCount*iBufferLength];
+	static MUSCLE_TLS int iBufferIndex = 0;
 	iBufferIndex = (iBufferIndex + 1)%iBufferCount;
 	char *pStr = szStr + iBufferIndex*iBufferLength;
 	sprintf(pStr, "%.3g", Score);
@@ -0,0 +1,311 @@
+/*
+ * File PackedDistMatrix.h: compact storage for the distance matrices
+ * of the guide-tree builders of ClustalW, ClustalOmega, and MUSCLE
+ *
+ * A packed matrix stores the entries (i, j), i <= j, i < nrows,
+ * j < ncols, of a symmetric matrix (nrows == ncols) or of its upper
+ * part (nrows < ncols, used for seed matrices) in one contiguous block.
+ *
+ * Storage is controlled by two environment variables:
+ *
+ * MSA_DIST_TYPE   "double", "float", or "half". Entries are stored with
+ *                 the least precise of this type and the one requested
+ *                 by the engine, i.e. the variable can only make the
+ *                 matrix smaller. "half" keeps the upper 16 bits of a
+ *                 float (8 bit exponent, 7 bit mantissa, rounded).
+ * MSA_DIST_MAXMB  Largest matrix (in MB) kept in memory. Larger blocks
+ *                 are backed by a deleted temporary file which is
+ *                 memory-mapped, so they are paged out by the operating
+ *                 system instead of exhausting RAM and swap. The file is
+ *                 created in MSA_DIST_TMPDIR, TMPDIR, or /tmp. Unset or
+ *                 0 means no limit. Not available on Windows.
+ *
+ * Everything is defined in this header (static inline functions) so that it
+ * can be used by the C and C++ sources of all three libraries.
+ */
+
+#ifndef _PackedDistMatrix_H_
+
+#define _PackedDistMatrix_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#endif
+
+/* element types, from most to least precise */
+typedef enum {
+    PDM_DOUBLE = 0,
+    PDM_FLOAT = 1,
+    PDM_HALF = 2
+} pdm_type_t;
+
+typedef struct {
+    size_t nrows;
+    size_t ncols;
+    pdm_type_t type;
+    void *data;
+    size_t bytes;
+    int mapped;
+} pdm_t;
+
+static inline pdm_type_t PdmEnvType(pdm_type_t type)
+{
+    const char *s = getenv("MSA_DIST_TYPE");
+    pdm_type_t env = PDM_DOUBLE;
+
+    if (NULL == s)
+        return type;
+    if (0 == strcmp(s, "float"))
+        env = PDM_FLOAT;
+    else if (0 == strcmp(s, "half"))
+        env = PDM_HALF;
+    return env > type ? env : type;
+}
+
+static inline size_t PdmBudget(void)
+{
+    const char *s = getenv("MSA_DIST_MAXMB");
+    double mb;
+
+    if (NULL == s || (mb = atof(s)) <= 0)
+        return (size_t) -1;
+    return (size_t) (mb * 1048576.0);
+}
+
+/*
+ * Allocates a zeroed block of the given size, file-backed if it is
+ * larger than MSA_DIST_MAXMB. Returns NULL if out of memory. Must be
+ * freed with PdmFreeBlock().
+ */
+static inline void *PdmAllocBlock(size_t bytes, int *mapped)
+{
+    *mapped = 0;
+    if (0 == bytes)
+        bytes = 1;
+
+#if !defined(_WIN32)
+    if (bytes > PdmBudget()) {
+        const char *dir = getenv("MSA_DIST_TMPDIR");
+        char path[4096];
+        int fd;
+
+        if (NULL == dir)
+            dir = getenv("TMPDIR");
+        if (NULL == dir)
+            dir = "/tmp";
+        snprintf(path, sizeof(path), "%s/msadistXXXXXX", dir);
+
+        fd = mkstemp(path);
+        if (fd >= 0) {
+            void *p = MAP_FAILED;
+
+            unlink(path);
+            if (0 == ftruncate(fd, (off_t) bytes))
+                p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (MAP_FAILED != p) {
+                *mapped = 1;
+                return p;
+            }
+        }
+        /* no file available: fall back to memory */
+    }
+#endif
+
+    {
+        void *p = calloc(bytes, 1);
+
+#if defined(MADV_HUGEPAGE)
+        /* rows are read with large strides (PdmGetRow()): use huge pages
+           for large blocks to avoid TLB misses */
+        if (NULL != p && bytes >= ((size_t) 4 << 20)) {
+            uintptr_t a = ((uintptr_t) p + 4095) & ~(uintptr_t) 4095;
+
+            madvise((void *) a, ((uintptr_t) p + bytes - a) & ~(uintptr_t) 4095,
+                    MADV_HUGEPAGE);
+        }
+#endif
+        return p;
+    }
+}
+
+static inline void PdmFreeBlock(void *p, size_t bytes, int mapped)
+{
+    if (NULL == p)
+        return;
+#if !defined(_WIN32)
+    if (mapped) {
+        munmap(p, 0 == bytes ? 1 : bytes);
+        return;
+    }
+#endif
+    free(p);
+}
+
+/* number of stored entries of an nrows x ncols matrix */
+static inline size_t PdmEntryCount(size_t nrows, size_t ncols)
+{
+    return nrows * ncols - nrows * (nrows - 1) / 2;
+}
+
+/*
+ * Creates a zeroed matrix. type is the precision the engine needs;
+ * MSA_DIST_TYPE may reduce it. Returns non-zero if out of memory.
+ */
+static inline int PdmNew(pdm_t *m, size_t nrows, size_t ncols, pdm_type_t type)
+{
+    static const size_t size[] = { sizeof(double), sizeof(float), sizeof(uint16_t) };
+
+    m->nrows = nrows;
+    m->ncols = ncols;
+    m->type = PdmEnvType(type);
+    m->bytes = PdmEntryCount(nrows, ncols) * size[m->type];
+    m->data = PdmAllocBlock(m->bytes, &m->mapped);
+    return NULL == m->data ? -1 : 0;
+}
+
+static inline void PdmFree(pdm_t *m)
+{
+    PdmFreeBlock(m->data, m->bytes, m->mapped);
+    m->data = NULL;
+    m->bytes = 0;
+    m->nrows = m->ncols = 0;
+}
+
+static inline size_t PdmIndex(const pdm_t *m, size_t i, size_t j)
+{
+    if (i > j) {
+        size_t t = i;
+        i = j;
+        j = t;
+    }
+    return i * m->ncols - i * (i + 1) / 2 + j;
+}
+
+static inline uint16_t PdmToHalf(float f)
+{
+    uint32_t u;
+
+    memcpy(&u, &f, sizeof(u));
+    u += 0x7fff + ((u >> 16) & 1);
+    return (uint16_t) (u >> 16);
+}
+
+static inline float PdmFromHalf(uint16_t h)
+{
+    uint32_t u = (uint32_t) h << 16;
+    float f;
+
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static inline double PdmGet(const pdm_t *m, size_t i, size_t j)
+{
+    size_t k = PdmIndex(m, i, j);
+
+    switch (m->type) {
+    case PDM_FLOAT:
+        return ((const float *) m->data)[k];
+    case PDM_HALF:
+        return PdmFromHalf(((const uint16_t *) m->data)[k]);
+    default:
+        return ((const double *) m->data)[k];
+    }
+}
+
+static inline void PdmSet(pdm_t *m, size_t i, size_t j, double value)
+{
+    size_t k = PdmIndex(m, i, j);
+
+    switch (m->type) {
+    case PDM_FLOAT:
+        ((float *) m->data)[k] = (float) value;
+        break;
+    case PDM_HALF:
+        ((uint16_t *) m->data)[k] = PdmToHalf((float) value);
+        break;
+    default:
+        ((double *) m->data)[k] = value;
+        break;
+    }
+}
+
+/*
+ * Copies row i of a symmetric matrix (nrows == ncols): row[k] is entry
+ * (i, k), k = 0 .. ncols - 1. Entries k < i are stored in column i of
+ * the rows above (one cache line and often one page each), k >= i are
+ * contiguous.
+ */
+static inline void PdmGetRow(const pdm_t *m, size_t i, double *row)
+{
+    const size_t n = m->ncols;
+    size_t k, idx = i, first = PdmIndex(m, i, i) - i;
+
+    switch (m->type) {
+    case PDM_FLOAT: {
+        const float *d = (const float *) m->data;
+        for (k = 0; k < i; idx += n - ++k)
+            row[k] = d[idx];
+        for (; k < n; k++)
+            row[k] = d[first + k];
+        break;
+    }
+    case PDM_HALF: {
+        const uint16_t *d = (const uint16_t *) m->data;
+        for (k = 0; k < i; idx += n - ++k)
+            row[k] = PdmFromHalf(d[idx]);
+        for (; k < n; k++)
+            row[k] = PdmFromHalf(d[first + k]);
+        break;
+    }
+    default: {
+        const double *d = (const double *) m->data;
+        for (k = 0; k < i; idx += n - ++k)
+            row[k] = d[idx];
+        for (; k < n; k++)
+            row[k] = d[first + k];
+        break;
+    }
+    }
+}
+
+/*
+ * Shrinks a symmetric matrix in place to the rows and columns
+ * keep[0] < keep[1] < ... < keep[count - 1]. Entries only move towards
+ * the start of the block, so no copy is needed. The block itself keeps
+ * its size (PdmFree() works as before).
+ */
+static inline void PdmShrink(pdm_t *m, const size_t *keep, size_t count)
+{
+    size_t r, c, to = 0;
+
+    for (r = 0; r < count; r++) {
+        /* entry (keep[r], j), j >= keep[r], is at from + j */
+        size_t from = keep[r] * m->ncols - keep[r] * (keep[r] + 1) / 2;
+
+        switch (m->type) {
+        case PDM_FLOAT:
+            for (c = r; c < count; c++)
+                ((float *) m->data)[to++] = ((float *) m->data)[from + keep[c]];
+            break;
+        case PDM_HALF:
+            for (c = r; c < count; c++)
+                ((uint16_t *) m->data)[to++] = ((uint16_t *) m->data)[from + keep[c]];
+            break;
+        default:
+            for (c = r; c < count; c++)
+                ((double *) m->data)[to++] = ((double *) m->data)[from + keep[c]];
+            break;
+        }
+    }
+    m->nrows = m->ncols = count;
+}
+
+#endif
@@ -11,6 +11,8 @@
 static const R_CallMethodDef callMethods[] = {
     /* RMuscle.cpp */
     {"RMuscle", (DL_FUNC) &RMuscle, 9},
+    {"RMuscleBatch", (DL_FUNC) &RMuscleBatch, 9},
+    {"RMuscleAddSeqs", (DL_FUNC) &RMuscleAddSeqs, 8},
     /* RClustalW.cpp */
     {"RClustalW", (DL_FUNC) &RClustalW, 9},
     /* RClustalOmega.cpp */
@@ -0,0 +1,82 @@
+/*
+ * File ScoreTableCache.h: process-wide cache of prepared substitution-score
+ * tables, shared by ClustalW and MUSCLE
+ *
+ * The engines prepare their scoring tables in every alignment (ClustalW:
+ * selection of a matrix of the series by percent identity, cross
+ * references of the residue codes, scaling, shift to positive scores;
+ * MUSCLE: translation of a matrix passed from R to its letter order),
+ * although the result only depends on a handful of settings. The caller
+ * encodes these settings in a key (a byte string starting with the name
+ * of the engine) and gets a table that is built only once per process.
+ *
+ * A table is never changed or freed after it has been built, so the
+ * returned pointer can be used by any thread without locking, also after
+ * the alignment which built the table has finished. The number of tables
+ * is limited (a long R session could pass many different user matrices);
+ * if the cache is full, ScoreTableGet() returns NULL and the caller
+ * builds the table on its own as before.
+ *
+ * Everything is defined in this header (inline functions, whose static
+ * objects exist once in the package library). It is C++ only and not
+ * used by ClustalOmega.
+ */
+
+#ifndef _ScoreTableCache_H_
+
+#define _ScoreTableCache_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#define SCORE_TABLE_CACHE_MAX 256
+
+inline std::mutex &ScoreTableMutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+inline std::map<std::string, std::shared_ptr<const void> > &ScoreTables()
+{
+    static std::map<std::string, std::shared_ptr<const void> > tables;
+    return tables;
+}
+
+/*
+ * Appends the bytes of value to key.
+ */
+template <typename T>
+inline void ScoreTableKey(std::string &key, const T &value)
+{
+    key.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/*
+ * Returns the table stored under key. If there is none, a table is
+ * default-constructed, filled by build(table) and stored. build() is
+ * called with the cache locked, so every table is built only once; if it
+ * throws, nothing is stored. Returns NULL if the cache is full.
+ */
+template <typename T, typename Build>
+inline const T *ScoreTableGet(const std::string &key, Build build)
+{
+    std::lock_guard<std::mutex> lock(ScoreTableMutex());
+    std::map<std::string, std::shared_ptr<const void> > &tables = ScoreTables();
+
+    std::map<std::string, std::shared_ptr<const void> >::const_iterator it =
+        tables.find(key);
+    if (it != tables.end())
+        return static_cast<const T *>(it->second.get());
+    if (tables.size() >= SCORE_TABLE_CACHE_MAX)
+        return NULL;
+
+    std::shared_ptr<T> table = std::make_shared<T>();
+    build(*table);
+    tables[key] = table;
+    return table.get();
+}
+
+#endif
@@ -1,26 +1,50 @@
-#include <Rcpp.h>
-
-using namespace Rcpp;
-using namespace std;
+#include <R.h>
+#include <Rinternals.h>
 
 #include "SplitCharVector2List.h"
 
-RcppExport SEXP SplitCharVector2List(SEXP xR)
+/*
+ * Splits the strings of the character vector xR into single characters
+ * and returns a list of character vectors, one per string. There is one
+ * CHARSXP per byte value, which is shared by all elements holding that
+ * character.
+ */
+SEXP SplitCharVector2List(SEXP xR)
 {
-    vector<string> x = as< vector<string> >(xR);
-    int i, j, n = x.size();
-    List out;
+    R_xlen_t i, n = XLENGTH(xR);
+    int j, len;
+    SEXP out, chars;
+
+    if (!isString(xR))
+	error("SplitCharVector2List: invalid argument");
+
+    PROTECT(chars = allocVector(STRSXP, 256));
+    PROTECT(out = allocVector(VECSXP, n));
 
     for (i = 0; i < n; i++)
     {
-	int len = x[i].length();
-	vector<string> tmp;
-	
+	const unsigned char *s = (const unsigned char *) CHAR(STRING_ELT(xR, i));
+	SEXP tmp;
+
+	len = LENGTH(STRING_ELT(xR, i));
+	tmp = allocVector(STRSXP, len);
+	SET_VECTOR_ELT(out, i, tmp);
+
 	for (j = 0; j < len; j++)
-	    tmp.push_back(x[i].substr(j, 1));
+	{
+	    SEXP c = STRING_ELT(chars, s[j]);
+
+	    if (c == R_BlankString)
+	    {
+		c = mkCharLen((const char *) (s + j), 1);
+		SET_STRING_ELT(chars, s[j], c);
+	    }
 
-	out.push_back(tmp);
+	    SET_STRING_ELT(tmp, j, c);
+	}
     }
 
+    UNPROTECT(2);
+
     return(out);
 }
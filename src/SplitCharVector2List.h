@@ -6,6 +6,6 @@
 
 #define _SplitCharVector2List_H_
 
-RcppExport SEXP SplitCharVector2List(SEXP xR);
+extern "C" SEXP SplitCharVector2List(SEXP xR);
 
 #endif
@@ -1,31 +1,64 @@
-#include <Rcpp.h>
-
-using namespace Rcpp;
-using namespace std;
+#include <R.h>
+#include <Rinternals.h>
 
 #include "SplitCharVector2Matrix.h"
 
-RcppExport SEXP SplitCharVector2Matrix(SEXP xR, SEXP replR)
+/*
+ * Splits the strings of the character vector xR into single characters
+ * and returns them as a character matrix with one row per string; '-'
+ * is replaced by the first string of replR. Rows shorter than the longest
+ * string are filled with "". There is one CHARSXP per byte value, which
+ * is shared by all cells holding that character.
+ */
+SEXP SplitCharVector2Matrix(SEXP xR, SEXP replR)
 {
-    vector<string> x = as< vector<string> >(xR);
-    string repl = as< string >(replR);
-    int i, j, n = x.size(), m = x[0].length();
-    CharacterMatrix out(n, m);
+    R_xlen_t i, n = XLENGTH(xR);
+    int j, len, m = 0;
+    SEXP out, chars, repl;
+
+    if (!isString(xR) || !isString(replR) || XLENGTH(replR) < 1)
+	error("SplitCharVector2Matrix: invalid arguments");
+
+    for (i = 0; i < n; i++)
+    {
+	len = LENGTH(STRING_ELT(xR, i));
+
+	if (len > m)
+	    m = len;
+    }
+
+    PROTECT(chars = allocVector(STRSXP, 256));
+    repl = STRING_ELT(replR, 0);
+    PROTECT(out = allocMatrix(STRSXP, n, m));
 
     for (i = 0; i < n; i++)
     {
-	m = x[i].length();
-	
-	for (j = 0; j < m; j++)
+	const unsigned char *s = (const unsigned char *) CHAR(STRING_ELT(xR, i));
+	len = LENGTH(STRING_ELT(xR, i));
+
+	for (j = 0; j < len; j++)
 	{
-	    string tmp = x[i].substr(j, 1);
+	    SEXP c = repl;
 
-	    if (tmp.compare("-") == 0)
-		tmp = repl;
+	    if (s[j] != '-')
+	    {
+		c = STRING_ELT(chars, s[j]);
 
-	    out(i, j) = tmp;
+		if (c == R_BlankString)
+		{
+		    c = mkCharLen((const char *) (s + j), 1);
+		    SET_STRING_ELT(chars, s[j], c);
+		}
+	    }
+
+	    SET_STRING_ELT(out, i + (R_xlen_t) j * n, c);
 	}
+
+	for (; j < m; j++)
+	    SET_STRING_ELT(out, i + (R_xlen_t) j * n, R_BlankString);
     }
 
+    UNPROTECT(2);
+
     return(out);
 }
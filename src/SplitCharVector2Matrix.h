@@ -6,6 +6,6 @@
 
 #define _SplitCharVector2Matrix_H_
 
-RcppExport SEXP SplitCharVector2Matrix(SEXP xR, SEXP replR);
+extern "C" SEXP SplitCharVector2Matrix(SEXP xR, SEXP replR);
 
 #endif
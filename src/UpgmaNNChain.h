@@ -0,0 +1,351 @@
+/*
+ * File UpgmaNNChain.h: UPGMA-type clustering with the nearest-neighbor
+ * chain algorithm, used for the guide trees of ClustalW, ClustalOmega,
+ * and MUSCLE
+ *
+ * The chain starts at an arbitrary cluster and is extended by the nearest
+ * neighbor of its last element until two clusters are nearest neighbors of
+ * each other; these two are joined. For linkages which satisfy
+ * d(i+j, k) >= min(d(i, k), d(j, k)) (all linkages below do), the rest of
+ * the chain stays valid after a join, and the tree is the same as the one
+ * obtained by always joining the globally closest pair, although the joins
+ * are found in a different order. Every join costs O(N), so the total
+ * running time is O(N^2) and no search for the global minimum is needed.
+ *
+ * The nearest neighbor of every cluster is cached. A join only invalidates
+ * the cache of the clusters whose nearest neighbor was one of the joined
+ * clusters, so most rows are scanned only once.
+ *
+ * Pairs of clusters are ordered by distance, then by the higher and the
+ * lower of their two rows, like in the greedy algorithms which scan the
+ * rows in this order. As this is a strict order, the chain cannot run into
+ * a cycle if there are ties, and the nearest neighbor of a row is the
+ * lowest row at the smallest distance. In the end, the joins are sorted in
+ * the same way, so callers see them in the order of the greedy algorithm.
+ *
+ * Everything is defined in this header (static inline functions) so that it
+ * can be used by the C and C++ sources of all three libraries.
+ */
+
+#ifndef _UpgmaNNChain_H_
+
+#define _UpgmaNNChain_H_
+
+#include "PackedDistMatrix.h"
+
+typedef enum {
+    NNC_AVG = 0,   /* (d1 + d2) / 2 (WPGMA, "average" of MUSCLE) */
+    NNC_UPGMA = 1, /* average weighted by the cluster sizes (ClustalW) */
+    NNC_MIN = 2,   /* single linkage */
+    NNC_MAX = 3,   /* complete linkage */
+    NNC_BIASED = 4 /* bias * NNC_AVG + (1 - bias) * NNC_MIN (MUSCLE) */
+} nnc_linkage_t;
+
+/*
+ * One join. Nodes are numbered 0 .. n-1 for the leaves (rows of the
+ * matrix) and n + k for the cluster created by join k, so children
+ * always come before their parent and the last join is the root. Joins
+ * are ordered by distance.
+ * left is the cluster containing the lower leaf.
+ */
+typedef struct {
+    size_t left;
+    size_t right;
+    double dist;  /* distance of left and right; the height of the node is dist / 2 */
+} nnc_join_t;
+
+#define NNC_NONE ((size_t) -1)
+
+typedef struct {
+    double key;
+    size_t tie;
+    size_t index;
+    nnc_join_t join;
+} nnc_order_t;
+
+static inline int NncCompareOrder(const void *a, const void *b)
+{
+    const nnc_order_t *x = (const nnc_order_t *) a;
+    const nnc_order_t *y = (const nnc_order_t *) b;
+
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    if (x->tie != y->tie)
+        return x->tie < y->tie ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index ? 1 : 0);
+}
+
+/*
+ * Sorts the joins into the order in which the greedy algorithm finds them
+ * and renumbers the clusters accordingly: by distance, then by the first
+ * leaf of the right cluster (the greedy algorithms scan the rows in this
+ * order). The key of a join is at least that of its children (this only
+ * matters if rounding made the distances non-monotonic). If the tie rule
+ * would put a parent before a child (only possible if there are ties in
+ * the topology as well), equal distances are left in the order of the
+ * chain. buf must have room for 2 * n entries. Returns -1 if out of memory.
+ */
+static inline int NncSortJoins(nnc_join_t *joins, size_t n, size_t *buf)
+{
+    nnc_order_t *order = (nnc_order_t *) malloc((n - 1) * sizeof(nnc_order_t));
+    size_t k;
+
+    if (NULL == order)
+        return -1;
+    /* buf[node] is the first leaf of the node (the left one contains it) */
+    for (k = 0; k < n; k++)
+        buf[k] = k;
+    for (k = 0; k < n - 1; k++) {
+        double key = joins[k].dist;
+
+        if (joins[k].left >= n && order[joins[k].left - n].key > key)
+            key = order[joins[k].left - n].key;
+        if (joins[k].right >= n && order[joins[k].right - n].key > key)
+            key = order[joins[k].right - n].key;
+        order[k].key = key;
+        order[k].tie = buf[joins[k].right];
+        order[k].index = k;
+        order[k].join = joins[k];
+        buf[n + k] = buf[joins[k].left];
+    }
+    qsort(order, n - 1, sizeof(nnc_order_t), NncCompareOrder);
+
+    /* buf[node] is the new number of the node */
+    for (k = 0; k < n; k++)
+        buf[k] = k;
+    for (k = 0; k < n - 1; k++)
+        buf[n + order[k].index] = n + k;
+    for (k = 0; k < n - 1; k++) {
+        if ((order[k].join.left >= n && buf[order[k].join.left] >= n + k)
+            || (order[k].join.right >= n && buf[order[k].join.right] >= n + k))
+            break;
+    }
+    if (k < n - 1) {
+        for (k = 0; k < n - 1; k++)
+            order[k].tie = 0;
+        qsort(order, n - 1, sizeof(nnc_order_t), NncCompareOrder);
+        for (k = 0; k < n - 1; k++)
+            buf[n + order[k].index] = n + k;
+    }
+
+    for (k = 0; k < n - 1; k++) {
+        joins[k] = order[k].join;
+        joins[k].left = buf[joins[k].left];
+        joins[k].right = buf[joins[k].right];
+    }
+    free(order);
+    return 0;
+}
+
+static inline double NncLinkage(nnc_linkage_t linkage, double bias,
+                                double d1, size_t n1, double d2, size_t n2)
+{
+    double dmin = d1 < d2 ? d1 : d2;
+
+    switch (linkage) {
+    case NNC_UPGMA:
+        return (d1 * n1 + d2 * n2) / (n1 + n2);
+    case NNC_MIN:
+        return dmin;
+    case NNC_MAX:
+        return d1 > d2 ? d1 : d2;
+    case NNC_BIASED:
+        return bias * ((d1 + d2) / 2) + (1 - bias) * dmin;
+    default:
+        return (d1 + d2) / 2;
+    }
+}
+
+/*
+ * Clusters the nrows objects of the symmetric matrix m; m is overwritten
+ * (joined rows are dropped from time to time, so that the matrix which is
+ * scanned shrinks with the number of clusters). joins must have room for
+ * nrows - 1 entries. bias is only used for NNC_BIASED. Returns 0, or -1
+ * if out of memory.
+ */
+static inline int NncCluster(pdm_t *m, nnc_linkage_t linkage, double bias,
+                             nnc_join_t *joins)
+{
+    const size_t n = m->nrows;
+    size_t *node, *size, *nn, *chain, *keep, *rowTo;
+    double *nnDist, *row;
+    char *inChain;
+    size_t i, k, rows = n, chainLen = 0, first = 0, join;
+    int status;
+
+    if (n < 2)
+        return 0;
+
+    node = (size_t *) malloc(6 * n * sizeof(size_t));
+    nnDist = (double *) malloc(2 * n * sizeof(double));
+    inChain = (char *) calloc(n, 1);
+    if (NULL == node || NULL == nnDist || NULL == inChain) {
+        free(node);
+        free(nnDist);
+        free(inChain);
+        return -1;
+    }
+    size = node + n;
+    nn = size + n;
+    chain = nn + n;
+    keep = chain + n;
+    rowTo = keep + n;
+    row = nnDist + n;
+
+    /* node[i] is the node in row i, NNC_NONE once the row is joined */
+    for (i = 0; i < n; i++) {
+        node[i] = i;
+        size[i] = 1;
+        nn[i] = NNC_NONE;
+    }
+    /* initial nearest neighbors in one pass through the matrix */
+    for (i = 0; i < n; i++) {
+        for (k = i + 1; k < n; k++) {
+            double d = PdmGet(m, i, k);
+
+            if (NNC_NONE == nn[i] || d < nnDist[i]) {
+                nn[i] = k;
+                nnDist[i] = d;
+            }
+            if (NNC_NONE == nn[k] || d < nnDist[k]) {
+                nn[k] = i;
+                nnDist[k] = d;
+            }
+        }
+    }
+
+    for (join = 0; join < n - 1; join++) {
+        size_t a, b, prev, i1, i2, n1, n2, kmin, left = n - 1 - join;
+        double d, dmin;
+
+        for (;;) {
+            if (0 == chainLen) {
+                while (NNC_NONE == node[first])
+                    first++;
+                chain[chainLen++] = first;
+                inChain[first] = 1;
+            }
+            a = chain[chainLen - 1];
+            prev = chainLen > 1 ? chain[chainLen - 2] : NNC_NONE;
+
+            if (NNC_NONE == nn[a]) {
+                size_t kmin = NNC_NONE;
+
+                dmin = 0;
+                PdmGetRow(m, a, row);
+                for (k = 0; k < rows; k++) {
+                    if (k != a && NNC_NONE != node[k]
+                        && (NNC_NONE == kmin || row[k] < dmin)) {
+                        kmin = k;
+                        dmin = row[k];
+                    }
+                }
+                nn[a] = kmin;
+                nnDist[a] = dmin;
+            }
+            b = nn[a];
+            d = nnDist[a];
+            if (NNC_NONE != prev && b != prev) {
+                double dprev = PdmGet(m, a, prev);
+
+                if (dprev < d || (dprev == d && prev < b)) {
+                    b = prev;
+                    d = dprev;
+                }
+            }
+
+            if (b == prev)
+                break;
+            if (inChain[b]) {
+                /* only possible with ties or rounding: start again from a */
+                while (chainLen > 0)
+                    inChain[chain[--chainLen]] = 0;
+                chain[chainLen++] = a;
+                inChain[a] = 1;
+            }
+            chain[chainLen++] = b;
+            inChain[b] = 1;
+        }
+
+        /* join a and b; the cluster is kept in the lower row */
+        chainLen -= 2;
+        inChain[a] = inChain[b] = 0;
+        i1 = a < b ? a : b;
+        i2 = a < b ? b : a;
+        joins[join].left = node[i1];
+        joins[join].right = node[i2];
+        joins[join].dist = d;
+
+        node[i1] = n + join;
+        node[i2] = NNC_NONE;
+        n1 = size[i1];
+        n2 = size[i2];
+        size[i1] = n1 + n2;
+        kmin = NNC_NONE;
+        dmin = 0;
+        for (k = 0; k < rows; k++) {
+            if (NNC_NONE == node[k] || k == i1)
+                continue;
+            /* in place: the entries of a row are far apart (see PdmGetRow()) */
+            d = NncLinkage(linkage, bias, PdmGet(m, i1, k), n1, PdmGet(m, i2, k), n2);
+            PdmSet(m, i1, k, d);
+            if (NNC_NONE == kmin || d < dmin) {
+                kmin = k;
+                dmin = d;
+            }
+            if (nn[k] == i1 || nn[k] == i2) {
+                if (d <= nnDist[k]) {
+                    nn[k] = i1;
+                    nnDist[k] = d;
+                } else {
+                    nn[k] = NNC_NONE;
+                }
+            } else if (NNC_NONE != nn[k]
+                       && (d < nnDist[k] || (d == nnDist[k] && i1 < nn[k]))) {
+                nn[k] = i1;
+                nnDist[k] = d;
+            }
+        }
+        nn[i1] = kmin;
+        nnDist[i1] = dmin;
+
+        /*
+         * Drop the joined rows once they are half of the matrix. The order
+         * of the rows is kept, so the ties are resolved as before.
+         */
+        if (left >= 64 && 2 * left <= rows) {
+            size_t count = 0;
+
+            for (k = 0; k < rows; k++) {
+                if (NNC_NONE != node[k]) {
+                    keep[count] = k;
+                    rowTo[k] = count;
+                    count++;
+                }
+            }
+            PdmShrink(m, keep, count);
+            for (k = 0; k < count; k++) {
+                i = keep[k];
+                node[k] = node[i];
+                size[k] = size[i];
+                nn[k] = NNC_NONE == nn[i] ? NNC_NONE : rowTo[nn[i]];
+                nnDist[k] = nnDist[i];
+            }
+            for (k = 0; k < chainLen; k++)
+                chain[k] = rowTo[chain[k]];
+            memset(inChain, 0, rows);
+            for (k = 0; k < chainLen; k++)
+                inChain[chain[k]] = 1;
+            rows = count;
+            first = 0;
+        }
+    }
+
+    free(nnDist);
+    free(inChain);
+    status = NncSortJoins(joins, n, node);
+    free(node);
+    return status;
+}
+
+#endif